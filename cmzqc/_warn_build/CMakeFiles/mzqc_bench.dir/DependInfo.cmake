@@ -0,0 +1,44 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/cmzqc/src/mzqc.cpp" "CMakeFiles/mzqc_bench.dir/src/mzqc.cpp.o" "gcc" "CMakeFiles/mzqc_bench.dir/src/mzqc.cpp.o.d"
+  "/root/repo/cmzqc/src/mzqc_aggregate.cpp" "CMakeFiles/mzqc_bench.dir/src/mzqc_aggregate.cpp.o" "gcc" "CMakeFiles/mzqc_bench.dir/src/mzqc_aggregate.cpp.o.d"
+  "/root/repo/cmzqc/src/mzqc_async.cpp" "CMakeFiles/mzqc_bench.dir/src/mzqc_async.cpp.o" "gcc" "CMakeFiles/mzqc_bench.dir/src/mzqc_async.cpp.o.d"
+  "/root/repo/cmzqc/src/mzqc_binary.cpp" "CMakeFiles/mzqc_bench.dir/src/mzqc_binary.cpp.o" "gcc" "CMakeFiles/mzqc_bench.dir/src/mzqc_binary.cpp.o.d"
+  "/root/repo/cmzqc/src/mzqc_compress.cpp" "CMakeFiles/mzqc_bench.dir/src/mzqc_compress.cpp.o" "gcc" "CMakeFiles/mzqc_bench.dir/src/mzqc_compress.cpp.o.d"
+  "/root/repo/cmzqc/src/mzqc_csv.cpp" "CMakeFiles/mzqc_bench.dir/src/mzqc_csv.cpp.o" "gcc" "CMakeFiles/mzqc_bench.dir/src/mzqc_csv.cpp.o.d"
+  "/root/repo/cmzqc/src/mzqc_document.cpp" "CMakeFiles/mzqc_bench.dir/src/mzqc_document.cpp.o" "gcc" "CMakeFiles/mzqc_bench.dir/src/mzqc_document.cpp.o.d"
+  "/root/repo/cmzqc/src/mzqc_index.cpp" "CMakeFiles/mzqc_bench.dir/src/mzqc_index.cpp.o" "gcc" "CMakeFiles/mzqc_bench.dir/src/mzqc_index.cpp.o.d"
+  "/root/repo/cmzqc/src/mzqc_intern.cpp" "CMakeFiles/mzqc_bench.dir/src/mzqc_intern.cpp.o" "gcc" "CMakeFiles/mzqc_bench.dir/src/mzqc_intern.cpp.o.d"
+  "/root/repo/cmzqc/src/mzqc_layout.cpp" "CMakeFiles/mzqc_bench.dir/src/mzqc_layout.cpp.o" "gcc" "CMakeFiles/mzqc_bench.dir/src/mzqc_layout.cpp.o.d"
+  "/root/repo/cmzqc/src/mzqc_mapped.cpp" "CMakeFiles/mzqc_bench.dir/src/mzqc_mapped.cpp.o" "gcc" "CMakeFiles/mzqc_bench.dir/src/mzqc_mapped.cpp.o.d"
+  "/root/repo/cmzqc/src/mzqc_merge.cpp" "CMakeFiles/mzqc_bench.dir/src/mzqc_merge.cpp.o" "gcc" "CMakeFiles/mzqc_bench.dir/src/mzqc_merge.cpp.o.d"
+  "/root/repo/cmzqc/src/mzqc_metrics.cpp" "CMakeFiles/mzqc_bench.dir/src/mzqc_metrics.cpp.o" "gcc" "CMakeFiles/mzqc_bench.dir/src/mzqc_metrics.cpp.o.d"
+  "/root/repo/cmzqc/src/mzqc_mmap.cpp" "CMakeFiles/mzqc_bench.dir/src/mzqc_mmap.cpp.o" "gcc" "CMakeFiles/mzqc_bench.dir/src/mzqc_mmap.cpp.o.d"
+  "/root/repo/cmzqc/src/mzqc_numbers.cpp" "CMakeFiles/mzqc_bench.dir/src/mzqc_numbers.cpp.o" "gcc" "CMakeFiles/mzqc_bench.dir/src/mzqc_numbers.cpp.o.d"
+  "/root/repo/cmzqc/src/mzqc_obo.cpp" "CMakeFiles/mzqc_bench.dir/src/mzqc_obo.cpp.o" "gcc" "CMakeFiles/mzqc_bench.dir/src/mzqc_obo.cpp.o.d"
+  "/root/repo/cmzqc/src/mzqc_parallel.cpp" "CMakeFiles/mzqc_bench.dir/src/mzqc_parallel.cpp.o" "gcc" "CMakeFiles/mzqc_bench.dir/src/mzqc_parallel.cpp.o.d"
+  "/root/repo/cmzqc/src/mzqc_schema.cpp" "CMakeFiles/mzqc_bench.dir/src/mzqc_schema.cpp.o" "gcc" "CMakeFiles/mzqc_bench.dir/src/mzqc_schema.cpp.o.d"
+  "/root/repo/cmzqc/src/mzqc_sketch.cpp" "CMakeFiles/mzqc_bench.dir/src/mzqc_sketch.cpp.o" "gcc" "CMakeFiles/mzqc_bench.dir/src/mzqc_sketch.cpp.o.d"
+  "/root/repo/cmzqc/src/mzqc_stats.cpp" "CMakeFiles/mzqc_bench.dir/src/mzqc_stats.cpp.o" "gcc" "CMakeFiles/mzqc_bench.dir/src/mzqc_stats.cpp.o.d"
+  "/root/repo/cmzqc/src/mzqc_store.cpp" "CMakeFiles/mzqc_bench.dir/src/mzqc_store.cpp.o" "gcc" "CMakeFiles/mzqc_bench.dir/src/mzqc_store.cpp.o.d"
+  "/root/repo/cmzqc/src/mzqc_stream.cpp" "CMakeFiles/mzqc_bench.dir/src/mzqc_stream.cpp.o" "gcc" "CMakeFiles/mzqc_bench.dir/src/mzqc_stream.cpp.o.d"
+  "/root/repo/cmzqc/src/mzqc_update.cpp" "CMakeFiles/mzqc_bench.dir/src/mzqc_update.cpp.o" "gcc" "CMakeFiles/mzqc_bench.dir/src/mzqc_update.cpp.o.d"
+  "/root/repo/cmzqc/src/mzqc_value.cpp" "CMakeFiles/mzqc_bench.dir/src/mzqc_value.cpp.o" "gcc" "CMakeFiles/mzqc_bench.dir/src/mzqc_value.cpp.o.d"
+  "/root/repo/cmzqc/src/mzqc_writer.cpp" "CMakeFiles/mzqc_bench.dir/src/mzqc_writer.cpp.o" "gcc" "CMakeFiles/mzqc_bench.dir/src/mzqc_writer.cpp.o.d"
+  "/root/repo/cmzqc/test/mzqc_bench.cpp" "CMakeFiles/mzqc_bench.dir/test/mzqc_bench.cpp.o" "gcc" "CMakeFiles/mzqc_bench.dir/test/mzqc_bench.cpp.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
@@ -0,0 +1,61 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/mzqc_bench.dir/src/mzqc.cpp.o"
+  "CMakeFiles/mzqc_bench.dir/src/mzqc.cpp.o.d"
+  "CMakeFiles/mzqc_bench.dir/src/mzqc_aggregate.cpp.o"
+  "CMakeFiles/mzqc_bench.dir/src/mzqc_aggregate.cpp.o.d"
+  "CMakeFiles/mzqc_bench.dir/src/mzqc_async.cpp.o"
+  "CMakeFiles/mzqc_bench.dir/src/mzqc_async.cpp.o.d"
+  "CMakeFiles/mzqc_bench.dir/src/mzqc_binary.cpp.o"
+  "CMakeFiles/mzqc_bench.dir/src/mzqc_binary.cpp.o.d"
+  "CMakeFiles/mzqc_bench.dir/src/mzqc_compress.cpp.o"
+  "CMakeFiles/mzqc_bench.dir/src/mzqc_compress.cpp.o.d"
+  "CMakeFiles/mzqc_bench.dir/src/mzqc_csv.cpp.o"
+  "CMakeFiles/mzqc_bench.dir/src/mzqc_csv.cpp.o.d"
+  "CMakeFiles/mzqc_bench.dir/src/mzqc_document.cpp.o"
+  "CMakeFiles/mzqc_bench.dir/src/mzqc_document.cpp.o.d"
+  "CMakeFiles/mzqc_bench.dir/src/mzqc_index.cpp.o"
+  "CMakeFiles/mzqc_bench.dir/src/mzqc_index.cpp.o.d"
+  "CMakeFiles/mzqc_bench.dir/src/mzqc_intern.cpp.o"
+  "CMakeFiles/mzqc_bench.dir/src/mzqc_intern.cpp.o.d"
+  "CMakeFiles/mzqc_bench.dir/src/mzqc_layout.cpp.o"
+  "CMakeFiles/mzqc_bench.dir/src/mzqc_layout.cpp.o.d"
+  "CMakeFiles/mzqc_bench.dir/src/mzqc_mapped.cpp.o"
+  "CMakeFiles/mzqc_bench.dir/src/mzqc_mapped.cpp.o.d"
+  "CMakeFiles/mzqc_bench.dir/src/mzqc_merge.cpp.o"
+  "CMakeFiles/mzqc_bench.dir/src/mzqc_merge.cpp.o.d"
+  "CMakeFiles/mzqc_bench.dir/src/mzqc_metrics.cpp.o"
+  "CMakeFiles/mzqc_bench.dir/src/mzqc_metrics.cpp.o.d"
+  "CMakeFiles/mzqc_bench.dir/src/mzqc_mmap.cpp.o"
+  "CMakeFiles/mzqc_bench.dir/src/mzqc_mmap.cpp.o.d"
+  "CMakeFiles/mzqc_bench.dir/src/mzqc_numbers.cpp.o"
+  "CMakeFiles/mzqc_bench.dir/src/mzqc_numbers.cpp.o.d"
+  "CMakeFiles/mzqc_bench.dir/src/mzqc_obo.cpp.o"
+  "CMakeFiles/mzqc_bench.dir/src/mzqc_obo.cpp.o.d"
+  "CMakeFiles/mzqc_bench.dir/src/mzqc_parallel.cpp.o"
+  "CMakeFiles/mzqc_bench.dir/src/mzqc_parallel.cpp.o.d"
+  "CMakeFiles/mzqc_bench.dir/src/mzqc_schema.cpp.o"
+  "CMakeFiles/mzqc_bench.dir/src/mzqc_schema.cpp.o.d"
+  "CMakeFiles/mzqc_bench.dir/src/mzqc_sketch.cpp.o"
+  "CMakeFiles/mzqc_bench.dir/src/mzqc_sketch.cpp.o.d"
+  "CMakeFiles/mzqc_bench.dir/src/mzqc_stats.cpp.o"
+  "CMakeFiles/mzqc_bench.dir/src/mzqc_stats.cpp.o.d"
+  "CMakeFiles/mzqc_bench.dir/src/mzqc_store.cpp.o"
+  "CMakeFiles/mzqc_bench.dir/src/mzqc_store.cpp.o.d"
+  "CMakeFiles/mzqc_bench.dir/src/mzqc_stream.cpp.o"
+  "CMakeFiles/mzqc_bench.dir/src/mzqc_stream.cpp.o.d"
+  "CMakeFiles/mzqc_bench.dir/src/mzqc_update.cpp.o"
+  "CMakeFiles/mzqc_bench.dir/src/mzqc_update.cpp.o.d"
+  "CMakeFiles/mzqc_bench.dir/src/mzqc_value.cpp.o"
+  "CMakeFiles/mzqc_bench.dir/src/mzqc_value.cpp.o.d"
+  "CMakeFiles/mzqc_bench.dir/src/mzqc_writer.cpp.o"
+  "CMakeFiles/mzqc_bench.dir/src/mzqc_writer.cpp.o.d"
+  "CMakeFiles/mzqc_bench.dir/test/mzqc_bench.cpp.o"
+  "CMakeFiles/mzqc_bench.dir/test/mzqc_bench.cpp.o.d"
+  "mzqc_bench"
+  "mzqc_bench.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/mzqc_bench.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,9 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/mzqc_cv_terms"
+  "generated/mzqc_cv_terms.inc"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang )
+  include(CMakeFiles/mzqc_cv_terms.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/mzqc_cvgen.dir/tools/mzqc_cvgen.cpp.o"
+  "CMakeFiles/mzqc_cvgen.dir/tools/mzqc_cvgen.cpp.o.d"
+  "mzqc_cvgen"
+  "mzqc_cvgen.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/mzqc_cvgen.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
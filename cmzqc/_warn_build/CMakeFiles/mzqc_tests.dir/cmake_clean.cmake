@@ -0,0 +1,111 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/mzqc_tests.dir/src/mzqc.cpp.o"
+  "CMakeFiles/mzqc_tests.dir/src/mzqc.cpp.o.d"
+  "CMakeFiles/mzqc_tests.dir/src/mzqc_aggregate.cpp.o"
+  "CMakeFiles/mzqc_tests.dir/src/mzqc_aggregate.cpp.o.d"
+  "CMakeFiles/mzqc_tests.dir/src/mzqc_async.cpp.o"
+  "CMakeFiles/mzqc_tests.dir/src/mzqc_async.cpp.o.d"
+  "CMakeFiles/mzqc_tests.dir/src/mzqc_binary.cpp.o"
+  "CMakeFiles/mzqc_tests.dir/src/mzqc_binary.cpp.o.d"
+  "CMakeFiles/mzqc_tests.dir/src/mzqc_compress.cpp.o"
+  "CMakeFiles/mzqc_tests.dir/src/mzqc_compress.cpp.o.d"
+  "CMakeFiles/mzqc_tests.dir/src/mzqc_csv.cpp.o"
+  "CMakeFiles/mzqc_tests.dir/src/mzqc_csv.cpp.o.d"
+  "CMakeFiles/mzqc_tests.dir/src/mzqc_document.cpp.o"
+  "CMakeFiles/mzqc_tests.dir/src/mzqc_document.cpp.o.d"
+  "CMakeFiles/mzqc_tests.dir/src/mzqc_index.cpp.o"
+  "CMakeFiles/mzqc_tests.dir/src/mzqc_index.cpp.o.d"
+  "CMakeFiles/mzqc_tests.dir/src/mzqc_intern.cpp.o"
+  "CMakeFiles/mzqc_tests.dir/src/mzqc_intern.cpp.o.d"
+  "CMakeFiles/mzqc_tests.dir/src/mzqc_layout.cpp.o"
+  "CMakeFiles/mzqc_tests.dir/src/mzqc_layout.cpp.o.d"
+  "CMakeFiles/mzqc_tests.dir/src/mzqc_mapped.cpp.o"
+  "CMakeFiles/mzqc_tests.dir/src/mzqc_mapped.cpp.o.d"
+  "CMakeFiles/mzqc_tests.dir/src/mzqc_merge.cpp.o"
+  "CMakeFiles/mzqc_tests.dir/src/mzqc_merge.cpp.o.d"
+  "CMakeFiles/mzqc_tests.dir/src/mzqc_metrics.cpp.o"
+  "CMakeFiles/mzqc_tests.dir/src/mzqc_metrics.cpp.o.d"
+  "CMakeFiles/mzqc_tests.dir/src/mzqc_mmap.cpp.o"
+  "CMakeFiles/mzqc_tests.dir/src/mzqc_mmap.cpp.o.d"
+  "CMakeFiles/mzqc_tests.dir/src/mzqc_numbers.cpp.o"
+  "CMakeFiles/mzqc_tests.dir/src/mzqc_numbers.cpp.o.d"
+  "CMakeFiles/mzqc_tests.dir/src/mzqc_obo.cpp.o"
+  "CMakeFiles/mzqc_tests.dir/src/mzqc_obo.cpp.o.d"
+  "CMakeFiles/mzqc_tests.dir/src/mzqc_parallel.cpp.o"
+  "CMakeFiles/mzqc_tests.dir/src/mzqc_parallel.cpp.o.d"
+  "CMakeFiles/mzqc_tests.dir/src/mzqc_schema.cpp.o"
+  "CMakeFiles/mzqc_tests.dir/src/mzqc_schema.cpp.o.d"
+  "CMakeFiles/mzqc_tests.dir/src/mzqc_sketch.cpp.o"
+  "CMakeFiles/mzqc_tests.dir/src/mzqc_sketch.cpp.o.d"
+  "CMakeFiles/mzqc_tests.dir/src/mzqc_stats.cpp.o"
+  "CMakeFiles/mzqc_tests.dir/src/mzqc_stats.cpp.o.d"
+  "CMakeFiles/mzqc_tests.dir/src/mzqc_store.cpp.o"
+  "CMakeFiles/mzqc_tests.dir/src/mzqc_store.cpp.o.d"
+  "CMakeFiles/mzqc_tests.dir/src/mzqc_stream.cpp.o"
+  "CMakeFiles/mzqc_tests.dir/src/mzqc_stream.cpp.o.d"
+  "CMakeFiles/mzqc_tests.dir/src/mzqc_update.cpp.o"
+  "CMakeFiles/mzqc_tests.dir/src/mzqc_update.cpp.o.d"
+  "CMakeFiles/mzqc_tests.dir/src/mzqc_value.cpp.o"
+  "CMakeFiles/mzqc_tests.dir/src/mzqc_value.cpp.o.d"
+  "CMakeFiles/mzqc_tests.dir/src/mzqc_writer.cpp.o"
+  "CMakeFiles/mzqc_tests.dir/src/mzqc_writer.cpp.o.d"
+  "CMakeFiles/mzqc_tests.dir/test/unit/aggregate_test.cpp.o"
+  "CMakeFiles/mzqc_tests.dir/test/unit/aggregate_test.cpp.o.d"
+  "CMakeFiles/mzqc_tests.dir/test/unit/async_test.cpp.o"
+  "CMakeFiles/mzqc_tests.dir/test/unit/async_test.cpp.o.d"
+  "CMakeFiles/mzqc_tests.dir/test/unit/binary_test.cpp.o"
+  "CMakeFiles/mzqc_tests.dir/test/unit/binary_test.cpp.o.d"
+  "CMakeFiles/mzqc_tests.dir/test/unit/compress_test.cpp.o"
+  "CMakeFiles/mzqc_tests.dir/test/unit/compress_test.cpp.o.d"
+  "CMakeFiles/mzqc_tests.dir/test/unit/csv_test.cpp.o"
+  "CMakeFiles/mzqc_tests.dir/test/unit/csv_test.cpp.o.d"
+  "CMakeFiles/mzqc_tests.dir/test/unit/cv_test.cpp.o"
+  "CMakeFiles/mzqc_tests.dir/test/unit/cv_test.cpp.o.d"
+  "CMakeFiles/mzqc_tests.dir/test/unit/document_test.cpp.o"
+  "CMakeFiles/mzqc_tests.dir/test/unit/document_test.cpp.o.d"
+  "CMakeFiles/mzqc_tests.dir/test/unit/index_test.cpp.o"
+  "CMakeFiles/mzqc_tests.dir/test/unit/index_test.cpp.o.d"
+  "CMakeFiles/mzqc_tests.dir/test/unit/intern_test.cpp.o"
+  "CMakeFiles/mzqc_tests.dir/test/unit/intern_test.cpp.o.d"
+  "CMakeFiles/mzqc_tests.dir/test/unit/mapped_test.cpp.o"
+  "CMakeFiles/mzqc_tests.dir/test/unit/mapped_test.cpp.o.d"
+  "CMakeFiles/mzqc_tests.dir/test/unit/merge_test.cpp.o"
+  "CMakeFiles/mzqc_tests.dir/test/unit/merge_test.cpp.o.d"
+  "CMakeFiles/mzqc_tests.dir/test/unit/metrics_test.cpp.o"
+  "CMakeFiles/mzqc_tests.dir/test/unit/metrics_test.cpp.o.d"
+  "CMakeFiles/mzqc_tests.dir/test/unit/model_test.cpp.o"
+  "CMakeFiles/mzqc_tests.dir/test/unit/model_test.cpp.o.d"
+  "CMakeFiles/mzqc_tests.dir/test/unit/numbers_test.cpp.o"
+  "CMakeFiles/mzqc_tests.dir/test/unit/numbers_test.cpp.o.d"
+  "CMakeFiles/mzqc_tests.dir/test/unit/obo_test.cpp.o"
+  "CMakeFiles/mzqc_tests.dir/test/unit/obo_test.cpp.o.d"
+  "CMakeFiles/mzqc_tests.dir/test/unit/parallel_test.cpp.o"
+  "CMakeFiles/mzqc_tests.dir/test/unit/parallel_test.cpp.o.d"
+  "CMakeFiles/mzqc_tests.dir/test/unit/reader_test.cpp.o"
+  "CMakeFiles/mzqc_tests.dir/test/unit/reader_test.cpp.o.d"
+  "CMakeFiles/mzqc_tests.dir/test/unit/schema_test.cpp.o"
+  "CMakeFiles/mzqc_tests.dir/test/unit/schema_test.cpp.o.d"
+  "CMakeFiles/mzqc_tests.dir/test/unit/sketch_test.cpp.o"
+  "CMakeFiles/mzqc_tests.dir/test/unit/sketch_test.cpp.o.d"
+  "CMakeFiles/mzqc_tests.dir/test/unit/stats_test.cpp.o"
+  "CMakeFiles/mzqc_tests.dir/test/unit/stats_test.cpp.o.d"
+  "CMakeFiles/mzqc_tests.dir/test/unit/store_test.cpp.o"
+  "CMakeFiles/mzqc_tests.dir/test/unit/store_test.cpp.o.d"
+  "CMakeFiles/mzqc_tests.dir/test/unit/stream_test.cpp.o"
+  "CMakeFiles/mzqc_tests.dir/test/unit/stream_test.cpp.o.d"
+  "CMakeFiles/mzqc_tests.dir/test/unit/stream_writer_test.cpp.o"
+  "CMakeFiles/mzqc_tests.dir/test/unit/stream_writer_test.cpp.o.d"
+  "CMakeFiles/mzqc_tests.dir/test/unit/update_test.cpp.o"
+  "CMakeFiles/mzqc_tests.dir/test/unit/update_test.cpp.o.d"
+  "CMakeFiles/mzqc_tests.dir/test/unit/value_test.cpp.o"
+  "CMakeFiles/mzqc_tests.dir/test/unit/value_test.cpp.o.d"
+  "CMakeFiles/mzqc_tests.dir/test/unit/writer_test.cpp.o"
+  "CMakeFiles/mzqc_tests.dir/test/unit/writer_test.cpp.o.d"
+  "mzqc_tests"
+  "mzqc_tests.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/mzqc_tests.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,8 @@
+# CMake generated Testfile for 
+# Source directory: /root/repo/cmzqc
+# Build directory: /root/repo/cmzqc/_warn_build
+# 
+# This file includes the relevant testing commands required for 
+# testing this directory and lists subdirectories to be tested as well.
+add_test(mzqc_tests "/root/repo/cmzqc/_warn_build/mzqc_tests")
+set_tests_properties(mzqc_tests PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/cmzqc/CMakeLists.txt;154;add_test;/root/repo/cmzqc/CMakeLists.txt;0;")
@@ -1,72 +1,52 @@
 #include "mzqc.hpp"
+#include "mzqc_async.hpp"
+#include "mzqc_stream.hpp"
+#include "mzqc_parallel.hpp"
+#include "mzqc_layout.hpp"
+#include "mzqc_mmap.hpp"
+#include "mzqc_stats.hpp"
+#include "mzqc_writer.hpp"
+#include <exception>
 #include <fstream>
 #include <chrono>
+#include <ctime>
 #include <iomanip>
 #include <sstream>
 #include <string>
+#include <type_traits>
+#include <utility>
 #include <nlohmann/json.hpp>
 #include <iostream>
+#include <algorithm>
 
 namespace mzqc {
 
-// Static schema variable
-static nlohmann::json schema = nullptr;
+// Schema json as loaded by the global SchemaRegistry, shared and immutable
+const nlohmann::json& loadSchema(const std::string& schemaPath) {
+    return loadCompiledSchema(schemaPath)->source();
+}
 
-// Function to load and cache schema from file
-nlohmann::json loadSchema(const std::string& schemaPath) {
-    static bool schemaLoaded = false;
-    static nlohmann::json cachedSchema;
-    
-    if (!schemaLoaded) {
-        try {
-            std::ifstream schemaFile(schemaPath);
-            if (!schemaFile.is_open()) {
-                throw std::runtime_error("Failed to open schema file: " + schemaPath);
-            }
-            
-            schemaFile >> cachedSchema;
-            schemaLoaded = true;
-        } catch (const std::exception& e) {
-            throw std::runtime_error("Error loading schema file: " + std::string(e.what()));
-        }
+std::shared_ptr<const CompiledSchema> loadCompiledSchema(const std::string& schemaPath) {
+    return SchemaRegistry::global().get(schemaPath);
+}
+
+void reportSchemaErrors(const std::vector<SchemaError>& errors) {
+    for (const auto& error : errors) {
+        std::cerr << "Schema validation error at '" << (error.path.empty() ? "/" : error.path) << "': "
+                  << error.message << std::endl;
     }
-    
-    return cachedSchema;
 }
 
-// Simple schema validation function - basic checks only, not full JSON Schema validation
+// Full JSON Schema validation in a single pass over the tree
 bool validateAgainstSchema(const nlohmann::json& j, const std::string& schemaPath) {
+    MZQC_STATS_SCOPE("validateAgainstSchema", Validate);
     try {
-        // Load the schema
-        nlohmann::json schemaJson = loadSchema(schemaPath);
-        
-        // Basic validation - check if root mzQC object exists
-        if (!j.contains("mzQC")) {
-            std::cerr << "Schema validation error: missing root 'mzQC' object" << std::endl;
-            return false;
-        }
-        
-        const auto& mzqc = j["mzQC"];
-        
-        // Check required properties from schema
-        if (!mzqc.contains("version") || !mzqc.contains("creationDate")) {
-            std::cerr << "Schema validation error: missing required properties in mzQC object" << std::endl;
-            return false;
+        std::vector<SchemaError> errors;
+        if (loadCompiledSchema(schemaPath)->validate(j, &errors, maxReportedSchemaErrors)) {
+            return true;
         }
-        
-        // Check if at least runQualities or setQualities exists
-        if (!mzqc.contains("runQualities") && !mzqc.contains("setQualities")) {
-            std::cerr << "Schema validation error: either runQualities or setQualities must be present" << std::endl;
-            return false;
-        }
-        
-        // Check if controlledVocabularies exists
-        if (!mzqc.contains("controlledVocabularies")) {
-            std::cerr << "Schema validation error: controlledVocabularies must be present" << std::endl;
-            return false;
-        }
-        
-        return true;
+        reportSchemaErrors(errors);
+        return false;
     } catch (const std::exception& e) {
         std::cerr << "Schema validation error: " << e.what() << std::endl;
         return false;
@@ -74,10 +54,10 @@ bool validateAgainstSchema(const nlohmann::json& j, const std::string& schemaPat
 }
 
 // ControlledVocabulary implementation
-ControlledVocabulary::ControlledVocabulary(const std::string& name,
-                                           const std::string& uri,
-                                           const std::string& version)
-    : name(name), uri(uri), version(version) {}
+ControlledVocabulary::ControlledVocabulary(std::string name,
+                                           std::string uri,
+                                           std::string version)
+    : name(std::move(name)), uri(std::move(uri)), version(std::move(version)) {}
 
 nlohmann::json ControlledVocabulary::toJson() const {
     nlohmann::json j;
@@ -98,95 +78,238 @@ void ControlledVocabulary::fromJson(const nlohmann::json& j) {
 // CvTermCache implementation
 int CvTermCache::loadFromOboFile(const std::string& filename) {
     currentOboFile = filename;
-    return parseOboFile(filename);
+    int count = parseOboFile(filename);
+    internTerms();
+    return count;
 }
 
-int CvTermCache::parseOboFile(const std::string& filename) {
-    std::ifstream file(filename);
-    if (!file.is_open()) return -1;
-    
-    // Simplified implementation for OBO file parsing
-    std::string line;
-    CvTermDetails currentTerm;
-    bool inTermDef = false;
-    
-    while (std::getline(file, line)) {
-        // Skip empty lines and comments
-        if (line.empty() || line[0] == '!') continue;
-        
-        // Term start
-        if (line == "[Term]") {
-            if (inTermDef && !currentTerm.accession.empty()) {
-                // Save previous term
-                termCache[currentTerm.accession] = currentTerm;
+void CvTermCache::internTerms() const {
+    // Terms get the first, densest handles so metric fields resolve to them
+    auto& table = StringInternTable::global();
+    for (const auto& term : terms) {
+        table.intern(term.accession);
+        table.intern(term.name);
+    }
+}
+
+static uint64_t hashAccession(std::string_view accession) {
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ULL;
+    for (char c : accession) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+void CvTermCache::addTerm(CvTermDetails&& term) {
+    uint32_t id = termId(term.accession);
+    if (id != npos) {
+        // Redefinitions replace the earlier term, as with the previous map
+        terms[id] = std::move(term);
+        return;
+    }
+    terms.push_back(std::move(term));
+    if (slots.size() < terms.size() * 2) {
+        buildIndex();
+        return;
+    }
+    size_t mask = slots.size() - 1;
+    size_t slot = hashAccession(terms.back().accession) & mask;
+    while (slots[slot] != npos) slot = (slot + 1) & mask;
+    slots[slot] = static_cast<uint32_t>(terms.size() - 1);
+}
+
+void CvTermCache::buildIndex() {
+    // Keep the load factor at or below one half
+    size_t capacity = 16;
+    while (capacity < terms.size() * 4) capacity <<= 1;
+    slots.assign(capacity, npos);
+    size_t mask = capacity - 1;
+    for (uint32_t id = 0; id < terms.size(); ++id) {
+        size_t slot = hashAccession(terms[id].accession) & mask;
+        while (slots[slot] != npos) slot = (slot + 1) & mask;
+        slots[slot] = id;
+    }
+}
+
+uint32_t CvTermCache::termId(std::string_view accession) const {
+    if (slots.empty()) return npos;
+    size_t mask = slots.size() - 1;
+    for (size_t slot = hashAccession(accession) & mask; slots[slot] != npos; slot = (slot + 1) & mask) {
+        if (terms[slots[slot]].accession == accession) return slots[slot];
+    }
+    return npos;
+}
+
+const CvTermDetails* CvTermCache::lookup(std::string_view accession) const {
+    uint32_t id = termId(accession);
+    return id == npos ? nullptr : &terms[id];
+}
+
+void CvTermCache::buildAncestry() {
+    size_t count = terms.size();
+    std::vector<std::vector<uint32_t>> parents(count);
+    for (uint32_t id = 0; id < count; ++id) {
+        for (const auto& parent : terms[id].parentTerms) {
+            uint32_t parentId = termId(parent);
+            if (parentId != npos && parentId != id) parents[id].push_back(parentId);
+        }
+    }
+
+    // Depth-first closure with memoization; cycles are cut at the revisit
+    std::vector<std::vector<uint32_t>> ancestors(count);
+    std::vector<uint8_t> state(count, 0); // 0 = new, 1 = in progress, 2 = done
+    std::vector<std::pair<uint32_t, size_t>> work;
+    for (uint32_t root = 0; root < count; ++root) {
+        if (state[root]) continue;
+        work.emplace_back(root, 0);
+        state[root] = 1;
+        while (!work.empty()) {
+            auto& [id, next] = work.back();
+            if (next < parents[id].size()) {
+                uint32_t parent = parents[id][next++];
+                if (state[parent] == 0) {
+                    state[parent] = 1;
+                    work.emplace_back(parent, 0);
+                }
+                continue;
+            }
+            auto& closure = ancestors[id];
+            closure.push_back(id);
+            for (uint32_t parent : parents[id]) {
+                closure.insert(closure.end(), ancestors[parent].begin(), ancestors[parent].end());
             }
-            // Reset for new term
-            currentTerm = CvTermDetails();
-            inTermDef = true;
-            continue;
+            std::sort(closure.begin(), closure.end());
+            closure.erase(std::unique(closure.begin(), closure.end()), closure.end());
+            state[id] = 2;
+            work.pop_back();
         }
-        
-        // Only process if we're inside a term definition
-        if (!inTermDef) continue;
-        
-        // Process basic term data
-        if (line.find("id:") == 0) {
-            currentTerm.accession = line.substr(3);
-        } else if (line.find("name:") == 0) {
-            currentTerm.name = line.substr(5);
-        } else if (line.find("def:") == 0) {
-            currentTerm.definition = line.substr(4);
-        } else if (line.find("is_a:") == 0) {
-            currentTerm.parentTerms.push_back(line.substr(5));
+    }
+
+    ancestorOffsets.assign(1, 0);
+    ancestorIds.clear();
+    std::vector<uint32_t> descendantCounts(count, 0);
+    for (uint32_t id = 0; id < count; ++id) {
+        ancestorIds.insert(ancestorIds.end(), ancestors[id].begin(), ancestors[id].end());
+        ancestorOffsets.push_back(static_cast<uint32_t>(ancestorIds.size()));
+        for (uint32_t ancestor : ancestors[id]) {
+            if (ancestor != id) ++descendantCounts[ancestor];
         }
     }
-    
-    // Add the last term
-    if (inTermDef && !currentTerm.accession.empty()) {
-        termCache[currentTerm.accession] = currentTerm;
+
+    descendantOffsets.assign(count + 1, 0);
+    for (uint32_t id = 0; id < count; ++id) {
+        descendantOffsets[id + 1] = descendantOffsets[id] + descendantCounts[id];
     }
-    
-    return termCache.size();
+    descendantIds.assign(descendantOffsets.back(), 0);
+    std::vector<uint32_t> fill(descendantOffsets.begin(), descendantOffsets.end() - 1);
+    for (uint32_t id = 0; id < count; ++id) {
+        for (uint32_t ancestor : ancestors[id]) {
+            if (ancestor != id) descendantIds[fill[ancestor]++] = id;
+        }
+    }
+}
+
+bool CvTermCache::isA(uint32_t child, uint32_t ancestor) const {
+    if (child >= terms.size() || ancestor >= terms.size()) return false;
+    auto first = ancestorIds.begin() + ancestorOffsets[child];
+    auto last = ancestorIds.begin() + ancestorOffsets[child + 1];
+    return std::binary_search(first, last, ancestor);
+}
+
+bool CvTermCache::isA(std::string_view child, std::string_view ancestor) const {
+    return isA(termId(child), termId(ancestor));
+}
+
+std::vector<uint32_t> CvTermCache::descendants(uint32_t id) const {
+    if (id >= terms.size()) return {};
+    return std::vector<uint32_t>(descendantIds.begin() + descendantOffsets[id],
+                                 descendantIds.begin() + descendantOffsets[id + 1]);
+}
+
+std::vector<const CvTermDetails*> CvTermCache::descendants(std::string_view accession) const {
+    std::vector<const CvTermDetails*> result;
+    for (uint32_t id : descendants(termId(accession))) {
+        result.push_back(&terms[id]);
+    }
+    return result;
+}
+
+// The readers below take a const tree, which they copy from, or a mutable
+// one, which they move strings, values and elements out of
+template <typename Json>
+static decltype(auto) take(Json& j) {
+    if constexpr (std::is_const_v<Json>) {
+        return static_cast<Json&>(j);
+    } else {
+        return std::move(j);
+    }
+}
+
+template <typename Json>
+static std::string takeString(Json& j) {
+    if constexpr (!std::is_const_v<Json>) {
+        if (j.is_string()) return std::move(j.template get_ref<std::string&>());
+    }
+    return j.template get<std::string>();
+}
+
+// Same result as j.value(key, ""), throws the same error for a non-string
+template <typename Json>
+static std::string takeString(Json& j, const char* key) {
+    if (!j.is_object()) return j.value(key, "");
+    auto it = j.find(key);
+    return it == j.end() ? std::string() : takeString(*it);
 }
 
 // CvParameter implementation, works
 CvParameter::CvParameter(const std::string& accession,
                         const std::string& name,
-                        const std::string& value,
+                        std::string value,
                         const std::string& cvRef)
-    : accession(accession), name(name), value(value), cvRef(cvRef) {}
+    : accession(accession), name(name), value(std::move(value)), cvRef(cvRef) {}
 
 nlohmann::json CvParameter::toJson() const {
     nlohmann::json j;
-    j["accession"] = accession;
-    j["name"] = name;
+    j["accession"] = accession.str();
+    j["name"] = name.str();
     if (!value.empty()) {
         j["value"] = value;
     }
     if (!cvRef.empty()) {
-        j["cvRef"] = cvRef;
+        j["cvRef"] = cvRef.str();
     }
     return j;
 }
 
+template <typename Json>
+static void readParameter(CvParameter& param, Json& j) {
+    param.accession = j.value("accession", "");
+    param.name = j.value("name", "");
+    param.value = takeString(j, "value");
+    param.cvRef = j.value("cvRef", "");
+}
+
 void CvParameter::fromJson(const nlohmann::json& j) {
-    accession = j.value("accession", "");
-    name = j.value("name", "");
-    value = j.value("value", "");
-    cvRef = j.value("cvRef", "");
+    readParameter(*this, j);
+}
+
+void CvParameter::fromJson(nlohmann::json&& j) {
+    readParameter(*this, j);
 }
 
 // AnalysisSoftware implementation
 AnalysisSoftware::AnalysisSoftware(const std::string& accession,
                                   const std::string& name,
-                                  const std::string& version,
-                                  const std::string& uri)
-    : accession(accession), name(name), version(version), uri(uri) {}
+                                  std::string version,
+                                  std::string uri)
+    : accession(accession), name(name), version(std::move(version)), uri(std::move(uri)) {}
 
 nlohmann::json AnalysisSoftware::toJson() const {
     nlohmann::json j;
-    j["accession"] = accession;
-    j["name"] = name;
+    j["accession"] = accession.str();
+    j["name"] = name.str();
     j["version"] = version;
     if (!uri.empty()) {
         j["uri"] = uri;
@@ -194,19 +317,31 @@ nlohmann::json AnalysisSoftware::toJson() const {
     return j;
 }
 
+template <typename Json>
+static void readSoftware(AnalysisSoftware& software, Json& j) {
+    software.accession = j.value("accession", "");
+    software.name = j.value("name", "");
+    software.version = takeString(j, "version");
+    software.uri = takeString(j, "uri");
+}
+
 void AnalysisSoftware::fromJson(const nlohmann::json& j) {
-    accession = j.value("accession", "");
-    name = j.value("name", "");
-    version = j.value("version", "");
-    uri = j.value("uri", "");
+    readSoftware(*this, j);
+}
+
+void AnalysisSoftware::fromJson(nlohmann::json&& j) {
+    readSoftware(*this, j);
 }
 
 // InputFile implementation
-InputFile::InputFile(const std::string& location,
-                    const std::string& name,
-                    const std::shared_ptr<CvParameter>& fileFormat,
-                    const std::vector<std::shared_ptr<CvParameter>>& fileProperties)
-    : location(location), name(name), fileFormat(fileFormat), fileProperties(fileProperties) {}
+InputFile::InputFile(std::string location,
+                    std::string name,
+                    std::shared_ptr<CvParameter> fileFormat,
+                    std::vector<std::shared_ptr<CvParameter>> fileProperties)
+    : location(std::move(location)),
+      name(std::move(name)),
+      fileFormat(std::move(fileFormat)),
+      fileProperties(std::move(fileProperties)) {}
 
 nlohmann::json InputFile::toJson() const {
     nlohmann::json j;
@@ -224,67 +359,91 @@ nlohmann::json InputFile::toJson() const {
     return j;
 }
 
-void InputFile::fromJson(const nlohmann::json& j) {
-    location = j.value("location", "");
-    name = j.value("name", "");
+template <typename Json>
+static void readInputFile(InputFile& file, Json& j) {
+    file.location = takeString(j, "location");
+    file.name = takeString(j, "name");
     
-    if (j.contains("fileFormat")) {
-        fileFormat = std::make_shared<CvParameter>();
-        fileFormat->fromJson(j["fileFormat"]);
+    auto format = j.find("fileFormat");
+    if (format != j.end()) {
+        file.fileFormat = std::make_shared<CvParameter>();
+        file.fileFormat->fromJson(take(*format));
     }
     
-    if (j.contains("fileProperties") && j["fileProperties"].is_array()) {
-        fileProperties.clear();
-        for (const auto& prop : j["fileProperties"]) {
+    auto properties = j.find("fileProperties");
+    if (properties != j.end() && properties->is_array()) {
+        file.fileProperties.clear();
+        for (auto& prop : *properties) {
             auto cvParam = std::make_shared<CvParameter>();
-            cvParam->fromJson(prop);
-            fileProperties.push_back(cvParam);
+            cvParam->fromJson(take(prop));
+            file.fileProperties.push_back(cvParam);
         }
     }
 }
 
+void InputFile::fromJson(const nlohmann::json& j) {
+    readInputFile(*this, j);
+}
+
+void InputFile::fromJson(nlohmann::json&& j) {
+    readInputFile(*this, j);
+}
+
 // QualityMetric implementation
 QualityMetric::QualityMetric(const std::string& accession,
                             const std::string& name,
-                            const std::string& description,
-                            const nlohmann::json& value,
+                            std::string description,
+                            MetricValue value,
                             const std::string& unit)
-    : accession(accession), name(name), description(description), value(value), unit(unit) {}
+    : accession(accession), name(name), description(std::move(description)), value(std::move(value)), unit(unit) {}
 
 nlohmann::json QualityMetric::toJson() const {
     nlohmann::json j;
-    j["accession"] = accession;
-    j["name"] = name;
+    j["accession"] = accession.str();
+    j["name"] = name.str();
     if (!description.empty()) {
         j["description"] = description;
     }
     if (!value.is_null()) {
-        j["value"] = value;
+        j["value"] = value.toJson();
     }
     if (!unit.empty()) {
-        j["unit"] = unit;
+        j["unit"] = unit.str();
     }
     return j;
 }
 
-void QualityMetric::fromJson(const nlohmann::json& j) {
-    accession = j.value("accession", "");
-    name = j.value("name", "");
-    description = j.value("description", "");
-    
-    if (j.contains("value")) {
-        value = j["value"];
+template <typename Json>
+static void readMetric(QualityMetric& metric, Json& j) {
+    metric.accession = j.value("accession", "");
+    metric.name = j.value("name", "");
+    metric.description = takeString(j, "description");
+
+    auto value = j.find("value");
+    if (value != j.end()) {
+        metric.value = MetricValue(take(*value));
     }
-    
-    unit = j.value("unit", "");
+
+    metric.unit = j.value("unit", "");
+}
+
+void QualityMetric::fromJson(const nlohmann::json& j) {
+    readMetric(*this, j);
+}
+
+void QualityMetric::fromJson(nlohmann::json&& j) {
+    readMetric(*this, j);
 }
 
 // RunQuality implementation
-RunQuality::RunQuality(const std::string& label,
-                      const std::vector<std::shared_ptr<InputFile>>& inputFiles,
-                      const std::vector<std::shared_ptr<AnalysisSoftware>>& analysisSoftware,
-                      const std::vector<std::shared_ptr<QualityMetric>>& metrics)
-    : label(label), inputFiles(inputFiles), analysisSoftware(analysisSoftware), metrics(metrics) {}
+RunQuality::RunQuality(std::string label,
+                      std::vector<std::shared_ptr<InputFile>> inputFiles,
+                      std::vector<std::shared_ptr<AnalysisSoftware>> analysisSoftware,
+                      std::vector<std::shared_ptr<QualityMetric>> metrics)
+    : label(std::move(label)),
+      inputFiles(std::move(inputFiles)),
+      analysisSoftware(std::move(analysisSoftware)),
+      metrics(std::move(metrics)) {}
 
 nlohmann::json RunQuality::toJson() const {
     nlohmann::json j;
@@ -308,45 +467,62 @@ nlohmann::json RunQuality::toJson() const {
     return j;
 }
 
-void RunQuality::fromJson(const nlohmann::json& j) {
-    label = j.value("label", "");
+template <typename Json>
+static void readMetrics(std::vector<std::shared_ptr<QualityMetric>>& metrics, Json& j) {
+    auto array = j.find("metrics");
+    if (array != j.end() && array->is_array()) {
+        metrics.clear();
+        metrics.reserve(array->size());
+        for (auto& metric : *array) {
+            auto qualityMetric = std::make_shared<QualityMetric>();
+            qualityMetric->fromJson(take(metric));
+            metrics.push_back(std::move(qualityMetric));
+        }
+    }
+}
+
+template <typename Json>
+static void readRun(RunQuality& run, Json& j) {
+    run.label = takeString(j, "label");
     
     // Parse input files
-    if (j.contains("inputFiles") && j["inputFiles"].is_array()) {
-        inputFiles.clear();
-        for (const auto& file : j["inputFiles"]) {
+    auto inputFiles = j.find("inputFiles");
+    if (inputFiles != j.end() && inputFiles->is_array()) {
+        run.inputFiles.clear();
+        for (auto& file : *inputFiles) {
             auto inputFile = std::make_shared<InputFile>();
-            inputFile->fromJson(file);
-            inputFiles.push_back(inputFile);
+            inputFile->fromJson(take(file));
+            run.inputFiles.push_back(inputFile);
         }
     }
     
     // Parse analysis software
-    if (j.contains("analysisSoftware") && j["analysisSoftware"].is_array()) {
-        analysisSoftware.clear();
-        for (const auto& software : j["analysisSoftware"]) {
+    auto software = j.find("analysisSoftware");
+    if (software != j.end() && software->is_array()) {
+        run.analysisSoftware.clear();
+        for (auto& entry : *software) {
             auto sw = std::make_shared<AnalysisSoftware>();
-            sw->fromJson(software);
-            analysisSoftware.push_back(sw);
+            sw->fromJson(take(entry));
+            run.analysisSoftware.push_back(sw);
         }
     }
     
-    // Parse metrics
-    if (j.contains("metrics") && j["metrics"].is_array()) {
-        metrics.clear();
-        for (const auto& metric : j["metrics"]) {
-            auto qualityMetric = std::make_shared<QualityMetric>();
-            qualityMetric->fromJson(metric);
-            metrics.push_back(qualityMetric);
-        }
-    }
+    readMetrics(run.metrics, j);
+}
+
+void RunQuality::fromJson(const nlohmann::json& j) {
+    readRun(*this, j);
+}
+
+void RunQuality::fromJson(nlohmann::json&& j) {
+    readRun(*this, j);
 }
 
 // SetQuality implementation
-SetQuality::SetQuality(const std::string& label,
-                      const std::vector<std::string>& setRefs,
-                      const std::vector<std::shared_ptr<QualityMetric>>& metrics)
-    : label(label), setRefs(setRefs), metrics(metrics) {}
+SetQuality::SetQuality(std::string label,
+                      std::vector<std::string> setRefs,
+                      std::vector<std::shared_ptr<QualityMetric>> metrics)
+    : label(std::move(label)), setRefs(std::move(setRefs)), metrics(std::move(metrics)) {}
 
 nlohmann::json SetQuality::toJson() const {
     nlohmann::json j;
@@ -361,49 +537,54 @@ nlohmann::json SetQuality::toJson() const {
     return j;
 }
 
-void SetQuality::fromJson(const nlohmann::json& j) {
-    label = j.value("label", "");
+template <typename Json>
+static void readSet(SetQuality& set, Json& j) {
+    set.label = takeString(j, "label");
     
     // Parse setRefs
-    if (j.contains("setRefs") && j["setRefs"].is_array()) {
-        setRefs.clear();
-        for (const auto& ref : j["setRefs"]) {
-            setRefs.push_back(ref.get<std::string>());
+    auto refs = j.find("setRefs");
+    if (refs != j.end() && refs->is_array()) {
+        set.setRefs.clear();
+        for (auto& ref : *refs) {
+            set.setRefs.push_back(takeString(ref));
         }
     }
     
-    // Parse metrics
-    if (j.contains("metrics") && j["metrics"].is_array()) {
-        metrics.clear();
-        for (const auto& metric : j["metrics"]) {
-            auto qualityMetric = std::make_shared<QualityMetric>();
-            qualityMetric->fromJson(metric);
-            metrics.push_back(qualityMetric);
-        }
-    }
+    readMetrics(set.metrics, j);
+}
+
+void SetQuality::fromJson(const nlohmann::json& j) {
+    readSet(*this, j);
+}
+
+void SetQuality::fromJson(nlohmann::json&& j) {
+    readSet(*this, j);
 }
 
 // MzQcFile implementation
-MzQCFile::MzQCFile(const std::string& creationDate,
-                   const std::string& version,
-                   const std::string& contactName,
-                   const std::string& contactAddress,
-                   const std::string& description,
-                   const std::vector<std::shared_ptr<RunQuality>>& runQualities,
-                   const std::vector<std::shared_ptr<SetQuality>>& setQualities)
-    : creationDate(creationDate.empty() ? getCurrentIsoTime() : creationDate),
-      version(version),
-      contactName(contactName),
-      contactAddress(contactAddress),
-      description(description),
-      runQualities(runQualities),
-      setQualities(setQualities) {}
+MzQCFile::MzQCFile(std::string creationDate,
+                   std::string version,
+                   std::string contactName,
+                   std::string contactAddress,
+                   std::string description,
+                   std::vector<std::shared_ptr<RunQuality>> runQualities,
+                   std::vector<std::shared_ptr<SetQuality>> setQualities)
+    : creationDate(creationDate.empty() ? getCurrentIsoTime() : std::move(creationDate)),
+      version(std::move(version)),
+      contactName(std::move(contactName)),
+      contactAddress(std::move(contactAddress)),
+      description(std::move(description)),
+      runQualities(std::move(runQualities)),
+      setQualities(std::move(setQualities)) {}
 
 std::string MzQCFile::getCurrentIsoTime() {
     auto now = std::chrono::system_clock::now();
     auto time = std::chrono::system_clock::to_time_t(now);
     std::stringstream ss;
-    ss << std::put_time(std::gmtime(&time), "%Y-%m-%dT%H:%M:%SZ");
+    // gmtime_r, not gmtime: files are created on several threads by loadMany
+    std::tm utc;
+    gmtime_r(&time, &utc);
+    ss << std::put_time(&utc, "%Y-%m-%dT%H:%M:%SZ");
     return ss.str();
 }
 
@@ -442,101 +623,398 @@ nlohmann::json MzQCFile::toJson() const {
     return j;
 }
 
-void MzQCFile::fromJson(const nlohmann::json& j) {
+template <typename Json>
+static void readFile(MzQCFile& file, Json& j) {
     // Check if the root object is "mzQC" or if we're already inside it
-    const auto& mzqc = j.contains("mzQC") ? j["mzQC"] : j;
+    auto root = j.find("mzQC");
+    auto& mzqc = root != j.end() ? *root : j;
     
     // Parse basic properties
-    if (mzqc.contains("creationDate")) {
-        creationDate = mzqc["creationDate"].get<std::string>();
-    } else {
-        creationDate = getCurrentIsoTime();
-
-
-
-    }
+    auto creationDate = mzqc.find("creationDate");
+    file.creationDate = creationDate != mzqc.end() ? takeString(*creationDate) : MzQCFile::getCurrentIsoTime();
     
-    version = mzqc.value("version", "");
-    contactName = mzqc.value("contactName", "");
-    contactAddress = mzqc.value("contactAddress", "");
-    description = mzqc.value("description", "");
+    file.version = takeString(mzqc, "version");
+    file.contactName = takeString(mzqc, "contactName");
+    file.contactAddress = takeString(mzqc, "contactAddress");
+    file.description = takeString(mzqc, "description");
     
     // Parse controlled vocabularies
     if (mzqc.contains("controlledVocabularies") && mzqc["controlledVocabularies"].is_array()) {
-        controlledVocabularies.clear();
+        file.controlledVocabularies.clear();
         for (const auto& v : mzqc["controlledVocabularies"]) {
             auto cv = std::make_shared<ControlledVocabulary>();
             cv->fromJson(v);
-            controlledVocabularies.push_back(cv);
+            file.controlledVocabularies.push_back(cv);
         }
     }
     
     // Parse run qualities
-    if (mzqc.contains("runQualities") && mzqc["runQualities"].is_array()) {
-        runQualities.clear();
-        for (const auto& rq : mzqc["runQualities"]) {
+    auto runs = mzqc.find("runQualities");
+    if (runs != mzqc.end() && runs->is_array()) {
+        file.runQualities.clear();
+        file.runQualities.reserve(runs->size());
+        for (auto& rq : *runs) {
             auto runQuality = std::make_shared<RunQuality>();
-            runQuality->fromJson(rq);
-            runQualities.push_back(runQuality);
+            runQuality->fromJson(take(rq));
+            file.runQualities.push_back(std::move(runQuality));
         }
     }
     
     // Parse set qualities
-    if (mzqc.contains("setQualities") && mzqc["setQualities"].is_array()) {
-        setQualities.clear();
-        for (const auto& sq : mzqc["setQualities"]) {
+    auto sets = mzqc.find("setQualities");
+    if (sets != mzqc.end() && sets->is_array()) {
+        file.setQualities.clear();
+        for (auto& sq : *sets) {
             auto setQuality = std::make_shared<SetQuality>();
-            setQuality->fromJson(sq);
-            setQualities.push_back(setQuality);
+            setQuality->fromJson(take(sq));
+            file.setQualities.push_back(std::move(setQuality));
         }
     }
 }
 
+void MzQCFile::fromJson(const nlohmann::json& j) {
+    readFile(*this, j);
+}
+
+void MzQCFile::fromJson(nlohmann::json&& j) {
+    readFile(*this, j);
+}
+
 std::shared_ptr<MzQCFile> MzQCFile::fromJsonStatic(const nlohmann::json& j) {
     auto file = std::make_shared<MzQCFile>();
     file->fromJson(j);
     return file;
 }
 
-std::shared_ptr<MzQCFile> MzQCFile::fromFile(const std::string& filepath, const std::string& schemaPath) {
-    std::ifstream file(filepath);
-    if (!file.is_open()) {
-        throw std::runtime_error("Could not open file: " + filepath);
+std::shared_ptr<MzQCFile> MzQCFile::fromJsonStatic(nlohmann::json&& j) {
+    auto file = std::make_shared<MzQCFile>();
+    file->fromJson(std::move(j));
+    return file;
+}
+
+static void throwIfInvalid(const SchemaValidator& validator, bool reportErrors) {
+    if (validator.valid()) return;
+    std::string message = "File does not conform to mzQC schema";
+    if (!validator.errors().empty()) {
+        const SchemaError& first = validator.errors().front();
+        message += ": " + (first.path.empty() ? std::string("/") : first.path) + ": " + first.message;
     }
+    if (reportErrors) reportSchemaErrors(validator.errors());
+    throw std::runtime_error(message);
+}
 
-    nlohmann::json j;
-    try {
-        file >> j;
-    } catch (const nlohmann::json::exception& e) {
-        throw std::runtime_error("Error parsing JSON from file: " + std::string(e.what()));
+#ifdef MZQC_ENABLE_STATS
+// Counts the JSON values of a parse for the current stats scope
+template <typename Sax>
+class CountingSax {
+public:
+    using Json = nlohmann::json;
+
+    explicit CountingSax(Sax& sax) : sax(sax) {}
+
+    bool null() { return ++values, sax.null(); }
+    bool boolean(bool value) { return ++values, sax.boolean(value); }
+    bool number_integer(Json::number_integer_t value) { return ++values, sax.number_integer(value); }
+    bool number_unsigned(Json::number_unsigned_t value) { return ++values, sax.number_unsigned(value); }
+    bool number_float(Json::number_float_t value, const Json::string_t& text) {
+        return ++values, sax.number_float(value, text);
+    }
+    bool string(Json::string_t& value) { return ++values, sax.string(value); }
+    bool binary(Json::binary_t& value) { return ++values, sax.binary(value); }
+    bool start_object(std::size_t size) { return ++values, sax.start_object(size); }
+    bool key(Json::string_t& value) { return sax.key(value); }
+    bool end_object() { return sax.end_object(); }
+    bool start_array(std::size_t size) { return ++values, sax.start_array(size); }
+    bool end_array() { return sax.end_array(); }
+    bool parse_error(std::size_t position, const std::string& token, const nlohmann::detail::exception& error) {
+        return sax.parse_error(position, token, error);
+    }
+
+    uint64_t values = 0;
+
+private:
+    Sax& sax;
+};
+
+static uint64_t countMetrics(const MzQCFile& file) {
+    uint64_t count = 0;
+    for (const auto& run : file.runQualities) count += run->metrics.size();
+    for (const auto& set : file.setQualities) count += set->metrics.size();
+    return count;
+}
+#endif
+
+template <typename Sax, typename... Input>
+static void saxParse(Sax& sax, Input&&... input) {
+#ifdef MZQC_ENABLE_STATS
+    CountingSax<Sax> counting(sax);
+    nlohmann::json::sax_parse(std::forward<Input>(input)..., &counting);
+    if (StatsScope* scope = StatsScope::current()) scope->nodes += counting.values;
+#else
+    nlohmann::json::sax_parse(std::forward<Input>(input)..., &sax);
+#endif
+}
+
+// Without a validator the handler sees every event and can decode numeric
+// arrays from the input itself
+static void saxParseNumbers(MzQCSaxHandler& handler, std::istream& in) {
+    StreamNumberInput numbers(*in.rdbuf());
+    handler.readNumbersFrom(&numbers);
+    saxParse(handler, in);
+}
+
+static void saxParseNumbers(MzQCSaxHandler& handler, const char* begin, const char* end) {
+    TextNumberInput text(begin, end);
+    handler.readNumbersFrom(&text);
+    saxParse(handler, text.begin(), text.end());
+}
+
+// Streaming load with optional validation during the parse, input is a stream
+// or an iterator pair. Schema errors are printed when reportErrors is set, the
+// first one is always in the exception.
+template <typename... Input>
+static std::shared_ptr<MzQCFile> parseInput(const std::shared_ptr<const CompiledSchema>& schema, bool reportErrors,
+                                            Input&&... input) {
+    auto file = std::make_shared<MzQCFile>();
+    MzQCSaxHandler handler(*file);
+    if (!schema) {
+        saxParseNumbers(handler, std::forward<Input>(input)...);
+    } else {
+        SchemaValidator validator(schema, reportErrors ? maxReportedSchemaErrors : 1);
+        ValidatingSax sax(validator, handler);
+        saxParse(sax, std::forward<Input>(input)...);
+        throwIfInvalid(validator, reportErrors);
+    }
+#ifdef MZQC_ENABLE_STATS
+    if (StatsScope* scope = StatsScope::current()) scope->metrics += countMetrics(*file);
+#endif
+    return file;
+}
+
+std::shared_ptr<MzQCFile> MzQCFile::fromFile(const std::string& filepath, const std::string& schemaPath) {
+    MZQC_STATS_SCOPE("fromFile", Parse);
+    FileInputStream file(filepath);
+    return parseInput(schemaPath.empty() ? nullptr : loadCompiledSchema(schemaPath), true, file);
+}
+
+std::shared_ptr<MzQCFile> MzQCFile::fromStream(std::istream& in, const std::string& schemaPath) {
+    MZQC_STATS_SCOPE("fromStream", Parse);
+    return parseInput(schemaPath.empty() ? nullptr : loadCompiledSchema(schemaPath), true, in);
+}
+
+std::vector<MzQCLoadResult> MzQCFile::loadMany(const std::vector<std::string>& paths, const MzQCLoadOptions& options) {
+    // Compiled once up front; a broken schema fails the whole batch
+    std::shared_ptr<const CompiledSchema> schema;
+    if (!options.schemaPath.empty()) {
+        schema = loadCompiledSchema(options.schemaPath);
     }
-    
- 
-    if (!schemaPath.empty()) {
-        if (!validateAgainstSchema(j, schemaPath)) {
-            throw std::runtime_error("File does not conform to mzQC schema");
+
+    std::vector<MzQCLoadResult> results(paths.size());
+    auto load = [&](size_t i) {
+        MZQC_STATS_SCOPE("loadMany", Parse);
+        MzQCLoadResult& result = results[i];
+        result.path = paths[i];
+        try {
+            FileInputStream file(paths[i]);
+            result.file = parseInput(schema, false, file);
+        } catch (const std::exception& e) {
+            result.error = e.what();
         }
+    };
+
+    if (options.threads == 0) {
+        ThreadPool::shared().parallelFor(paths.size(), load);
+    } else {
+        ThreadPool pool(options.threads);
+        pool.parallelFor(paths.size(), load);
     }
-    
-    return fromJsonStatic(j);
+    return results;
 }
 
-void MzQCFile::toFile(const std::string& filepath, const std::string& schemaPath) const {
-    nlohmann::json j = toJson();
-    
+std::shared_ptr<MzQCFile> MzQCFile::fromFileParallel(const std::string& filepath, const MzQCLoadOptions& options) {
+    // The workers have no stats scope, the parallel path only records totals
+    MZQC_STATS_SCOPE("fromFileParallel", Parse);
+    MappedFile mapped;
+    if (!mapped.open(filepath)) {
+        throw std::runtime_error("Could not open file: " + filepath);
+    }
+    const char* begin = mapped.data();
+    const char* end = begin + mapped.size();
+#ifdef MZQC_ENABLE_STATS
+    mzqcStatsScope.bytes = mapped.size();
+#endif
+    std::shared_ptr<const CompiledSchema> schema;
+    if (!options.schemaPath.empty()) {
+        schema = loadCompiledSchema(options.schemaPath);
+    }
+    // Compressed text can only be read front to back
+    if (detectCompression(begin, mapped.size()) != Compression::None) {
+        FileInputStream file(filepath);
+        return parseInput(schema, true, file);
+    }
+
+    // Anything the pre-scan does not recognise, including most malformed
+    // input, takes the sequential path and gets its usual error messages
+    MzQCLayout layout;
+    if (!scanLayout(mapped.view(), layout) || layout.runs.size() + layout.sets.size() < 2) {
+        return parseInput(schema, true, begin, end);
+    }
+
+    std::unique_ptr<ThreadPool> localPool;
+    if (options.threads != 0) localPool = std::make_unique<ThreadPool>(options.threads);
+    ThreadPool& pool = localPool ? *localPool : ThreadPool::shared();
+
+    // Consecutive elements are grouped so each task parses a few megabytes
+    struct Chunk {
+        MzQCSaxHandler::Fragment fragment;
+        const std::vector<MzQCLayout::Span>* spans;
+        size_t first;
+        size_t last;
+    };
+    size_t elementBytes = 0;
+    for (const auto& span : layout.runs) elementBytes += span.size();
+    for (const auto& span : layout.sets) elementBytes += span.size();
+    const size_t chunkBytes = std::max<size_t>(elementBytes / (size_t(pool.size() + 1) * 8), 1 << 16);
+    std::vector<Chunk> chunks;
+    auto split = [&](MzQCSaxHandler::Fragment fragment, const std::vector<MzQCLayout::Span>& spans) {
+        size_t first = 0;
+        size_t bytes = 0;
+        for (size_t i = 0; i < spans.size(); ++i) {
+            bytes += spans[i].size();
+            if (bytes >= chunkBytes || i + 1 == spans.size()) {
+                chunks.push_back({fragment, &spans, first, i + 1});
+                first = i + 1;
+                bytes = 0;
+            }
+        }
+    };
+    split(MzQCSaxHandler::Fragment::Runs, layout.runs);
+    split(MzQCSaxHandler::Fragment::Sets, layout.sets);
+
+    // Task 0 parses everything but the elements, task 1 validates the whole
+    // text when a schema is given; validation is a single pass and bounds
+    // the speed-up in that case
+    const std::string skeleton = layout.skeleton(mapped.view());
+    const size_t firstChunk = schema ? 2 : 1;
+    std::shared_ptr<MzQCFile> file;
+    std::unique_ptr<SchemaValidator> validator;
+    if (schema) validator = std::make_unique<SchemaValidator>(schema, maxReportedSchemaErrors);
+    std::vector<MzQCFile> parts(chunks.size());
+    std::vector<std::exception_ptr> failures(firstChunk + chunks.size());
+
+    pool.parallelFor(failures.size(), [&](size_t task) {
+        try {
+            if (task == 0) {
+                file = parseInput(nullptr, false, skeleton.data(), skeleton.data() + skeleton.size());
+            } else if (task < firstChunk) {
+                nlohmann::json::sax_parse(begin, end, validator.get());
+            } else {
+                const Chunk& chunk = chunks[task - firstChunk];
+                MzQCSaxHandler handler(parts[task - firstChunk], chunk.fragment);
+                for (size_t i = chunk.first; i < chunk.last; ++i) {
+                    const MzQCLayout::Span& span = (*chunk.spans)[i];
+                    TextNumberInput text(begin + span.begin, begin + span.end);
+                    handler.readNumbersFrom(&text);
+                    nlohmann::json::sax_parse(text.begin(), text.end(), &handler);
+                }
+            }
+        } catch (...) {
+            failures[task] = std::current_exception();
+        }
+    });
+
+    // Report the error a sequential parse would have hit first
+    for (const auto& failure : failures) {
+        if (failure) std::rethrow_exception(failure);
+    }
+    if (validator) throwIfInvalid(*validator, true);
 
+    for (auto& part : parts) {
+        for (auto& run : part.runQualities) file->runQualities.push_back(std::move(run));
+        for (auto& set : part.setQualities) file->setQualities.push_back(std::move(set));
+    }
+#ifdef MZQC_ENABLE_STATS
+    // Values are only counted by the sequential parse
+    mzqcStatsScope.nodes = 0;
+    mzqcStatsScope.metrics = countMetrics(*file);
+#endif
+    return file;
+}
+
+// Shared by toFile and saveAsync, Output is FileOutputStream or AsyncFileOutputStream
+template <typename Output>
+static void writeFile(const MzQCFile& mzqc, const std::string& filepath, const std::string& schemaPath,
+                      const CompressionOptions& compression) {
     if (!schemaPath.empty()) {
+        nlohmann::json j;
+        {
+            MZQC_STATS_PHASE(ToJson, 0);
+            j = mzqc.toJson();
+        }
+        MZQC_STATS_PHASE(Validate, 0);
         if (!validateAgainstSchema(j, schemaPath)) {
             throw std::runtime_error("Generated mzQC does not conform to schema");
         }
     }
-    
-    std::ofstream file(filepath);
-    if (!file.is_open()) {
-        throw std::runtime_error("Could not open file for writing: " + filepath);
-    }
+#ifdef MZQC_ENABLE_STATS
+    if (StatsScope* scope = StatsScope::current()) scope->metrics = countMetrics(mzqc);
+#endif
+
+    Output file(filepath, compression);
+    // Same text as toJson().dump(2), written without the intermediate tree
+    JsonWriter writer(file, 2);
+    writer.write(mzqc);
+    file.close();
+}
+
+void MzQCFile::toFile(const std::string& filepath, const std::string& schemaPath,
+                      const CompressionOptions& compression) const {
+    MZQC_STATS_SCOPE("toFile", Serialize);
+    writeFile<FileOutputStream>(*this, filepath, schemaPath, compression);
+}
+
+std::future<std::shared_ptr<MzQCFile>> MzQCFile::loadAsync(const std::string& filepath,
+                                                           const std::string& schemaPath) {
+    auto promise = std::make_shared<std::promise<std::shared_ptr<MzQCFile>>>();
+    auto result = promise->get_future();
+    ThreadPool::shared().submit([promise, filepath, schemaPath]() {
+        try {
+            std::shared_ptr<MzQCFile> loaded;
+            {
+                MZQC_STATS_SCOPE("loadAsync", Parse);
+                AsyncFileInputStream in(filepath);
+                loaded = parseInput(schemaPath.empty() ? nullptr : loadCompiledSchema(schemaPath), true, in);
+            }
+            promise->set_value(std::move(loaded));
+        } catch (...) {
+            promise->set_exception(std::current_exception());
+        }
+    });
+    return result;
+}
+
+std::future<void> MzQCFile::saveAsync(std::shared_ptr<const MzQCFile> file, const std::string& filepath,
+                                      const std::string& schemaPath, const CompressionOptions& compression) {
+    auto promise = std::make_shared<std::promise<void>>();
+    auto result = promise->get_future();
+    ThreadPool::shared().submit([promise, file = std::move(file), filepath, schemaPath, compression]() {
+        try {
+            {
+                MZQC_STATS_SCOPE("saveAsync", Serialize);
+                writeFile<AsyncFileOutputStream>(*file, filepath, schemaPath, compression);
+            }
+            promise->set_value();
+        } catch (...) {
+            promise->set_exception(std::current_exception());
+        }
+    });
+    return result;
+}
 
-    file << j.dump(2);
+std::string MzQCFile::dump(int indent) const {
+    JsonWriter writer(indent);
+    writer.write(*this);
+    return writer.text();
 }
 
 } 
@@ -3,10 +3,19 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <utility>
 #include <optional>
+#include <cstdint>
+#include <string_view>
 #include <map>
 #include <fstream>
+#include <future>
+#include <istream>
 #include <nlohmann/json.hpp>
+#include "mzqc_compress.hpp"
+#include "mzqc_value.hpp"
+#include "mzqc_intern.hpp"
+#include "mzqc_schema.hpp"
 
 namespace mzqc {
 
@@ -23,11 +32,17 @@ class QualityMetric;
 class RunQuality;
 class SetQuality;
 class MzQcFile;
+class MzQCFile;
 class JsonSerializable;
 
 // Function declarations for schema validation
-nlohmann::json loadSchema(const std::string& schemaPath);
+const nlohmann::json& loadSchema(const std::string& schemaPath);
+std::shared_ptr<const CompiledSchema> loadCompiledSchema(const std::string& schemaPath);
 bool validateAgainstSchema(const nlohmann::json& j, const std::string& schemaPath);
+// Number of schema errors collected before validation gives up
+constexpr size_t maxReportedSchemaErrors = 10;
+// Prints schema errors to std::cerr
+void reportSchemaErrors(const std::vector<SchemaError>& errors);
 
 // Base class for JSON serialization
 class JsonSerializable {
@@ -35,6 +50,9 @@ public:
     virtual ~JsonSerializable() = default;
     virtual nlohmann::json toJson() const = 0;
     virtual void fromJson(const nlohmann::json& j) = 0;
+    // Classes holding large values move them out of the tree instead of
+    // copying; j is left valid but unspecified
+    virtual void fromJson(nlohmann::json&& j) { fromJson(static_cast<const nlohmann::json&>(j)); }
 };
 
 // CvTermDetails class
@@ -45,33 +63,75 @@ public:
     std::string accession;     // MS ID
     std::string name;          // Human readable name
     std::string definition;
-    std::vector<std::string> relationships; // ontology relationship
-    std::vector<std::string> parentTerms;
+    std::vector<std::string> relationships; // ontology relationship, e.g. "has_units UO:0000010"
+    std::vector<std::string> parentTerms;   // is_a parent accessions
     std::optional<std::string> valueType;
     std::optional<std::string> unit;
 };
 
 // CvTermCache class
+// Terms are stored densely and found through a flat open-addressing index.
+// The is_a ancestry is closed transitively at load time, so lookup, isA and
+// descendants do not walk the ontology.
 class CvTermCache {
 public:
+    static constexpr uint32_t npos = UINT32_MAX;
+
     CvTermCache() = default;
     
+    // Also interns every term accession and name, see StringInternTable
     int loadFromOboFile(const std::string& filename);
     int parseOboFile(const std::string& filename);
-    
 
+    // Binary snapshot of terms, index and ancestry that loads without parsing
+    bool saveSnapshot(const std::string& filename) const;
+    // Replaces the cache contents, -1 if the file is missing or not a snapshot.
+    // The index and ancestry arrays are taken as stored; the term strings are
+    // copied out of the mapping into CvTermDetails and interned again, so a
+    // load is a copy pass, not a parse and not a zero-copy view.
+    int loadSnapshot(const std::string& filename);
+    // Loads the snapshot if it was written from this OBO file as it is now,
+    // otherwise parses the OBO file and rewrites the snapshot
+    int loadCached(const std::string& oboFile, const std::string& snapshotFile);
+    
+    size_t size() const { return terms.size(); }
+    // Dense id of a term, npos if unknown
+    uint32_t termId(std::string_view accession) const;
+    const CvTermDetails& term(uint32_t id) const { return terms[id]; }
+    // nullptr if the accession is unknown
+    const CvTermDetails* lookup(std::string_view accession) const;
+
+    // True if ancestor is the term itself or reachable through is_a
+    bool isA(uint32_t child, uint32_t ancestor) const;
+    bool isA(std::string_view child, std::string_view ancestor) const;
+    // Transitive is_a children, excluding the term itself
+    std::vector<uint32_t> descendants(uint32_t id) const;
+    std::vector<const CvTermDetails*> descendants(std::string_view accession) const;
     
 private:
+    void addTerm(CvTermDetails&& term);
+    void buildIndex();
+    void buildAncestry();
+    int readSnapshot(const std::string& filename, const std::string* source);
+    void internTerms() const;
+
     std::string currentOboFile;
-    std::map<std::string, CvTermDetails> termCache;
+    std::vector<CvTermDetails> terms;
+    // Open addressing, size is a power of two, holds term ids or npos
+    std::vector<uint32_t> slots;
+    // Sorted transitive ancestors (including self) and descendants, CSR layout
+    std::vector<uint32_t> ancestorOffsets;
+    std::vector<uint32_t> ancestorIds;
+    std::vector<uint32_t> descendantOffsets;
+    std::vector<uint32_t> descendantIds;
 };
 
 // ControlledVocabulary class
 class ControlledVocabulary : public JsonSerializable {
 public:
-    ControlledVocabulary(const std::string& name = "",
-                         const std::string& uri = "",
-                         const std::string& version = "");
+    ControlledVocabulary(std::string name = "",
+                         std::string uri = "",
+                         std::string version = "");
     
     std::string id;
     std::string name;
@@ -87,16 +147,17 @@ class CvParameter : public JsonSerializable {
 public:
     CvParameter(const std::string& accession = "",
                 const std::string& name = "",
-                const std::string& value = "",
+                std::string value = "",
                 const std::string& cvRef = "");
 
-    std::string accession;
-    std::string name;
+    InternedString accession;
+    InternedString name;
     std::string value;
-    std::string cvRef;
+    InternedString cvRef;
 
     nlohmann::json toJson() const override;
     void fromJson(const nlohmann::json& j) override;
+    void fromJson(nlohmann::json&& j) override;
 };
 
 // From PDF: AnalysisSoftware class
@@ -104,25 +165,26 @@ class AnalysisSoftware : public JsonSerializable {
 public:
     AnalysisSoftware(const std::string& accession = "",
                      const std::string& name = "",
-                     const std::string& version = "",
-                     const std::string& uri = "");
+                     std::string version = "",
+                     std::string uri = "");
 
-    std::string accession;
-    std::string name;
+    InternedString accession;
+    InternedString name;
     std::string version;
     std::string uri;
 
     nlohmann::json toJson() const override;
     void fromJson(const nlohmann::json& j) override;
+    void fromJson(nlohmann::json&& j) override;
 };
 
 // From PDF: InputFile class
 class InputFile : public JsonSerializable {
 public:
-    InputFile(const std::string& location = "",
-              const std::string& name = "",
-              const std::shared_ptr<CvParameter>& fileFormat = nullptr,
-              const std::vector<std::shared_ptr<CvParameter>>& fileProperties = {});
+    InputFile(std::string location = "",
+              std::string name = "",
+              std::shared_ptr<CvParameter> fileFormat = nullptr,
+              std::vector<std::shared_ptr<CvParameter>> fileProperties = {});
 
     std::string location;
     std::string name;
@@ -131,6 +193,7 @@ public:
 
     nlohmann::json toJson() const override;
     void fromJson(const nlohmann::json& j) override;
+    void fromJson(nlohmann::json&& j) override;
 };
 
 // From PDF: QualityMetric class
@@ -138,62 +201,98 @@ class QualityMetric : public JsonSerializable {
 public:
     QualityMetric(const std::string& accession = "",
                   const std::string& name = "",
-                  const std::string& description = "",
-                  const nlohmann::json& value = nullptr,
+                  std::string description = "",
+                  MetricValue value = MetricValue(),
                   const std::string& unit = "");
 
-    std::string accession;
-    std::string name;
+    InternedString accession;
+    InternedString name;
     std::string description;
-    nlohmann::json value;
-    std::string unit;
+    MetricValue value;
+    InternedString unit;
 
     nlohmann::json toJson() const override;
     void fromJson(const nlohmann::json& j) override;
+    void fromJson(nlohmann::json&& j) override;
 };
 
 // From PDF: RunQuality class
 class RunQuality : public JsonSerializable {
 public:
-    RunQuality(const std::string& label = "",
-               const std::vector<std::shared_ptr<InputFile>>& inputFiles = {},
-               const std::vector<std::shared_ptr<AnalysisSoftware>>& analysisSoftware = {},
-               const std::vector<std::shared_ptr<QualityMetric>>& metrics = {});
+    RunQuality(std::string label = "",
+               std::vector<std::shared_ptr<InputFile>> inputFiles = {},
+               std::vector<std::shared_ptr<AnalysisSoftware>> analysisSoftware = {},
+               std::vector<std::shared_ptr<QualityMetric>> metrics = {});
 
     std::string label;
     std::vector<std::shared_ptr<InputFile>> inputFiles;
     std::vector<std::shared_ptr<AnalysisSoftware>> analysisSoftware;
     std::vector<std::shared_ptr<QualityMetric>> metrics;
 
+    // Constructs a metric from QualityMetric constructor arguments and
+    // appends it, e.g. addMetric("MS:4000059", "name", "", std::move(values))
+    template <typename... Args>
+    QualityMetric& addMetric(Args&&... args) {
+        metrics.push_back(std::make_shared<QualityMetric>(std::forward<Args>(args)...));
+        return *metrics.back();
+    }
+
     nlohmann::json toJson() const override;
     void fromJson(const nlohmann::json& j) override;
+    void fromJson(nlohmann::json&& j) override;
 };
 
 // From PDF: SetQuality class
 class SetQuality : public JsonSerializable {
 public:
-    SetQuality(const std::string& label = "",
-               const std::vector<std::string>& setRefs = {},
-               const std::vector<std::shared_ptr<QualityMetric>>& metrics = {});
+    SetQuality(std::string label = "",
+               std::vector<std::string> setRefs = {},
+               std::vector<std::shared_ptr<QualityMetric>> metrics = {});
 
     std::string label;
     std::vector<std::string> setRefs;
     std::vector<std::shared_ptr<QualityMetric>> metrics;
 
+    template <typename... Args>
+    QualityMetric& addMetric(Args&&... args) {
+        metrics.push_back(std::make_shared<QualityMetric>(std::forward<Args>(args)...));
+        return *metrics.back();
+    }
+
     nlohmann::json toJson() const override;
     void fromJson(const nlohmann::json& j) override;
+    void fromJson(nlohmann::json&& j) override;
+};
+
+// Binary encodings for toBinary/fromBinary
+enum class BinaryFormat { Cbor, MessagePack };
+
+struct MzQCLoadOptions {
+    // Validate every file against this schema, empty means no validation
+    std::string schemaPath;
+    // Worker threads, 0 uses ThreadPool::shared()
+    unsigned threads = 0;
+};
+
+struct MzQCLoadResult {
+    std::string path;
+    // Null if the file could not be loaded, see error
+    std::shared_ptr<MzQCFile> file;
+    std::string error;
+
+    bool ok() const { return file != nullptr; }
 };
 
 // From PDF: MzQCFile class
 class MzQCFile : public JsonSerializable {
 public:
-    MzQCFile(const std::string& creationDate = "",
-             const std::string& version = "1.0.0",
-             const std::string& contactName = "",
-             const std::string& contactAddress = "",
-             const std::string& description = "",
-             const std::vector<std::shared_ptr<RunQuality>>& runQualities = {},
-             const std::vector<std::shared_ptr<SetQuality>>& setQualities = {});
+    MzQCFile(std::string creationDate = "",
+             std::string version = "1.0.0",
+             std::string contactName = "",
+             std::string contactAddress = "",
+             std::string description = "",
+             std::vector<std::shared_ptr<RunQuality>> runQualities = {},
+             std::vector<std::shared_ptr<SetQuality>> setQualities = {});
 
     std::string creationDate;
     std::string version;
@@ -204,11 +303,65 @@ public:
     std::vector<std::shared_ptr<RunQuality>> runQualities;
     std::vector<std::shared_ptr<SetQuality>> setQualities;
 
+    // Append a run or set built from its constructor arguments
+    template <typename... Args>
+    RunQuality& addRun(Args&&... args) {
+        runQualities.push_back(std::make_shared<RunQuality>(std::forward<Args>(args)...));
+        return *runQualities.back();
+    }
+    template <typename... Args>
+    SetQuality& addSet(Args&&... args) {
+        setQualities.push_back(std::make_shared<SetQuality>(std::forward<Args>(args)...));
+        return *setQualities.back();
+    }
+
     nlohmann::json toJson() const override;
     void fromJson(const nlohmann::json& j) override;
+    void fromJson(nlohmann::json&& j) override;
     static std::shared_ptr<MzQCFile> fromJsonStatic(const nlohmann::json& j);
+    static std::shared_ptr<MzQCFile> fromJsonStatic(nlohmann::json&& j);
     static std::shared_ptr<MzQCFile> fromFile(const std::string& filepath, const std::string& schemaPath = "");
-    void toFile(const std::string& filepath, const std::string& schemaPath = "") const;
+    // Streaming load: objects are filled from SAX events, no document tree is built
+    static std::shared_ptr<MzQCFile> fromStream(std::istream& in, const std::string& schemaPath = "");
+    // Loads files concurrently; results are in the order of paths and a
+    // failing file is reported in its result instead of throwing
+    static std::vector<MzQCLoadResult> loadMany(const std::vector<std::string>& paths,
+                                                const MzQCLoadOptions& options = MzQCLoadOptions());
+    // Single large file: the runQualities and setQualities elements are
+    // located by a structural pre-scan of the mapped file and parsed in parallel.
+    // Gives the same result as fromFile, which it falls back to for unusual layouts.
+    static std::shared_ptr<MzQCFile> fromFileParallel(const std::string& filepath,
+                                                      const MzQCLoadOptions& options = MzQCLoadOptions());
+    // Compressed by default when the path ends in ".gz" or ".zst"; fromFile and
+    // the other loaders recognise compressed input by its magic bytes
+    void toFile(const std::string& filepath, const std::string& schemaPath = "",
+                const CompressionOptions& compression = CompressionOptions()) const;
+    // Same text as toJson().dump(indent), serialized without building the tree
+    std::string dump(int indent = -1) const;
+    // fromFile and toFile without blocking the caller: the work runs on
+    // ThreadPool::shared() and the file is read or written in large chunks on
+    // ioThreadPool(), one chunk ahead of the parse or behind the serializer.
+    // Errors, including schema errors, are rethrown by the future's get().
+    static std::future<std::shared_ptr<MzQCFile>> loadAsync(const std::string& filepath,
+                                                            const std::string& schemaPath = "");
+    // file is kept alive until the future is ready and must not change before
+    static std::future<void> saveAsync(std::shared_ptr<const MzQCFile> file, const std::string& filepath,
+                                       const std::string& schemaPath = "",
+                                       const CompressionOptions& compression = CompressionOptions());
+
+    // Same content as toJson in CBOR or MessagePack. Numeric arrays and
+    // numeric table columns are stored as raw little-endian buffers with
+    // RFC 8746 typed-array tags (ext types in MessagePack), so they load with
+    // one copy. CBOR output starts with the self-describe tag 55799.
+    std::vector<uint8_t> toBinary(BinaryFormat format = BinaryFormat::Cbor) const;
+    void toBinaryFile(const std::string& filepath, BinaryFormat format = BinaryFormat::Cbor) const;
+    // Throws std::runtime_error on malformed input
+    static std::shared_ptr<MzQCFile> fromBinary(const uint8_t* data, size_t size,
+                                                BinaryFormat format = BinaryFormat::Cbor);
+    static std::shared_ptr<MzQCFile> fromBinary(const std::vector<uint8_t>& data,
+                                                BinaryFormat format = BinaryFormat::Cbor);
+    static std::shared_ptr<MzQCFile> fromBinaryFile(const std::string& filepath,
+                                                    BinaryFormat format = BinaryFormat::Cbor);
 
     static std::string getCurrentIsoTime();
 };
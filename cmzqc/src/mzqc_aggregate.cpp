@@ -0,0 +1,251 @@
+#include "mzqc_aggregate.hpp"
+#include "mzqc_parallel.hpp"
+#include "mzqc_stream.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+namespace mzqc {
+
+static constexpr double nan = std::numeric_limits<double>::quiet_NaN();
+
+// MetricAggregate implementation
+MetricAggregate::MetricAggregate(double compression) : distribution(compression) {}
+
+void MetricAggregate::add(const double* values, size_t count) {
+    ++runCount;
+    for (size_t i = 0; i < count; ++i) {
+        const double value = values[i];
+        if (std::isnan(value)) continue;
+        // Welford's update
+        ++valueCount;
+        const double delta = value - average;
+        average += delta / static_cast<double>(valueCount);
+        m2 += delta * (value - average);
+        distribution.add(value);
+    }
+}
+
+void MetricAggregate::merge(const MetricAggregate& other) {
+    runCount += other.runCount;
+    if (other.valueCount == 0) return;
+    const double n = static_cast<double>(valueCount);
+    const double m = static_cast<double>(other.valueCount);
+    const double delta = other.average - average;
+    valueCount += other.valueCount;
+    average += delta * m / (n + m);
+    m2 += other.m2 + delta * delta * n * m / (n + m);
+    distribution.merge(other.distribution);
+}
+
+double MetricAggregate::mean() const {
+    return valueCount == 0 ? nan : average;
+}
+
+double MetricAggregate::stddev() const {
+    return valueCount < 2 ? nan : std::sqrt(m2 / static_cast<double>(valueCount - 1));
+}
+
+nlohmann::json MetricAggregate::toJson() const {
+    return {
+        {"runs", runCount},
+        {"count", valueCount},
+        {"mean", average},
+        {"m2", m2},
+        {"sketch", distribution.toJson()},
+    };
+}
+
+MetricAggregate MetricAggregate::fromJson(const nlohmann::json& j) {
+    if (!j.is_object() || !j.contains("runs") || !j.contains("count") || !j.contains("sketch")) {
+        throw std::runtime_error("Not a metric aggregate");
+    }
+    MetricAggregate aggregate;
+    aggregate.runCount = j.at("runs").get<size_t>();
+    aggregate.valueCount = j.at("count").get<size_t>();
+    aggregate.average = j.value("mean", 0.0);
+    aggregate.m2 = j.value("m2", 0.0);
+    aggregate.distribution = QuantileSketch::fromJson(j.at("sketch"));
+    if (aggregate.m2 < 0 || aggregate.distribution.count() != static_cast<double>(aggregate.valueCount)) {
+        throw std::runtime_error("Metric aggregate counts do not match its sketch");
+    }
+    return aggregate;
+}
+
+// SetAggregate implementation
+SetAggregate::SetAggregate(const SetAggregateOptions& options) : options(options) {
+    std::sort(this->options.accessions.begin(), this->options.accessions.end());
+}
+
+void SetAggregate::addMetric(const QualityMetric& metric) {
+    const std::string& accession = metric.accession;
+    if (!options.accessions.empty() &&
+        !std::binary_search(options.accessions.begin(), options.accessions.end(), accession)) {
+        return;
+    }
+
+    std::vector<double> converted;
+    const double* values = nullptr;
+    size_t count = 0;
+    if (const auto* doubles = metric.value.doubles()) {
+        values = doubles->data();
+        count = doubles->size();
+    } else if (const auto* integers = metric.value.integers()) {
+        converted.assign(integers->begin(), integers->end());
+        values = converted.data();
+        count = converted.size();
+    } else if (const auto* json = metric.value.json(); json && json->is_number()) {
+        converted.push_back(json->get<double>());
+        values = converted.data();
+        count = 1;
+    } else {
+        return;
+    }
+
+    auto it = metrics.find(accession);
+    if (it == metrics.end()) {
+        it = metrics.emplace(accession, Entry{metric.name, metric.unit, MetricAggregate(options.sketchCompression)})
+                 .first;
+    }
+    it->second.values.add(values, count);
+}
+
+void SetAggregate::add(const RunQuality& run) {
+    labels.push_back(run.label);
+    for (const auto& metric : run.metrics) {
+        if (metric) addMetric(*metric);
+    }
+}
+
+void SetAggregate::addFile(const std::string& filepath) {
+    class Visitor : public MzQCVisitor {
+    public:
+        explicit Visitor(SetAggregate& aggregate) : aggregate(aggregate) {}
+        bool visitRunMetric(const RunQuality& /*run*/, const std::shared_ptr<QualityMetric>& metric) override {
+            aggregate.addMetric(*metric);
+            return true;
+        }
+        // The label is complete only once the run is
+        bool visitRun(const std::shared_ptr<RunQuality>& run) override {
+            aggregate.labels.push_back(run->label);
+            return true;
+        }
+        SetAggregate& aggregate;
+    };
+
+    MzQCReaderOptions readerOptions;
+    readerOptions.accessions = options.accessions;
+    Visitor visitor(*this);
+    MzQCReader(readerOptions).readFile(filepath, visitor);
+}
+
+void SetAggregate::addFiles(const std::vector<std::string>& filepaths) {
+    std::vector<SetAggregate> partials(filepaths.size(), SetAggregate(options));
+    std::unique_ptr<ThreadPool> ownPool;
+    if (options.threads != 0) ownPool = std::make_unique<ThreadPool>(options.threads);
+    ThreadPool& pool = ownPool ? *ownPool : ThreadPool::shared();
+    pool.parallelFor(filepaths.size(), [&](size_t i) { partials[i].addFile(filepaths[i]); });
+    for (const auto& partial : partials) merge(partial);
+}
+
+void SetAggregate::merge(const SetAggregate& other) {
+    if (options.accessions != other.options.accessions) {
+        throw std::runtime_error("Cannot merge set aggregates of different accessions");
+    }
+    labels.insert(labels.end(), other.labels.begin(), other.labels.end());
+    for (const auto& [accession, entry] : other.metrics) {
+        auto it = metrics.find(accession);
+        if (it == metrics.end()) {
+            metrics.emplace(accession, entry);
+        } else {
+            it->second.values.merge(entry.values);
+        }
+    }
+}
+
+const MetricAggregate* SetAggregate::aggregate(const std::string& accession) const {
+    auto it = metrics.find(accession);
+    return it == metrics.end() ? nullptr : &it->second.values;
+}
+
+nlohmann::json SetAggregate::toJson() const {
+    nlohmann::json list = nlohmann::json::array();
+    for (const auto& [accession, entry] : metrics) {
+        nlohmann::json j = entry.values.toJson();
+        j["accession"] = accession;
+        j["name"] = entry.name.str();
+        if (!entry.unit.empty()) j["unit"] = entry.unit.str();
+        list.push_back(std::move(j));
+    }
+    return {
+        {"accessions", options.accessions},
+        {"compression", options.sketchCompression},
+        {"runs", labels},
+        {"metrics", std::move(list)},
+    };
+}
+
+SetAggregate SetAggregate::fromJson(const nlohmann::json& j) {
+    if (!j.is_object() || !j.contains("runs") || !j.contains("metrics")) {
+        throw std::runtime_error("Not a set aggregate");
+    }
+    SetAggregateOptions options;
+    options.accessions = j.value("accessions", std::vector<std::string>());
+    options.sketchCompression = j.value("compression", options.sketchCompression);
+    SetAggregate aggregate(options);
+    aggregate.labels = j.at("runs").get<std::vector<std::string>>();
+    for (const auto& metric : j.at("metrics")) {
+        const std::string accession = metric.value("accession", "");
+        if (accession.empty()) {
+            throw std::runtime_error("Set aggregate metric without accession");
+        }
+        aggregate.metrics.emplace(accession, Entry{metric.value("name", ""), metric.value("unit", ""),
+                                                   MetricAggregate::fromJson(metric)});
+    }
+    return aggregate;
+}
+
+std::vector<uint8_t> SetAggregate::toBinary(BinaryFormat format) const {
+    const nlohmann::json j = toJson();
+    return format == BinaryFormat::Cbor ? nlohmann::json::to_cbor(j) : nlohmann::json::to_msgpack(j);
+}
+
+SetAggregate SetAggregate::fromBinary(const std::vector<uint8_t>& data, BinaryFormat format) {
+    try {
+        return fromJson(format == BinaryFormat::Cbor ? nlohmann::json::from_cbor(data)
+                                                     : nlohmann::json::from_msgpack(data));
+    } catch (const nlohmann::json::exception& e) {
+        throw std::runtime_error(std::string("Invalid set aggregate: ") + e.what());
+    }
+}
+
+std::shared_ptr<SetQuality> SetAggregate::toSetQuality(const std::string& label,
+                                                       const std::map<std::string, SetMetricTerm>& terms) const {
+    auto set = std::make_shared<SetQuality>(label, labels);
+    for (const auto& [accession, entry] : metrics) {
+        auto term = terms.find(accession);
+        if (term == terms.end()) continue;
+        const MetricAggregate& values = entry.values;
+        const QuantileSketch& sketch = values.sketch();
+        const std::vector<double> quartiles = sketch.quantiles({0.25, 0.5, 0.75});
+        MetricTable table;
+        table.addColumn("runs", std::vector<int64_t>{static_cast<int64_t>(values.runs())});
+        table.addColumn("values", std::vector<int64_t>{static_cast<int64_t>(values.count())});
+        table.addColumn("mean", std::vector<double>{values.mean()});
+        table.addColumn("stddev", std::vector<double>{values.stddev()});
+        table.addColumn("min", std::vector<double>{sketch.min()});
+        table.addColumn("Q1", std::vector<double>{quartiles[0]});
+        table.addColumn("median", std::vector<double>{quartiles[1]});
+        table.addColumn("Q3", std::vector<double>{quartiles[2]});
+        table.addColumn("max", std::vector<double>{sketch.max()});
+        set->addMetric(term->second.accession, term->second.name,
+                       "Summary of " + entry.name.str() + " (" + accession + ") over " +
+                           std::to_string(values.runs()) + " runs",
+                       std::move(table), entry.unit);
+    }
+    return set;
+}
+
+} // namespace mzqc
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "mzqc.hpp"
+#include "mzqc_sketch.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+namespace mzqc {
+
+// Statistics of the numeric values of one metric across runs. Count, mean
+// and variance are exact and merge with Chan's pairwise update; quantiles
+// come from a QuantileSketch.
+class MetricAggregate {
+public:
+    explicit MetricAggregate(double compression = 100);
+
+    // NaN values are ignored
+    void add(const double* values, size_t count);
+    void merge(const MetricAggregate& other);
+
+    // Runs that reported the metric and values taken from them
+    size_t runs() const { return runCount; }
+    size_t count() const { return valueCount; }
+    // NaN if empty
+    double mean() const;
+    // Sample standard deviation, NaN with fewer than two values
+    double stddev() const;
+    const QuantileSketch& sketch() const { return distribution; }
+
+    nlohmann::json toJson() const;
+    // Throws std::runtime_error if the json is not an aggregate
+    static MetricAggregate fromJson(const nlohmann::json& j);
+
+private:
+    size_t runCount = 0;
+    size_t valueCount = 0;
+    double average = 0;
+    // Sum of squared differences from the mean
+    double m2 = 0;
+    QuantileSketch distribution;
+};
+
+struct SetAggregateOptions {
+    // Run metrics aggregated, empty means every metric with a numeric value
+    std::vector<std::string> accessions;
+    double sketchCompression = 100;
+    // Worker threads for addFiles, 0 uses ThreadPool::shared()
+    unsigned threads = 0;
+};
+
+// CV term a set-level summary is reported under
+struct SetMetricTerm {
+    std::string accession;
+    std::string name;
+};
+
+// Map/reduce aggregation of run metrics into set-level metrics. Each node
+// adds its shard of runs to a SetAggregate, ships toBinary() to a reducer,
+// which merges the partials and turns the result into a SetQuality. Merging
+// is associative, so partials can be combined in any tree; the run labels
+// keep the order of the merges. Single numbers and numeric arrays are
+// aggregated, table and other values are skipped.
+class SetAggregate {
+public:
+    explicit SetAggregate(const SetAggregateOptions& options = SetAggregateOptions());
+
+    void add(const RunQuality& run);
+    // Streams the runs of the file, no MzQCFile is built
+    void addFile(const std::string& filepath);
+    // Files are read in parallel and added in the order of paths
+    void addFiles(const std::vector<std::string>& filepaths);
+    // Throws std::runtime_error if the partials were built with different
+    // accession filters
+    void merge(const SetAggregate& other);
+
+    size_t runCount() const { return labels.size(); }
+    const std::vector<std::string>& runLabels() const { return labels; }
+    // nullptr if no run had a numeric value for the accession
+    const MetricAggregate* aggregate(const std::string& accession) const;
+
+    // Partial result for the reducer; fromJson and fromBinary throw
+    // std::runtime_error on anything else
+    nlohmann::json toJson() const;
+    static SetAggregate fromJson(const nlohmann::json& j);
+    std::vector<uint8_t> toBinary(BinaryFormat format = BinaryFormat::Cbor) const;
+    static SetAggregate fromBinary(const std::vector<uint8_t>& data, BinaryFormat format = BinaryFormat::Cbor);
+
+    // One metric per aggregated run accession found in terms, reported under
+    // the set-level term mapped to it and with the unit of the run metrics.
+    // A run term describes a per-run value, not this summary, so it is never
+    // reused; aggregates without a term are left out. The value is a one-row
+    // table with the columns runs, values, mean, stddev, min, Q1, median, Q3
+    // and max. setRefs are the run labels.
+    std::shared_ptr<SetQuality> toSetQuality(const std::string& label,
+                                             const std::map<std::string, SetMetricTerm>& terms) const;
+
+private:
+    struct Entry {
+        InternedString name;
+        InternedString unit;
+        MetricAggregate values;
+    };
+
+    void addMetric(const QualityMetric& metric);
+
+    SetAggregateOptions options;
+    std::vector<std::string> labels;
+    // Sorted by accession so output does not depend on the merge order
+    std::map<std::string, Entry> metrics;
+};
+
+} // namespace mzqc
@@ -0,0 +1,225 @@
+#include "mzqc_async.hpp"
+#include "mzqc_parallel.hpp"
+#include "mzqc_stats.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <utility>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace mzqc {
+
+static constexpr size_t pageSize = 4096;
+
+ThreadPool& ioThreadPool() {
+    // Threads mostly sleep in read and write calls; a few keep several
+    // loads and saves going at once
+    static ThreadPool pool(4);
+    return pool;
+}
+
+// Runs task on the I/O pool; the future gets its result
+template <typename Result, typename Task>
+static std::future<Result> submitIo(Task task) {
+    auto promise = std::make_shared<std::promise<Result>>();
+    std::future<Result> result = promise->get_future();
+    ioThreadPool().submit([promise, task = std::move(task)]() { promise->set_value(task()); });
+    return result;
+}
+
+// AlignedBuffer implementation
+AlignedBuffer::AlignedBuffer(size_t size)
+    : memory(static_cast<char*>(std::aligned_alloc(pageSize, (size + pageSize - 1) / pageSize * pageSize))),
+      length(size) {
+    if (!memory) throw std::bad_alloc();
+}
+
+// ReadAheadStreamBuf implementation
+ReadAheadStreamBuf::ReadAheadStreamBuf(const std::string& filepath, size_t chunkSize)
+    : path(filepath), current(chunkSize), next(chunkSize) {
+    fd = ::open(filepath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open file: " + filepath);
+    }
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    setg(current.data(), current.data(), current.data());
+    startRead();
+}
+
+ReadAheadStreamBuf::~ReadAheadStreamBuf() {
+    if (pending.valid()) pending.wait();
+    ::close(fd);
+}
+
+void ReadAheadStreamBuf::startRead() {
+    // Short reads, as on network file systems, are retried until the chunk
+    // is full or the file ends
+    pending = submitIo<ssize_t>([fd = fd, data = next.data(), size = next.size(), start = offset]() -> ssize_t {
+        size_t done = 0;
+        while (done < size) {
+            ssize_t n = ::pread(fd, data + done, size - done, static_cast<off_t>(start + done));
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) return -errno;
+            if (n == 0) break;
+            done += static_cast<size_t>(n);
+        }
+        return static_cast<ssize_t>(done);
+    });
+}
+
+ReadAheadStreamBuf::int_type ReadAheadStreamBuf::underflow() {
+    if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+    if (!pending.valid()) return traits_type::eof();
+
+    ssize_t n;
+    {
+        MZQC_STATS_PHASE(Read, 0);
+        n = pending.get();
+    }
+    if (n < 0) {
+        throw std::runtime_error("Error reading file " + path + ": " + std::strerror(static_cast<int>(-n)));
+    }
+    if (n == 0) return traits_type::eof();
+#ifdef MZQC_ENABLE_STATS
+    if (StatsScope* scope = StatsScope::current()) scope->addPhase(StatsPhase::Read, 0, static_cast<uint64_t>(n));
+#endif
+
+    std::swap(current, next);
+    offset += n;
+    // A short chunk was the end of the file
+    if (static_cast<size_t>(n) == current.size()) startRead();
+    setg(current.data(), current.data(), current.data() + n);
+    return traits_type::to_int_type(*gptr());
+}
+
+size_t ReadAheadStreamBuf::peek(char* data, size_t size) {
+    if (traits_type::eq_int_type(sgetc(), traits_type::eof())) return 0;
+    size = std::min(size, static_cast<size_t>(egptr() - gptr()));
+    std::memcpy(data, gptr(), size);
+    return size;
+}
+
+// WriteBehindStreamBuf implementation
+WriteBehindStreamBuf::WriteBehindStreamBuf(const std::string& filepath, size_t chunkSize)
+    : path(filepath), current(chunkSize), writing(chunkSize) {
+    fd = ::open(filepath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open file for writing: " + filepath);
+    }
+    setp(current.data(), current.data() + current.size());
+}
+
+WriteBehindStreamBuf::~WriteBehindStreamBuf() {
+    wait();
+    if (fd >= 0) ::close(fd);
+}
+
+bool WriteBehindStreamBuf::wait() {
+    if (pending.valid()) {
+        MZQC_STATS_PHASE(Write, 0);
+        if (!pending.get()) failed = true;
+    }
+    return !failed;
+}
+
+bool WriteBehindStreamBuf::handOff() {
+    if (!wait()) return false;
+    const size_t size = static_cast<size_t>(pptr() - pbase());
+    if (size == 0) return true;
+    std::swap(current, writing);
+    setp(current.data(), current.data() + current.size());
+    pending = submitIo<bool>([fd = fd, data = writing.data(), size]() {
+        size_t done = 0;
+        while (done < size) {
+            ssize_t n = ::write(fd, data + done, size - done);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            done += static_cast<size_t>(n);
+        }
+        return true;
+    });
+    return true;
+}
+
+WriteBehindStreamBuf::int_type WriteBehindStreamBuf::overflow(int_type ch) {
+    if (!handOff()) return traits_type::eof();
+    if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(ch);
+        pbump(1);
+    }
+    return traits_type::not_eof(ch);
+}
+
+int WriteBehindStreamBuf::sync() {
+    return handOff() && wait() ? 0 : -1;
+}
+
+void WriteBehindStreamBuf::finish() {
+    if (fd < 0) return;
+    const bool ok = sync() == 0;
+    const bool closed = ::close(fd) == 0;
+    fd = -1;
+    if (!ok || !closed) {
+        throw std::runtime_error("Error writing file " + path);
+    }
+}
+
+// AsyncFileInputStream implementation
+AsyncFileInputStream::AsyncFileInputStream(const std::string& filepath) : std::istream(nullptr), file(filepath) {
+    char magic[4];
+    const Compression type = detectCompression(magic, file.peek(magic, sizeof(magic)));
+    if (type == Compression::None) {
+        rdbuf(&file);
+        return;
+    }
+    if (!compressionAvailable(type)) {
+        throw std::runtime_error(filepath + ": compressed input support is not compiled in");
+    }
+    decompressor = std::make_unique<DecompressingStreamBuf>(file, type);
+    rdbuf(decompressor.get());
+}
+
+AsyncFileInputStream::~AsyncFileInputStream() = default;
+
+// AsyncFileOutputStream implementation
+AsyncFileOutputStream::AsyncFileOutputStream(const std::string& filepath, const CompressionOptions& options)
+    : std::ostream(nullptr), file(filepath) {
+    const Compression type = options.type == Compression::Auto ? compressionForPath(filepath) : options.type;
+    if (type == Compression::None) {
+        rdbuf(&file);
+        return;
+    }
+    compressor = std::make_unique<CompressingStreamBuf>(file, type, options.level, options.threads);
+    rdbuf(compressor.get());
+}
+
+AsyncFileOutputStream::~AsyncFileOutputStream() {
+    try {
+        close();
+    } catch (...) {
+        // close() explicitly to see write errors
+    }
+}
+
+void AsyncFileOutputStream::close() {
+    if (closed) return;
+    closed = true;
+    MZQC_STATS_PHASE(Write, 0);
+    bool ok = static_cast<bool>(*this);
+    if (compressor) compressor->finish();
+    try {
+        file.finish();
+    } catch (...) {
+        setstate(std::ios::badbit);
+        throw;
+    }
+    if (!ok) {
+        setstate(std::ios::badbit);
+        throw std::runtime_error("Error writing file");
+    }
+}
+
+} // namespace mzqc
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "mzqc_compress.hpp"
+#include <cstddef>
+#include <cstdlib>
+#include <future>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <sys/types.h>
+
+namespace mzqc {
+
+class ThreadPool;
+
+// Small pool that runs the blocking reads and writes of the async streams,
+// separate from ThreadPool::shared() so parse and serialize tasks never wait
+// behind I/O and I/O never waits for them
+ThreadPool& ioThreadPool();
+
+// Page-aligned chunk of memory for large reads and writes
+class AlignedBuffer {
+public:
+    explicit AlignedBuffer(size_t size);
+
+    char* data() { return memory.get(); }
+    size_t size() const { return length; }
+
+private:
+    struct Free {
+        void operator()(char* p) const { std::free(p); }
+    };
+    std::unique_ptr<char, Free> memory;
+    size_t length;
+};
+
+constexpr size_t asyncChunkSize = 4 << 20;
+
+// Reads a file in large chunks on ioThreadPool(), one chunk ahead of the
+// reader, so parsing the current chunk overlaps reading the next
+class ReadAheadStreamBuf : public std::streambuf {
+public:
+    // Throws std::runtime_error "Could not open file: <path>"
+    explicit ReadAheadStreamBuf(const std::string& filepath, size_t chunkSize = asyncChunkSize);
+    // Waits for the read in flight
+    ~ReadAheadStreamBuf() override;
+    ReadAheadStreamBuf(const ReadAheadStreamBuf&) = delete;
+    ReadAheadStreamBuf& operator=(const ReadAheadStreamBuf&) = delete;
+
+    // Copies up to size bytes from the read position without consuming them
+    size_t peek(char* data, size_t size);
+
+protected:
+    // Throws std::runtime_error on read errors
+    int_type underflow() override;
+
+private:
+    void startRead();
+
+    std::string path;
+    int fd = -1;
+    off_t offset = 0;
+    AlignedBuffer current;
+    AlignedBuffer next;
+    std::future<ssize_t> pending;
+};
+
+// Buffers writes into large chunks and writes each on ioThreadPool() while
+// the caller fills the next one
+class WriteBehindStreamBuf : public std::streambuf {
+public:
+    // Throws std::runtime_error "Could not open file for writing: <path>"
+    explicit WriteBehindStreamBuf(const std::string& filepath, size_t chunkSize = asyncChunkSize);
+    // Closes the file, call finish() to see errors
+    ~WriteBehindStreamBuf() override;
+    WriteBehindStreamBuf(const WriteBehindStreamBuf&) = delete;
+    WriteBehindStreamBuf& operator=(const WriteBehindStreamBuf&) = delete;
+
+    // Writes the rest and closes the file; throws std::runtime_error on write errors
+    void finish();
+
+protected:
+    int_type overflow(int_type ch) override;
+    // Waits until everything buffered is written
+    int sync() override;
+
+private:
+    // Waits for the write in flight, false if it failed
+    bool wait();
+    // Starts writing the filled buffer and switches to the other one
+    bool handOff();
+
+    std::string path;
+    int fd = -1;
+    AlignedBuffer current;
+    AlignedBuffer writing;
+    std::future<bool> pending;
+    bool failed = false;
+};
+
+// FileInputStream over a ReadAheadStreamBuf, plain, gzip and zstd alike
+class AsyncFileInputStream : public std::istream {
+public:
+    explicit AsyncFileInputStream(const std::string& filepath);
+    ~AsyncFileInputStream() override;
+
+private:
+    ReadAheadStreamBuf file;
+    std::unique_ptr<DecompressingStreamBuf> decompressor;
+};
+
+// FileOutputStream over a WriteBehindStreamBuf
+class AsyncFileOutputStream : public std::ostream {
+public:
+    explicit AsyncFileOutputStream(const std::string& filepath,
+                                   const CompressionOptions& options = CompressionOptions());
+    ~AsyncFileOutputStream() override;
+
+    // Completes the compressed frame and closes the file, throws on write errors
+    void close();
+
+private:
+    WriteBehindStreamBuf file;
+    std::unique_ptr<CompressingStreamBuf> compressor;
+    bool closed = false;
+};
+
+} // namespace mzqc
@@ -0,0 +1,200 @@
+#include "mzqc.hpp"
+#include "mzqc_mmap.hpp"
+#include "mzqc_stream.hpp"
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+namespace mzqc {
+
+// CBOR self-describe tag 55799, marks a file as CBOR
+static const uint8_t cborMagic[] = {0xd9, 0xd9, 0xf7};
+
+// Writes the head of a CBOR item with major type major (0-7) and argument
+// value, using size bytes (1, 2, 3, 5 or 9) where the minimal form is shorter
+static void writeHead(std::vector<uint8_t>& out, uint8_t major, uint64_t value, size_t size) {
+    major = static_cast<uint8_t>(major << 5);
+    if (size == 1) {
+        out.push_back(static_cast<uint8_t>(major | value));
+        return;
+    }
+    size_t bytes = size - 1;
+    out.push_back(static_cast<uint8_t>(major | (bytes == 1 ? 24 : bytes == 2 ? 25 : bytes == 4 ? 26 : 27)));
+    for (size_t i = bytes; i-- > 0;) {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+static size_t minimalHead(uint64_t value) {
+    return value < 24 ? 1 : value <= 0xff ? 2 : value <= 0xffff ? 3 : value <= 0xffffffff ? 5 : 9;
+}
+
+// CBOR like to_cbor, except that a typed array in an object starts at a
+// multiple of 8 from the beginning of the output, so MappedMzQC can hand out
+// pointers into a mapped file. Heads of the key, tag and byte string are
+// lengthened as needed; non-minimal heads are still valid CBOR.
+static void writeAlignedCbor(const nlohmann::json& j, std::vector<uint8_t>& out) {
+    if (j.is_array()) {
+        writeHead(out, 4, j.size(), minimalHead(j.size()));
+        for (const auto& element : j) writeAlignedCbor(element, out);
+        return;
+    }
+    if (!j.is_object()) {
+        nlohmann::json::to_cbor(j, out);
+        return;
+    }
+
+    static const size_t heads[] = {1, 2, 3, 5, 9};
+    writeHead(out, 5, j.size(), minimalHead(j.size()));
+    for (auto it = j.begin(); it != j.end(); ++it) {
+        const std::string& key = it.key();
+        const nlohmann::json& value = it.value();
+        size_t keyHead = minimalHead(key.size());
+        size_t tagHead = 2;
+        size_t lengthHead = 0;
+        bool typed = value.is_binary() && value.get_binary().has_subtype() &&
+                     (value.get_binary().subtype() == typedArrayFloat64 ||
+                      value.get_binary().subtype() == typedArraySint64);
+        if (typed) {
+            const size_t size = value.get_binary().size();
+            bool found = false;
+            for (size_t k : heads) {
+                for (size_t t : heads) {
+                    for (size_t l : heads) {
+                        if (found || k < minimalHead(key.size()) || t < 2 || l < minimalHead(size)) continue;
+                        if ((out.size() + k + key.size() + t + l) % 8 == 0) {
+                            keyHead = k;
+                            tagHead = t;
+                            lengthHead = l;
+                            found = true;
+                        }
+                    }
+                }
+            }
+        }
+
+        writeHead(out, 3, key.size(), keyHead);
+        out.insert(out.end(), key.begin(), key.end());
+        if (typed && lengthHead != 0) {
+            const auto& bytes = value.get_binary();
+            writeHead(out, 6, bytes.subtype(), tagHead);
+            writeHead(out, 2, bytes.size(), lengthHead);
+            out.insert(out.end(), bytes.begin(), bytes.end());
+        } else {
+            writeAlignedCbor(value, out);
+        }
+    }
+}
+
+// Mirrors QualityMetric::toJson with the value in typed form
+static nlohmann::json typedMetric(const QualityMetric& metric) {
+    nlohmann::json j;
+    j["accession"] = metric.accession.str();
+    j["name"] = metric.name.str();
+    if (!metric.description.empty()) {
+        j["description"] = metric.description;
+    }
+    if (!metric.value.is_null()) {
+        j["value"] = metric.value.toTypedJson();
+    }
+    if (!metric.unit.empty()) {
+        j["unit"] = metric.unit.str();
+    }
+    return j;
+}
+
+static nlohmann::json typedMetrics(const std::vector<std::shared_ptr<QualityMetric>>& metrics) {
+    nlohmann::json j = nlohmann::json::array();
+    for (const auto& metric : metrics) {
+        j.push_back(typedMetric(*metric));
+    }
+    return j;
+}
+
+std::vector<uint8_t> MzQCFile::toBinary(BinaryFormat format) const {
+    // Runs and sets are built without metrics first, toJson of the metrics
+    // would convert every numeric array only to throw it away
+    MzQCFile shell = *this;
+    auto strip = [](auto& qualities) {
+        for (auto& quality : qualities) {
+            auto copy = std::make_shared<typename std::decay<decltype(*quality)>::type>(*quality);
+            copy->metrics.clear();
+            quality = std::move(copy);
+        }
+    };
+    strip(shell.runQualities);
+    strip(shell.setQualities);
+    nlohmann::json j = shell.toJson();
+    nlohmann::json& mzqc = j["mzQC"];
+    for (size_t i = 0; i < runQualities.size(); ++i) {
+        mzqc["runQualities"][i]["metrics"] = typedMetrics(runQualities[i]->metrics);
+    }
+    for (size_t i = 0; i < setQualities.size(); ++i) {
+        mzqc["setQualities"][i]["metrics"] = typedMetrics(setQualities[i]->metrics);
+    }
+
+    std::vector<uint8_t> out;
+    if (format == BinaryFormat::Cbor) {
+        out.assign(std::begin(cborMagic), std::end(cborMagic));
+        writeAlignedCbor(j, out);
+    } else {
+        nlohmann::json::to_msgpack(j, out);
+    }
+    return out;
+}
+
+void MzQCFile::toBinaryFile(const std::string& filepath, BinaryFormat format) const {
+    std::vector<uint8_t> data = toBinary(format);
+    std::ofstream file(filepath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open file for writing: " + filepath);
+    }
+    file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    if (!file) {
+        throw std::runtime_error("Failed to write file: " + filepath);
+    }
+}
+
+std::shared_ptr<MzQCFile> MzQCFile::fromBinary(const uint8_t* data, size_t size, BinaryFormat format) {
+    if (format == BinaryFormat::Cbor && size >= sizeof(cborMagic) &&
+        std::equal(std::begin(cborMagic), std::end(cborMagic), data)) {
+        data += sizeof(cborMagic);
+        size -= sizeof(cborMagic);
+    }
+
+    auto file = std::make_shared<MzQCFile>();
+    const auto tags = nlohmann::json::cbor_tag_handler_t::store;
+#if NLOHMANN_JSON_VERSION_MAJOR == 3 && NLOHMANN_JSON_VERSION_MINOR == 11
+    // The public sax_parse rejects CBOR tags, the reader underneath can hand
+    // them to the handler as binary subtypes. It is internal to nlohmann_json
+    // and takes the input format in its constructor only from 3.11 on.
+    MzQCSaxHandler handler(*file);
+    const auto inputFormat = format == BinaryFormat::Cbor ? nlohmann::json::input_format_t::cbor
+                                                          : nlohmann::json::input_format_t::msgpack;
+    auto adapter = nlohmann::detail::input_adapter(data, data + size);
+    nlohmann::detail::binary_reader<nlohmann::json, decltype(adapter), MzQCSaxHandler> reader(std::move(adapter),
+                                                                                              inputFormat);
+    reader.sax_parse(inputFormat, &handler, true, tags);
+#else
+    // Other versions build the tree first; typed arrays arrive as binaries
+    // with their tag as subtype, which MetricValue turns into typed storage
+    nlohmann::json j = format == BinaryFormat::Cbor ? nlohmann::json::from_cbor(data, data + size, true, true, tags)
+                                                    : nlohmann::json::from_msgpack(data, data + size);
+    file->fromJson(std::move(j));
+#endif
+    return file;
+}
+
+std::shared_ptr<MzQCFile> MzQCFile::fromBinary(const std::vector<uint8_t>& data, BinaryFormat format) {
+    return fromBinary(data.data(), data.size(), format);
+}
+
+std::shared_ptr<MzQCFile> MzQCFile::fromBinaryFile(const std::string& filepath, BinaryFormat format) {
+    MappedFile mapped;
+    if (!mapped.open(filepath)) {
+        throw std::runtime_error("Could not open file: " + filepath);
+    }
+    return fromBinary(reinterpret_cast<const uint8_t*>(mapped.data()), mapped.size(), format);
+}
+
+} // namespace mzqc
@@ -0,0 +1,409 @@
+#include "mzqc_compress.hpp"
+#include "mzqc_stats.hpp"
+#include <cstring>
+#include <stdexcept>
+#ifdef MZQC_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef MZQC_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace mzqc {
+
+static constexpr size_t chunkSize = 1 << 18;
+
+static const char* compressionName(Compression type) {
+    return type == Compression::Gzip ? "gzip" : "zstd";
+}
+
+static bool endsWith(const std::string& text, const char* suffix) {
+    size_t n = std::strlen(suffix);
+    return text.size() >= n && text.compare(text.size() - n, n, suffix) == 0;
+}
+
+Compression compressionForPath(const std::string& filepath) {
+    if (endsWith(filepath, ".gz")) return Compression::Gzip;
+    if (endsWith(filepath, ".zst") || endsWith(filepath, ".zstd")) return Compression::Zstd;
+    return Compression::None;
+}
+
+Compression detectCompression(const void* data, size_t size) {
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    if (size >= 2 && bytes[0] == 0x1f && bytes[1] == 0x8b) return Compression::Gzip;
+    if (size >= 4 && bytes[0] == 0x28 && bytes[1] == 0xb5 && bytes[2] == 0x2f && bytes[3] == 0xfd) {
+        return Compression::Zstd;
+    }
+    return Compression::None;
+}
+
+bool compressionAvailable(Compression type) {
+    switch (type) {
+        case Compression::Gzip:
+#ifdef MZQC_HAVE_ZLIB
+            return true;
+#else
+            return false;
+#endif
+        case Compression::Zstd:
+#ifdef MZQC_HAVE_ZSTD
+            return true;
+#else
+            return false;
+#endif
+        default:
+            return true;
+    }
+}
+
+static void requireAvailable(Compression type) {
+    if (!compressionAvailable(type)) {
+        throw std::runtime_error(std::string(compressionName(type)) + " support is not compiled in");
+    }
+}
+
+// CompressingStreamBuf implementation
+struct CompressingStreamBuf::Codec {
+    Compression type;
+#ifdef MZQC_HAVE_ZLIB
+    z_stream gzip{};
+#endif
+#ifdef MZQC_HAVE_ZSTD
+    ZSTD_CCtx* zstd = nullptr;
+#endif
+
+    explicit Codec(Compression type) : type(type) {}
+    ~Codec() {
+#ifdef MZQC_HAVE_ZLIB
+        if (type == Compression::Gzip) deflateEnd(&gzip);
+#endif
+#ifdef MZQC_HAVE_ZSTD
+        if (zstd) ZSTD_freeCCtx(zstd);
+#endif
+    }
+};
+
+CompressingStreamBuf::CompressingStreamBuf(std::streambuf& sink, Compression type, int level, unsigned threads)
+    : sink(sink), input(chunkSize), output(chunkSize) {
+    if (type != Compression::Gzip && type != Compression::Zstd) {
+        throw std::runtime_error("CompressingStreamBuf needs gzip or zstd");
+    }
+    requireAvailable(type);
+    codec = std::make_unique<Codec>(type);
+#ifdef MZQC_HAVE_ZLIB
+    if (type == Compression::Gzip) {
+        // 15 + 16 selects a gzip header instead of a raw zlib stream
+        if (deflateInit2(&codec->gzip, level == 0 ? Z_DEFAULT_COMPRESSION : level, Z_DEFLATED, 15 + 16, 8,
+                         Z_DEFAULT_STRATEGY) != Z_OK) {
+            codec->type = Compression::None;
+            throw std::runtime_error("Failed to initialize gzip compression");
+        }
+    }
+#endif
+#ifdef MZQC_HAVE_ZSTD
+    if (type == Compression::Zstd) {
+        codec->zstd = ZSTD_createCCtx();
+        if (!codec->zstd) throw std::runtime_error("Failed to initialize zstd compression");
+        if (level != 0) ZSTD_CCtx_setParameter(codec->zstd, ZSTD_c_compressionLevel, level);
+        // Ignored by libraries built without multithreading
+        if (threads > 0) ZSTD_CCtx_setParameter(codec->zstd, ZSTD_c_nbWorkers, static_cast<int>(threads));
+    }
+#endif
+    (void)level;
+    (void)threads;
+    setp(input.data(), input.data() + input.size());
+}
+
+CompressingStreamBuf::~CompressingStreamBuf() {
+    try {
+        finish();
+    } catch (...) {
+        // finish() explicitly to see errors
+    }
+}
+
+void CompressingStreamBuf::compress(const char* data, size_t size, bool end) {
+    auto emit = [this](size_t produced) {
+        if (produced > 0 &&
+            sink.sputn(output.data(), static_cast<std::streamsize>(produced)) != static_cast<std::streamsize>(produced)) {
+            throw std::runtime_error("Error writing compressed stream");
+        }
+    };
+#ifdef MZQC_HAVE_ZLIB
+    if (codec->type == Compression::Gzip) {
+        z_stream& z = codec->gzip;
+        z.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+        z.avail_in = static_cast<uInt>(size);
+        int rc;
+        do {
+            z.next_out = reinterpret_cast<Bytef*>(output.data());
+            z.avail_out = static_cast<uInt>(output.size());
+            rc = deflate(&z, end ? Z_FINISH : Z_NO_FLUSH);
+            if (rc == Z_STREAM_ERROR) throw std::runtime_error("gzip compression failed");
+            emit(output.size() - z.avail_out);
+        } while (z.avail_out == 0 || (end && rc != Z_STREAM_END));
+        return;
+    }
+#endif
+#ifdef MZQC_HAVE_ZSTD
+    if (codec->type == Compression::Zstd) {
+        ZSTD_inBuffer in{data, size, 0};
+        for (;;) {
+            ZSTD_outBuffer out{output.data(), output.size(), 0};
+            size_t remaining = ZSTD_compressStream2(codec->zstd, &out, &in, end ? ZSTD_e_end : ZSTD_e_continue);
+            if (ZSTD_isError(remaining)) {
+                throw std::runtime_error(std::string("zstd compression failed: ") + ZSTD_getErrorName(remaining));
+            }
+            emit(out.pos);
+            if (end ? remaining == 0 : in.pos == in.size) break;
+        }
+        return;
+    }
+#endif
+    (void)data;
+    (void)size;
+    (void)end;
+    (void)emit;
+}
+
+CompressingStreamBuf::int_type CompressingStreamBuf::overflow(int_type ch) {
+    if (finished) return traits_type::eof();
+    compress(pbase(), static_cast<size_t>(pptr() - pbase()), false);
+    setp(input.data(), input.data() + input.size());
+    if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(ch);
+        pbump(1);
+    }
+    return traits_type::not_eof(ch);
+}
+
+std::streamsize CompressingStreamBuf::xsputn(const char* s, std::streamsize n) {
+    if (finished) return 0;
+    // Large blocks skip the put area
+    if (static_cast<size_t>(n) >= input.size()) {
+        compress(pbase(), static_cast<size_t>(pptr() - pbase()), false);
+        setp(input.data(), input.data() + input.size());
+        compress(s, static_cast<size_t>(n), false);
+        return n;
+    }
+    return std::streambuf::xsputn(s, n);
+}
+
+int CompressingStreamBuf::sync() {
+    if (finished) return 0;
+    compress(pbase(), static_cast<size_t>(pptr() - pbase()), false);
+    setp(input.data(), input.data() + input.size());
+    return sink.pubsync();
+}
+
+void CompressingStreamBuf::finish() {
+    if (finished) return;
+    finished = true;
+    compress(pbase(), static_cast<size_t>(pptr() - pbase()), true);
+    setp(nullptr, nullptr);
+    if (sink.pubsync() != 0) {
+        throw std::runtime_error("Error writing compressed stream");
+    }
+}
+
+// DecompressingStreamBuf implementation
+struct DecompressingStreamBuf::Codec {
+    Compression type;
+    // Set between gzip members and after a complete zstd frame
+    bool atFrameEnd = false;
+#ifdef MZQC_HAVE_ZLIB
+    z_stream gzip{};
+#endif
+#ifdef MZQC_HAVE_ZSTD
+    ZSTD_DCtx* zstd = nullptr;
+#endif
+
+    explicit Codec(Compression type) : type(type) {}
+    ~Codec() {
+#ifdef MZQC_HAVE_ZLIB
+        if (type == Compression::Gzip) inflateEnd(&gzip);
+#endif
+#ifdef MZQC_HAVE_ZSTD
+        if (zstd) ZSTD_freeDCtx(zstd);
+#endif
+    }
+};
+
+DecompressingStreamBuf::DecompressingStreamBuf(std::streambuf& source, Compression type)
+    : source(source), input(chunkSize), output(chunkSize) {
+    if (type != Compression::Gzip && type != Compression::Zstd) {
+        throw std::runtime_error("DecompressingStreamBuf needs gzip or zstd");
+    }
+    requireAvailable(type);
+    codec = std::make_unique<Codec>(type);
+#ifdef MZQC_HAVE_ZLIB
+    if (type == Compression::Gzip && inflateInit2(&codec->gzip, 15 + 16) != Z_OK) {
+        codec->type = Compression::None;
+        throw std::runtime_error("Failed to initialize gzip decompression");
+    }
+#endif
+#ifdef MZQC_HAVE_ZSTD
+    if (type == Compression::Zstd) {
+        codec->zstd = ZSTD_createDCtx();
+        if (!codec->zstd) throw std::runtime_error("Failed to initialize zstd decompression");
+    }
+#endif
+    setg(output.data(), output.data(), output.data());
+}
+
+DecompressingStreamBuf::~DecompressingStreamBuf() = default;
+
+DecompressingStreamBuf::int_type DecompressingStreamBuf::underflow() {
+    if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+    // Covers the reads of the compressed file too, the nested timers are ignored
+    MZQC_STATS_PHASE(Read, 0);
+
+    for (;;) {
+        if (inputBegin == inputEnd && !sourceDone) {
+            std::streamsize n = source.sgetn(input.data(), static_cast<std::streamsize>(input.size()));
+            inputBegin = 0;
+            inputEnd = n > 0 ? static_cast<size_t>(n) : 0;
+            sourceDone = inputEnd == 0;
+        }
+        if (inputBegin == inputEnd && sourceDone) {
+            if (!codec->atFrameEnd) {
+                throw std::runtime_error(std::string("Unexpected end of ") + compressionName(codec->type) + " stream");
+            }
+            return traits_type::eof();
+        }
+
+        size_t produced = 0;
+#ifdef MZQC_HAVE_ZLIB
+        if (codec->type == Compression::Gzip) {
+            z_stream& z = codec->gzip;
+            if (codec->atFrameEnd) {
+                // Another member follows, as in concatenated .gz files
+                inflateReset(&z);
+                codec->atFrameEnd = false;
+            }
+            z.next_in = reinterpret_cast<Bytef*>(input.data() + inputBegin);
+            z.avail_in = static_cast<uInt>(inputEnd - inputBegin);
+            z.next_out = reinterpret_cast<Bytef*>(output.data());
+            z.avail_out = static_cast<uInt>(output.size());
+            int rc = inflate(&z, Z_NO_FLUSH);
+            if (rc != Z_OK && rc != Z_STREAM_END && rc != Z_BUF_ERROR) {
+                throw std::runtime_error(std::string("Corrupt gzip stream: ") + (z.msg ? z.msg : "inflate failed"));
+            }
+            inputBegin = inputEnd - z.avail_in;
+            produced = output.size() - z.avail_out;
+            codec->atFrameEnd = rc == Z_STREAM_END;
+        }
+#endif
+#ifdef MZQC_HAVE_ZSTD
+        if (codec->type == Compression::Zstd) {
+            ZSTD_inBuffer in{input.data() + inputBegin, inputEnd - inputBegin, 0};
+            ZSTD_outBuffer out{output.data(), output.size(), 0};
+            size_t rc = ZSTD_decompressStream(codec->zstd, &out, &in);
+            if (ZSTD_isError(rc)) {
+                throw std::runtime_error(std::string("Corrupt zstd stream: ") + ZSTD_getErrorName(rc));
+            }
+            inputBegin += in.pos;
+            produced = out.pos;
+            codec->atFrameEnd = rc == 0;
+        }
+#endif
+        if (produced > 0) {
+#ifdef MZQC_ENABLE_STATS
+            if (StatsScope* scope = StatsScope::current()) scope->addPhase(StatsPhase::Read, 0, produced);
+#endif
+            setg(output.data(), output.data(), output.data() + produced);
+            return traits_type::to_int_type(*gptr());
+        }
+    }
+}
+
+// FileInputStream implementation
+FileInputStream::ReadBuffer::int_type FileInputStream::ReadBuffer::underflow() {
+#ifdef MZQC_ENABLE_STATS
+    if (!timed) return std::filebuf::underflow();
+    StatsPhaseTimer timer(StatsPhase::Read);
+    int_type c = std::filebuf::underflow();
+    timer.bytes = static_cast<uint64_t>(egptr() - gptr());
+    return c;
+#else
+    return std::filebuf::underflow();
+#endif
+}
+
+std::streamsize FileInputStream::ReadBuffer::xsgetn(char* data, std::streamsize count) {
+#ifdef MZQC_ENABLE_STATS
+    if (!timed) return std::filebuf::xsgetn(data, count);
+    StatsPhaseTimer timer(StatsPhase::Read);
+    std::streamsize n = std::filebuf::xsgetn(data, count);
+    timer.bytes = n > 0 ? static_cast<uint64_t>(n) : 0;
+    return n;
+#else
+    return std::filebuf::xsgetn(data, count);
+#endif
+}
+
+FileInputStream::FileInputStream(const std::string& filepath) : std::istream(nullptr), buffer(1 << 20) {
+    file.pubsetbuf(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    if (!file.open(filepath, std::ios::in | std::ios::binary)) {
+        throw std::runtime_error("Could not open file: " + filepath);
+    }
+    char magic[4];
+    std::streamsize n = file.sgetn(magic, sizeof(magic));
+    file.pubseekpos(0, std::ios::in);
+    file.timed = true;
+    type = detectCompression(magic, n > 0 ? static_cast<size_t>(n) : 0);
+    if (type == Compression::None) {
+        rdbuf(&file);
+        return;
+    }
+    if (!compressionAvailable(type)) {
+        throw std::runtime_error(filepath + ": " + compressionName(type) + " support is not compiled in");
+    }
+    decompressor = std::make_unique<DecompressingStreamBuf>(file, type);
+    rdbuf(decompressor.get());
+}
+
+FileInputStream::~FileInputStream() = default;
+
+// FileOutputStream implementation
+FileOutputStream::FileOutputStream(const std::string& filepath, const CompressionOptions& options)
+    : std::ostream(nullptr), buffer(1 << 20) {
+    type = options.type == Compression::Auto ? compressionForPath(filepath) : options.type;
+    requireAvailable(type);
+    file.pubsetbuf(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    if (!file.open(filepath, std::ios::out | std::ios::binary | std::ios::trunc)) {
+        throw std::runtime_error("Could not open file for writing: " + filepath);
+    }
+    if (type == Compression::None) {
+        rdbuf(&file);
+        return;
+    }
+    compressor = std::make_unique<CompressingStreamBuf>(file, type, options.level, options.threads);
+    rdbuf(compressor.get());
+}
+
+FileOutputStream::~FileOutputStream() {
+    try {
+        close();
+    } catch (...) {
+        // close() explicitly to see write errors
+    }
+}
+
+void FileOutputStream::close() {
+    if (!file.is_open()) return;
+    MZQC_STATS_PHASE(Write, 0);
+    bool ok = static_cast<bool>(*this);
+    if (compressor) {
+        compressor->finish();
+    } else {
+        ok = ok && file.pubsync() == 0;
+    }
+    ok = file.close() != nullptr && ok;
+    if (!ok) {
+        setstate(std::ios::badbit);
+        throw std::runtime_error("Error writing file");
+    }
+}
+
+} // namespace mzqc
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstddef>
+#include <fstream>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+namespace mzqc {
+
+enum class Compression { Auto, None, Gzip, Zstd };
+
+struct CompressionOptions {
+    // Auto picks gzip for ".gz" and zstd for ".zst" paths, none otherwise
+    Compression type = Compression::Auto;
+    // 0 uses the library default
+    int level = 0;
+    // zstd worker threads, 0 compresses on the calling thread
+    unsigned threads = 0;
+};
+
+// Compression implied by a file name
+Compression compressionForPath(const std::string& filepath);
+// Gzip or zstd from the magic bytes at the start of a file, None otherwise
+Compression detectCompression(const void* data, size_t size);
+// False for formats this build was configured without (MZQC_HAVE_ZLIB, MZQC_HAVE_ZSTD)
+bool compressionAvailable(Compression type);
+
+// Compresses everything written to it into another streambuf. The frame is
+// completed by finish() or the destructor; sync() only pushes buffered text
+// through the compressor.
+class CompressingStreamBuf : public std::streambuf {
+public:
+    // Throws std::runtime_error if the format is not available
+    CompressingStreamBuf(std::streambuf& sink, Compression type, int level = 0, unsigned threads = 0);
+    ~CompressingStreamBuf() override;
+
+    // Throws std::runtime_error on compression or write errors
+    void finish();
+
+protected:
+    int_type overflow(int_type ch) override;
+    std::streamsize xsputn(const char* s, std::streamsize n) override;
+    int sync() override;
+
+private:
+    struct Codec;
+    void compress(const char* data, size_t size, bool end);
+
+    std::unique_ptr<Codec> codec;
+    std::streambuf& sink;
+    std::vector<char> input;
+    std::vector<char> output;
+    bool finished = false;
+};
+
+// Decompresses a gzip (possibly multi-member) or zstd stream read from another streambuf
+class DecompressingStreamBuf : public std::streambuf {
+public:
+    DecompressingStreamBuf(std::streambuf& source, Compression type);
+    ~DecompressingStreamBuf() override;
+
+protected:
+    int_type underflow() override;
+
+private:
+    struct Codec;
+
+    std::unique_ptr<Codec> codec;
+    std::streambuf& source;
+    std::vector<char> input;
+    std::vector<char> output;
+    size_t inputBegin = 0;
+    size_t inputEnd = 0;
+    bool sourceDone = false;
+};
+
+// Reads plain, gzip and zstd files alike; the format is taken from the
+// first bytes, so no decompressed copy of the file is ever held in memory
+class FileInputStream : public std::istream {
+public:
+    // Throws std::runtime_error "Could not open file: <path>"
+    explicit FileInputStream(const std::string& filepath);
+    ~FileInputStream() override;
+
+    Compression compression() const { return type; }
+
+private:
+    // Plain file buffer whose reads are timed when stats are enabled
+    class ReadBuffer : public std::filebuf {
+    public:
+        // Off while the format is detected
+        bool timed = false;
+
+    protected:
+        int_type underflow() override;
+        std::streamsize xsgetn(char* data, std::streamsize count) override;
+    };
+
+    std::vector<char> buffer;
+    ReadBuffer file;
+    std::unique_ptr<DecompressingStreamBuf> decompressor;
+    Compression type = Compression::None;
+};
+
+// Writes a plain or compressed file, by default chosen from the file name.
+// Plain files remain seekable.
+class FileOutputStream : public std::ostream {
+public:
+    // Throws std::runtime_error "Could not open file for writing: <path>"
+    explicit FileOutputStream(const std::string& filepath, const CompressionOptions& options = CompressionOptions());
+    ~FileOutputStream() override;
+
+    Compression compression() const { return type; }
+    // Completes the compressed frame and closes the file, throws on write errors
+    void close();
+
+private:
+    std::vector<char> buffer;
+    std::filebuf file;
+    std::unique_ptr<CompressingStreamBuf> compressor;
+    Compression type = Compression::None;
+};
+
+} // namespace mzqc
@@ -0,0 +1,347 @@
+#include "mzqc_csv.hpp"
+#include "mzqc_mmap.hpp"
+#include "mzqc_parallel.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <deque>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace mzqc {
+
+namespace {
+
+constexpr size_t allFields = std::numeric_limits<size_t>::max();
+// Smaller bodies are not worth splitting
+constexpr size_t minChunkBytes = 1 << 20;
+
+// Position of the next delimiter, quote or newline at or after i, n if there is none
+size_t nextSpecial(const char* p, size_t i, size_t n, char delimiter) {
+#if defined(__SSE2__)
+    const __m128i delim = _mm_set1_epi8(delimiter);
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i newline = _mm_set1_epi8('\n');
+    for (; i + 16 <= n; i += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(chunk, delim),
+                                    _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, newline)));
+        int mask = _mm_movemask_epi8(hits);
+        if (mask != 0) return i + static_cast<size_t>(__builtin_ctz(static_cast<unsigned>(mask)));
+    }
+#endif
+    while (i < n && p[i] != delimiter && p[i] != '"' && p[i] != '\n') ++i;
+    return i;
+}
+
+std::string_view trim(std::string_view text) {
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) text.remove_prefix(1);
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r')) text.remove_suffix(1);
+    return text;
+}
+
+bool equalsIgnoreCase(std::string_view text, const char* word) {
+    size_t n = std::strlen(word);
+    if (text.size() != n) return false;
+    for (size_t i = 0; i < n; ++i) {
+        char c = text[i];
+        if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+        if (c != word[i]) return false;
+    }
+    return true;
+}
+
+struct LineSplitter {
+    const char* p;
+    size_t n;
+    char delimiter;
+    // Without quotes in the text everything after the last wanted field is skipped with memchr
+    bool quotes;
+    std::vector<std::string_view> fields;
+    // Storage for quoted fields containing "" escapes, stable under push_back
+    std::deque<std::string> unescaped;
+
+    // Splits the record starting at i into its first `wanted` fields and
+    // returns the position after the record's newline
+    size_t split(size_t i, size_t wanted) {
+        fields.clear();
+        unescaped.clear();
+        for (;;) {
+            if (fields.size() == wanted && !quotes) {
+                const void* newline = i < n ? std::memchr(p + i, '\n', n - i) : nullptr;
+                return newline ? static_cast<size_t>(static_cast<const char*>(newline) - p) + 1 : n;
+            }
+
+            std::string_view field;
+            size_t j;
+            if (i < n && p[i] == '"') {
+                bool escaped = false;
+                j = i + 1;
+                for (;;) {
+                    const void* quote = j < n ? std::memchr(p + j, '"', n - j) : nullptr;
+                    if (!quote) throw std::runtime_error("unterminated quoted field");
+                    j = static_cast<size_t>(static_cast<const char*>(quote) - p);
+                    if (j + 1 < n && p[j + 1] == '"') {
+                        escaped = true;
+                        j += 2;
+                        continue;
+                    }
+                    break;
+                }
+                field = std::string_view(p + i + 1, j - i - 1);
+                if (escaped) {
+                    std::string text;
+                    for (size_t k = 0; k < field.size(); ++k) {
+                        text += field[k];
+                        if (field[k] == '"') ++k;
+                    }
+                    unescaped.push_back(std::move(text));
+                    field = unescaped.back();
+                }
+                ++j;
+                if (j < n && p[j] == '\r') ++j;
+                if (j < n && p[j] != delimiter && p[j] != '\n') {
+                    throw std::runtime_error("unexpected character after quoted field");
+                }
+            } else {
+                // A quote inside an unquoted field is taken literally
+                j = nextSpecial(p, i, n, delimiter);
+                while (j < n && p[j] == '"') j = nextSpecial(p, j + 1, n, delimiter);
+                field = std::string_view(p + i, j - i);
+                if (!field.empty() && field.back() == '\r' && (j == n || p[j] == '\n')) field.remove_suffix(1);
+            }
+
+            if (fields.size() < wanted) fields.push_back(field);
+            if (j >= n) return n;
+            if (p[j] == '\n') return j + 1;
+            i = j + 1;
+        }
+    }
+};
+
+struct Part {
+    std::vector<TableColumn> columns;
+    // Offset of the failing record and the reason, error is empty on success
+    size_t errorOffset = 0;
+    std::string error;
+};
+
+TableColumn emptyColumn(CsvColumnType type) {
+    switch (type) {
+        case CsvColumnType::Double:
+            return std::vector<double>();
+        case CsvColumnType::Integer:
+            return std::vector<int64_t>();
+        case CsvColumnType::Boolean:
+            return std::vector<bool>();
+        default:
+            return std::vector<std::string>();
+    }
+}
+
+void appendField(TableColumn& column, CsvColumnType type, std::string_view field, const std::string& name) {
+    switch (type) {
+        case CsvColumnType::Double: {
+            std::string_view text = trim(field);
+            auto& values = std::get<std::vector<double>>(column);
+            if (text.empty()) {
+                values.push_back(std::numeric_limits<double>::quiet_NaN());
+                return;
+            }
+            if (text.front() == '+') text.remove_prefix(1);
+            double value = 0;
+            auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+            if (result.ec != std::errc() || result.ptr != text.data() + text.size()) {
+                throw std::runtime_error("column '" + name + "': '" + std::string(field) + "' is not a number");
+            }
+            values.push_back(value);
+            return;
+        }
+        case CsvColumnType::Integer: {
+            std::string_view text = trim(field);
+            if (!text.empty() && text.front() == '+') text.remove_prefix(1);
+            int64_t value = 0;
+            auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+            if (text.empty() || result.ec != std::errc() || result.ptr != text.data() + text.size()) {
+                throw std::runtime_error("column '" + name + "': '" + std::string(field) + "' is not an integer");
+            }
+            std::get<std::vector<int64_t>>(column).push_back(value);
+            return;
+        }
+        case CsvColumnType::Boolean: {
+            std::string_view text = trim(field);
+            bool value;
+            if (equalsIgnoreCase(text, "true") || text == "1") {
+                value = true;
+            } else if (equalsIgnoreCase(text, "false") || text == "0") {
+                value = false;
+            } else {
+                throw std::runtime_error("column '" + name + "': '" + std::string(field) + "' is not a boolean");
+            }
+            std::get<std::vector<bool>>(column).push_back(value);
+            return;
+        }
+        case CsvColumnType::String:
+            std::get<std::vector<std::string>>(column).emplace_back(field);
+            return;
+    }
+}
+
+} // namespace
+
+std::vector<CsvColumn> identificationColumns() {
+    return {
+        {"RT", "", CsvColumnType::Double},
+        {"peptide", "", CsvColumnType::String},
+        {"target", "", CsvColumnType::Boolean},
+        {"MZ", "", CsvColumnType::Double},
+        {"deltaPPM", "", CsvColumnType::Double},
+    };
+}
+
+// CsvTableReader implementation
+CsvTableReader::CsvTableReader(const CsvTableOptions& options) : options(options) {}
+
+MetricTable CsvTableReader::read(const std::string& filepath) const {
+    MappedFile mapped;
+    if (!mapped.open(filepath)) {
+        throw std::runtime_error("Could not open file: " + filepath);
+    }
+    return parse(mapped.view(), filepath);
+}
+
+MetricTable CsvTableReader::parse(std::string_view text) const {
+    return parse(text, "CSV");
+}
+
+std::shared_ptr<QualityMetric> CsvTableReader::readMetric(const std::string& filepath, const std::string& accession,
+                                                          const std::string& name, const std::string& description,
+                                                          const std::string& unit) const {
+    return std::make_shared<QualityMetric>(accession, name, description, MetricValue(read(filepath)), unit);
+}
+
+MetricTable CsvTableReader::parse(std::string_view text, const std::string& source) const {
+    const char* p = text.data();
+    const size_t n = text.size();
+    const bool quotes = std::memchr(p, '"', n) != nullptr;
+    auto fail = [&](size_t offset, const std::string& message) {
+        size_t line = 1 + static_cast<size_t>(std::count(p, p + offset, '\n'));
+        throw std::runtime_error(source + ":" + std::to_string(line) + ": " + message);
+    };
+
+    // Header
+    size_t begin = 0;
+    if (n >= 3 && std::memcmp(p, "\xEF\xBB\xBF", 3) == 0) begin = 3;
+    if (begin == n) throw std::runtime_error(source + ": missing CSV header");
+    LineSplitter header{p, n, options.delimiter, quotes, {}, {}};
+    size_t bodyBegin = 0;
+    try {
+        bodyBegin = header.split(begin, allFields);
+    } catch (const std::runtime_error& e) {
+        fail(begin, e.what());
+    }
+
+    // Field index of every output column
+    std::vector<CsvColumn> columns = options.columns;
+    if (columns.empty()) {
+        for (std::string_view name : header.fields) {
+            columns.push_back({std::string(name), "", CsvColumnType::String});
+        }
+    }
+    std::vector<size_t> fieldIndex;
+    std::vector<std::string> names;
+    size_t wanted = 0;
+    for (const auto& column : columns) {
+        auto it = std::find(header.fields.begin(), header.fields.end(), column.source);
+        if (it == header.fields.end()) {
+            throw std::runtime_error(source + ": CSV column '" + column.source + "' not found");
+        }
+        fieldIndex.push_back(static_cast<size_t>(it - header.fields.begin()));
+        names.push_back(column.name.empty() ? column.source : column.name);
+        wanted = std::max(wanted, fieldIndex.back() + 1);
+    }
+
+    // Chunks end at newlines; a quoted field may contain one, so such text stays whole
+    std::unique_ptr<ThreadPool> localPool;
+    if (options.threads > 1) localPool = std::make_unique<ThreadPool>(options.threads);
+    ThreadPool* pool = localPool ? localPool.get() : options.threads == 0 ? &ThreadPool::shared() : nullptr;
+    std::vector<size_t> bounds{bodyBegin};
+    if (pool && !quotes && n - bodyBegin >= 2 * minChunkBytes) {
+        size_t count = std::min<size_t>((n - bodyBegin) / minChunkBytes, size_t(pool->size() + 1) * 4);
+        for (size_t k = 1; k < count; ++k) {
+            size_t target = bodyBegin + (n - bodyBegin) / count * k;
+            if (target <= bounds.back()) continue;
+            const void* newline = std::memchr(p + target, '\n', n - target);
+            if (!newline) break;
+            bounds.push_back(static_cast<size_t>(static_cast<const char*>(newline) - p) + 1);
+        }
+    }
+    bounds.push_back(n);
+
+    std::vector<Part> parts(bounds.size() - 1);
+    auto parseChunk = [&](size_t k) {
+        Part& part = parts[k];
+        for (const auto& column : columns) part.columns.push_back(emptyColumn(column.type));
+        LineSplitter splitter{p, bounds[k + 1], options.delimiter, quotes, {}, {}};
+        size_t i = bounds[k];
+        while (i < bounds[k + 1]) {
+            // Blank lines, including a final newline, are skipped
+            if (p[i] == '\n' || (p[i] == '\r' && i + 1 < bounds[k + 1] && p[i + 1] == '\n')) {
+                i += p[i] == '\n' ? 1 : 2;
+                continue;
+            }
+            size_t record = i;
+            try {
+                i = splitter.split(i, wanted);
+                if (splitter.fields.size() < wanted) {
+                    throw std::runtime_error("expected at least " + std::to_string(wanted) + " fields, found " +
+                                             std::to_string(splitter.fields.size()));
+                }
+                for (size_t c = 0; c < columns.size(); ++c) {
+                    appendField(part.columns[c], columns[c].type, splitter.fields[fieldIndex[c]], names[c]);
+                }
+            } catch (const std::runtime_error& e) {
+                part.errorOffset = record;
+                part.error = e.what();
+                return;
+            }
+        }
+    };
+    if (parts.size() == 1) {
+        parseChunk(0);
+    } else {
+        pool->parallelFor(parts.size(), parseChunk);
+    }
+
+    for (const auto& part : parts) {
+        if (!part.error.empty()) fail(part.errorOffset, part.error);
+    }
+
+    MetricTable table;
+    for (size_t c = 0; c < columns.size(); ++c) {
+        TableColumn column = std::move(parts.front().columns[c]);
+        if (parts.size() > 1) {
+            std::visit(
+                [&](auto& out) {
+                    using Column = std::decay_t<decltype(out)>;
+                    size_t rows = 0;
+                    for (const auto& part : parts) rows += std::get<Column>(part.columns[c]).size();
+                    out.reserve(rows);
+                    for (size_t k = 1; k < parts.size(); ++k) {
+                        auto& in = std::get<Column>(parts[k].columns[c]);
+                        out.insert(out.end(), std::make_move_iterator(in.begin()), std::make_move_iterator(in.end()));
+                        Column().swap(in);
+                    }
+                },
+                column);
+        }
+        table.addColumn(names[c], std::move(column));
+    }
+    return table;
+}
+
+} // namespace mzqc
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "mzqc.hpp"
+#include "mzqc_value.hpp"
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mzqc {
+
+enum class CsvColumnType { Double, Integer, String, Boolean };
+
+// Maps one CSV column to a column of the resulting table
+struct CsvColumn {
+    // Header name in the CSV file
+    std::string source;
+    // Column name in the table, empty keeps the source name
+    std::string name;
+    CsvColumnType type = CsvColumnType::String;
+};
+
+struct CsvTableOptions {
+    char delimiter = ',';
+    // Columns to keep, in table order; empty keeps every column as strings
+    std::vector<CsvColumn> columns;
+    // Worker threads, 0 uses ThreadPool::shared() and 1 parses on the calling thread
+    unsigned threads = 0;
+};
+
+// RT, peptide, target, MZ and deltaPPM of an identification table such as
+// input_files/CPTAC_CompRef_00_iTRAQ_01_2Feb12_Cougar_11-10-09_ids.csv
+std::vector<CsvColumn> identificationColumns();
+
+// Reads a delimited text file with a header line into a columnar MetricTable.
+// The file is mapped and split at line boundaries into chunks that are parsed
+// in parallel; numbers are converted with std::from_chars. Fields may be
+// quoted with '"' ("" inside quotes is a quote), files containing quotes are
+// parsed in one piece since a quoted field can span lines.
+// Empty Double fields become NaN, written as null; booleans are true/false or
+// 1/0 in any case. Errors throw std::runtime_error with the line number.
+class CsvTableReader {
+public:
+    explicit CsvTableReader(const CsvTableOptions& options = CsvTableOptions());
+
+    MetricTable read(const std::string& filepath) const;
+    MetricTable parse(std::string_view text) const;
+
+    // Table of the whole file as the value of a single metric
+    std::shared_ptr<QualityMetric> readMetric(const std::string& filepath, const std::string& accession,
+                                              const std::string& name, const std::string& description = "",
+                                              const std::string& unit = "") const;
+
+private:
+    MetricTable parse(std::string_view text, const std::string& source) const;
+
+    CsvTableOptions options;
+};
+
+} // namespace mzqc
@@ -0,0 +1,156 @@
+#pragma once
+
+#include "mzqc.hpp"
+#include "mzqc_intern.hpp"
+#include "mzqc_value.hpp"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace mzqc {
+
+// Compile-time registry of the QC CV. The term table is generated from
+// schema/qc-cv.obo when the library is built, so term checks against it need
+// no CvTermCache; CvTermCache stays the way to load other or newer OBO files.
+
+// Value shape of a metric term, from its is_a ancestors; None for other terms
+enum class CvValueShape : uint8_t { None, SingleValue, Tuple, Table, Matrix };
+// Element type given by the term's value-type xref
+enum class CvValueType : uint8_t { Any, Integer, Double };
+
+struct CvTermInfo {
+    std::string_view accession;
+    std::string_view name;
+    // First has_units accession, empty if the term has none
+    std::string_view unit;
+    CvValueShape shape;
+    CvValueType valueType;
+    // Transitive is_a ancestors including the term itself, in cv::ancestorIds
+    uint32_t firstAncestor;
+    uint32_t ancestorCount;
+};
+
+// Type standing for one term, e.g. cv::MS_4000059. Id is the dense index
+// into cv::terms.
+template <uint32_t Id>
+struct CvTerm {
+    static constexpr uint32_t id = Id;
+};
+
+} // namespace mzqc
+
+// Generated: cv::termCount, cv::terms sorted by accession, cv::ancestorIds and
+// a CvTerm alias per accession
+#include "mzqc_cv_terms.inc"
+
+namespace mzqc {
+namespace cv {
+
+inline constexpr uint32_t npos = UINT32_MAX;
+
+constexpr const CvTermInfo& term(uint32_t id) { return terms[id]; }
+
+// Dense id of a term, npos if the QC CV has no such accession
+constexpr uint32_t termId(std::string_view accession) {
+    uint32_t low = 0;
+    uint32_t high = termCount;
+    while (low < high) {
+        const uint32_t mid = low + (high - low) / 2;
+        if (terms[mid].accession < accession) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low < termCount && terms[low].accession == accession ? low : npos;
+}
+
+// True if ancestor is the term itself or reachable through is_a
+constexpr bool isA(uint32_t child, uint32_t ancestor) {
+    const CvTermInfo& info = terms[child];
+    for (uint32_t i = 0; i < info.ancestorCount; ++i) {
+        if (ancestorIds[info.firstAncestor + i] == ancestor) return true;
+    }
+    return false;
+}
+
+// Metric terms are the ones below a value shape term such as MS:4000003
+// "single value"; not all of them reach MS:4000001 "QC metric" through is_a
+constexpr bool isMetric(uint32_t id) { return terms[id].shape != CvValueShape::None; }
+
+template <typename T>
+struct IsVector : std::false_type {};
+template <typename T>
+struct IsVector<std::vector<T>> : std::true_type {
+    using element = T;
+};
+
+template <typename T>
+constexpr bool isNumber = std::is_arithmetic_v<T> && !std::is_same_v<T, bool>;
+
+// Whether numbers of type T are allowed by a term's value type
+template <typename T>
+constexpr bool elementMatches(CvValueType type) {
+    if (!isNumber<T>) return false;
+    return type != CvValueType::Integer || std::is_integral_v<T>;
+}
+
+template <typename T>
+constexpr bool accepts(uint32_t id) {
+    const CvTermInfo& info = terms[id];
+    if constexpr (std::is_same_v<T, MetricTable>) {
+        return info.shape == CvValueShape::Table;
+    } else if constexpr (IsVector<T>::value) {
+        using Element = typename IsVector<T>::element;
+        if constexpr (IsVector<Element>::value) {
+            using Number = typename IsVector<Element>::element;
+            return info.shape == CvValueShape::Matrix && elementMatches<Number>(info.valueType);
+        } else {
+            return info.shape == CvValueShape::Tuple && elementMatches<Element>(info.valueType);
+        }
+    } else {
+        return info.shape == CvValueShape::SingleValue && elementMatches<T>(info.valueType);
+    }
+}
+
+// Accession, name and unit of a term, interned once per term
+template <typename Term>
+struct InternedTerm {
+    static const InternedTerm& get() {
+        static const InternedTerm strings;
+        return strings;
+    }
+
+    InternedString accession{terms[Term::id].accession};
+    InternedString name{terms[Term::id].name};
+    InternedString unit{terms[Term::id].unit};
+};
+
+} // namespace cv
+
+// QualityMetric for a QC CV term, e.g. make_metric<cv::MS_4000059>(int64_t(5120)).
+// The term must be a metric and value must fit its shape and value type:
+// a number for single values, std::vector of numbers for n-tuples, a
+// MetricTable for tables and nested vectors for matrices, integral where the
+// term asks for xsd:int. Name and unit come from the term; its strings are
+// interned on the first call, so later calls do no lookups.
+template <typename Term, typename T>
+QualityMetric make_metric(T&& value, std::string description = "") {
+    using Value = std::decay_t<T>;
+    static_assert(cv::isMetric(Term::id), "term is not a QC metric with a value shape");
+    static_assert(cv::accepts<Value>(Term::id), "value does not match the shape or value type of the term");
+
+    const cv::InternedTerm<Term>& strings = cv::InternedTerm<Term>::get();
+    QualityMetric metric;
+    metric.accession = strings.accession;
+    metric.name = strings.name;
+    metric.unit = strings.unit;
+    metric.description = std::move(description);
+    metric.value = MetricValue(std::forward<T>(value));
+    return metric;
+}
+
+} // namespace mzqc
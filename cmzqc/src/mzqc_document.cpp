@@ -0,0 +1,517 @@
+#include "mzqc_document.hpp"
+#include "mzqc_stream.hpp"
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace mzqc {
+
+static std::string viewString(std::string_view text) {
+    return std::string(text.data(), text.size());
+}
+
+// Fills an MzQCDocument, the document layout and its errors come from
+// MzQCSaxDispatcher as for MzQCSaxHandler
+class MzQCDocumentBuilder : public MzQCSaxDispatcher {
+public:
+    explicit MzQCDocumentBuilder(MzQCDocument& doc) : doc(doc) {}
+
+    // Copies the nodes into the document once their counts are known, so the
+    // arena holds each array once at its final size
+    void seal() {
+        seal(vocabularyNodes, doc.vocabularyNodes);
+        seal(runNodes, doc.runNodes);
+        seal(setNodes, doc.setNodes);
+        seal(inputFileNodes, doc.inputFileNodes);
+        seal(cvParameterNodes, doc.cvParameterNodes);
+        seal(softwareNodes, doc.softwareNodes);
+        seal(metricNodes, doc.metricNodes);
+        seal(setRefNodes, doc.setRefNodes);
+    }
+
+protected:
+    void beginHeader() override {
+        doc.creationDate = doc.version = doc.contactName = doc.contactAddress = doc.description = {};
+        vocabularyNodes.clear();
+        runNodes.clear();
+        setNodes.clear();
+        sawCreationDate = false;
+    }
+
+    void field(Context context, const std::string& key, std::string&& value) override {
+        std::string_view text = doc.store(value);
+        switch (context) {
+            case Context::MzQC:
+                if (key == "creationDate") {
+                    doc.creationDate = text;
+                    sawCreationDate = true;
+                } else if (key == "version") {
+                    doc.version = text;
+                } else if (key == "contactName") {
+                    doc.contactName = text;
+                } else if (key == "contactAddress") {
+                    doc.contactAddress = text;
+                } else {
+                    doc.description = text;
+                }
+                break;
+            case Context::Cv: {
+                auto& cv = vocabularyNodes.back();
+                if (key == "id") cv.id = text;
+                else if (key == "name") cv.name = text;
+                else if (key == "uri") cv.uri = text;
+                else cv.version = text;
+                break;
+            }
+            case Context::Run:
+                runNodes.back().label = text;
+                break;
+            case Context::Set:
+                setNodes.back().label = text;
+                break;
+            case Context::InputFile: {
+                auto& file = inputFileNodes.back();
+                if (key == "location") file.location = text;
+                else file.name = text;
+                break;
+            }
+            case Context::FileFormat:
+            case Context::FileProperty: {
+                auto& param = cvParameterNodes.back();
+                if (key == "accession") param.accession = text;
+                else if (key == "name") param.name = text;
+                else if (key == "value") param.value = text;
+                else param.cvRef = text;
+                break;
+            }
+            case Context::Software: {
+                auto& software = softwareNodes.back();
+                if (key == "accession") software.accession = text;
+                else if (key == "name") software.name = text;
+                else if (key == "version") software.version = text;
+                else software.uri = text;
+                break;
+            }
+            case Context::Metric: {
+                auto& metric = metricNodes.back();
+                if (key == "accession") metric.accession = text;
+                else if (key == "name") metric.name = text;
+                else if (key == "description") metric.description = text;
+                else metric.unit = text;
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    void beginObject(Context context) override {
+        switch (context) {
+            case Context::Cv:
+                vocabularyNodes.emplace_back();
+                break;
+            case Context::Run:
+                runNodes.emplace_back();
+                break;
+            case Context::Set:
+                setNodes.emplace_back();
+                break;
+            case Context::InputFile:
+                inputFileNodes.emplace_back();
+                break;
+            case Context::FileFormat:
+                inputFileNodes.back().fileFormat = static_cast<uint32_t>(cvParameterNodes.size());
+                cvParameterNodes.emplace_back();
+                break;
+            case Context::FileProperty:
+                cvParameterNodes.emplace_back();
+                break;
+            case Context::Software:
+                softwareNodes.emplace_back();
+                break;
+            default:
+                metricNodes.emplace_back();
+                break;
+        }
+    }
+
+    bool endObject(Context /*context*/) override { return true; }
+
+    void beginList(Context list, Context owner) override {
+        switch (list) {
+            case Context::CvList:
+                vocabularyNodes.clear();
+                break;
+            case Context::RunList:
+                runNodes.clear();
+                break;
+            case Context::SetList:
+                setNodes.clear();
+                break;
+            case Context::InputFileList:
+                runNodes.back().firstInputFile = static_cast<uint32_t>(inputFileNodes.size());
+                break;
+            case Context::FilePropertyList:
+                inputFileNodes.back().firstProperty = static_cast<uint32_t>(cvParameterNodes.size());
+                break;
+            case Context::SoftwareList:
+                runNodes.back().firstSoftware = static_cast<uint32_t>(softwareNodes.size());
+                break;
+            case Context::SetRefList:
+                setNodes.back().firstSetRef = static_cast<uint32_t>(setRefNodes.size());
+                setNodes.back().setRefCount = 0;
+                break;
+            default:
+                if (owner == Context::Run) {
+                    runNodes.back().firstMetric = static_cast<uint32_t>(metricNodes.size());
+                } else {
+                    setNodes.back().firstMetric = static_cast<uint32_t>(metricNodes.size());
+                }
+                break;
+        }
+    }
+
+    void endList(Context list, Context owner) override {
+        switch (list) {
+            case Context::InputFileList: {
+                auto& run = runNodes.back();
+                run.inputFileCount = static_cast<uint32_t>(inputFileNodes.size()) - run.firstInputFile;
+                break;
+            }
+            case Context::SoftwareList: {
+                auto& run = runNodes.back();
+                run.softwareCount = static_cast<uint32_t>(softwareNodes.size()) - run.firstSoftware;
+                break;
+            }
+            case Context::FilePropertyList: {
+                auto& file = inputFileNodes.back();
+                file.propertyCount = static_cast<uint32_t>(cvParameterNodes.size()) - file.firstProperty;
+                break;
+            }
+            case Context::MetricList:
+                if (owner == Context::Run) {
+                    auto& run = runNodes.back();
+                    run.metricCount = static_cast<uint32_t>(metricNodes.size()) - run.firstMetric;
+                } else {
+                    auto& set = setNodes.back();
+                    set.metricCount = static_cast<uint32_t>(metricNodes.size()) - set.firstMetric;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    void setRef(std::string&& ref) override {
+        setRefNodes.push_back(doc.store(ref));
+        ++setNodes.back().setRefCount;
+    }
+
+    void metricValue(nlohmann::json&& value) override {
+        auto& metric = metricNodes.back();
+        metric.value = DocMetricValue();
+        if (!value.is_null()) {
+            metric.value.kind = DocMetricValue::Kind::Json;
+            metric.value.json = doc.store(value.dump());
+        }
+    }
+
+    void metricValue(std::vector<double>& values) override {
+        auto& metric = metricNodes.back();
+        metric.value = DocMetricValue();
+        metric.value.kind = DocMetricValue::Kind::Doubles;
+        metric.value.doubles = doc.store(values);
+        metric.value.size = values.size();
+    }
+
+    void metricValue(std::vector<int64_t>& values) override {
+        auto& metric = metricNodes.back();
+        metric.value = DocMetricValue();
+        metric.value.kind = DocMetricValue::Kind::Integers;
+        metric.value.integers = doc.store(values);
+        metric.value.size = values.size();
+    }
+
+    void finish() override {
+        if (!sawCreationDate) {
+            doc.creationDate = doc.store(MzQCFile::getCurrentIsoTime());
+        }
+    }
+
+private:
+    template <typename T>
+    void seal(std::vector<T>& nodes, std::pmr::vector<T>& target) {
+        doc.reserve(target, nodes.size());
+        target.assign(nodes.begin(), nodes.end());
+        std::vector<T>().swap(nodes);
+    }
+
+    MzQCDocument& doc;
+    // Nodes are collected on the heap while their number is unknown; growing
+    // them in the arena would leave every outgrown buffer behind
+    std::vector<DocControlledVocabulary> vocabularyNodes;
+    std::vector<DocRunQuality> runNodes;
+    std::vector<DocSetQuality> setNodes;
+    std::vector<DocInputFile> inputFileNodes;
+    std::vector<DocCvParameter> cvParameterNodes;
+    std::vector<DocAnalysisSoftware> softwareNodes;
+    std::vector<DocQualityMetric> metricNodes;
+    std::vector<std::string_view> setRefNodes;
+    bool sawCreationDate = false;
+};
+
+// DocQualityMetric implementation
+nlohmann::json DocQualityMetric::valueJson() const {
+    switch (value.kind) {
+        case DocMetricValue::Kind::Json:
+            return nlohmann::json::parse(value.json.begin(), value.json.end());
+        case DocMetricValue::Kind::Doubles:
+            return nlohmann::json(std::vector<double>(value.doubles, value.doubles + value.size));
+        case DocMetricValue::Kind::Integers:
+            return nlohmann::json(std::vector<int64_t>(value.integers, value.integers + value.size));
+        default:
+            return nullptr;
+    }
+}
+
+// MzQCDocument implementation
+MzQCDocument::MzQCDocument()
+    : arena(64 * 1024),
+      vocabularyNodes(&arena),
+      runNodes(&arena),
+      setNodes(&arena),
+      inputFileNodes(&arena),
+      cvParameterNodes(&arena),
+      softwareNodes(&arena),
+      metricNodes(&arena),
+      setRefNodes(&arena) {}
+
+std::string_view MzQCDocument::store(std::string_view text) {
+    if (text.empty()) return std::string_view();
+    char* data = static_cast<char*>(arena.allocate(text.size(), 1));
+    std::memcpy(data, text.data(), text.size());
+    bytesUsed += text.size();
+    return std::string_view(data, text.size());
+}
+
+const double* MzQCDocument::store(const std::vector<double>& values) {
+    if (values.empty()) return nullptr;
+    size_t bytes = values.size() * sizeof(double);
+    auto* data = static_cast<double*>(arena.allocate(bytes, alignof(double)));
+    std::memcpy(data, values.data(), bytes);
+    bytesUsed += bytes;
+    return data;
+}
+
+const int64_t* MzQCDocument::store(const std::vector<int64_t>& values) {
+    if (values.empty()) return nullptr;
+    size_t bytes = values.size() * sizeof(int64_t);
+    auto* data = static_cast<int64_t*>(arena.allocate(bytes, alignof(int64_t)));
+    std::memcpy(data, values.data(), bytes);
+    bytesUsed += bytes;
+    return data;
+}
+
+const DocCvParameter* MzQCDocument::fileFormat(const DocInputFile& file) const {
+    if (file.fileFormat == DocInputFile::npos) return nullptr;
+    return &cvParameterNodes[file.fileFormat];
+}
+
+std::unique_ptr<MzQCDocument> MzQCDocument::fromFile(const std::string& filepath) {
+    FileInputStream file(filepath);
+    return fromStream(file);
+}
+
+std::unique_ptr<MzQCDocument> MzQCDocument::fromStream(std::istream& in) {
+    auto doc = std::make_unique<MzQCDocument>();
+    MzQCDocumentBuilder builder(*doc);
+    nlohmann::json::sax_parse(in, &builder);
+    builder.seal();
+    return doc;
+}
+
+std::unique_ptr<MzQCDocument> MzQCDocument::fromMzQCFile(const MzQCFile& file) {
+    auto doc = std::make_unique<MzQCDocument>();
+    doc->creationDate = doc->store(file.creationDate);
+    doc->version = doc->store(file.version);
+    doc->contactName = doc->store(file.contactName);
+    doc->contactAddress = doc->store(file.contactAddress);
+    doc->description = doc->store(file.description);
+
+    // Every node array is allocated once at its final size
+    size_t inputFiles = 0;
+    size_t parameters = 0;
+    size_t software = 0;
+    size_t metrics = 0;
+    size_t setRefs = 0;
+    for (const auto& run : file.runQualities) {
+        inputFiles += run->inputFiles.size();
+        for (const auto& input : run->inputFiles) {
+            parameters += (input->fileFormat ? 1 : 0) + input->fileProperties.size();
+        }
+        software += run->analysisSoftware.size();
+        metrics += run->metrics.size();
+    }
+    for (const auto& set : file.setQualities) {
+        setRefs += set->setRefs.size();
+        metrics += set->metrics.size();
+    }
+    doc->reserve(doc->vocabularyNodes, file.controlledVocabularies.size());
+    doc->reserve(doc->runNodes, file.runQualities.size());
+    doc->reserve(doc->setNodes, file.setQualities.size());
+    doc->reserve(doc->inputFileNodes, inputFiles);
+    doc->reserve(doc->cvParameterNodes, parameters);
+    doc->reserve(doc->softwareNodes, software);
+    doc->reserve(doc->metricNodes, metrics);
+    doc->reserve(doc->setRefNodes, setRefs);
+
+    for (const auto& cv : file.controlledVocabularies) {
+        doc->vocabularyNodes.push_back({doc->store(cv->id), doc->store(cv->name),
+                                        doc->store(cv->uri), doc->store(cv->version)});
+    }
+
+    auto storeParameter = [&](const CvParameter& param) {
+        doc->cvParameterNodes.push_back({doc->store(param.accession.str()), doc->store(param.name.str()),
+                                         doc->store(param.value), doc->store(param.cvRef.str())});
+    };
+
+    auto storeMetrics = [&](const std::vector<std::shared_ptr<QualityMetric>>& metrics) {
+        for (const auto& metric : metrics) {
+            DocQualityMetric node;
+            node.accession = doc->store(metric->accession.str());
+            node.name = doc->store(metric->name.str());
+            node.description = doc->store(metric->description);
+            node.unit = doc->store(metric->unit.str());
+            if (const auto* doubles = metric->value.doubles()) {
+                node.value.kind = DocMetricValue::Kind::Doubles;
+                node.value.doubles = doc->store(*doubles);
+                node.value.size = doubles->size();
+            } else if (const auto* integers = metric->value.integers()) {
+                node.value.kind = DocMetricValue::Kind::Integers;
+                node.value.integers = doc->store(*integers);
+                node.value.size = integers->size();
+            } else if (!metric->value.is_null()) {
+                node.value.kind = DocMetricValue::Kind::Json;
+                node.value.json = doc->store(metric->value.toJson().dump());
+            }
+            doc->metricNodes.push_back(node);
+        }
+    };
+
+    for (const auto& run : file.runQualities) {
+        DocRunQuality node;
+        node.label = doc->store(run->label);
+        node.firstInputFile = static_cast<uint32_t>(doc->inputFileNodes.size());
+        node.inputFileCount = static_cast<uint32_t>(run->inputFiles.size());
+        for (const auto& input : run->inputFiles) {
+            DocInputFile fileNode;
+            fileNode.location = doc->store(input->location);
+            fileNode.name = doc->store(input->name);
+            if (input->fileFormat) {
+                fileNode.fileFormat = static_cast<uint32_t>(doc->cvParameterNodes.size());
+                storeParameter(*input->fileFormat);
+            }
+            fileNode.firstProperty = static_cast<uint32_t>(doc->cvParameterNodes.size());
+            fileNode.propertyCount = static_cast<uint32_t>(input->fileProperties.size());
+            for (const auto& prop : input->fileProperties) {
+                storeParameter(*prop);
+            }
+            doc->inputFileNodes.push_back(fileNode);
+        }
+        node.firstSoftware = static_cast<uint32_t>(doc->softwareNodes.size());
+        node.softwareCount = static_cast<uint32_t>(run->analysisSoftware.size());
+        for (const auto& sw : run->analysisSoftware) {
+            doc->softwareNodes.push_back({doc->store(sw->accession.str()), doc->store(sw->name.str()),
+                                          doc->store(sw->version), doc->store(sw->uri)});
+        }
+        node.firstMetric = static_cast<uint32_t>(doc->metricNodes.size());
+        node.metricCount = static_cast<uint32_t>(run->metrics.size());
+        storeMetrics(run->metrics);
+        doc->runNodes.push_back(node);
+    }
+
+    for (const auto& set : file.setQualities) {
+        DocSetQuality node;
+        node.label = doc->store(set->label);
+        node.firstSetRef = static_cast<uint32_t>(doc->setRefNodes.size());
+        node.setRefCount = static_cast<uint32_t>(set->setRefs.size());
+        for (const auto& ref : set->setRefs) {
+            doc->setRefNodes.push_back(doc->store(ref));
+        }
+        node.firstMetric = static_cast<uint32_t>(doc->metricNodes.size());
+        node.metricCount = static_cast<uint32_t>(set->metrics.size());
+        storeMetrics(set->metrics);
+        doc->setNodes.push_back(node);
+    }
+
+    return doc;
+}
+
+std::shared_ptr<MzQCFile> MzQCDocument::toMzQCFile() const {
+    auto file = std::make_shared<MzQCFile>(viewString(creationDate), viewString(version),
+                                           viewString(contactName), viewString(contactAddress),
+                                           viewString(description));
+
+    for (const auto& cv : controlledVocabularies()) {
+        auto vocabulary = std::make_shared<ControlledVocabulary>(viewString(cv.name), viewString(cv.uri),
+                                                                 viewString(cv.version));
+        vocabulary->id = viewString(cv.id);
+        file->controlledVocabularies.push_back(vocabulary);
+    }
+
+    auto toParameter = [](const DocCvParameter& param) {
+        return std::make_shared<CvParameter>(viewString(param.accession), viewString(param.name),
+                                             viewString(param.value), viewString(param.cvRef));
+    };
+
+    auto toMetrics = [](DocRange<DocQualityMetric> metrics) {
+        std::vector<std::shared_ptr<QualityMetric>> result;
+        result.reserve(metrics.size());
+        for (const auto& metric : metrics) {
+            MetricValue value;
+            if (metric.value.kind == DocMetricValue::Kind::Doubles) {
+                value = MetricValue(std::vector<double>(metric.doubles().begin(), metric.doubles().end()));
+            } else if (metric.value.kind == DocMetricValue::Kind::Integers) {
+                value = MetricValue(std::vector<int64_t>(metric.integers().begin(), metric.integers().end()));
+            } else if (metric.value.kind == DocMetricValue::Kind::Json) {
+                value = MetricValue(metric.valueJson());
+            }
+            result.push_back(std::make_shared<QualityMetric>(viewString(metric.accession), viewString(metric.name),
+                                                             viewString(metric.description), value,
+                                                             viewString(metric.unit)));
+        }
+        return result;
+    };
+
+    for (const auto& run : runQualities()) {
+        auto runQuality = std::make_shared<RunQuality>(viewString(run.label));
+        for (const auto& input : inputFiles(run)) {
+            auto inputFile = std::make_shared<InputFile>(viewString(input.location), viewString(input.name));
+            if (const DocCvParameter* format = fileFormat(input)) {
+                inputFile->fileFormat = toParameter(*format);
+            }
+            for (const auto& prop : fileProperties(input)) {
+                inputFile->fileProperties.push_back(toParameter(prop));
+            }
+            runQuality->inputFiles.push_back(inputFile);
+        }
+        for (const auto& sw : analysisSoftware(run)) {
+            runQuality->analysisSoftware.push_back(std::make_shared<AnalysisSoftware>(
+                viewString(sw.accession), viewString(sw.name), viewString(sw.version), viewString(sw.uri)));
+        }
+        runQuality->metrics = toMetrics(metrics(run));
+        file->runQualities.push_back(runQuality);
+    }
+
+    for (const auto& set : setQualities()) {
+        std::vector<std::string> refs;
+        for (const auto& ref : setRefs(set)) {
+            refs.push_back(viewString(ref));
+        }
+        file->setQualities.push_back(std::make_shared<SetQuality>(viewString(set.label), refs, toMetrics(metrics(set))));
+    }
+
+    return file;
+}
+
+} // namespace mzqc
@@ -0,0 +1,179 @@
+#pragma once
+
+#include "mzqc.hpp"
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <istream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+namespace mzqc {
+
+// Contiguous view over nodes owned by an MzQCDocument
+template <typename T>
+class DocRange {
+public:
+    DocRange() = default;
+    DocRange(const T* first, size_t count) : first(first), count(count) {}
+
+    const T* begin() const { return first; }
+    const T* end() const { return first + count; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const T& operator[](size_t index) const { return first[index]; }
+
+private:
+    const T* first = nullptr;
+    size_t count = 0;
+};
+
+// Node types of an MzQCDocument. Strings are views into the document arena,
+// children are referenced by index ranges into the document's node arrays.
+struct DocControlledVocabulary {
+    std::string_view id;
+    std::string_view name;
+    std::string_view uri;
+    std::string_view version;
+};
+
+struct DocCvParameter {
+    std::string_view accession;
+    std::string_view name;
+    std::string_view value;
+    std::string_view cvRef;
+};
+
+struct DocAnalysisSoftware {
+    std::string_view accession;
+    std::string_view name;
+    std::string_view version;
+    std::string_view uri;
+};
+
+struct DocInputFile {
+    static constexpr uint32_t npos = UINT32_MAX;
+
+    std::string_view location;
+    std::string_view name;
+    uint32_t fileFormat = npos;
+    uint32_t firstProperty = 0;
+    uint32_t propertyCount = 0;
+};
+
+struct DocMetricValue {
+    enum class Kind { Null, Json, Doubles, Integers };
+
+    Kind kind = Kind::Null;
+    // Compact json text for Kind::Json
+    std::string_view json;
+    // Typed arrays for Kind::Doubles / Kind::Integers
+    const double* doubles = nullptr;
+    const int64_t* integers = nullptr;
+    size_t size = 0;
+};
+
+struct DocQualityMetric {
+    std::string_view accession;
+    std::string_view name;
+    std::string_view description;
+    std::string_view unit;
+    DocMetricValue value;
+
+    DocRange<double> doubles() const { return DocRange<double>(value.doubles, value.kind == DocMetricValue::Kind::Doubles ? value.size : 0); }
+    DocRange<int64_t> integers() const { return DocRange<int64_t>(value.integers, value.kind == DocMetricValue::Kind::Integers ? value.size : 0); }
+    // Decodes the value, only needed for Kind::Json
+    nlohmann::json valueJson() const;
+};
+
+struct DocRunQuality {
+    std::string_view label;
+    uint32_t firstInputFile = 0;
+    uint32_t inputFileCount = 0;
+    uint32_t firstSoftware = 0;
+    uint32_t softwareCount = 0;
+    uint32_t firstMetric = 0;
+    uint32_t metricCount = 0;
+};
+
+struct DocSetQuality {
+    std::string_view label;
+    uint32_t firstSetRef = 0;
+    uint32_t setRefCount = 0;
+    uint32_t firstMetric = 0;
+    uint32_t metricCount = 0;
+};
+
+// Arena-backed alternative to MzQCFile for large documents. All nodes and
+// strings live in one monotonic buffer and are released together when the
+// document is destroyed, with no per-node allocation or reference counting.
+// The shared_ptr object model stays available through toMzQCFile/fromMzQCFile.
+class MzQCDocument {
+public:
+    MzQCDocument();
+    MzQCDocument(const MzQCDocument&) = delete;
+    MzQCDocument& operator=(const MzQCDocument&) = delete;
+
+    static std::unique_ptr<MzQCDocument> fromFile(const std::string& filepath);
+    static std::unique_ptr<MzQCDocument> fromStream(std::istream& in);
+    static std::unique_ptr<MzQCDocument> fromMzQCFile(const MzQCFile& file);
+    std::shared_ptr<MzQCFile> toMzQCFile() const;
+
+    std::string_view creationDate;
+    std::string_view version;
+    std::string_view contactName;
+    std::string_view contactAddress;
+    std::string_view description;
+
+    DocRange<DocControlledVocabulary> controlledVocabularies() const { return range(vocabularyNodes, 0, vocabularyNodes.size()); }
+    DocRange<DocRunQuality> runQualities() const { return range(runNodes, 0, runNodes.size()); }
+    DocRange<DocSetQuality> setQualities() const { return range(setNodes, 0, setNodes.size()); }
+
+    DocRange<DocInputFile> inputFiles(const DocRunQuality& run) const { return range(inputFileNodes, run.firstInputFile, run.inputFileCount); }
+    DocRange<DocAnalysisSoftware> analysisSoftware(const DocRunQuality& run) const { return range(softwareNodes, run.firstSoftware, run.softwareCount); }
+    DocRange<DocQualityMetric> metrics(const DocRunQuality& run) const { return range(metricNodes, run.firstMetric, run.metricCount); }
+    DocRange<DocQualityMetric> metrics(const DocSetQuality& set) const { return range(metricNodes, set.firstMetric, set.metricCount); }
+    DocRange<std::string_view> setRefs(const DocSetQuality& set) const { return range(setRefNodes, set.firstSetRef, set.setRefCount); }
+    DocRange<DocCvParameter> fileProperties(const DocInputFile& file) const { return range(cvParameterNodes, file.firstProperty, file.propertyCount); }
+    const DocCvParameter* fileFormat(const DocInputFile& file) const;
+
+    // Copy a string or array into the arena
+    std::string_view store(std::string_view text);
+    const double* store(const std::vector<double>& values);
+    const int64_t* store(const std::vector<int64_t>& values);
+
+    // Bytes handed out by the arena so far, node arrays included
+    size_t arenaBytes() const { return bytesUsed; }
+
+private:
+    friend class MzQCDocumentBuilder;
+
+    template <typename T>
+    static DocRange<T> range(const std::pmr::vector<T>& nodes, size_t first, size_t count) {
+        return DocRange<T>(nodes.data() + first, count);
+    }
+
+    // Node arrays are sized once: growing them in the monotonic arena would
+    // leave every outgrown buffer behind until the document is destroyed
+    template <typename T>
+    void reserve(std::pmr::vector<T>& nodes, size_t count) {
+        nodes.reserve(count);
+        bytesUsed += nodes.capacity() * sizeof(T);
+    }
+
+    std::pmr::monotonic_buffer_resource arena;
+    size_t bytesUsed = 0;
+
+    std::pmr::vector<DocControlledVocabulary> vocabularyNodes;
+    std::pmr::vector<DocRunQuality> runNodes;
+    std::pmr::vector<DocSetQuality> setNodes;
+    std::pmr::vector<DocInputFile> inputFileNodes;
+    std::pmr::vector<DocCvParameter> cvParameterNodes;
+    std::pmr::vector<DocAnalysisSoftware> softwareNodes;
+    std::pmr::vector<DocQualityMetric> metricNodes;
+    std::pmr::vector<std::string_view> setRefNodes;
+};
+
+} // namespace mzqc
@@ -0,0 +1,117 @@
+#include "mzqc_index.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <limits>
+#include <stdexcept>
+
+namespace mzqc {
+
+static double scalarValue(const MetricValue& value) {
+    const nlohmann::json* j = value.json();
+    return j && j->is_number() ? j->get<double>() : std::numeric_limits<double>::quiet_NaN();
+}
+
+static bool isMzQCPath(const std::string& name) {
+    for (const char* suffix : {".mzqc", ".mzqc.gz", ".mzqc.zst"}) {
+        size_t n = std::char_traits<char>::length(suffix);
+        if (name.size() > n && name.compare(name.size() - n, n, suffix) == 0) return true;
+    }
+    return false;
+}
+
+// MzQCIndex implementation
+MzQCIndex::MzQCIndex(std::shared_ptr<const MzQCFile> file) {
+    add(std::move(file));
+}
+
+MzQCIndex MzQCIndex::fromDirectory(const std::string& directory, const MzQCLoadOptions& options) {
+    std::vector<std::string> paths;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+        if (entry.is_regular_file() && isMzQCPath(entry.path().filename().string())) {
+            paths.push_back(entry.path().string());
+        }
+    }
+    if (error) {
+        throw std::runtime_error("Could not read directory: " + directory);
+    }
+    std::sort(paths.begin(), paths.end());
+
+    MzQCIndex index;
+    for (auto& result : MzQCFile::loadMany(paths, options)) {
+        if (!result.file) {
+            throw std::runtime_error(result.path + ": " + result.error);
+        }
+        index.add(std::move(result.file));
+    }
+    return index;
+}
+
+void MzQCIndex::add(std::shared_ptr<const MzQCFile> file) {
+    if (!file) return;
+    const auto fileIndex = static_cast<uint32_t>(files.size());
+    for (const auto& run : file->runQualities) {
+        const auto runIndex = static_cast<uint32_t>(runs.size());
+        runs.push_back(run.get());
+        runFiles.push_back(fileIndex);
+        byLabel.emplace(run->label, runIndex);
+        for (const auto& input : run->inputFiles) {
+            byInputFile.emplace(input->name, runIndex);
+        }
+        for (const auto& metric : run->metrics) {
+            byAccession[metric->accession.handle()].push_back({runIndex, metric.get()});
+        }
+    }
+    files.push_back(std::move(file));
+}
+
+size_t MzQCIndex::findRun(std::string_view label) const {
+    auto it = byLabel.find(label);
+    return it == byLabel.end() ? npos : it->second;
+}
+
+size_t MzQCIndex::findRunByInputFile(std::string_view name) const {
+    auto it = byInputFile.find(name);
+    return it == byInputFile.end() ? npos : it->second;
+}
+
+const std::vector<MzQCIndex::MetricRef>& MzQCIndex::metrics(std::string_view accession) const {
+    static const std::vector<MetricRef> none;
+    // An accession that was never interned cannot be in any file
+    uint32_t id = 0;
+    if (!StringInternTable::global().find(accession, id)) return none;
+    auto it = byAccession.find(id);
+    return it == byAccession.end() ? none : it->second;
+}
+
+const QualityMetric* MzQCIndex::metric(size_t run, std::string_view accession) const {
+    const auto& refs = metrics(accession);
+    auto it = std::lower_bound(refs.begin(), refs.end(), run,
+                               [](const MetricRef& ref, size_t value) { return ref.run < value; });
+    return it != refs.end() && it->run == run ? it->metric : nullptr;
+}
+
+std::vector<double> MzQCIndex::column(std::string_view accession) const {
+    std::vector<double> values(runs.size(), std::numeric_limits<double>::quiet_NaN());
+    const auto& refs = metrics(accession);
+    // Refs are in run order, the first metric of a run wins
+    for (auto it = refs.rbegin(); it != refs.rend(); ++it) {
+        values[it->run] = scalarValue(it->metric->value);
+    }
+    return values;
+}
+
+MzQCIndex::Series MzQCIndex::series(std::string_view accession) const {
+    Series out;
+    const auto& refs = metrics(accession);
+    out.runs.reserve(refs.size());
+    out.values.reserve(refs.size());
+    for (const auto& ref : refs) {
+        if (!out.runs.empty() && out.runs.back() == ref.run) continue;
+        out.runs.push_back(ref.run);
+        out.values.push_back(scalarValue(ref.metric->value));
+    }
+    return out;
+}
+
+} // namespace mzqc
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "mzqc.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace mzqc {
+
+// Lookup tables over the runs of one or more loaded files, built once.
+// Runs are numbered densely across all added files in the order added. The
+// index keeps the files alive but they must not be modified while indexed.
+class MzQCIndex {
+public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    struct MetricRef {
+        uint32_t run;
+        const QualityMetric* metric;
+    };
+
+    // One scalar metric over the runs that have it, in run order
+    struct Series {
+        std::vector<uint32_t> runs;
+        std::vector<double> values;
+    };
+
+    MzQCIndex() = default;
+    explicit MzQCIndex(std::shared_ptr<const MzQCFile> file);
+
+    // Every *.mzqc, *.mzqc.gz and *.mzqc.zst file of the directory, in path
+    // order, loaded with MzQCFile::loadMany. Throws std::runtime_error naming
+    // the first file that fails to load.
+    static MzQCIndex fromDirectory(const std::string& directory, const MzQCLoadOptions& options = MzQCLoadOptions());
+
+    void add(std::shared_ptr<const MzQCFile> file);
+
+    size_t fileCount() const { return files.size(); }
+    size_t runCount() const { return runs.size(); }
+    const MzQCFile& file(size_t index) const { return *files[index]; }
+    const RunQuality& run(size_t index) const { return *runs[index]; }
+    // Index of the file a run belongs to
+    size_t fileOf(size_t run) const { return runFiles[run]; }
+
+    // Run with this label or input file name, the first one added if several
+    // share it; npos if there is none
+    size_t findRun(std::string_view label) const;
+    size_t findRunByInputFile(std::string_view name) const;
+
+    // All metrics with the accession in run order, empty if no run has it
+    const std::vector<MetricRef>& metrics(std::string_view accession) const;
+    // First metric of the run with the accession, nullptr if it has none
+    const QualityMetric* metric(size_t run, std::string_view accession) const;
+
+    // Numeric value of the metric for every run, NaN where a run lacks it or
+    // the value is not a single number
+    std::vector<double> column(std::string_view accession) const;
+    // Same values for only the runs that have the metric, O(k) for k runs
+    Series series(std::string_view accession) const;
+
+private:
+    std::vector<std::shared_ptr<const MzQCFile>> files;
+    std::vector<const RunQuality*> runs;
+    std::vector<uint32_t> runFiles;
+    // Keyed by the interned accession handle
+    std::unordered_map<uint32_t, std::vector<MetricRef>> byAccession;
+    // Views into the labels and names of the indexed runs
+    std::unordered_map<std::string_view, uint32_t> byLabel;
+    std::unordered_map<std::string_view, uint32_t> byInputFile;
+};
+
+} // namespace mzqc
@@ -0,0 +1,108 @@
+#include "mzqc_intern.hpp"
+#include <mutex>
+#include <stdexcept>
+
+namespace mzqc {
+
+namespace {
+
+std::atomic<uint64_t> nextTableSerial{1};
+
+// Direct-mapped cache of the strings a thread interned or found last.
+// Entries view strings owned by the table, which never move.
+struct InternCache {
+    static constexpr size_t size = 256;
+    struct Entry {
+        uint64_t table = 0;
+        std::string_view text;
+        uint32_t id = 0;
+    };
+    Entry entries[size];
+};
+
+thread_local InternCache internCache;
+
+} // namespace
+
+// StringInternTable implementation
+StringInternTable& StringInternTable::global() {
+    static StringInternTable table;
+    return table;
+}
+
+StringInternTable::StringInternTable()
+    : serial(nextTableSerial.fetch_add(1, std::memory_order_relaxed)), chunks(new std::atomic<std::string*>[maxChunks]) {
+    for (size_t i = 0; i < maxChunks; ++i) {
+        chunks[i].store(nullptr, std::memory_order_relaxed);
+    }
+    intern(std::string_view());
+}
+
+StringInternTable::~StringInternTable() {
+    for (size_t i = 0; i < maxChunks; ++i) {
+        delete[] chunks[i].load(std::memory_order_relaxed);
+    }
+}
+
+bool StringInternTable::cached(std::string_view text, size_t hash, uint32_t& id) const {
+    const auto& entry = internCache.entries[hash % InternCache::size];
+    if (entry.table != serial || entry.text != text) return false;
+    id = entry.id;
+    return true;
+}
+
+void StringInternTable::remember(std::string_view stored, size_t hash, uint32_t id) const {
+    internCache.entries[hash % InternCache::size] = {serial, stored, id};
+}
+
+bool StringInternTable::find(std::string_view text, uint32_t& id) const {
+    size_t hash = std::hash<std::string_view>()(text);
+    if (cached(text, hash, id)) return true;
+
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto it = index.find(text);
+    if (it == index.end()) return false;
+    id = it->second;
+    remember(it->first, hash, id);
+    return true;
+}
+
+uint32_t StringInternTable::intern(std::string_view text) {
+    uint32_t id;
+    if (find(text, id)) return id;
+
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    size_t hash = std::hash<std::string_view>()(text);
+    auto it = index.find(text);
+    if (it != index.end()) {
+        remember(it->first, hash, it->second);
+        return it->second;
+    }
+
+    id = count.load(std::memory_order_relaxed);
+    size_t chunk = id >> chunkBits;
+    if (chunk >= maxChunks) {
+        throw std::runtime_error("String intern table is full");
+    }
+    std::string* strings = chunks[chunk].load(std::memory_order_relaxed);
+    if (!strings) {
+        strings = new std::string[chunkSize];
+        chunks[chunk].store(strings, std::memory_order_release);
+    }
+    std::string& stored = strings[id & (chunkSize - 1)];
+    stored.assign(text.data(), text.size());
+    index.emplace(std::string_view(stored), id);
+    count.store(id + 1, std::memory_order_release);
+    remember(stored, hash, id);
+    return id;
+}
+
+const std::string& StringInternTable::lookup(uint32_t id) const {
+    return chunks[id >> chunkBits].load(std::memory_order_acquire)[id & (chunkSize - 1)];
+}
+
+std::ostream& operator<<(std::ostream& os, InternedString text) {
+    return os << text.str();
+}
+
+} // namespace mzqc
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace mzqc {
+
+// Process-wide table of unique strings. Ids are dense, 0 is the empty string.
+// intern and find answer repeated strings from a small per-thread cache and
+// only take the table lock, shared for known strings, on a cache miss.
+// Resolving an id to its string never locks.
+class StringInternTable {
+public:
+    static StringInternTable& global();
+
+    StringInternTable();
+    ~StringInternTable();
+    StringInternTable(const StringInternTable&) = delete;
+    StringInternTable& operator=(const StringInternTable&) = delete;
+
+    uint32_t intern(std::string_view text);
+    // Id of an already interned string, without adding it
+    bool find(std::string_view text, uint32_t& id) const;
+    const std::string& lookup(uint32_t id) const;
+    size_t size() const { return count.load(std::memory_order_acquire); }
+
+private:
+    static constexpr unsigned chunkBits = 12;
+    static constexpr size_t chunkSize = size_t(1) << chunkBits;
+    static constexpr size_t maxChunks = size_t(1) << 16;
+
+    bool cached(std::string_view text, size_t hash, uint32_t& id) const;
+    void remember(std::string_view stored, size_t hash, uint32_t id) const;
+
+    // Tells the per-thread cache entries of different tables apart
+    const uint64_t serial;
+    mutable std::shared_mutex mutex;
+    std::unordered_map<std::string_view, uint32_t> index;
+    // Fixed directory of chunks so that strings never move once stored
+    std::unique_ptr<std::atomic<std::string*>[]> chunks;
+    std::atomic<uint32_t> count{0};
+};
+
+// Compact handle to an interned string. Used for accessions, names and cvRefs,
+// which repeat across all metrics of a file; comparing two handles is an
+// integer compare.
+class InternedString {
+public:
+    InternedString() = default;
+    // The empty string is id 0 without a table lookup, so default arguments
+    // such as an empty unit cost nothing
+    InternedString(const std::string& text) : id(text.empty() ? 0 : StringInternTable::global().intern(text)) {}
+    InternedString(const char* text) : id(*text == '\0' ? 0 : StringInternTable::global().intern(text)) {}
+    InternedString(std::string_view text) : id(text.empty() ? 0 : StringInternTable::global().intern(text)) {}
+
+    const std::string& str() const { return StringInternTable::global().lookup(id); }
+    operator const std::string&() const { return str(); }
+    const char* c_str() const { return str().c_str(); }
+    size_t size() const { return str().size(); }
+    bool empty() const { return id == 0; }
+    uint32_t handle() const { return id; }
+
+    friend bool operator==(InternedString a, InternedString b) { return a.id == b.id; }
+    friend bool operator!=(InternedString a, InternedString b) { return a.id != b.id; }
+    friend bool operator==(InternedString a, const std::string& b) { return a.str() == b; }
+    friend bool operator==(const std::string& a, InternedString b) { return a == b.str(); }
+    friend bool operator==(InternedString a, const char* b) { return a.str() == b; }
+    friend bool operator==(const char* a, InternedString b) { return a == b.str(); }
+    friend bool operator!=(InternedString a, const std::string& b) { return !(a == b); }
+    friend bool operator!=(const std::string& a, InternedString b) { return !(a == b); }
+    friend bool operator!=(InternedString a, const char* b) { return !(a == b); }
+    friend bool operator!=(const char* a, InternedString b) { return !(a == b); }
+    // Orders by content so sorted containers stay alphabetical
+    friend bool operator<(InternedString a, InternedString b) { return a.id != b.id && a.str() < b.str(); }
+
+private:
+    uint32_t id = 0;
+};
+
+std::ostream& operator<<(std::ostream& os, InternedString text);
+
+} // namespace mzqc
+
+namespace std {
+template <>
+struct hash<mzqc::InternedString> {
+    size_t operator()(mzqc::InternedString text) const noexcept { return std::hash<uint32_t>()(text.handle()); }
+};
+} // namespace std
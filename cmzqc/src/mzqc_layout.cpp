@@ -0,0 +1,211 @@
+#include "mzqc_layout.hpp"
+#include <cstring>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace mzqc {
+
+namespace {
+
+// Runs and sets can sit in the mzQC object or, without one, at the root
+struct Candidates {
+    MzQCLayout::Span runArray;
+    MzQCLayout::Span setArray;
+    std::vector<MzQCLayout::Span> runs;
+    std::vector<MzQCLayout::Span> sets;
+};
+
+bool isStructural(char c) {
+    return c == '"' || c == '{' || c == '}' || c == '[' || c == ']';
+}
+
+bool isWhitespace(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+// Position of the next quote or bracket at or after i, n if there is none
+size_t nextStructural(const char* p, size_t i, size_t n) {
+#if defined(__SSE2__)
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i braceOpen = _mm_set1_epi8('{');
+    const __m128i braceClose = _mm_set1_epi8('}');
+    const __m128i bracketOpen = _mm_set1_epi8('[');
+    const __m128i bracketClose = _mm_set1_epi8(']');
+    for (; i + 16 <= n; i += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        __m128i hits = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, braceOpen)),
+            _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, braceClose), _mm_cmpeq_epi8(chunk, bracketOpen)),
+                         _mm_cmpeq_epi8(chunk, bracketClose)));
+        int mask = _mm_movemask_epi8(hits);
+        if (mask != 0) return i + static_cast<size_t>(__builtin_ctz(static_cast<unsigned>(mask)));
+    }
+#endif
+    while (i < n && !isStructural(p[i])) ++i;
+    return i;
+}
+
+// Position of the quote closing the string opened at i, n if it is unterminated
+size_t stringEnd(const char* p, size_t i, size_t n) {
+    size_t pos = i + 1;
+    for (;;) {
+        const void* quote = pos < n ? std::memchr(p + pos, '"', n - pos) : nullptr;
+        if (!quote) return n;
+        pos = static_cast<size_t>(static_cast<const char*>(quote) - p);
+        size_t backslashes = 0;
+        while (pos - backslashes > i + 1 && p[pos - 1 - backslashes] == '\\') ++backslashes;
+        if (backslashes % 2 == 0) return pos;
+        ++pos;
+    }
+}
+
+} // namespace
+
+bool scanLayout(std::string_view text, MzQCLayout& layout) {
+    layout = MzQCLayout();
+    const char* p = text.data();
+    const size_t n = text.size();
+
+    Candidates root;
+    Candidates nested;
+    // Open containers, '{' or '['
+    std::string stack;
+    // Whether the next string in the innermost object is a key
+    bool expectKey = false;
+    std::string_view rootKey;
+    std::string_view mzqcKey;
+    // Stack depth of the mzQC object, 0 outside of it
+    size_t mzqcDepth = 0;
+    size_t mzqcCount = 0;
+
+    // The runQualities or setQualities array being split, if any
+    Candidates* target = nullptr;
+    bool targetIsRuns = false;
+    size_t targetDepth = 0;
+    bool expectElement = false;
+    bool expectSeparator = false;
+    size_t elementBegin = 0;
+    // Set after a target key until its value starts
+    Candidates* awaiting = nullptr;
+    bool awaitingRuns = false;
+
+    size_t i = 0;
+    while (i < n) {
+        // Inside an element only brackets and strings matter
+        if (target && stack.size() > targetDepth) {
+            i = nextStructural(p, i, n);
+            if (i == n) return false;
+        }
+        char c = p[i];
+
+        if (awaiting && !isWhitespace(c) && c != ':') {
+            if (c != '[') return false;
+            target = awaiting;
+            targetIsRuns = awaitingRuns;
+            targetDepth = stack.size() + 1;
+            (targetIsRuns ? target->runArray : target->setArray).begin = i;
+            expectElement = true;
+            expectSeparator = false;
+            awaiting = nullptr;
+        }
+        bool inTarget = target && stack.size() == targetDepth;
+
+        switch (c) {
+            case '"': {
+                if (inTarget) return false;
+                size_t end = stringEnd(p, i, n);
+                if (end == n) return false;
+                if (expectKey && stack.size() <= 2) {
+                    std::string_view key(p + i + 1, end - i - 1);
+                    if (key.find('\\') != std::string_view::npos) return false;
+                    Candidates* owner = nullptr;
+                    if (stack.size() == 1) {
+                        rootKey = key;
+                        if (key == "mzQC" && ++mzqcCount > 1) return false;
+                        owner = &root;
+                    } else if (mzqcDepth == 2) {
+                        mzqcKey = key;
+                        owner = &nested;
+                    }
+                    if (owner && (key == "runQualities" || key == "setQualities")) {
+                        bool runs = key == "runQualities";
+                        // A repeated key would replace the first array
+                        if ((runs ? owner->runArray : owner->setArray).begin != MzQCLayout::npos) return false;
+                        awaiting = owner;
+                        awaitingRuns = runs;
+                    }
+                }
+                expectKey = false;
+                i = end;
+                break;
+            }
+            case '{':
+            case '[':
+                if (inTarget) {
+                    if (c != '{' || !expectElement) return false;
+                    elementBegin = i;
+                    expectElement = false;
+                }
+                if (c == '{' && stack.size() == 1 && rootKey == "mzQC") mzqcDepth = 2;
+                stack.push_back(c);
+                expectKey = c == '{';
+                break;
+            case '}':
+            case ']': {
+                if (stack.empty() || stack.back() != (c == '}' ? '{' : '[')) return false;
+                stack.pop_back();
+                if (target && stack.size() == targetDepth) {
+                    (targetIsRuns ? target->runs : target->sets).push_back({elementBegin, i + 1});
+                    expectSeparator = true;
+                } else if (target && stack.size() == targetDepth - 1) {
+                    // Trailing comma
+                    if (expectElement && !(targetIsRuns ? target->runs : target->sets).empty()) return false;
+                    (targetIsRuns ? target->runArray : target->setArray).end = i + 1;
+                    target = nullptr;
+                }
+                if (stack.size() < mzqcDepth) mzqcDepth = 0;
+                break;
+            }
+            case ',':
+                if (inTarget) {
+                    if (!expectSeparator) return false;
+                    expectSeparator = false;
+                    expectElement = true;
+                }
+                if (!stack.empty() && stack.back() == '{') expectKey = true;
+                break;
+            default:
+                if (inTarget && !isWhitespace(c)) return false;
+                break;
+        }
+        ++i;
+    }
+    if (!stack.empty() || target || awaiting) return false;
+
+    // Only the arrays that end up in the file are split, the rest stay in the skeleton
+    Candidates& chosen = mzqcCount > 0 ? nested : root;
+    layout.runArray = chosen.runArray;
+    layout.setArray = chosen.setArray;
+    layout.runs = std::move(chosen.runs);
+    layout.sets = std::move(chosen.sets);
+    return true;
+}
+
+std::string MzQCLayout::skeleton(std::string_view text) const {
+    Span first = runArray;
+    Span second = setArray;
+    if (second.begin < first.begin) std::swap(first, second);
+
+    std::string out;
+    size_t pos = 0;
+    for (const Span& array : {first, second}) {
+        if (array.begin == npos) continue;
+        out.append(text.substr(pos, array.begin + 1 - pos));
+        pos = array.end - 1;
+    }
+    out.append(text.substr(pos));
+    return out;
+}
+
+} // namespace mzqc
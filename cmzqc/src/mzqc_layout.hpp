@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mzqc {
+
+// Byte ranges of the runQualities and setQualities elements of an mzQC text,
+// found by a structural pre-scan that only tracks strings and brackets.
+struct MzQCLayout {
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    struct Span {
+        size_t begin = npos; // first byte
+        size_t end = npos;   // one past the last byte
+        size_t size() const { return end - begin; }
+    };
+
+    // From '[' to one past ']' of each array, npos if the array is absent
+    Span runArray;
+    Span setArray;
+    // One span per element object, in document order
+    std::vector<Span> runs;
+    std::vector<Span> sets;
+
+    // The text with the contents of both arrays removed
+    std::string skeleton(std::string_view text) const;
+};
+
+// Fills layout for a document of the form {"mzQC": {..., "runQualities": [{...}, ...]}}.
+// Returns false for anything else, e.g. duplicate keys, escaped keys or array
+// elements that are not objects, in which case callers parse sequentially.
+// The elements themselves are not validated, only their boundaries.
+bool scanLayout(std::string_view text, MzQCLayout& layout);
+
+} // namespace mzqc
@@ -0,0 +1,253 @@
+#include "mzqc_mapped.hpp"
+#include <stdexcept>
+
+namespace mzqc {
+
+namespace {
+
+// Head of a CBOR item: major type, argument and the first byte after the head.
+// Indefinite lengths have info 31 and argument 0.
+struct CborHead {
+    uint8_t major;
+    uint8_t info;
+    uint64_t value;
+    const uint8_t* next;
+};
+
+[[noreturn]] void malformed() {
+    throw std::runtime_error("Malformed binary mzQC file");
+}
+
+CborHead readHead(const uint8_t* p, const uint8_t* end) {
+    if (p >= end) malformed();
+    CborHead head{static_cast<uint8_t>(*p >> 5), static_cast<uint8_t>(*p & 31), 0, p + 1};
+    if (head.info < 24) {
+        head.value = head.info;
+    } else if (head.info <= 27) {
+        size_t bytes = size_t(1) << (head.info - 24);
+        if (static_cast<size_t>(end - head.next) < bytes) malformed();
+        for (size_t i = 0; i < bytes; ++i) head.value = (head.value << 8) | head.next[i];
+        head.next += bytes;
+    } else if (head.info != 31) {
+        malformed();
+    }
+    return head;
+}
+
+// Length of a definite string or byte string, checked against the mapping
+const uint8_t* payloadEnd(const CborHead& head, const uint8_t* end) {
+    if (head.value > static_cast<uint64_t>(end - head.next)) malformed();
+    return head.next + head.value;
+}
+
+bool isBreak(const uint8_t* p, const uint8_t* end) {
+    if (p >= end) malformed();
+    return *p == 0xff;
+}
+
+// First byte after the item at p. Strings and typed arrays are skipped by
+// their length, only containers are walked.
+const uint8_t* skipItem(const uint8_t* p, const uint8_t* end, int depth = 0) {
+    if (depth > 512) malformed();
+    CborHead head = readHead(p, end);
+    const bool indefinite = head.info == 31;
+    switch (head.major) {
+        case 0:
+        case 1:
+            if (indefinite) malformed();
+            return head.next;
+        case 2:
+        case 3: {
+            if (!indefinite) return payloadEnd(head, end);
+            const uint8_t* q = head.next;
+            while (!isBreak(q, end)) q = skipItem(q, end, depth + 1);
+            return q + 1;
+        }
+        case 4:
+        case 5: {
+            const uint8_t* q = head.next;
+            if (indefinite) {
+                while (!isBreak(q, end)) q = skipItem(q, end, depth + 1);
+                return q + 1;
+            }
+            uint64_t items = head.major == 5 ? head.value * 2 : head.value;
+            if (head.value > static_cast<uint64_t>(end - q)) malformed();
+            for (uint64_t i = 0; i < items; ++i) q = skipItem(q, end, depth + 1);
+            return q;
+        }
+        case 6:
+            if (indefinite) malformed();
+            return skipItem(head.next, end, depth + 1);
+        default:
+            // Simple values and floats, the argument bytes were the payload
+            if (indefinite) malformed();
+            return head.next;
+    }
+}
+
+// Text of a definite-length string item, nullopt for anything else
+std::optional<std::string_view> readText(const uint8_t* p, const uint8_t* end) {
+    CborHead head = readHead(p, end);
+    if (head.major != 3 || head.info == 31) return std::nullopt;
+    payloadEnd(head, end);
+    return std::string_view(reinterpret_cast<const char*>(head.next), head.value);
+}
+
+// Calls visit(key, value) for every text key of the map at p
+template <typename Visit>
+void forEachEntry(const uint8_t* p, const uint8_t* end, Visit&& visit) {
+    CborHead head = readHead(p, end);
+    if (head.major != 5 || head.info == 31) malformed();
+    const uint8_t* q = head.next;
+    for (uint64_t i = 0; i < head.value; ++i) {
+        std::optional<std::string_view> key = readText(q, end);
+        q = skipItem(q, end);
+        const uint8_t* value = q;
+        q = skipItem(q, end);
+        if (key) visit(*key, value);
+    }
+}
+
+const uint8_t* findEntry(const uint8_t* p, const uint8_t* end, std::string_view key) {
+    const uint8_t* found = nullptr;
+    forEachEntry(p, end, [&](std::string_view k, const uint8_t* value) {
+        if (!found && k == key) found = value;
+    });
+    return found;
+}
+
+// Offsets of the elements of the array at p, relative to base
+std::vector<size_t> elementOffsets(const uint8_t* p, const uint8_t* end, const uint8_t* base) {
+    CborHead head = readHead(p, end);
+    if (head.major != 4 || head.info == 31) malformed();
+    if (head.value > static_cast<uint64_t>(end - head.next)) malformed();
+    std::vector<size_t> offsets;
+    offsets.reserve(head.value);
+    const uint8_t* q = head.next;
+    for (uint64_t i = 0; i < head.value; ++i) {
+        offsets.push_back(static_cast<size_t>(q - base));
+        q = skipItem(q, end);
+    }
+    return offsets;
+}
+
+// Payload of a typed array with the given tag, empty if the value is something else
+template <typename T>
+NumericView<T> typedArray(const uint8_t* p, const uint8_t* end, uint64_t tag) {
+    if (!p) return NumericView<T>();
+    CborHead head = readHead(p, end);
+    if (head.major != 6 || head.value != tag) return NumericView<T>();
+    CborHead bytes = readHead(head.next, end);
+    if (bytes.major != 2 || bytes.info == 31 || bytes.value % sizeof(T) != 0) return NumericView<T>();
+    payloadEnd(bytes, end);
+    return NumericView<T>(bytes.next, static_cast<size_t>(bytes.value / sizeof(T)));
+}
+
+} // namespace
+
+// MappedMetric implementation
+NumericView<double> MappedMetric::doubles() const {
+    return typedArray<double>(valueBegin, valueEnd, typedArrayFloat64);
+}
+
+NumericView<int64_t> MappedMetric::integers() const {
+    return typedArray<int64_t>(valueBegin, valueEnd, typedArraySint64);
+}
+
+MetricValue MappedMetric::value() const {
+    if (!hasValue()) return MetricValue();
+    return MetricValue(nlohmann::json::from_cbor(valueBegin, valueEnd, true, true,
+                                                 nlohmann::json::cbor_tag_handler_t::store));
+}
+
+// MappedRun implementation
+MappedMetric MappedRun::metric(size_t index) const {
+    if (index >= metricOffsets.size()) {
+        throw std::runtime_error("Metric index " + std::to_string(index) + " out of range");
+    }
+    MappedMetric metric;
+    forEachEntry(base + metricOffsets[index], end, [&](std::string_view key, const uint8_t* value) {
+        if (key == "value") {
+            metric.valueBegin = value;
+            metric.valueEnd = skipItem(value, end);
+            return;
+        }
+        std::optional<std::string_view> text = readText(value, end);
+        if (!text) return;
+        if (key == "accession") {
+            metric.accessionText = *text;
+        } else if (key == "name") {
+            metric.nameText = *text;
+        } else if (key == "description") {
+            metric.descriptionText = *text;
+        } else if (key == "unit") {
+            metric.unitText = *text;
+        }
+    });
+    return metric;
+}
+
+std::optional<MappedMetric> MappedRun::find(std::string_view accession) const {
+    for (size_t i = 0; i < metricOffsets.size(); ++i) {
+        // Only the accession is read until a metric matches
+        const uint8_t* value = findEntry(base + metricOffsets[i], end, "accession");
+        if (value && readText(value, end) == accession) return metric(i);
+    }
+    return std::nullopt;
+}
+
+// MappedMzQC implementation
+MappedMzQC::MappedMzQC(const std::string& filepath) {
+    if (!file.open(filepath)) {
+        throw std::runtime_error("Could not open file: " + filepath);
+    }
+    begin = reinterpret_cast<const uint8_t*>(file.data());
+    end = begin + file.size();
+    // Self-describe tag written by MzQCFile::toBinary
+    static const uint8_t magic[] = {0xd9, 0xd9, 0xf7};
+    if (file.size() < sizeof(magic) || std::memcmp(begin, magic, sizeof(magic)) != 0) {
+        throw std::runtime_error("Not a CBOR mzQC file: " + filepath);
+    }
+}
+
+void MappedMzQC::index() const {
+    std::call_once(indexed, [this] {
+        const uint8_t* root = begin + 3;
+        const uint8_t* mzqc = findEntry(root, end, "mzQC");
+        const uint8_t* runs = findEntry(mzqc ? mzqc : root, end, "runQualities");
+        if (runs) runOffsets = elementOffsets(runs, end, begin);
+    });
+}
+
+size_t MappedMzQC::runCount() const {
+    index();
+    return runOffsets.size();
+}
+
+MappedRun MappedMzQC::run(size_t index) const {
+    this->index();
+    if (index >= runOffsets.size()) {
+        throw std::runtime_error("Run index " + std::to_string(index) + " out of range");
+    }
+    MappedRun run;
+    run.base = begin;
+    run.end = end;
+    forEachEntry(begin + runOffsets[index], end, [&](std::string_view key, const uint8_t* value) {
+        if (key == "label") {
+            if (auto text = readText(value, end)) run.labelText = *text;
+        } else if (key == "metrics") {
+            run.metricOffsets = elementOffsets(value, end, begin);
+        }
+    });
+    return run;
+}
+
+std::optional<MappedRun> MappedMzQC::findRun(std::string_view label) const {
+    for (size_t i = 0; i < runCount(); ++i) {
+        const uint8_t* value = findEntry(begin + runOffsets[i], end, "label");
+        if (value && readText(value, end) == label) return run(i);
+    }
+    return std::nullopt;
+}
+
+} // namespace mzqc
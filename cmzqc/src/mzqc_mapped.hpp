@@ -0,0 +1,144 @@
+#pragma once
+
+#include "mzqc.hpp"
+#include "mzqc_mmap.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mzqc {
+
+// Little-endian numeric array inside a mapped binary mzQC file. toBinary
+// aligns typed arrays, so data() normally points straight into the mapping;
+// element access works either way. On big-endian hosts elements are byte
+// swapped, as fromBinary does, and data() is null.
+template <typename T>
+class NumericView {
+public:
+    NumericView() = default;
+    NumericView(const uint8_t* bytes, size_t count) : bytes(bytes), count(count) {}
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    T operator[](size_t i) const {
+        T v;
+        std::memcpy(&v, bytes + i * sizeof(T), sizeof(T));
+        return swapped(v);
+    }
+    // Null if the payload is not aligned for T or not in host byte order
+    const T* data() const {
+        if (bigEndian) return nullptr;
+        return reinterpret_cast<uintptr_t>(bytes) % alignof(T) == 0 ? reinterpret_cast<const T*>(bytes) : nullptr;
+    }
+    std::vector<T> toVector() const {
+        std::vector<T> out(count);
+        if (count) std::memcpy(out.data(), bytes, count * sizeof(T));
+        if (bigEndian) {
+            for (T& v : out) v = swapped(v);
+        }
+        return out;
+    }
+
+private:
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    static constexpr bool bigEndian = true;
+#else
+    static constexpr bool bigEndian = false;
+#endif
+
+    static T swapped(T v) {
+        if (!bigEndian) return v;
+        uint8_t raw[sizeof(T)];
+        std::memcpy(raw, &v, sizeof(T));
+        std::reverse(raw, raw + sizeof(T));
+        std::memcpy(&v, raw, sizeof(T));
+        return v;
+    }
+
+    const uint8_t* bytes = nullptr;
+    size_t count = 0;
+};
+
+class MappedMzQC;
+
+// A metric of a mapped file. Strings are views into the mapping; the value
+// is only decoded when value() is called.
+class MappedMetric {
+public:
+    std::string_view accession() const { return accessionText; }
+    std::string_view name() const { return nameText; }
+    std::string_view description() const { return descriptionText; }
+    std::string_view unit() const { return unitText; }
+
+    bool hasValue() const { return valueBegin != valueEnd; }
+    // Empty views unless the value is a typed array of that type
+    NumericView<double> doubles() const;
+    NumericView<int64_t> integers() const;
+    // Decodes the value, e.g. for tables or json values
+    MetricValue value() const;
+
+private:
+    friend class MappedMzQC;
+    friend class MappedRun;
+
+    const uint8_t* valueBegin = nullptr;
+    const uint8_t* valueEnd = nullptr;
+    std::string_view accessionText;
+    std::string_view nameText;
+    std::string_view descriptionText;
+    std::string_view unitText;
+};
+
+class MappedRun {
+public:
+    std::string_view label() const { return labelText; }
+    size_t metricCount() const { return metricOffsets.size(); }
+    MappedMetric metric(size_t index) const;
+    // First metric with this accession
+    std::optional<MappedMetric> find(std::string_view accession) const;
+
+private:
+    friend class MappedMzQC;
+
+    const uint8_t* base = nullptr;
+    const uint8_t* end = nullptr;
+    std::string_view labelText;
+    std::vector<size_t> metricOffsets;
+};
+
+// Read-only view of a file written by MzQCFile::toBinary in CBOR. Opening
+// only maps the file and checks its CBOR magic; the offsets of the runs are
+// found by skipping over items, without reading array payloads, the first
+// time a run is requested. Safe to share between threads.
+class MappedMzQC {
+public:
+    // Throws std::runtime_error if the file cannot be mapped or is not CBOR
+    explicit MappedMzQC(const std::string& filepath);
+
+    MappedMzQC(const MappedMzQC&) = delete;
+    MappedMzQC& operator=(const MappedMzQC&) = delete;
+
+    size_t size() const { return file.size(); }
+    size_t runCount() const;
+    // Throws std::runtime_error on a malformed file or out-of-range index
+    MappedRun run(size_t index) const;
+    // First run with this label
+    std::optional<MappedRun> findRun(std::string_view label) const;
+
+private:
+    void index() const;
+
+    MappedFile file;
+    const uint8_t* begin = nullptr;
+    const uint8_t* end = nullptr;
+    mutable std::once_flag indexed;
+    mutable std::vector<size_t> runOffsets;
+};
+
+} // namespace mzqc
@@ -0,0 +1,269 @@
+#include "mzqc_merge.hpp"
+#include "mzqc_layout.hpp"
+#include "mzqc_mmap.hpp"
+#include "mzqc_parallel.hpp"
+#include "mzqc_stream.hpp"
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+namespace mzqc {
+
+namespace {
+
+struct InputHeader {
+    MzQCFile header;
+    size_t sets = 0;
+    // Byte ranges of the sets when the pre-scan recognised the layout;
+    // otherwise the sets are read again with MzQCReader
+    bool layoutKnown = false;
+    std::vector<MzQCLayout::Span> setSpans;
+    // cvRef values of this input that the merged file names differently
+    std::unordered_map<std::string, std::string> cvIds;
+};
+
+// Key for deduplication by (name, version)
+std::string nameVersion(const std::string& name, const std::string& version) {
+    std::string key = name;
+    key += '\0';
+    key += version;
+    return key;
+}
+
+// Header and controlledVocabularies of a file. When the pre-scan recognises
+// the layout only the text around the run and set arrays is parsed.
+void readHeader(const std::string& filepath, InputHeader& input) {
+    MappedFile mapped;
+    if (!mapped.open(filepath)) {
+        throw std::runtime_error("Could not open file: " + filepath);
+    }
+    MzQCLayout layout;
+    if (detectCompression(mapped.data(), mapped.size()) == Compression::None && scanLayout(mapped.view(), layout)) {
+        std::string skeleton = layout.skeleton(mapped.view());
+        MzQCSaxHandler handler(input.header);
+        nlohmann::json::sax_parse(skeleton.data(), skeleton.data() + skeleton.size(), &handler);
+        input.sets = layout.sets.size();
+        input.setSpans = std::move(layout.sets);
+        input.layoutKnown = true;
+        return;
+    }
+
+    class HeaderVisitor : public MzQCVisitor {
+    public:
+        explicit HeaderVisitor(InputHeader& input) : input(input) {}
+        bool visitSet(const std::shared_ptr<SetQuality>& /*set*/) override {
+            ++input.sets;
+            return true;
+        }
+        void visitHeader(const MzQCFile& file) override { input.header = file; }
+        InputHeader& input;
+    };
+    HeaderVisitor visitor(input);
+    MzQCReader().readFile(filepath, visitor);
+}
+
+// Merged controlledVocabularies, deduplicated by (name, version) with the
+// first occurrence winning. An input naming a known CV by another id, or
+// reusing the id of a different CV, gets its cvRef values mapped to the
+// merged id.
+void mergeVocabularies(std::vector<InputHeader>& inputs, MzQCFile& merged) {
+    std::unordered_map<std::string, std::string> idByKey;
+    std::unordered_set<std::string> ids;
+    for (auto& input : inputs) {
+        for (const auto& cv : input.header.controlledVocabularies) {
+            auto [known, added] = idByKey.emplace(nameVersion(cv->name, cv->version), cv->id);
+            if (added) {
+                std::shared_ptr<ControlledVocabulary> entry = cv;
+                if (!cv->id.empty() && !ids.insert(cv->id).second) {
+                    // Same id as a different CV: give this one a fresh id
+                    size_t n = 2;
+                    std::string id = cv->id + "_2";
+                    while (!ids.insert(id).second) id = cv->id + "_" + std::to_string(++n);
+                    entry = std::make_shared<ControlledVocabulary>(*cv);
+                    entry->id = id;
+                    known->second = id;
+                }
+                merged.controlledVocabularies.push_back(std::move(entry));
+            }
+            if (!cv->id.empty() && !known->second.empty() && known->second != cv->id) input.cvIds[cv->id] = known->second;
+        }
+    }
+}
+
+void remapCvRef(CvParameter& parameter, const std::unordered_map<std::string, std::string>& cvIds) {
+    if (parameter.cvRef.empty()) return;
+    auto it = cvIds.find(parameter.cvRef.str());
+    if (it != cvIds.end()) parameter.cvRef = it->second;
+}
+
+// Writes the runs, or the sets, handed out by MzQCReader. Metrics are
+// collected here rather than kept by the reader, so the pass that skips
+// runs or sets does not hold on to their metrics.
+class MergeVisitor : public MzQCVisitor {
+public:
+    MergeVisitor(MzQCStreamWriter& writer, MzQCMergeStats& stats, std::unordered_set<std::string>& software,
+                 bool writeSets)
+        : writer(writer), stats(stats), software(software), writeSets(writeSets) {}
+
+    void setInput(const InputHeader& input) { cvIds = &input.cvIds; }
+
+    bool visitRunMetric(const RunQuality& /*run*/, const std::shared_ptr<QualityMetric>& metric) override {
+        if (!writeSets) metrics.push_back(metric);
+        return true;
+    }
+
+    bool visitSetMetric(const SetQuality& /*set*/, const std::shared_ptr<QualityMetric>& metric) override {
+        if (writeSets) metrics.push_back(metric);
+        return true;
+    }
+
+    bool visitRun(const std::shared_ptr<RunQuality>& run) override {
+        if (writeSets) return true;
+        std::unordered_set<std::string> seen;
+        auto& list = run->analysisSoftware;
+        size_t kept = 0;
+        for (auto& entry : list) {
+            std::string key = nameVersion(entry->name, entry->version);
+            if (!seen.insert(key).second) {
+                ++stats.duplicateSoftware;
+                continue;
+            }
+            software.insert(std::move(key));
+            list[kept++] = std::move(entry);
+        }
+        list.resize(kept);
+        if (!cvIds->empty()) {
+            for (auto& input : run->inputFiles) {
+                if (input->fileFormat) remapCvRef(*input->fileFormat, *cvIds);
+                for (auto& property : input->fileProperties) remapCvRef(*property, *cvIds);
+            }
+        }
+        run->metrics = std::move(metrics);
+        metrics.clear();
+        writer.writeRun(*run);
+        ++stats.runs;
+        return true;
+    }
+
+    bool visitSet(const std::shared_ptr<SetQuality>& set) override {
+        if (!writeSets) return true;
+        set->metrics = std::move(metrics);
+        metrics.clear();
+        writer.writeSet(*set);
+        ++stats.sets;
+        return true;
+    }
+
+private:
+    MzQCStreamWriter& writer;
+    MzQCMergeStats& stats;
+    std::unordered_set<std::string>& software;
+    bool writeSets;
+    const std::unordered_map<std::string, std::string>* cvIds = nullptr;
+    std::vector<std::shared_ptr<QualityMetric>> metrics;
+};
+
+// Parses only the set elements of an input whose layout is known
+void writeSets(const std::string& filepath, const InputHeader& input, MzQCStreamWriter& writer,
+               MzQCMergeStats& stats) {
+    MappedFile mapped;
+    if (!mapped.open(filepath)) {
+        throw std::runtime_error("Could not open file: " + filepath);
+    }
+    MzQCFile part;
+    MzQCSaxHandler handler(part, MzQCSaxHandler::Fragment::Sets);
+    for (const auto& span : input.setSpans) {
+        if (span.end > mapped.size()) {
+            throw std::runtime_error(filepath + " changed during the merge");
+        }
+        TextNumberInput text(mapped.data() + span.begin, mapped.data() + span.end);
+        handler.readNumbersFrom(&text);
+        nlohmann::json::sax_parse(text.begin(), text.end(), &handler);
+        for (const auto& set : part.setQualities) {
+            writer.writeSet(*set);
+            ++stats.sets;
+        }
+        part.setQualities.clear();
+    }
+}
+
+} // namespace
+
+// MzQCMerger implementation
+MzQCMerger::MzQCMerger(const MzQCMergeOptions& options) : options(options) {}
+
+MzQCMergeStats MzQCMerger::merge(const std::vector<std::string>& inputs, const std::string& outputPath) const {
+    return mergeInto(inputs, outputPath);
+}
+
+MzQCMergeStats MzQCMerger::merge(const std::vector<std::string>& inputs, std::ostream& out) const {
+    return mergeInto(inputs, out);
+}
+
+template <typename Output>
+MzQCMergeStats MzQCMerger::mergeInto(const std::vector<std::string>& inputs, Output&& output) const {
+    if (inputs.empty()) {
+        throw std::runtime_error("No input files to merge");
+    }
+
+    // Pass 1: headers, which are small and independent, in parallel
+    std::vector<InputHeader> headers(inputs.size());
+    std::vector<std::string> failures(inputs.size());
+    auto read = [&](size_t i) {
+        try {
+            readHeader(inputs[i], headers[i]);
+        } catch (const std::exception& e) {
+            failures[i] = inputs[i] + ": " + e.what();
+        }
+    };
+    if (options.threads == 0) {
+        ThreadPool::shared().parallelFor(inputs.size(), read);
+    } else {
+        ThreadPool pool(options.threads);
+        pool.parallelFor(inputs.size(), read);
+    }
+    for (const auto& failure : failures) {
+        if (!failure.empty()) throw std::runtime_error(failure);
+    }
+
+    MzQCMergeStats stats;
+    stats.files = inputs.size();
+    MzQCFile merged;
+    const MzQCFile& first = headers.front().header;
+    merged.version = first.version;
+    merged.contactName = first.contactName;
+    merged.contactAddress = first.contactAddress;
+    merged.description = first.description;
+    mergeVocabularies(headers, merged);
+    stats.controlledVocabularies = merged.controlledVocabularies.size();
+
+    // Pass 2 streams the runs and validates each input. The sets follow,
+    // since the writer needs every run before the first set: parsed from
+    // their byte ranges where the pre-scan found them, else read again.
+    MzQCStreamWriter writer(output, merged);
+    MzQCReaderOptions readerOptions;
+    readerOptions.schemaPath = options.schemaPath;
+    MzQCReader reader(readerOptions);
+    std::unordered_set<std::string> software;
+    MergeVisitor runs(writer, stats, software, false);
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        runs.setInput(headers[i]);
+        reader.readFile(inputs[i], runs);
+    }
+    MergeVisitor sets(writer, stats, software, true);
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        if (headers[i].sets == 0) continue;
+        if (headers[i].layoutKnown) {
+            writeSets(inputs[i], headers[i], writer, stats);
+        } else {
+            sets.setInput(headers[i]);
+            MzQCReader().readFile(inputs[i], sets);
+        }
+    }
+    writer.close();
+    stats.software = software.size();
+    return stats;
+}
+
+} // namespace mzqc
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "mzqc.hpp"
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace mzqc {
+
+struct MzQCMergeOptions {
+    // Validate every input against this schema while it is read, empty means no validation
+    std::string schemaPath;
+    // Worker threads for reading the input headers, 0 uses ThreadPool::shared()
+    unsigned threads = 0;
+};
+
+struct MzQCMergeStats {
+    size_t files = 0;
+    size_t runs = 0;
+    size_t sets = 0;
+    // Distinct entries after deduplication by (name, version)
+    size_t controlledVocabularies = 0;
+    size_t software = 0;
+    // analysisSoftware entries dropped because the run already listed them
+    size_t duplicateSoftware = 0;
+};
+
+// Concatenates the runs and sets of several mzQC files into one document
+// without holding more than one run in memory. The headers are read first,
+// found with a structural pre-scan, to build the merged
+// controlledVocabularies; then the runs are streamed into an
+// MzQCStreamWriter and, last, the sets, parsed from the byte ranges the
+// pre-scan found. Only inputs the pre-scan cannot handle, e.g. compressed
+// ones, are read a second time for their sets.
+// Header fields come from the first input and creationDate is the merge time.
+// Controlled vocabularies are deduplicated by (name, version), the first
+// occurrence wins; cvRef values of inputs that name a CV by another id are
+// rewritten to the merged id. The analysisSoftware entries of each run are
+// deduplicated the same way.
+class MzQCMerger {
+public:
+    explicit MzQCMerger(const MzQCMergeOptions& options = MzQCMergeOptions());
+
+    // Throws std::runtime_error if an input cannot be read; a file being
+    // written stays a complete document holding the runs merged so far
+    MzQCMergeStats merge(const std::vector<std::string>& inputs, const std::string& outputPath) const;
+    MzQCMergeStats merge(const std::vector<std::string>& inputs, std::ostream& out) const;
+
+private:
+    template <typename Output>
+    MzQCMergeStats mergeInto(const std::vector<std::string>& inputs, Output&& output) const;
+
+    MzQCMergeOptions options;
+};
+
+} // namespace mzqc
@@ -0,0 +1,316 @@
+#include "mzqc_metrics.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+namespace mzqc {
+
+namespace {
+
+constexpr double nan = std::numeric_limits<double>::quiet_NaN();
+
+// Fallback units where no CvTermCache is given or the term has none
+const char* const countUnit = "UO:0000189";
+const char* const ratioUnit = "UO:0000190";
+const char* const ppmUnit = "UO:0000169";
+const char* const secondUnit = "UO:0000010";
+const char* const mzUnit = "MS:1000040";
+
+bool isDecoyLabel(const std::string& label) {
+    auto equals = [&](const char* word) {
+        return std::equal(label.begin(), label.end(), word, word + std::char_traits<char>::length(word),
+                          [](char a, char b) { return std::tolower(static_cast<unsigned char>(a)) == b; });
+    };
+    return equals("decoy") || equals("false") || label == "0";
+}
+
+// Columns of an identification table, numeric ones as doubles
+struct TableView {
+    const double* rt = nullptr;
+    const double* mz = nullptr;
+    const double* ppm = nullptr;
+    const std::vector<bool>* targetFlags = nullptr;
+    const std::vector<std::string>* targetLabels = nullptr;
+    size_t rows = 0;
+    // Integer columns converted to doubles
+    std::vector<double> converted[3];
+
+    TableView(const MetricTable& table, const IdentificationColumns& names) : rows(table.rowCount()) {
+        rt = numericColumn(table, names.retentionTime, converted[0]);
+        mz = numericColumn(table, names.mz, converted[1]);
+        ppm = numericColumn(table, names.deltaPPM, converted[2]);
+        targetFlags = table.columnAs<bool>(names.target);
+        targetLabels = table.columnAs<std::string>(names.target);
+    }
+    TableView(const TableView&) = delete;
+    TableView& operator=(const TableView&) = delete;
+
+    bool hasTarget() const { return targetFlags || targetLabels; }
+
+    static const double* numericColumn(const MetricTable& table, const std::string& name,
+                                       std::vector<double>& converted) {
+        if (const auto* doubles = table.columnAs<double>(name)) return doubles->data();
+        if (const auto* integers = table.columnAs<int64_t>(name)) {
+            converted.assign(integers->begin(), integers->end());
+            return converted.data();
+        }
+        return nullptr;
+    }
+};
+
+// Calls visit(i) for every target row, all rows without a target column; returns the number of targets
+template <typename Visit>
+size_t forEachTarget(const TableView& view, Visit visit) {
+    size_t targets = 0;
+    auto scan = [&](auto isTarget) {
+        for (size_t i = 0; i < view.rows; ++i) {
+            if (!isTarget(i)) continue;
+            ++targets;
+            visit(i);
+        }
+    };
+    if (view.targetFlags) {
+        scan([&](size_t i) { return static_cast<bool>((*view.targetFlags)[i]); });
+    } else if (view.targetLabels) {
+        scan([&](size_t i) { return !isDecoyLabel((*view.targetLabels)[i]); });
+    } else {
+        scan([](size_t) { return true; });
+    }
+    return targets;
+}
+
+void setCounts(IdentificationSummary& summary, size_t psms, size_t targets) {
+    summary.psms = psms;
+    summary.targets = targets;
+    summary.decoys = psms - targets;
+    summary.targetDecoyRatio = summary.decoys == 0 ? std::numeric_limits<double>::infinity()
+                                                   : static_cast<double>(targets) / summary.decoys;
+}
+
+// Quantiles of values at sorted levels, by successive selection on the shrinking tail
+std::vector<double> quantiles(std::vector<double>& values, const std::vector<double>& levels) {
+    std::vector<size_t> order(levels.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return levels[a] < levels[b]; });
+
+    std::vector<double> out(levels.size(), nan);
+    if (values.empty()) return out;
+    const size_t n = values.size();
+    size_t selected = 0;
+    for (size_t k : order) {
+        double level = std::clamp(levels[k], 0.0, 1.0);
+        double position = level * static_cast<double>(n - 1);
+        size_t lower = static_cast<size_t>(position);
+        std::nth_element(values.begin() + selected, values.begin() + lower, values.end());
+        selected = lower;
+        double value = values[lower];
+        double fraction = position - static_cast<double>(lower);
+        if (fraction > 0 && lower + 1 < n) {
+            double upper = *std::min_element(values.begin() + lower + 1, values.end());
+            value += fraction * (upper - value);
+        }
+        out[k] = value;
+    }
+    return out;
+}
+
+// Text between the quotes of an OBO def: value
+std::string definitionText(const std::string& definition) {
+    if (definition.size() < 2 || definition.front() != '"') return definition;
+    size_t end = definition.rfind('"');
+    return end == 0 ? definition : definition.substr(1, end - 1);
+}
+
+} // namespace
+
+// IdentificationSketch implementation
+IdentificationSketch::IdentificationSketch(double compression) : rt(compression), mzValues(compression), ppm(compression) {}
+
+void IdentificationSketch::add(const MetricTable& table, const IdentificationColumns& columns) {
+    TableView view(table, columns);
+    hasTarget = hasTarget || view.hasTarget();
+    hasRetentionTime = hasRetentionTime || view.rt;
+    hasMz = hasMz || view.mz;
+    hasDeltaPPM = hasDeltaPPM || view.ppm;
+    psmCount += view.rows;
+    targetCount += forEachTarget(view, [&](size_t i) {
+        if (view.rt) rt.add(view.rt[i]);
+        if (view.mz) mzValues.add(view.mz[i]);
+        if (view.ppm) ppm.add(view.ppm[i]);
+    });
+}
+
+void IdentificationSketch::merge(const IdentificationSketch& other) {
+    hasTarget = hasTarget || other.hasTarget;
+    hasRetentionTime = hasRetentionTime || other.hasRetentionTime;
+    hasMz = hasMz || other.hasMz;
+    hasDeltaPPM = hasDeltaPPM || other.hasDeltaPPM;
+    psmCount += other.psmCount;
+    targetCount += other.targetCount;
+    rt.merge(other.rt);
+    mzValues.merge(other.mzValues);
+    ppm.merge(other.ppm);
+}
+
+IdentificationSummary IdentificationSketch::summary(const std::vector<double>& retentionTimeQuantiles) const {
+    IdentificationSummary summary;
+    summary.hasTarget = hasTarget;
+    summary.hasRetentionTime = hasRetentionTime;
+    summary.hasMz = hasMz;
+    summary.hasDeltaPPM = hasDeltaPPM;
+    setCounts(summary, psmCount, targetCount);
+
+    summary.deltaPPMQuartiles = ppm.quantiles({0.25, 0.5, 0.75});
+    summary.deltaPPMMedian = summary.deltaPPMQuartiles[1];
+    summary.deltaPPMIqr = summary.deltaPPMQuartiles[2] - summary.deltaPPMQuartiles[0];
+    summary.retentionTimeQuantiles = rt.quantiles(retentionTimeQuantiles);
+    summary.retentionTimeIqr = rt.quantile(0.75) - rt.quantile(0.25);
+    summary.mzMin = mzValues.min();
+    summary.mzMax = mzValues.max();
+    summary.mzMedian = mzValues.quantile(0.5);
+    return summary;
+}
+
+nlohmann::json IdentificationSketch::toJson() const {
+    nlohmann::json j = {{"psms", psmCount}, {"targets", targetCount}, {"hasTarget", hasTarget}};
+    if (hasRetentionTime) j["retentionTime"] = rt.toJson();
+    if (hasMz) j["mz"] = mzValues.toJson();
+    if (hasDeltaPPM) j["deltaPPM"] = ppm.toJson();
+    return j;
+}
+
+IdentificationSketch IdentificationSketch::fromJson(const nlohmann::json& j) {
+    if (!j.is_object() || !j.contains("psms") || !j.contains("targets")) {
+        throw std::runtime_error("Not an identification sketch");
+    }
+    IdentificationSketch sketch;
+    sketch.psmCount = j.at("psms").get<size_t>();
+    sketch.targetCount = j.at("targets").get<size_t>();
+    if (sketch.targetCount > sketch.psmCount) {
+        throw std::runtime_error("Identification sketch has more targets than PSMs");
+    }
+    sketch.hasTarget = j.value("hasTarget", false);
+    auto read = [&](const char* key, QuantileSketch& target, bool& present) {
+        auto it = j.find(key);
+        if (it == j.end()) return;
+        target = QuantileSketch::fromJson(*it);
+        present = true;
+    };
+    read("retentionTime", sketch.rt, sketch.hasRetentionTime);
+    read("mz", sketch.mzValues, sketch.hasMz);
+    read("deltaPPM", sketch.ppm, sketch.hasDeltaPPM);
+    return sketch;
+}
+
+// IdentificationMetrics implementation
+IdentificationMetrics::IdentificationMetrics(const IdentificationMetricOptions& options) : options(options) {}
+
+IdentificationSummary IdentificationMetrics::summarize(const MetricTable& table) const {
+    if (options.approximate) {
+        IdentificationSketch sketch(options.sketchCompression);
+        sketch.add(table, options.columns);
+        return summarize(sketch);
+    }
+
+    TableView view(table, options.columns);
+    IdentificationSummary summary;
+    summary.hasRetentionTime = view.rt != nullptr;
+    summary.hasMz = view.mz != nullptr;
+    summary.hasDeltaPPM = view.ppm != nullptr;
+    summary.hasTarget = view.hasTarget();
+
+    // One pass gathers the values of every distribution and the m/z extremes
+    std::vector<double> rtValues;
+    std::vector<double> mzValues;
+    std::vector<double> ppmValues;
+    if (view.rt) rtValues.reserve(view.rows);
+    if (view.mz) mzValues.reserve(view.rows);
+    if (view.ppm) ppmValues.reserve(view.rows);
+    double mzMin = std::numeric_limits<double>::infinity();
+    double mzMax = -std::numeric_limits<double>::infinity();
+    size_t targets = forEachTarget(view, [&](size_t i) {
+        if (view.rt && !std::isnan(view.rt[i])) rtValues.push_back(view.rt[i]);
+        if (view.ppm && !std::isnan(view.ppm[i])) ppmValues.push_back(view.ppm[i]);
+        if (view.mz && !std::isnan(view.mz[i])) {
+            mzValues.push_back(view.mz[i]);
+            mzMin = std::min(mzMin, view.mz[i]);
+            mzMax = std::max(mzMax, view.mz[i]);
+        }
+    });
+    setCounts(summary, view.rows, targets);
+
+    summary.deltaPPMQuartiles = quantiles(ppmValues, {0.25, 0.5, 0.75});
+    summary.deltaPPMMedian = summary.deltaPPMQuartiles[1];
+    summary.deltaPPMIqr = summary.deltaPPMQuartiles[2] - summary.deltaPPMQuartiles[0];
+
+    std::vector<double> levels = options.retentionTimeQuantiles;
+    levels.push_back(0.25);
+    levels.push_back(0.75);
+    std::vector<double> rtQuantiles = quantiles(rtValues, levels);
+    summary.retentionTimeIqr = rtQuantiles[levels.size() - 1] - rtQuantiles[levels.size() - 2];
+    rtQuantiles.resize(options.retentionTimeQuantiles.size());
+    summary.retentionTimeQuantiles = std::move(rtQuantiles);
+
+    summary.mzMin = mzValues.empty() ? nan : mzMin;
+    summary.mzMax = mzValues.empty() ? nan : mzMax;
+    summary.mzMedian = quantiles(mzValues, {0.5})[0];
+    return summary;
+}
+
+IdentificationSummary IdentificationMetrics::summarize(const IdentificationSketch& sketch) const {
+    return sketch.summary(options.retentionTimeQuantiles);
+}
+
+std::shared_ptr<QualityMetric> IdentificationMetrics::makeMetric(const std::string& accession, const char* name,
+                                                                 MetricValue value, const char* unit) const {
+    const CvTermDetails* term = options.terms ? options.terms->lookup(accession) : nullptr;
+    if (!term) return std::make_shared<QualityMetric>(accession, name, "", std::move(value), unit);
+    return std::make_shared<QualityMetric>(accession, term->name, definitionText(term->definition),
+                                           std::move(value), term->unit.value_or(unit));
+}
+
+std::vector<std::shared_ptr<QualityMetric>> IdentificationMetrics::metrics(const MetricTable& table) const {
+    return metrics(summarize(table));
+}
+
+std::vector<std::shared_ptr<QualityMetric>> IdentificationMetrics::metrics(const IdentificationSummary& summary) const {
+    const IdentificationAccessions& accessions = options.accessions;
+    std::vector<std::shared_ptr<QualityMetric>> out;
+    auto add = [&](bool available, const std::string& accession, const char* name, MetricValue value,
+                   const char* unit) {
+        if (available && !accession.empty()) out.push_back(makeMetric(accession, name, std::move(value), unit));
+    };
+
+    add(true, accessions.psmCount, "Total number of PSM", static_cast<int64_t>(summary.psms), countUnit);
+    add(summary.hasTarget, accessions.targetDecoyRatio, "target/decoy ratio", summary.targetDecoyRatio, ratioUnit);
+    add(summary.hasDeltaPPM, accessions.deltaPPMQuartiles, "Precursor errors (ppm) Q1, Q2, Q3",
+        summary.deltaPPMQuartiles, ppmUnit);
+    add(summary.hasDeltaPPM, accessions.deltaPPMMedian, "Precursor errors (ppm) median", summary.deltaPPMMedian,
+        ppmUnit);
+    add(summary.hasDeltaPPM, accessions.deltaPPMIqr, "Precursor errors (ppm) IQR", summary.deltaPPMIqr, ppmUnit);
+    add(summary.hasRetentionTime, accessions.retentionTimeIqr, "Interquartile RT period for peptide identifications",
+        summary.retentionTimeIqr, secondUnit);
+    add(summary.hasRetentionTime, accessions.retentionTimeQuantiles, "identification RT quantiles",
+        summary.retentionTimeQuantiles, secondUnit);
+    add(summary.hasMz, accessions.mzMedian, "Precursor median m/z for IDs", summary.mzMedian, mzUnit);
+    add(summary.hasMz, accessions.mzRange, "identified precursor m/z range",
+        std::vector<double>{summary.mzMin, summary.mzMax}, mzUnit);
+    return out;
+}
+
+void IdentificationMetrics::addTo(RunQuality& run, const MetricTable& table) const {
+    for (auto& metric : metrics(table)) run.metrics.push_back(std::move(metric));
+}
+
+void IdentificationMetrics::addTo(RunQuality& run, const IdentificationSketch& sketch) const {
+    for (auto& metric : metrics(summarize(sketch))) run.metrics.push_back(std::move(metric));
+}
+
+void IdentificationMetrics::addTo(SetQuality& set, const IdentificationSketch& sketch) const {
+    for (auto& metric : metrics(summarize(sketch))) set.metrics.push_back(std::move(metric));
+}
+
+} // namespace mzqc
@@ -0,0 +1,143 @@
+#pragma once
+
+#include "mzqc.hpp"
+#include "mzqc_sketch.hpp"
+#include "mzqc_value.hpp"
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mzqc {
+
+// Table columns read by IdentificationMetrics. A missing column only drops
+// the metrics that depend on it. The target column may hold booleans or
+// strings ("decoy", "false" and "0" mark decoys).
+struct IdentificationColumns {
+    std::string retentionTime = "RT";
+    std::string mz = "MZ";
+    std::string deltaPPM = "deltaPPM";
+    std::string target = "target";
+};
+
+// Accession of every emitted metric, empty skips the metric. The defaults
+// are the PSI QC terms; the QC CV has no term for the target/decoy ratio,
+// for identification RT quantiles or for the identified m/z range.
+struct IdentificationAccessions {
+    std::string psmCount = "MS:4000186";           // Total number of PSM
+    std::string deltaPPMQuartiles = "MS:4000195";  // Precursor errors (ppm) Q1, Q2, Q3
+    std::string deltaPPMMedian = "MS:4000201";     // Precursor errors (ppm) median
+    std::string deltaPPMIqr = "MS:4000202";        // Precursor errors (ppm) IQR
+    std::string retentionTimeIqr = "MS:4000072";   // Interquartile RT period for peptide identifications
+    std::string mzMedian = "MS:4000065";           // Precursor median m/z for IDs
+    std::string targetDecoyRatio;
+    std::string retentionTimeQuantiles;
+    std::string mzRange;
+};
+
+struct IdentificationMetricOptions {
+    IdentificationColumns columns;
+    IdentificationAccessions accessions;
+    // Quantile levels in [0, 1] reported for the retention times
+    std::vector<double> retentionTimeQuantiles = {0.25, 0.5, 0.75};
+    // Names, descriptions and units of the emitted terms, built-in names if null
+    const CvTermCache* terms = nullptr;
+    // Estimate the distributions with QuantileSketch instead of gathering the
+    // values, for tables too large to copy a column of
+    bool approximate = false;
+    double sketchCompression = 100;
+};
+
+// Statistics of one identification table. Distributions are taken over the
+// target PSMs and skip NaN values; statistics of an empty distribution are
+// NaN. Quantiles interpolate linearly between order statistics, as numpy does.
+struct IdentificationSummary {
+    // Which of the configured columns the table holds with a usable type
+    bool hasTarget = false;
+    bool hasDeltaPPM = false;
+    bool hasRetentionTime = false;
+    bool hasMz = false;
+
+    size_t psms = 0;
+    size_t targets = 0;
+    size_t decoys = 0;
+    // targets / decoys, infinite without decoys
+    double targetDecoyRatio = 0;
+
+    // Q1, median, Q3
+    std::vector<double> deltaPPMQuartiles;
+    double deltaPPMMedian = 0;
+    double deltaPPMIqr = 0;
+
+    // One per IdentificationMetricOptions::retentionTimeQuantiles
+    std::vector<double> retentionTimeQuantiles;
+    double retentionTimeIqr = 0;
+
+    double mzMin = 0;
+    double mzMax = 0;
+    double mzMedian = 0;
+};
+
+// Constant-memory accumulator of the IdentificationSummary statistics.
+// Tables can be added piece by piece, e.g. per chunk of a huge run, and the
+// sketches of several runs merged for set-level metrics without the raw data.
+// Quantiles are t-digest estimates; counts and the m/z extremes are exact.
+class IdentificationSketch {
+public:
+    explicit IdentificationSketch(double compression = 100);
+
+    void add(const MetricTable& table, const IdentificationColumns& columns = IdentificationColumns());
+    void merge(const IdentificationSketch& other);
+
+    IdentificationSummary summary(const std::vector<double>& retentionTimeQuantiles = {0.25, 0.5, 0.75}) const;
+
+    size_t psms() const { return psmCount; }
+    size_t targets() const { return targetCount; }
+    const QuantileSketch& retentionTime() const { return rt; }
+    const QuantileSketch& mz() const { return mzValues; }
+    const QuantileSketch& deltaPPM() const { return ppm; }
+
+    // For storing a run's sketch alongside its metrics; fromJson throws
+    // std::runtime_error on anything else
+    nlohmann::json toJson() const;
+    static IdentificationSketch fromJson(const nlohmann::json& j);
+
+private:
+    bool hasTarget = false;
+    bool hasRetentionTime = false;
+    bool hasMz = false;
+    bool hasDeltaPPM = false;
+    size_t psmCount = 0;
+    size_t targetCount = 0;
+    QuantileSketch rt;
+    QuantileSketch mzValues;
+    QuantileSketch ppm;
+};
+
+// Standard ID-based QC metrics of an identification table such as the one
+// read by CsvTableReader with identificationColumns(). All statistics come
+// from one pass over the columns followed by selection (nth_element) on the
+// gathered values; no json is built until the metrics are serialized.
+class IdentificationMetrics {
+public:
+    explicit IdentificationMetrics(const IdentificationMetricOptions& options = IdentificationMetricOptions());
+
+    // Exact unless options.approximate is set
+    IdentificationSummary summarize(const MetricTable& table) const;
+    IdentificationSummary summarize(const IdentificationSketch& sketch) const;
+    // One metric per non-empty accession whose inputs are present
+    std::vector<std::shared_ptr<QualityMetric>> metrics(const IdentificationSummary& summary) const;
+    std::vector<std::shared_ptr<QualityMetric>> metrics(const MetricTable& table) const;
+    // Append the metrics to the run or set
+    void addTo(RunQuality& run, const MetricTable& table) const;
+    void addTo(RunQuality& run, const IdentificationSketch& sketch) const;
+    void addTo(SetQuality& set, const IdentificationSketch& sketch) const;
+
+private:
+    std::shared_ptr<QualityMetric> makeMetric(const std::string& accession, const char* name, MetricValue value,
+                                              const char* unit) const;
+
+    IdentificationMetricOptions options;
+};
+
+} // namespace mzqc
@@ -0,0 +1,63 @@
+#include "mzqc_mmap.hpp"
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace mzqc {
+
+// MappedFile implementation
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : address(std::exchange(other.address, nullptr)),
+      length(std::exchange(other.length, 0)),
+      opened(std::exchange(other.opened, false)) {}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        address = std::exchange(other.address, nullptr);
+        length = std::exchange(other.length, 0);
+        opened = std::exchange(other.opened, false);
+    }
+    return *this;
+}
+
+bool MappedFile::open(const std::string& filepath) {
+    close();
+    int fd = ::open(filepath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+        ::close(fd);
+        return false;
+    }
+    length = static_cast<size_t>(info.st_size);
+    if (length > 0) {
+        void* mapped = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            ::close(fd);
+            length = 0;
+            return false;
+        }
+        // Parsers walk the file front to back
+        ::madvise(mapped, length, MADV_SEQUENTIAL);
+        address = mapped;
+    }
+    // The mapping stays valid after the descriptor is closed
+    ::close(fd);
+    opened = true;
+    return true;
+}
+
+void MappedFile::close() {
+    if (address) {
+        ::munmap(address, length);
+    }
+    address = nullptr;
+    length = 0;
+    opened = false;
+}
+
+} // namespace mzqc
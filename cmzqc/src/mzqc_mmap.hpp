@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace mzqc {
+
+// Read-only memory mapping of a whole file. Empty files map to an empty view.
+class MappedFile {
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string& filepath) { open(filepath); }
+    ~MappedFile() { close(); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    // False if the file cannot be opened or mapped
+    bool open(const std::string& filepath);
+    void close();
+
+    bool isOpen() const { return opened; }
+    const char* data() const { return static_cast<const char*>(address); }
+    size_t size() const { return length; }
+    std::string_view view() const { return std::string_view(data(), length); }
+
+private:
+    void* address = nullptr;
+    size_t length = 0;
+    bool opened = false;
+};
+
+} // namespace mzqc
@@ -0,0 +1,174 @@
+#include "mzqc_numbers.hpp"
+#include <charconv>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+namespace mzqc {
+
+namespace {
+
+constexpr int endOfInput = -1;
+
+// Character access of the two inputs; peek returns endOfInput at the end
+struct StreamSource {
+    std::streambuf& buffer;
+
+    int peek() {
+        const auto c = buffer.sgetc();
+        return std::streambuf::traits_type::eq_int_type(c, std::streambuf::traits_type::eof())
+                   ? endOfInput
+                   : static_cast<unsigned char>(std::streambuf::traits_type::to_char_type(c));
+    }
+    void bump() { buffer.sbumpc(); }
+};
+
+struct TextSource {
+    const char*& position;
+    const char* last;
+
+    int peek() const { return position < last ? static_cast<unsigned char>(*position) : endOfInput; }
+    void bump() { ++position; }
+};
+
+bool isWhitespace(int c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+bool isNumberStart(int c) {
+    return c == '-' || (c >= '0' && c <= '9');
+}
+
+bool isNumberCharacter(int c) {
+    return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
+
+bool isDigit(const char* p, const char* end) {
+    return p < end && *p >= '0' && *p <= '9';
+}
+
+// JSON number grammar: -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+bool validNumber(const char* p, const char* end, bool& isFloat) {
+    isFloat = false;
+    if (p < end && *p == '-') ++p;
+    if (!isDigit(p, end)) return false;
+    if (*p == '0') {
+        ++p;
+    } else {
+        while (isDigit(p, end)) ++p;
+    }
+    if (p < end && *p == '.') {
+        ++p;
+        if (!isDigit(p, end)) return false;
+        while (isDigit(p, end)) ++p;
+        isFloat = true;
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        ++p;
+        if (p < end && (*p == '+' || *p == '-')) ++p;
+        if (!isDigit(p, end)) return false;
+        while (isDigit(p, end)) ++p;
+        isFloat = true;
+    }
+    return p == end;
+}
+
+[[noreturn]] void syntaxError(const std::string& what) {
+    throw std::runtime_error("Error parsing JSON from file: syntax error in number array: " + what);
+}
+
+template <typename Source>
+void skipWhitespace(Source& in) {
+    while (isWhitespace(in.peek())) in.bump();
+}
+
+template <typename Source>
+void readNumbers(Source& in, std::vector<double>& doubles, std::vector<int64_t>& integers, nlohmann::json& rest) {
+    enum class Kind { None, Double, Integer };
+    Kind kind = Kind::None;
+    // Numbers longer than the local buffer are valid but rare, they go
+    // through a string
+    char local[64];
+    std::string longToken;
+
+    skipWhitespace(in);
+    if (!isNumberStart(in.peek())) return;
+    for (;;) {
+        size_t size = 0;
+        longToken.clear();
+        for (int c = in.peek(); isNumberCharacter(c); c = in.peek()) {
+            if (size < sizeof(local)) {
+                local[size] = static_cast<char>(c);
+            } else {
+                if (longToken.empty()) longToken.assign(local, size);
+                longToken += static_cast<char>(c);
+            }
+            ++size;
+            in.bump();
+        }
+        const char* token = longToken.empty() ? local : longToken.data();
+        const char* tokenEnd = token + size;
+        bool isFloat;
+        if (!validNumber(token, tokenEnd, isFloat)) {
+            syntaxError("invalid number '" + std::string(token, tokenEnd) + "'");
+        }
+
+        // Same values as the lexer: doubles are correctly rounded by both
+        // from_chars and strtod, integers beyond int64_t become unsigned or
+        // double, which only nlohmann itself reproduces exactly
+        bool typed = false;
+        if (isFloat) {
+            double value;
+            if (std::from_chars(token, tokenEnd, value).ec == std::errc() && kind != Kind::Integer) {
+                doubles.push_back(value);
+                kind = Kind::Double;
+                typed = true;
+            }
+        } else {
+            int64_t value;
+            if (std::from_chars(token, tokenEnd, value).ec == std::errc() && kind != Kind::Double) {
+                integers.push_back(value);
+                kind = Kind::Integer;
+                typed = true;
+            }
+        }
+        if (!typed) {
+            try {
+                rest = nlohmann::json::parse(token, tokenEnd);
+            } catch (const nlohmann::json::exception& e) {
+                // Overflowing doubles, which the parser rejects as well
+                throw std::runtime_error("Error parsing JSON from file: " + std::string(e.what()));
+            }
+        }
+
+        skipWhitespace(in);
+        int c = in.peek();
+        if (c == ']') return;
+        if (c != ',') {
+            syntaxError(c == endOfInput ? std::string("unexpected end of input")
+                                        : "unexpected '" + std::string(1, static_cast<char>(c)) + "'");
+        }
+        in.bump();
+        skipWhitespace(in);
+        c = in.peek();
+        // The lexer would take the ']' for an empty array
+        if (c == ']') syntaxError("expected a value after ','");
+        if (!typed || !isNumberStart(c)) return;
+    }
+}
+
+} // namespace
+
+// StreamNumberInput implementation
+void StreamNumberInput::read(std::vector<double>& doubles, std::vector<int64_t>& integers, nlohmann::json& rest) {
+    StreamSource source{buffer};
+    readNumbers(source, doubles, integers, rest);
+}
+
+// TextNumberInput implementation
+void TextNumberInput::read(std::vector<double>& doubles, std::vector<int64_t>& integers, nlohmann::json& rest) {
+    TextSource source{position, last};
+    readNumbers(source, doubles, integers, rest);
+}
+
+} // namespace mzqc
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <streambuf>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+namespace mzqc {
+
+// NumberInput relies on the lexer not reading ahead of a '[', which has only
+// been verified for nlohmann_json 3.11.2. With any other version the handler
+// ignores readNumbersFrom and takes every number from the parser's events.
+#if NLOHMANN_JSON_VERSION_MAJOR == 3 && NLOHMANN_JSON_VERSION_MINOR == 11 && NLOHMANN_JSON_VERSION_PATCH == 2
+constexpr bool numberInputSupported = true;
+#else
+constexpr bool numberInputSupported = false;
+#endif
+
+// Direct access to the input of a running nlohmann::json::sax_parse, used by
+// MzQCSaxHandler to decode long metric value arrays with std::from_chars
+// instead of token by token through the JSON lexer. The handler reads from
+// here right after the lexer has consumed a '[', when the lexer holds no
+// lookahead; what is consumed here is never seen by the lexer. Positions in
+// later parse error messages do not count the consumed text.
+class NumberInput {
+public:
+    virtual ~NumberInput() = default;
+
+    // Reads the leading numbers of the array into doubles or integers, never
+    // both, and consumes them with their commas. Stops before the ']' or
+    // before the first element that is not a number. A number of the other
+    // kind, or an integer outside int64_t, ends the run: it is consumed and
+    // returned in rest, the value nlohmann would have produced for it, with
+    // rest left null otherwise. Throws std::runtime_error on malformed numbers
+    // and separators.
+    virtual void read(std::vector<double>& doubles, std::vector<int64_t>& integers, nlohmann::json& rest) = 0;
+};
+
+// For sax_parse(std::istream&), which reads the stream buffer one character
+// at a time without buffering of its own
+class StreamNumberInput : public NumberInput {
+public:
+    explicit StreamNumberInput(std::streambuf& buffer) : buffer(buffer) {}
+
+    void read(std::vector<double>& doubles, std::vector<int64_t>& integers, nlohmann::json& rest) override;
+
+private:
+    std::streambuf& buffer;
+};
+
+// For text in memory. The parse has to read through begin() and end(), whose
+// iterators share the position that read() moves forward.
+class TextNumberInput : public NumberInput {
+public:
+    TextNumberInput(const char* begin, const char* end) : position(begin), last(end) {}
+    TextNumberInput(const TextNumberInput&) = delete;
+    TextNumberInput& operator=(const TextNumberInput&) = delete;
+
+    class Iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = char;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const char*;
+        using reference = const char&;
+
+        Iterator(TextNumberInput* input, bool atEnd) : input(input), atEnd(atEnd) {}
+
+        reference operator*() const { return *input->position; }
+        Iterator& operator++() {
+            ++input->position;
+            return *this;
+        }
+        Iterator operator++(int) {
+            Iterator before = *this;
+            ++input->position;
+            return before;
+        }
+        bool operator==(const Iterator& other) const { return where() == other.where(); }
+        bool operator!=(const Iterator& other) const { return where() != other.where(); }
+
+    private:
+        const char* where() const { return atEnd ? input->last : input->position; }
+
+        TextNumberInput* input;
+        bool atEnd;
+    };
+
+    Iterator begin() { return Iterator(this, false); }
+    Iterator end() { return Iterator(this, true); }
+
+    void read(std::vector<double>& doubles, std::vector<int64_t>& integers, nlohmann::json& rest) override;
+
+private:
+    const char* position;
+    const char* last;
+};
+
+} // namespace mzqc
@@ -0,0 +1,384 @@
+#include "mzqc.hpp"
+#include "mzqc_mmap.hpp"
+#include "mzqc_stats.hpp"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace mzqc {
+
+// OBO tokenizer. Lines are scanned in place over the mapped file; only the
+// fields kept in CvTermDetails are copied out.
+
+// Strip leading blanks and trailing whitespace
+static std::string_view trimOboValue(std::string_view value) {
+    size_t first = value.find_first_not_of(" \t");
+    if (first == std::string_view::npos) return std::string_view();
+    size_t last = value.find_last_not_of(" \t\r");
+    return value.substr(first, last - first + 1);
+}
+
+// Drop a trailing "! comment" from a tag value
+static std::string_view stripOboComment(std::string_view value) {
+    size_t bang = value.find(" !");
+    return trimOboValue(bang == std::string_view::npos ? value : value.substr(0, bang));
+}
+
+static bool oboTag(std::string_view line, std::string_view tag, std::string_view& value) {
+    if (line.compare(0, tag.size(), tag) != 0) return false;
+    value = line.substr(tag.size());
+    return true;
+}
+
+int CvTermCache::parseOboFile(const std::string& filename) {
+    // The file is mapped, reading it is part of the parse
+    MZQC_STATS_SCOPE("parseOboFile", Parse);
+    MappedFile file;
+    if (!file.open(filename)) return -1;
+
+    const std::string_view text = file.view();
+#ifdef MZQC_ENABLE_STATS
+    mzqcStatsScope.bytes = text.size();
+    const size_t termsBefore = terms.size();
+#endif
+    CvTermDetails currentTerm;
+    bool inTermDef = false;
+    size_t pos = 0;
+
+    while (pos < text.size()) {
+        const char* newline = static_cast<const char*>(std::memchr(text.data() + pos, '\n', text.size() - pos));
+        size_t end = newline ? static_cast<size_t>(newline - text.data()) : text.size();
+        std::string_view line = text.substr(pos, end - pos);
+        pos = end + 1;
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+
+        // Skip empty lines and comments
+        if (line.empty() || line[0] == '!') continue;
+
+        // Stanza start, only [Term] stanzas are kept
+        if (line[0] == '[') {
+            if (inTermDef && !currentTerm.accession.empty()) {
+                addTerm(std::move(currentTerm));
+            }
+            currentTerm = CvTermDetails();
+            inTermDef = line == "[Term]";
+            continue;
+        }
+
+        // Only process if we're inside a term definition
+        if (!inTermDef) continue;
+
+        std::string_view value;
+        if (oboTag(line, "id:", value)) {
+            currentTerm.accession = trimOboValue(value);
+        } else if (oboTag(line, "name:", value)) {
+            currentTerm.name = trimOboValue(value);
+        } else if (oboTag(line, "def:", value)) {
+            currentTerm.definition = trimOboValue(value);
+        } else if (oboTag(line, "is_a:", value)) {
+            currentTerm.parentTerms.emplace_back(stripOboComment(value));
+        } else if (oboTag(line, "relationship:", value)) {
+            std::string_view relationship = stripOboComment(value);
+            std::string_view unit;
+            if (oboTag(relationship, "has_units ", unit) && !currentTerm.unit) {
+                currentTerm.unit = std::string(trimOboValue(unit));
+            }
+            currentTerm.relationships.emplace_back(relationship);
+        } else if (oboTag(line, "xref: value-type:", value)) {
+            // e.g. xref: value-type:xsd\:double "The allowed value-type for this CV term."
+            std::string type(value.substr(0, value.find(' ')));
+            size_t escape = type.find("\\:");
+            if (escape != std::string::npos) type.erase(escape, 1);
+            currentTerm.valueType = std::move(type);
+        }
+    }
+
+    // Add the last term
+    if (inTermDef && !currentTerm.accession.empty()) {
+        addTerm(std::move(currentTerm));
+    }
+
+    buildAncestry();
+#ifdef MZQC_ENABLE_STATS
+    mzqcStatsScope.nodes = terms.size() - termsBefore;
+#endif
+    return terms.size();
+}
+
+// Snapshot layout, native byte order, every section 4-byte aligned:
+//   SnapshotHeader
+//   SnapshotTerm[termCount]
+//   SnapshotString[listCount]        parent accessions and relationships
+//   uint32_t slots[slotCount]
+//   uint32_t ancestorOffsets[termCount + 1], ancestorIds[ancestorCount]
+//   uint32_t descendantOffsets[termCount + 1], descendantIds[descendantCount]
+//   char source[sourceSize], char strings[stringBytes]
+// Bump snapshotVersion whenever this layout or CvTermDetails changes.
+static constexpr char snapshotMagic[8] = {'M', 'Z', 'Q', 'C', 'O', 'B', 'O', '\0'};
+static constexpr uint32_t snapshotVersion = 1;
+static constexpr uint32_t snapshotByteOrder = 0x01020304;
+static constexpr uint32_t snapshotAbsent = UINT32_MAX;
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t oboSize;
+    int64_t oboModified;
+    uint32_t termCount;
+    uint32_t listCount;
+    uint32_t slotCount;
+    uint32_t ancestorCount;
+    uint32_t descendantCount;
+    uint32_t sourceSize;
+    uint64_t stringBytes;
+};
+
+struct SnapshotString {
+    uint32_t offset;
+    uint32_t size; // snapshotAbsent for an unset optional
+};
+
+struct SnapshotTerm {
+    SnapshotString accession;
+    SnapshotString name;
+    SnapshotString definition;
+    SnapshotString valueType;
+    SnapshotString unit;
+    uint32_t firstParent;
+    uint32_t parentCount;
+    uint32_t firstRelationship;
+    uint32_t relationshipCount;
+};
+
+// Size and modification time identify the OBO file a snapshot was built from
+static bool oboStamp(const std::string& filename, uint64_t& size, int64_t& modified) {
+    struct stat info;
+    if (::stat(filename.c_str(), &info) != 0) return false;
+    size = static_cast<uint64_t>(info.st_size);
+    modified = static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+    return true;
+}
+
+bool CvTermCache::saveSnapshot(const std::string& filename) const {
+    std::string strings;
+    auto addString = [&strings](std::string_view text) {
+        SnapshotString ref{static_cast<uint32_t>(strings.size()), static_cast<uint32_t>(text.size())};
+        strings.append(text.data(), text.size());
+        return ref;
+    };
+    auto addOptional = [&addString](const std::optional<std::string>& text) {
+        return text ? addString(*text) : SnapshotString{0, snapshotAbsent};
+    };
+
+    std::vector<SnapshotTerm> records;
+    std::vector<SnapshotString> lists;
+    records.reserve(terms.size());
+    for (const auto& term : terms) {
+        SnapshotTerm record;
+        record.accession = addString(term.accession);
+        record.name = addString(term.name);
+        record.definition = addString(term.definition);
+        record.valueType = addOptional(term.valueType);
+        record.unit = addOptional(term.unit);
+        record.firstParent = static_cast<uint32_t>(lists.size());
+        record.parentCount = static_cast<uint32_t>(term.parentTerms.size());
+        for (const auto& parent : term.parentTerms) lists.push_back(addString(parent));
+        record.firstRelationship = static_cast<uint32_t>(lists.size());
+        record.relationshipCount = static_cast<uint32_t>(term.relationships.size());
+        for (const auto& relationship : term.relationships) lists.push_back(addString(relationship));
+        records.push_back(record);
+    }
+    if (strings.size() >= snapshotAbsent) return false;
+
+    SnapshotHeader header = {};
+    std::memcpy(header.magic, snapshotMagic, sizeof(snapshotMagic));
+    header.version = snapshotVersion;
+    header.byteOrder = snapshotByteOrder;
+    if (!oboStamp(currentOboFile, header.oboSize, header.oboModified)) {
+        header.oboSize = 0;
+        header.oboModified = 0;
+    }
+    header.termCount = static_cast<uint32_t>(terms.size());
+    header.listCount = static_cast<uint32_t>(lists.size());
+    header.slotCount = static_cast<uint32_t>(slots.size());
+    header.ancestorCount = static_cast<uint32_t>(ancestorIds.size());
+    header.descendantCount = static_cast<uint32_t>(descendantIds.size());
+    header.sourceSize = static_cast<uint32_t>(currentOboFile.size());
+    header.stringBytes = strings.size();
+
+    // Write aside and rename, so concurrent readers never map a partial file
+    std::string tempFile = filename + ".tmp." + std::to_string(::getpid());
+    {
+        std::ofstream out(tempFile, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) return false;
+        auto write = [&out](const void* data, size_t bytes) {
+            out.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+        };
+        write(&header, sizeof(header));
+        write(records.data(), records.size() * sizeof(SnapshotTerm));
+        write(lists.data(), lists.size() * sizeof(SnapshotString));
+        write(slots.data(), slots.size() * sizeof(uint32_t));
+        write(ancestorOffsets.data(), ancestorOffsets.size() * sizeof(uint32_t));
+        write(ancestorIds.data(), ancestorIds.size() * sizeof(uint32_t));
+        write(descendantOffsets.data(), descendantOffsets.size() * sizeof(uint32_t));
+        write(descendantIds.data(), descendantIds.size() * sizeof(uint32_t));
+        write(currentOboFile.data(), currentOboFile.size());
+        write(strings.data(), strings.size());
+        out.close();
+        if (!out) {
+            std::remove(tempFile.c_str());
+            return false;
+        }
+    }
+    if (std::rename(tempFile.c_str(), filename.c_str()) != 0) {
+        std::remove(tempFile.c_str());
+        return false;
+    }
+    return true;
+}
+
+int CvTermCache::loadSnapshot(const std::string& filename) {
+    return readSnapshot(filename, nullptr);
+}
+
+int CvTermCache::loadCached(const std::string& oboFile, const std::string& snapshotFile) {
+    int count = readSnapshot(snapshotFile, &oboFile);
+    if (count >= 0) return count;
+
+    *this = CvTermCache();
+    count = loadFromOboFile(oboFile);
+    if (count >= 0) {
+        // A missing or read-only cache directory only costs the next start a parse
+        saveSnapshot(snapshotFile);
+    }
+    return count;
+}
+
+// Offsets into a snapshot are checked before use, a corrupt file is rejected
+// like a missing one rather than read out of bounds
+int CvTermCache::readSnapshot(const std::string& filename, const std::string* source) {
+    MappedFile file;
+    if (!file.open(filename) || file.size() < sizeof(SnapshotHeader)) return -1;
+
+    SnapshotHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, snapshotMagic, sizeof(snapshotMagic)) != 0 ||
+        header.version != snapshotVersion || header.byteOrder != snapshotByteOrder) {
+        return -1;
+    }
+
+    const uint64_t termCount = header.termCount;
+    const uint64_t offsetBase = sizeof(SnapshotHeader);
+    const uint64_t listBase = offsetBase + termCount * sizeof(SnapshotTerm);
+    const uint64_t slotBase = listBase + uint64_t(header.listCount) * sizeof(SnapshotString);
+    const uint64_t ancestorBase = slotBase + uint64_t(header.slotCount) * sizeof(uint32_t);
+    const uint64_t descendantBase = ancestorBase + (termCount + 1 + header.ancestorCount) * sizeof(uint32_t);
+    const uint64_t sourceBase = descendantBase + (termCount + 1 + header.descendantCount) * sizeof(uint32_t);
+    const uint64_t stringBase = sourceBase + header.sourceSize;
+    if (stringBase + header.stringBytes != file.size()) return -1;
+
+    const char* base = file.data();
+    std::string_view sourceName(base + sourceBase, header.sourceSize);
+    if (source) {
+        uint64_t size;
+        int64_t modified;
+        if (sourceName != *source || !oboStamp(*source, size, modified) ||
+            size != header.oboSize || modified != header.oboModified) {
+            return -1;
+        }
+    }
+
+    auto readArray = [base](uint64_t offset, uint64_t count) {
+        std::vector<uint32_t> values(count);
+        if (count) std::memcpy(values.data(), base + offset, count * sizeof(uint32_t));
+        return values;
+    };
+    std::vector<uint32_t> slotIds = readArray(slotBase, header.slotCount);
+    std::vector<uint32_t> ancestorStarts = readArray(ancestorBase, termCount + 1);
+    std::vector<uint32_t> ancestorList = readArray(ancestorBase + (termCount + 1) * sizeof(uint32_t), header.ancestorCount);
+    std::vector<uint32_t> descendantStarts = readArray(descendantBase, termCount + 1);
+    std::vector<uint32_t> descendantList = readArray(descendantBase + (termCount + 1) * sizeof(uint32_t), header.descendantCount);
+
+    if (header.slotCount != 0 && ((header.slotCount & (header.slotCount - 1)) != 0 || header.slotCount <= termCount)) return -1;
+    if (header.slotCount == 0 && termCount != 0) return -1;
+    // Every term in exactly one slot, so probing always reaches an empty one
+    uint64_t occupied = 0;
+    for (uint32_t id : slotIds) {
+        if (id == npos) continue;
+        if (id >= termCount) return -1;
+        ++occupied;
+    }
+    if (occupied != termCount) return -1;
+    auto validCsr = [termCount](const std::vector<uint32_t>& starts, const std::vector<uint32_t>& ids) {
+        if (starts.front() != 0 || starts.back() != ids.size()) return false;
+        for (size_t i = 1; i < starts.size(); ++i) {
+            if (starts[i] < starts[i - 1]) return false;
+        }
+        for (uint32_t id : ids) {
+            if (id >= termCount) return false;
+        }
+        return true;
+    };
+    if (!validCsr(ancestorStarts, ancestorList) || !validCsr(descendantStarts, descendantList)) return -1;
+
+    const char* strings = base + stringBase;
+    auto validString = [&header](const SnapshotString& ref) {
+        return uint64_t(ref.offset) + ref.size <= header.stringBytes;
+    };
+    auto text = [strings](const SnapshotString& ref) {
+        return std::string(strings + ref.offset, ref.size);
+    };
+    auto optionalText = [&](const SnapshotString& ref, std::optional<std::string>& out) {
+        if (ref.size == snapshotAbsent) return true;
+        if (!validString(ref)) return false;
+        out = text(ref);
+        return true;
+    };
+
+    std::vector<SnapshotString> lists(header.listCount);
+    if (!lists.empty()) std::memcpy(lists.data(), base + listBase, lists.size() * sizeof(SnapshotString));
+    for (const auto& ref : lists) {
+        if (!validString(ref)) return -1;
+    }
+
+    std::vector<CvTermDetails> loaded(termCount);
+    for (uint64_t id = 0; id < termCount; ++id) {
+        SnapshotTerm record;
+        std::memcpy(&record, base + offsetBase + id * sizeof(SnapshotTerm), sizeof(record));
+        if (!validString(record.accession) || !validString(record.name) || !validString(record.definition) ||
+            uint64_t(record.firstParent) + record.parentCount > lists.size() ||
+            uint64_t(record.firstRelationship) + record.relationshipCount > lists.size()) {
+            return -1;
+        }
+        CvTermDetails& term = loaded[id];
+        term.accession = text(record.accession);
+        term.name = text(record.name);
+        term.definition = text(record.definition);
+        if (!optionalText(record.valueType, term.valueType) || !optionalText(record.unit, term.unit)) return -1;
+        term.parentTerms.reserve(record.parentCount);
+        for (uint32_t i = 0; i < record.parentCount; ++i) {
+            term.parentTerms.push_back(text(lists[record.firstParent + i]));
+        }
+        term.relationships.reserve(record.relationshipCount);
+        for (uint32_t i = 0; i < record.relationshipCount; ++i) {
+            term.relationships.push_back(text(lists[record.firstRelationship + i]));
+        }
+    }
+
+    currentOboFile = std::string(sourceName);
+    terms = std::move(loaded);
+    slots = std::move(slotIds);
+    ancestorOffsets = std::move(ancestorStarts);
+    ancestorIds = std::move(ancestorList);
+    descendantOffsets = std::move(descendantStarts);
+    descendantIds = std::move(descendantList);
+    internTerms();
+    return terms.size();
+}
+
+} // namespace mzqc
@@ -0,0 +1,139 @@
+#include "mzqc_parallel.hpp"
+#include <algorithm>
+#include <chrono>
+#include <exception>
+
+namespace mzqc {
+
+// Pool and queue of the worker running on this thread, if any
+static thread_local ThreadPool* currentPool = nullptr;
+static thread_local unsigned currentQueue = 0;
+
+// ThreadPool implementation
+ThreadPool::ThreadPool(unsigned threads) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    // One extra queue for tasks submitted from outside the pool
+    for (unsigned i = 0; i <= threads; ++i) {
+        queues.push_back(std::make_unique<Queue>());
+    }
+    for (unsigned i = 0; i < threads; ++i) {
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    unsigned index = currentPool == this ? currentQueue : static_cast<unsigned>(workers.size());
+    {
+        std::lock_guard<std::mutex> lock(queues[index]->mutex);
+        queues[index]->tasks.push_back(std::move(task));
+    }
+    queued.fetch_add(1, std::memory_order_release);
+    {
+        // Taking the lock orders this against a worker about to sleep
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    wake.notify_one();
+}
+
+bool ThreadPool::runOne(unsigned self) {
+    std::function<void()> task;
+    {
+        Queue& own = *queues[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+        }
+    }
+    for (size_t i = 1; !task && i < queues.size(); ++i) {
+        Queue& victim = *queues[(self + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+        }
+    }
+    if (!task) return false;
+    queued.fetch_sub(1, std::memory_order_acq_rel);
+    task();
+    return true;
+}
+
+void ThreadPool::workerLoop(unsigned index) {
+    currentPool = this;
+    currentQueue = index;
+    while (true) {
+        if (runOne(index)) continue;
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wake.wait(lock, [this] { return stopping || queued.load(std::memory_order_acquire) > 0; });
+        if (stopping && queued.load(std::memory_order_acquire) == 0) return;
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& body, size_t grain) {
+    if (count == 0) return;
+    grain = std::max<size_t>(grain, 1);
+
+    struct State {
+        std::atomic<size_t> remaining;
+        std::mutex mutex;
+        std::condition_variable done;
+        std::exception_ptr error;
+    };
+    auto state = std::make_shared<State>();
+    state->remaining = count;
+
+    // Splits off the upper half for thieves until the range is one chunk
+    std::function<void(size_t, size_t)> run = [this, state, &body, grain, &run](size_t begin, size_t end) {
+        // The caller may return as soon as remaining hits zero, which destroys
+        // this closure, so only the local copy of the state is used after that
+        std::shared_ptr<State> keep = state;
+        while (end - begin > grain) {
+            size_t middle = begin + (end - begin) / 2;
+            submit([&run, middle, end] { run(middle, end); });
+            end = middle;
+        }
+        for (size_t i = begin; i < end; ++i) {
+            try {
+                body(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                if (!state->error) state->error = std::current_exception();
+            }
+        }
+        if (keep->remaining.fetch_sub(end - begin, std::memory_order_acq_rel) == end - begin) {
+            std::lock_guard<std::mutex> lock(keep->mutex);
+            keep->done.notify_all();
+        }
+    };
+
+    run(0, count);
+
+    // Help with queued work until every item of this loop is finished
+    unsigned self = currentPool == this ? currentQueue : static_cast<unsigned>(workers.size());
+    while (state->remaining.load(std::memory_order_acquire) > 0) {
+        if (runOne(self)) continue;
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->done.wait_for(lock, std::chrono::milliseconds(1),
+                             [&state] { return state->remaining.load(std::memory_order_acquire) == 0; });
+    }
+    if (state->error) std::rethrow_exception(state->error);
+}
+
+} // namespace mzqc
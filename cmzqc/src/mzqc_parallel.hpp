@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mzqc {
+
+// Work-stealing thread pool. Every worker owns a deque: it pushes and pops at
+// the back, idle workers steal from the front of the others, so large chunks
+// split by parallelFor travel to idle cores while hot work stays local.
+class ThreadPool {
+public:
+    // 0 threads means std::thread::hardware_concurrency()
+    explicit ThreadPool(unsigned threads = 0);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Pool sized to the machine, created on first use
+    static ThreadPool& shared();
+
+    unsigned size() const { return static_cast<unsigned>(workers.size()); }
+
+    // Tasks must not throw
+    void submit(std::function<void()> task);
+
+    // Runs body(i) for every i in [0, count), splitting the range down to
+    // chunks of at least grain items. The calling thread takes part in the
+    // work. The first exception thrown by body is rethrown once all items
+    // have finished.
+    void parallelFor(size_t count, const std::function<void(size_t)>& body, size_t grain = 1);
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void workerLoop(unsigned index);
+    // Runs one task from the own queue or a stolen one, false if all are empty
+    bool runOne(unsigned self);
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<size_t> queued{0};
+    std::atomic<unsigned> nextQueue{0};
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    bool stopping = false;
+};
+
+} // namespace mzqc
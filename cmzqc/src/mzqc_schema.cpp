@@ -0,0 +1,1250 @@
+#include "mzqc_schema.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <regex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace mzqc {
+
+static constexpr uint8_t typeNull = 1;
+static constexpr uint8_t typeBoolean = 2;
+static constexpr uint8_t typeInteger = 4;
+static constexpr uint8_t typeNumber = 8;
+static constexpr uint8_t typeString = 16;
+static constexpr uint8_t typeObject = 32;
+static constexpr uint8_t typeArray = 64;
+
+enum class SchemaFormat { None, DateTime, Date, Time, Uri };
+
+struct SchemaPattern {
+    std::string source;
+    std::regex regex;
+};
+
+struct SchemaDependency {
+    std::string key;
+    uint32_t keySlot = 0;
+    // Property dependency: keys that must be present as well
+    std::vector<std::pair<std::string, uint32_t>> needs;
+    // Schema dependency: applied to the whole object
+    const SchemaNode* schema = nullptr;
+};
+
+struct SchemaNode {
+    // The `false` schema
+    bool rejectAll = false;
+    // False for `true`, `{}` and schemas with annotations only
+    bool constrained = false;
+    const SchemaNode* ref = nullptr;
+    uint8_t types = 0;
+
+    std::unordered_map<std::string, const SchemaNode*> properties;
+    std::vector<std::pair<SchemaPattern, const SchemaNode*>> patternProperties;
+    const SchemaNode* additionalProperties = nullptr;
+    std::optional<uint64_t> minProperties;
+    std::optional<uint64_t> maxProperties;
+    const SchemaNode* propertyNames = nullptr;
+    // Keys whose presence is recorded while an object is parsed
+    std::unordered_map<std::string, uint32_t> trackedKeys;
+    std::vector<std::pair<std::string, uint32_t>> required;
+    std::vector<SchemaDependency> dependencies;
+
+    bool tuple = false;
+    const SchemaNode* items = nullptr;
+    std::vector<const SchemaNode*> tupleItems;
+    const SchemaNode* additionalItems = nullptr;
+    std::optional<uint64_t> minItems;
+    std::optional<uint64_t> maxItems;
+    bool uniqueItems = false;
+    const SchemaNode* contains = nullptr;
+
+    std::optional<uint64_t> minLength;
+    std::optional<uint64_t> maxLength;
+    std::optional<SchemaPattern> pattern;
+    SchemaFormat format = SchemaFormat::None;
+
+    std::optional<double> minimum;
+    std::optional<double> maximum;
+    std::optional<double> exclusiveMinimum;
+    std::optional<double> exclusiveMaximum;
+    std::optional<double> multipleOf;
+
+    std::optional<nlohmann::json> constValue;
+    std::optional<std::vector<nlohmann::json>> enumValues;
+
+    std::vector<const SchemaNode*> allOf;
+    std::vector<const SchemaNode*> anyOf;
+    std::vector<const SchemaNode*> oneOf;
+    const SchemaNode* notSchema = nullptr;
+    const SchemaNode* ifSchema = nullptr;
+    const SchemaNode* thenSchema = nullptr;
+    const SchemaNode* elseSchema = nullptr;
+
+    // Keywords that need the complete value of a container
+    bool captures() const { return constValue || enumValues || uniqueItems; }
+};
+
+static const SchemaNode* followRefs(const SchemaNode* node) {
+    while (node->ref) node = node->ref;
+    return node;
+}
+
+static std::string escapePointer(const std::string& key) {
+    std::string out;
+    out.reserve(key.size());
+    for (char c : key) {
+        if (c == '~') {
+            out += "~0";
+        } else if (c == '/') {
+            out += "~1";
+        } else {
+            out += c;
+        }
+    }
+    return out;
+}
+
+// Fragment of a $ref to a JSON pointer, undoing URI percent-encoding
+static std::string decodeFragment(const std::string& fragment) {
+    std::string out;
+    for (size_t i = 0; i < fragment.size(); ++i) {
+        if (fragment[i] == '%' && i + 2 < fragment.size() &&
+            std::isxdigit(static_cast<unsigned char>(fragment[i + 1])) &&
+            std::isxdigit(static_cast<unsigned char>(fragment[i + 2]))) {
+            out += static_cast<char>(std::stoi(fragment.substr(i + 1, 2), nullptr, 16));
+            i += 2;
+        } else {
+            out += fragment[i];
+        }
+    }
+    return out;
+}
+
+// Translates schema json into SchemaNodes. Each schema location is compiled
+// once, which also makes recursive $refs terminate.
+class SchemaCompiler {
+public:
+    SchemaCompiler(CompiledSchema& out, const nlohmann::json& document) : out(out), document(document) {}
+
+    const SchemaNode* compile(const nlohmann::json& s, const std::string& pointer);
+
+private:
+    const SchemaNode* child(const nlohmann::json& s, const std::string& pointer, const char* key);
+    std::vector<const SchemaNode*> childList(const nlohmann::json& s, const std::string& pointer, const char* key);
+    uint64_t count(const nlohmann::json& s, const std::string& pointer, const char* key);
+    double number(const nlohmann::json& s, const std::string& pointer, const char* key);
+    SchemaPattern pattern(const nlohmann::json& s, const std::string& pointer);
+    uint32_t track(SchemaNode& node, const std::string& key);
+
+    CompiledSchema& out;
+    const nlohmann::json& document;
+    std::unordered_map<std::string, SchemaNode*> compiled;
+};
+
+const SchemaNode* SchemaCompiler::child(const nlohmann::json& s, const std::string& pointer, const char* key) {
+    return compile(s.at(key), pointer + "/" + key);
+}
+
+std::vector<const SchemaNode*> SchemaCompiler::childList(const nlohmann::json& s, const std::string& pointer,
+                                                         const char* key) {
+    const auto& list = s.at(key);
+    if (!list.is_array() || list.empty()) {
+        throw std::runtime_error("Schema keyword '" + std::string(key) + "' at '" + pointer + "' must be a non-empty array");
+    }
+    std::vector<const SchemaNode*> nodes;
+    for (size_t i = 0; i < list.size(); ++i) {
+        nodes.push_back(compile(list[i], pointer + "/" + key + "/" + std::to_string(i)));
+    }
+    return nodes;
+}
+
+uint64_t SchemaCompiler::count(const nlohmann::json& s, const std::string& pointer, const char* key) {
+    const auto& value = s.at(key);
+    if (value.is_number_unsigned()) return value.get<uint64_t>();
+    if (value.is_number_float() && value.get<double>() >= 0 && std::floor(value.get<double>()) == value.get<double>()) {
+        return static_cast<uint64_t>(value.get<double>());
+    }
+    throw std::runtime_error("Schema keyword '" + std::string(key) + "' at '" + pointer + "' must be a non-negative integer");
+}
+
+double SchemaCompiler::number(const nlohmann::json& s, const std::string& pointer, const char* key) {
+    const auto& value = s.at(key);
+    if (!value.is_number()) {
+        throw std::runtime_error("Schema keyword '" + std::string(key) + "' at '" + pointer + "' must be a number");
+    }
+    return value.get<double>();
+}
+
+SchemaPattern SchemaCompiler::pattern(const nlohmann::json& s, const std::string& pointer) {
+    if (!s.is_string()) {
+        throw std::runtime_error("Schema pattern at '" + pointer + "' must be a string");
+    }
+    try {
+        const std::string& source = s.get_ref<const std::string&>();
+        return SchemaPattern{source, std::regex(source, std::regex::ECMAScript | std::regex::optimize)};
+    } catch (const std::regex_error& e) {
+        throw std::runtime_error("Invalid schema pattern at '" + pointer + "': " + e.what());
+    }
+}
+
+uint32_t SchemaCompiler::track(SchemaNode& node, const std::string& key) {
+    auto it = node.trackedKeys.find(key);
+    if (it != node.trackedKeys.end()) return it->second;
+    uint32_t slot = static_cast<uint32_t>(node.trackedKeys.size());
+    node.trackedKeys.emplace(key, slot);
+    return slot;
+}
+
+const SchemaNode* SchemaCompiler::compile(const nlohmann::json& s, const std::string& pointer) {
+    auto found = compiled.find(pointer);
+    if (found != compiled.end()) return found->second;
+
+    out.nodes.push_back(std::make_unique<SchemaNode>());
+    SchemaNode& node = *out.nodes.back();
+    compiled.emplace(pointer, &node);
+
+    if (s.is_boolean()) {
+        node.rejectAll = !s.get<bool>();
+        node.constrained = node.rejectAll;
+        return &node;
+    }
+    if (!s.is_object()) {
+        throw std::runtime_error("Schema at '" + pointer + "' must be an object or boolean");
+    }
+
+    // In draft-07 a $ref replaces all sibling keywords
+    if (s.contains("$ref")) {
+        const auto& ref = s["$ref"];
+        if (!ref.is_string() || ref.get_ref<const std::string&>().compare(0, 1, "#") != 0) {
+            throw std::runtime_error("Unsupported $ref at '" + pointer + "', only local references are supported");
+        }
+        std::string target = decodeFragment(ref.get_ref<const std::string&>().substr(1));
+        nlohmann::json::json_pointer targetPointer;
+        try {
+            targetPointer = nlohmann::json::json_pointer(target);
+        } catch (const nlohmann::json::exception&) {
+            throw std::runtime_error("Invalid $ref '" + ref.get<std::string>() + "' at '" + pointer + "'");
+        }
+        if (!document.contains(targetPointer)) {
+            throw std::runtime_error("Unresolved $ref '" + ref.get<std::string>() + "' at '" + pointer + "'");
+        }
+        node.ref = compile(document.at(targetPointer), target);
+        node.constrained = true;
+        return &node;
+    }
+
+    for (auto it = s.begin(); it != s.end(); ++it) {
+        const std::string& key = it.key();
+        const auto& value = it.value();
+        bool handled = true;
+
+        if (key == "type") {
+            static const std::unordered_map<std::string, uint8_t> names = {
+                {"null", typeNull}, {"boolean", typeBoolean}, {"integer", typeInteger}, {"number", typeNumber},
+                {"string", typeString}, {"object", typeObject}, {"array", typeArray}};
+            std::vector<nlohmann::json> list = value.is_array() ? value.get<std::vector<nlohmann::json>>()
+                                                                : std::vector<nlohmann::json>{value};
+            for (const auto& name : list) {
+                auto type = name.is_string() ? names.find(name.get<std::string>()) : names.end();
+                if (type == names.end()) {
+                    throw std::runtime_error("Unknown type " + name.dump() + " in schema at '" + pointer + "'");
+                }
+                node.types |= type->second;
+            }
+        } else if (key == "enum") {
+            if (!value.is_array()) {
+                throw std::runtime_error("Schema keyword 'enum' at '" + pointer + "' must be an array");
+            }
+            node.enumValues = value.get<std::vector<nlohmann::json>>();
+        } else if (key == "const") {
+            node.constValue = value;
+        } else if (key == "properties") {
+            for (auto property = value.begin(); property != value.end(); ++property) {
+                node.properties[property.key()] =
+                    compile(property.value(), pointer + "/properties/" + escapePointer(property.key()));
+            }
+        } else if (key == "patternProperties") {
+            for (auto property = value.begin(); property != value.end(); ++property) {
+                std::string location = pointer + "/patternProperties/" + escapePointer(property.key());
+                node.patternProperties.emplace_back(pattern(property.key(), location),
+                                                    compile(property.value(), location));
+            }
+        } else if (key == "additionalProperties") {
+            node.additionalProperties = child(s, pointer, "additionalProperties");
+        } else if (key == "required") {
+            if (!value.is_array()) {
+                throw std::runtime_error("Schema keyword 'required' at '" + pointer + "' must be an array");
+            }
+            for (const auto& name : value) {
+                node.required.emplace_back(name.get<std::string>(), track(node, name.get<std::string>()));
+            }
+        } else if (key == "minProperties") {
+            node.minProperties = count(s, pointer, "minProperties");
+        } else if (key == "maxProperties") {
+            node.maxProperties = count(s, pointer, "maxProperties");
+        } else if (key == "propertyNames") {
+            node.propertyNames = child(s, pointer, "propertyNames");
+        } else if (key == "dependencies") {
+            for (auto dependency = value.begin(); dependency != value.end(); ++dependency) {
+                SchemaDependency entry;
+                entry.key = dependency.key();
+                entry.keySlot = track(node, entry.key);
+                if (dependency.value().is_array()) {
+                    for (const auto& name : dependency.value()) {
+                        entry.needs.emplace_back(name.get<std::string>(), track(node, name.get<std::string>()));
+                    }
+                } else {
+                    entry.schema = compile(dependency.value(), pointer + "/dependencies/" + escapePointer(entry.key));
+                }
+                node.dependencies.push_back(std::move(entry));
+            }
+        } else if (key == "items") {
+            if (value.is_array()) {
+                node.tuple = true;
+                for (size_t i = 0; i < value.size(); ++i) {
+                    node.tupleItems.push_back(compile(value[i], pointer + "/items/" + std::to_string(i)));
+                }
+            } else {
+                node.items = child(s, pointer, "items");
+            }
+        } else if (key == "additionalItems") {
+            node.additionalItems = child(s, pointer, "additionalItems");
+        } else if (key == "minItems") {
+            node.minItems = count(s, pointer, "minItems");
+        } else if (key == "maxItems") {
+            node.maxItems = count(s, pointer, "maxItems");
+        } else if (key == "uniqueItems") {
+            node.uniqueItems = value.is_boolean() && value.get<bool>();
+        } else if (key == "contains") {
+            node.contains = child(s, pointer, "contains");
+        } else if (key == "minLength") {
+            node.minLength = count(s, pointer, "minLength");
+        } else if (key == "maxLength") {
+            node.maxLength = count(s, pointer, "maxLength");
+        } else if (key == "pattern") {
+            node.pattern = pattern(value, pointer + "/pattern");
+        } else if (key == "format") {
+            // Formats not listed here are annotations only
+            std::string format = value.is_string() ? value.get<std::string>() : "";
+            if (format == "date-time") {
+                node.format = SchemaFormat::DateTime;
+            } else if (format == "date") {
+                node.format = SchemaFormat::Date;
+            } else if (format == "time") {
+                node.format = SchemaFormat::Time;
+            } else if (format == "uri") {
+                node.format = SchemaFormat::Uri;
+            } else {
+                handled = false;
+            }
+        } else if (key == "minimum") {
+            node.minimum = number(s, pointer, "minimum");
+        } else if (key == "maximum") {
+            node.maximum = number(s, pointer, "maximum");
+        } else if (key == "exclusiveMinimum") {
+            node.exclusiveMinimum = number(s, pointer, "exclusiveMinimum");
+        } else if (key == "exclusiveMaximum") {
+            node.exclusiveMaximum = number(s, pointer, "exclusiveMaximum");
+        } else if (key == "multipleOf") {
+            node.multipleOf = number(s, pointer, "multipleOf");
+            if (*node.multipleOf <= 0) {
+                throw std::runtime_error("Schema keyword 'multipleOf' at '" + pointer + "' must be positive");
+            }
+        } else if (key == "allOf") {
+            node.allOf = childList(s, pointer, "allOf");
+        } else if (key == "anyOf") {
+            node.anyOf = childList(s, pointer, "anyOf");
+        } else if (key == "oneOf") {
+            node.oneOf = childList(s, pointer, "oneOf");
+        } else if (key == "not") {
+            node.notSchema = child(s, pointer, "not");
+        } else if (key == "if") {
+            node.ifSchema = child(s, pointer, "if");
+        } else if (key == "then") {
+            node.thenSchema = child(s, pointer, "then");
+        } else if (key == "else") {
+            node.elseSchema = child(s, pointer, "else");
+        } else {
+            // definitions, title, description, $id, $schema and other annotations
+            handled = false;
+        }
+        node.constrained = node.constrained || handled;
+    }
+
+    // then/else without if have no effect
+    if (!node.ifSchema) {
+        node.thenSchema = nullptr;
+        node.elseSchema = nullptr;
+    }
+    return &node;
+}
+
+// CompiledSchema implementation
+CompiledSchema::CompiledSchema() = default;
+CompiledSchema::~CompiledSchema() = default;
+
+std::shared_ptr<const CompiledSchema> CompiledSchema::compile(const nlohmann::json& schema) {
+    std::shared_ptr<CompiledSchema> compiled(new CompiledSchema());
+    SchemaCompiler compiler(*compiled, schema);
+    compiled->root = compiler.compile(schema, "");
+    if (schema.is_object()) {
+        compiled->schemaId = schema.value("$id", "");
+        compiled->schemaTitle = schema.value("title", "");
+        static const std::regex versionPattern("\\d+\\.\\d+\\.\\d+");
+        std::smatch match;
+        if (std::regex_search(compiled->schemaTitle, match, versionPattern) ||
+            std::regex_search(compiled->schemaId, match, versionPattern)) {
+            compiled->schemaVersion = match.str();
+        }
+    }
+    compiled->document = schema;
+
+    // A chain of $refs that never reaches a real schema would loop forever
+    for (const auto& node : compiled->nodes) {
+        const SchemaNode* current = node.get();
+        for (size_t steps = 0; current->ref; ++steps) {
+            if (steps > compiled->nodes.size()) {
+                throw std::runtime_error("Schema contains a circular $ref");
+            }
+            current = current->ref;
+        }
+    }
+    return compiled;
+}
+
+static nlohmann::json readSchemaFile(const std::string& schemaPath) {
+    std::ifstream file(schemaPath);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open schema file: " + schemaPath);
+    }
+    nlohmann::json schema;
+    try {
+        file >> schema;
+    } catch (const std::exception& e) {
+        throw std::runtime_error("Error loading schema file: " + std::string(e.what()));
+    }
+    return schema;
+}
+
+std::shared_ptr<const CompiledSchema> CompiledSchema::fromFile(const std::string& schemaPath) {
+    return compile(readSchemaFile(schemaPath));
+}
+
+// Model layout of the mzQC schema
+nlohmann::json modelLayout(nlohmann::json schema) {
+    if (!schema.is_object() || !schema.contains("definitions")) return schema;
+    nlohmann::json& definitions = schema["definitions"];
+    for (const char* name : {"metadata", "inputFile", "qualityMetric", "controlledVocabulary"}) {
+        if (!definitions.contains(name)) return schema;
+    }
+    const nlohmann::json metadata = definitions["metadata"].value("properties", nlohmann::json::object());
+    if (!metadata.contains("label") || !metadata.contains("analysisSoftware")) return schema;
+
+    // Software without a uri is written without the field
+    nlohmann::json software = metadata["analysisSoftware"].value("items", nlohmann::json::object());
+    if (software.contains("allOf")) {
+        for (auto& part : software["allOf"]) {
+            auto required = part.find("required");
+            if (required == part.end() || !required->is_array()) continue;
+            required->erase(std::remove(required->begin(), required->end(), "uri"), required->end());
+        }
+    }
+    const nlohmann::json metrics = {{"type", "array"}, {"items", {{"$ref", "#/definitions/qualityMetric"}}}};
+
+    definitions["runQuality"] = {
+        {"description", "Element containing the label, inputs, software and metrics of a single run."},
+        {"type", "object"},
+        {"properties",
+         {{"label", metadata["label"]},
+          {"inputFiles", {{"type", "array"}, {"items", {{"$ref", "#/definitions/inputFile"}}}}},
+          {"analysisSoftware", {{"type", "array"}, {"items", software}}},
+          {"metrics", metrics}}},
+        {"additionalProperties", false},
+        {"required", {"label", "inputFiles", "analysisSoftware", "metrics"}}};
+    definitions["setQuality"] = {
+        {"description", "Element containing the label, run references and metrics of a collection of runs."},
+        {"type", "object"},
+        {"properties",
+         {{"label", metadata["label"]},
+          {"setRefs", {{"type", "array"}, {"items", {{"type", "string"}}}}},
+          {"metrics", metrics}}},
+        {"additionalProperties", false},
+        {"required", {"label", "setRefs", "metrics"}}};
+
+    // Units are stored as their accession
+    nlohmann::json& qualityMetric = definitions["qualityMetric"];
+    if (qualityMetric.contains("allOf")) {
+        for (auto& part : qualityMetric["allOf"]) {
+            if (part.contains("properties") && part["properties"].contains("unit")) {
+                part["properties"]["unit"] = {{"description", "Accession of the unit of the metric."},
+                                              {"type", "string"}};
+            }
+        }
+    }
+
+    nlohmann::json& cv = definitions["controlledVocabulary"];
+    if (cv.contains("properties")) {
+        cv["properties"]["id"] = {{"description", "Short name that cvRef fields refer to."}, {"type", "string"}};
+    }
+    return schema;
+}
+
+// SchemaRegistry implementation
+SchemaRegistry& SchemaRegistry::global() {
+    static SchemaRegistry registry;
+    return registry;
+}
+
+// Different spellings of the same file share one entry
+static std::string registryKey(const std::string& schemaPath) {
+    std::error_code error;
+    std::filesystem::path canonical = std::filesystem::weakly_canonical(schemaPath, error);
+    return error ? schemaPath : canonical.string();
+}
+
+std::shared_ptr<const CompiledSchema> SchemaRegistry::get(const std::string& schemaPath) {
+    std::string key = registryKey(schemaPath);
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto it = byPath.find(key);
+        if (it != byPath.end()) return it->second;
+    }
+
+    auto compiled = CompiledSchema::compile(modelLayout(readSchemaFile(schemaPath)));
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    auto inserted = byPath.emplace(key, compiled);
+    if (inserted.second && !compiled->version().empty()) {
+        byVersion.emplace(compiled->version(), compiled);
+    }
+    return inserted.first->second;
+}
+
+std::shared_ptr<const CompiledSchema> SchemaRegistry::find(const std::string& version) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto it = byVersion.find(version);
+    return it == byVersion.end() ? nullptr : it->second;
+}
+
+void SchemaRegistry::add(std::shared_ptr<const CompiledSchema> schema) {
+    if (!schema || schema->version().empty()) {
+        throw std::runtime_error("Schema has no version to register it under");
+    }
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    byVersion[schema->version()] = std::move(schema);
+}
+
+size_t SchemaRegistry::size() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return byPath.size();
+}
+
+// Replays a tree as SAX events. The validator never modifies the strings it
+// is handed, so they are passed without copying.
+static bool feed(const nlohmann::json& j, SchemaValidator& validator) {
+    switch (j.type()) {
+        case nlohmann::json::value_t::null:
+            return validator.null();
+        case nlohmann::json::value_t::boolean:
+            return validator.boolean(j.get<bool>());
+        case nlohmann::json::value_t::number_integer:
+            return validator.number_integer(j.get<int64_t>());
+        case nlohmann::json::value_t::number_unsigned:
+            return validator.number_unsigned(j.get<uint64_t>());
+        case nlohmann::json::value_t::number_float:
+            return validator.number_float(j.get<double>(), std::string());
+        case nlohmann::json::value_t::string:
+            return validator.string(const_cast<std::string&>(j.get_ref<const std::string&>()));
+        case nlohmann::json::value_t::binary:
+            return validator.binary(const_cast<nlohmann::json::binary_t&>(j.get_binary()));
+        case nlohmann::json::value_t::object:
+            if (!validator.start_object(j.size())) return false;
+            for (auto it = j.begin(); it != j.end(); ++it) {
+                if (!validator.key(const_cast<std::string&>(it.key())) || !feed(it.value(), validator)) return false;
+            }
+            return validator.end_object();
+        case nlohmann::json::value_t::array:
+            if (!validator.start_array(j.size())) return false;
+            for (const auto& item : j) {
+                if (!feed(item, validator)) return false;
+            }
+            return validator.end_array();
+        default:
+            return true;
+    }
+}
+
+bool CompiledSchema::validate(const nlohmann::json& j, std::vector<SchemaError>* errors, size_t maxErrors) const {
+    // Non-owning handle, the validator does not outlive this call
+    SchemaValidator validator(std::shared_ptr<const CompiledSchema>(std::shared_ptr<const CompiledSchema>(), this), maxErrors);
+    feed(j, validator);
+    if (errors) *errors = validator.errors();
+    return validator.valid();
+}
+
+// Runtime state of SchemaValidator. A Check is one schema node applied to
+// the value currently open in its frame; a Sink collects whether the checks
+// feeding it passed. Sink 0 is the document itself, other sinks belong to
+// combinator branches and are settled by a Resolution when the value ends.
+struct SchemaValidator::Check {
+    const SchemaNode* node = nullptr;
+    uint32_t sink = 0;
+    size_t flagBase = 0;
+    bool containsMatched = false;
+};
+
+struct SchemaValidator::Sink {
+    bool valid = true;
+    std::string firstError;
+};
+
+struct SchemaValidator::Resolution {
+    enum class Kind { AnyOf, OneOf, Not, IfThenElse, Dependency, ContainsItem };
+
+    Kind kind = Kind::AnyOf;
+    uint32_t parentSink = 0;
+    uint32_t firstSink = 0;
+    uint32_t sinkCount = 0;
+    size_t check = 0;
+    size_t dependency = 0;
+};
+
+struct SchemaValidator::Frame {
+    ValueType type = ValueType::Null;
+    size_t firstCheck = 0;
+    size_t firstResolution = 0;
+    size_t firstSink = 0;
+    size_t firstFlag = 0;
+    bool capture = false;
+    // Keys or items seen so far
+    uint64_t count = 0;
+    // Most recent key of an object
+    std::string key;
+};
+
+static const char* typeName(int type) {
+    static const char* names[] = {"null", "boolean", "integer", "number", "string", "object", "array"};
+    return names[type];
+}
+
+static std::string expectedTypes(uint8_t types) {
+    static const std::pair<uint8_t, const char*> names[] = {
+        {typeNull, "null"}, {typeBoolean, "boolean"}, {typeInteger, "integer"}, {typeNumber, "number"},
+        {typeString, "string"}, {typeObject, "object"}, {typeArray, "array"}};
+    std::string out;
+    for (const auto& [bit, name] : names) {
+        if (!(types & bit)) continue;
+        if (!out.empty()) out += " or ";
+        out += name;
+    }
+    return out;
+}
+
+static bool isDigits(const std::string& s, size_t pos, size_t count) {
+    if (pos + count > s.size()) return false;
+    for (size_t i = pos; i < pos + count; ++i) {
+        if (!std::isdigit(static_cast<unsigned char>(s[i]))) return false;
+    }
+    return true;
+}
+
+static int digits(const std::string& s, size_t pos, size_t count) {
+    return std::stoi(s.substr(pos, count));
+}
+
+// RFC 3339 full-date
+static bool isDate(const std::string& s, size_t pos) {
+    if (!isDigits(s, pos, 4) || s.size() < pos + 10 || s[pos + 4] != '-' || !isDigits(s, pos + 5, 2) ||
+        s[pos + 7] != '-' || !isDigits(s, pos + 8, 2)) {
+        return false;
+    }
+    int year = digits(s, pos, 4);
+    int month = digits(s, pos + 5, 2);
+    int day = digits(s, pos + 8, 2);
+    static const int monthDays[] = {31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    if (month < 1 || month > 12 || day < 1 || day > monthDays[month - 1]) return false;
+    bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    return month != 2 || day <= 28 || leap;
+}
+
+// RFC 3339 full-time
+static bool isTime(const std::string& s, size_t pos) {
+    if (!isDigits(s, pos, 2) || s.size() < pos + 8 || s[pos + 2] != ':' || !isDigits(s, pos + 3, 2) ||
+        s[pos + 5] != ':' || !isDigits(s, pos + 6, 2)) {
+        return false;
+    }
+    if (digits(s, pos, 2) > 23 || digits(s, pos + 3, 2) > 59 || digits(s, pos + 6, 2) > 60) return false;
+    pos += 8;
+    if (pos < s.size() && s[pos] == '.') {
+        size_t start = ++pos;
+        while (pos < s.size() && std::isdigit(static_cast<unsigned char>(s[pos]))) ++pos;
+        if (pos == start) return false;
+    }
+    if (pos < s.size() && (s[pos] == 'Z' || s[pos] == 'z')) return pos + 1 == s.size();
+    if (pos < s.size() && (s[pos] == '+' || s[pos] == '-')) {
+        return pos + 6 == s.size() && isDigits(s, pos + 1, 2) && s[pos + 3] == ':' && isDigits(s, pos + 4, 2) &&
+               digits(s, pos + 1, 2) <= 23 && digits(s, pos + 4, 2) <= 59;
+    }
+    return false;
+}
+
+static bool matchesFormat(SchemaFormat format, const std::string& s) {
+    switch (format) {
+        case SchemaFormat::DateTime:
+            return s.size() > 11 && (s[10] == 'T' || s[10] == 't' || s[10] == ' ') && isDate(s, 0) && isTime(s, 11);
+        case SchemaFormat::Date:
+            return s.size() == 10 && isDate(s, 0);
+        case SchemaFormat::Time:
+            return isTime(s, 0);
+        case SchemaFormat::Uri: {
+            // Absolute URI: a scheme followed by ':' and no whitespace
+            if (s.empty() || !std::isalpha(static_cast<unsigned char>(s[0]))) return false;
+            size_t colon = 1;
+            while (colon < s.size() && (std::isalnum(static_cast<unsigned char>(s[colon])) || s[colon] == '+' ||
+                                        s[colon] == '-' || s[colon] == '.')) {
+                ++colon;
+            }
+            if (colon >= s.size() || s[colon] != ':') return false;
+            return std::none_of(s.begin(), s.end(), [](char c) {
+                return static_cast<unsigned char>(c) <= 0x20 || c == '\x7f';
+            });
+        }
+        default:
+            return true;
+    }
+}
+
+// Length in code points, as JSON Schema counts it
+static uint64_t codePoints(const std::string& s) {
+    uint64_t length = 0;
+    for (char c : s) {
+        if ((static_cast<unsigned char>(c) & 0xC0) != 0x80) ++length;
+    }
+    return length;
+}
+
+// SchemaValidator implementation
+SchemaValidator::SchemaValidator(std::shared_ptr<const CompiledSchema> schema, size_t maxErrors)
+    : schema(std::move(schema)), maxErrors(maxErrors) {
+    reset();
+}
+
+SchemaValidator::~SchemaValidator() = default;
+
+void SchemaValidator::reset() {
+    errorList.clear();
+    complete = false;
+    frames.clear();
+    checks.clear();
+    sinks.assign(1, Sink());
+    resolutions.clear();
+    flags.clear();
+    pending.clear();
+    pendingContains.clear();
+    inertDepth = 0;
+    captures.clear();
+    pending.emplace_back(schema->root, 0);
+}
+
+std::string SchemaValidator::currentPath() const {
+    std::string path;
+    for (size_t i = 1; i < frames.size(); ++i) {
+        const Frame& parent = frames[i - 1];
+        path += '/';
+        path += parent.type == ValueType::Object ? escapePointer(parent.key) : std::to_string(parent.count - 1);
+    }
+    return path;
+}
+
+uint32_t SchemaValidator::newSink() {
+    sinks.emplace_back();
+    return static_cast<uint32_t>(sinks.size() - 1);
+}
+
+void SchemaValidator::fail(uint32_t sink, std::string message) {
+    if (sink == 0) {
+        if (maxErrors == 0 || errorList.size() < maxErrors) {
+            errorList.push_back(SchemaError{currentPath(), std::move(message)});
+        }
+        return;
+    }
+    Sink& target = sinks[sink];
+    if (target.valid) {
+        target.valid = false;
+        std::string path = currentPath();
+        target.firstError = (path.empty() ? "/" : path) + ": " + message;
+    }
+}
+
+void SchemaValidator::addCheck(const SchemaNode* node, uint32_t sink) {
+    node = followRefs(node);
+    if (node->rejectAll) {
+        fail(sink, "No value is allowed here");
+        return;
+    }
+    if (!node->constrained) return;
+
+    size_t index = checks.size();
+    checks.push_back(Check{node, sink, flags.size(), false});
+    flags.resize(flags.size() + node->trackedKeys.size(), 0);
+
+    for (const SchemaNode* sub : node->allOf) {
+        addCheck(sub, sink);
+    }
+    // Branch sinks are allocated together so that a resolution sees a contiguous range
+    auto branches = [&](Resolution::Kind kind, const std::vector<const SchemaNode*>& subs) {
+        uint32_t first = static_cast<uint32_t>(sinks.size());
+        sinks.resize(sinks.size() + subs.size());
+        resolutions.push_back(Resolution{kind, sink, first, static_cast<uint32_t>(subs.size()), index, 0});
+        for (size_t i = 0; i < subs.size(); ++i) {
+            addCheck(subs[i], first + static_cast<uint32_t>(i));
+        }
+    };
+    if (!node->anyOf.empty()) branches(Resolution::Kind::AnyOf, node->anyOf);
+    if (!node->oneOf.empty()) branches(Resolution::Kind::OneOf, node->oneOf);
+    if (node->notSchema) {
+        branches(Resolution::Kind::Not, {node->notSchema});
+    }
+    if (node->ifSchema) {
+        uint32_t first = static_cast<uint32_t>(sinks.size());
+        sinks.resize(sinks.size() + 3);
+        resolutions.push_back(Resolution{Resolution::Kind::IfThenElse, sink, first, 3, index, 0});
+        addCheck(node->ifSchema, first);
+        if (node->thenSchema) addCheck(node->thenSchema, first + 1);
+        if (node->elseSchema) addCheck(node->elseSchema, first + 2);
+    }
+    for (size_t i = 0; i < node->dependencies.size(); ++i) {
+        if (!node->dependencies[i].schema) continue;
+        uint32_t first = newSink();
+        resolutions.push_back(Resolution{Resolution::Kind::Dependency, sink, first, 1, index, i});
+        addCheck(node->dependencies[i].schema, first);
+    }
+}
+
+bool SchemaValidator::needsCapture() const {
+    const Frame& frame = frames.back();
+    if (frames.size() > 1 && frames[frames.size() - 2].capture) return true;
+    for (size_t i = frame.firstCheck; i < checks.size(); ++i) {
+        if (checks[i].node->captures()) return true;
+    }
+    return false;
+}
+
+void SchemaValidator::prepareItem() {
+    Frame& frame = frames.back();
+    uint64_t index = frame.count++;
+    for (size_t i = frame.firstCheck; i < checks.size(); ++i) {
+        const SchemaNode* node = checks[i].node;
+        const SchemaNode* items = nullptr;
+        if (node->tuple) {
+            items = index < node->tupleItems.size() ? node->tupleItems[index] : node->additionalItems;
+        } else {
+            items = node->items;
+        }
+        if (items) {
+            items = followRefs(items);
+            if (items->constrained) pending.emplace_back(items, checks[i].sink);
+        }
+        if (node->contains) pendingContains.push_back(i);
+    }
+}
+
+void SchemaValidator::beginValue(ValueType type) {
+    Frame frame;
+    frame.type = type;
+    frame.firstCheck = checks.size();
+    frame.firstResolution = resolutions.size();
+    frame.firstSink = sinks.size();
+    frame.firstFlag = flags.size();
+    frames.push_back(std::move(frame));
+
+    std::vector<std::pair<const SchemaNode*, uint32_t>> expected;
+    expected.swap(pending);
+    std::vector<size_t> containing;
+    containing.swap(pendingContains);
+
+    for (size_t check : containing) {
+        uint32_t sink = newSink();
+        resolutions.push_back(Resolution{Resolution::Kind::ContainsItem, 0, sink, 1, check, 0});
+        addCheck(checks[check].node->contains, sink);
+    }
+    for (const auto& [node, sink] : expected) {
+        addCheck(node, sink);
+    }
+
+    // Reuse the buffers for the next value
+    expected.clear();
+    pending.swap(expected);
+    containing.clear();
+    pendingContains.swap(containing);
+
+    uint8_t bit = 0;
+    switch (type) {
+        case ValueType::Null: bit = typeNull; break;
+        case ValueType::Boolean: bit = typeBoolean; break;
+        case ValueType::Integer: bit = typeInteger | typeNumber; break;
+        case ValueType::Number: bit = typeNumber; break;
+        case ValueType::String: bit = typeString; break;
+        case ValueType::Object: bit = typeObject; break;
+        case ValueType::Array: bit = typeArray; break;
+    }
+    for (size_t i = frames.back().firstCheck; i < checks.size(); ++i) {
+        const Check& check = checks[i];
+        if (check.node->types && !(check.node->types & bit)) {
+            fail(check.sink, "Expected " + expectedTypes(check.node->types) + ", found " +
+                                 typeName(static_cast<int>(type)));
+        }
+    }
+    frames.back().capture = (type == ValueType::Object || type == ValueType::Array) && needsCapture();
+}
+
+void SchemaValidator::checkScalar(const Check& check, ValueType type, const nlohmann::json& val) {
+    const SchemaNode* node = check.node;
+    if (type == ValueType::String && val.is_string()) {
+        const std::string& text = val.get_ref<const std::string&>();
+        if (node->minLength || node->maxLength) {
+            uint64_t length = codePoints(text);
+            if (node->minLength && length < *node->minLength) {
+                fail(check.sink, "String is shorter than " + std::to_string(*node->minLength) + " characters");
+            }
+            if (node->maxLength && length > *node->maxLength) {
+                fail(check.sink, "String is longer than " + std::to_string(*node->maxLength) + " characters");
+            }
+        }
+        if (node->pattern && !std::regex_search(text, node->pattern->regex)) {
+            fail(check.sink, "String '" + text + "' does not match pattern '" + node->pattern->source + "'");
+        }
+        if (node->format != SchemaFormat::None && !matchesFormat(node->format, text)) {
+            static const char* formats[] = {"", "date-time", "date", "time", "uri"};
+            fail(check.sink, "String '" + text + "' is not a valid " + formats[static_cast<int>(node->format)]);
+        }
+    } else if (type == ValueType::Integer || type == ValueType::Number) {
+        double number = val.get<double>();
+        if (node->minimum && number < *node->minimum) {
+            fail(check.sink, "Value " + val.dump() + " is less than minimum " + nlohmann::json(*node->minimum).dump());
+        }
+        if (node->maximum && number > *node->maximum) {
+            fail(check.sink, "Value " + val.dump() + " is greater than maximum " + nlohmann::json(*node->maximum).dump());
+        }
+        if (node->exclusiveMinimum && number <= *node->exclusiveMinimum) {
+            fail(check.sink, "Value " + val.dump() + " is not greater than " + nlohmann::json(*node->exclusiveMinimum).dump());
+        }
+        if (node->exclusiveMaximum && number >= *node->exclusiveMaximum) {
+            fail(check.sink, "Value " + val.dump() + " is not less than " + nlohmann::json(*node->exclusiveMaximum).dump());
+        }
+        if (node->multipleOf) {
+            double quotient = number / *node->multipleOf;
+            if (std::abs(quotient - std::round(quotient)) > 1e-9 * std::max(1.0, std::abs(quotient))) {
+                fail(check.sink, "Value " + val.dump() + " is not a multiple of " + nlohmann::json(*node->multipleOf).dump());
+            }
+        }
+    }
+    if (node->constValue && val != *node->constValue) {
+        fail(check.sink, "Value must be " + node->constValue->dump());
+    }
+    if (node->enumValues &&
+        std::find(node->enumValues->begin(), node->enumValues->end(), val) == node->enumValues->end()) {
+        fail(check.sink, "Value " + val.dump() + " is not one of the allowed values");
+    }
+}
+
+void SchemaValidator::checkContainer(const Check& check, const nlohmann::json* value) {
+    const SchemaNode* node = check.node;
+    const Frame& frame = frames.back();
+    if (frame.type == ValueType::Object) {
+        for (const auto& [name, slot] : node->required) {
+            if (!flags[check.flagBase + slot]) {
+                fail(check.sink, "Missing required property '" + name + "'");
+            }
+        }
+        if (node->minProperties && frame.count < *node->minProperties) {
+            fail(check.sink, "Object has " + std::to_string(frame.count) + " properties, at least " +
+                                 std::to_string(*node->minProperties) + " required");
+        }
+        if (node->maxProperties && frame.count > *node->maxProperties) {
+            fail(check.sink, "Object has " + std::to_string(frame.count) + " properties, at most " +
+                                 std::to_string(*node->maxProperties) + " allowed");
+        }
+        for (const auto& dependency : node->dependencies) {
+            if (!flags[check.flagBase + dependency.keySlot]) continue;
+            for (const auto& [name, slot] : dependency.needs) {
+                if (!flags[check.flagBase + slot]) {
+                    fail(check.sink, "Property '" + dependency.key + "' requires property '" + name + "'");
+                }
+            }
+        }
+    } else {
+        if (node->minItems && frame.count < *node->minItems) {
+            fail(check.sink, "Array has " + std::to_string(frame.count) + " items, at least " +
+                                 std::to_string(*node->minItems) + " required");
+        }
+        if (node->maxItems && frame.count > *node->maxItems) {
+            fail(check.sink, "Array has " + std::to_string(frame.count) + " items, at most " +
+                                 std::to_string(*node->maxItems) + " allowed");
+        }
+        if (node->contains && !check.containsMatched) {
+            fail(check.sink, "No item matches the schema in 'contains'");
+        }
+        if (node->uniqueItems && value) {
+            std::vector<const nlohmann::json*> items;
+            for (const auto& item : *value) items.push_back(&item);
+            std::sort(items.begin(), items.end(), [](const nlohmann::json* a, const nlohmann::json* b) { return *a < *b; });
+            for (size_t i = 1; i < items.size(); ++i) {
+                if (*items[i - 1] == *items[i]) {
+                    fail(check.sink, "Array items are not unique");
+                    break;
+                }
+            }
+        }
+    }
+    if (value && node->constValue && *value != *node->constValue) {
+        fail(check.sink, "Value must be " + node->constValue->dump());
+    }
+    if (value && node->enumValues &&
+        std::find(node->enumValues->begin(), node->enumValues->end(), *value) == node->enumValues->end()) {
+        fail(check.sink, "Value is not one of the allowed values");
+    }
+}
+
+void SchemaValidator::resolve(const Resolution& resolution) {
+    const Sink* branch = &sinks[resolution.firstSink];
+    auto detail = [](const Sink& sink) { return sink.firstError.empty() ? std::string() : " (" + sink.firstError + ")"; };
+    switch (resolution.kind) {
+        case Resolution::Kind::AnyOf: {
+            bool any = false;
+            for (uint32_t i = 0; i < resolution.sinkCount && !any; ++i) any = branch[i].valid;
+            if (!any) fail(resolution.parentSink, "Value does not match any schema in 'anyOf'" + detail(branch[0]));
+            break;
+        }
+        case Resolution::Kind::OneOf: {
+            uint32_t matched = 0;
+            for (uint32_t i = 0; i < resolution.sinkCount; ++i) matched += branch[i].valid ? 1 : 0;
+            if (matched == 0) {
+                fail(resolution.parentSink, "Value does not match any schema in 'oneOf'" + detail(branch[0]));
+            } else if (matched > 1) {
+                fail(resolution.parentSink, "Value matches " + std::to_string(matched) +
+                                                " schemas in 'oneOf', exactly one required");
+            }
+            break;
+        }
+        case Resolution::Kind::Not:
+            if (branch[0].valid) fail(resolution.parentSink, "Value must not match the schema in 'not'");
+            break;
+        case Resolution::Kind::IfThenElse:
+            if (branch[0].valid && !branch[1].valid) {
+                fail(resolution.parentSink, "Value matches 'if' but not 'then'" + detail(branch[1]));
+            } else if (!branch[0].valid && !branch[2].valid) {
+                fail(resolution.parentSink, "Value matches neither 'if' nor 'else'" + detail(branch[2]));
+            }
+            break;
+        case Resolution::Kind::Dependency: {
+            const Check& check = checks[resolution.check];
+            const SchemaDependency& dependency = check.node->dependencies[resolution.dependency];
+            if (frames.back().type == ValueType::Object && flags[check.flagBase + dependency.keySlot] && !branch[0].valid) {
+                fail(resolution.parentSink, "Dependency of property '" + dependency.key + "' not satisfied" + detail(branch[0]));
+            }
+            break;
+        }
+        case Resolution::Kind::ContainsItem:
+            if (branch[0].valid) checks[resolution.check].containsMatched = true;
+            break;
+    }
+}
+
+void SchemaValidator::endValue(nlohmann::json* value) {
+    const Frame& frame = frames.back();
+    for (size_t i = resolutions.size(); i > frame.firstResolution; --i) {
+        resolve(resolutions[i - 1]);
+    }
+
+    bool container = frame.type == ValueType::Object || frame.type == ValueType::Array;
+    if (frames.size() > 1 && frames[frames.size() - 2].capture && value) {
+        const Frame& parent = frames[frames.size() - 2];
+        nlohmann::json& target = captures[captures.size() - (container && frame.capture ? 2 : 1)];
+        if (parent.type == ValueType::Object) {
+            target[parent.key] = std::move(*value);
+        } else {
+            target.push_back(std::move(*value));
+        }
+    }
+
+    checks.erase(checks.begin() + frame.firstCheck, checks.end());
+    resolutions.erase(resolutions.begin() + frame.firstResolution, resolutions.end());
+    sinks.erase(sinks.begin() + frame.firstSink, sinks.end());
+    flags.erase(flags.begin() + frame.firstFlag, flags.end());
+    if (container && frame.capture) captures.pop_back();
+    frames.pop_back();
+    if (frames.empty()) complete = true;
+}
+
+// Collects the subschemas for the value about to start, false if none apply
+// and the value can be skipped
+bool SchemaValidator::startValue() {
+    if (!frames.empty() && frames.back().type == ValueType::Array) prepareItem();
+    if (!pending.empty() || !pendingContains.empty()) return true;
+    return !frames.empty() && frames.back().capture;
+}
+
+bool SchemaValidator::keepGoing() const {
+    return maxErrors == 0 || errorList.size() < maxErrors;
+}
+
+template <typename Make>
+bool SchemaValidator::scalar(ValueType type, Make&& make) {
+    if (inertDepth) return true;
+    if (!startValue()) return keepGoing();
+
+    nlohmann::json val = make();
+    beginValue(type);
+    for (size_t i = frames.back().firstCheck; i < checks.size(); ++i) {
+        checkScalar(checks[i], type, val);
+    }
+    endValue(&val);
+    return keepGoing();
+}
+
+bool SchemaValidator::openContainer(ValueType type) {
+    if (inertDepth || !startValue()) {
+        ++inertDepth;
+        return keepGoing();
+    }
+    beginValue(type);
+    if (frames.back().capture) {
+        captures.push_back(type == ValueType::Object ? nlohmann::json::object() : nlohmann::json::array());
+    }
+    return keepGoing();
+}
+
+bool SchemaValidator::closeContainer() {
+    if (inertDepth) {
+        --inertDepth;
+        return keepGoing();
+    }
+    nlohmann::json* value = frames.back().capture ? &captures.back() : nullptr;
+    for (size_t i = frames.back().firstCheck; i < checks.size(); ++i) {
+        checkContainer(checks[i], value);
+    }
+    endValue(value);
+    return keepGoing();
+}
+
+bool SchemaValidator::null() {
+    return scalar(ValueType::Null, [] { return nlohmann::json(nullptr); });
+}
+
+bool SchemaValidator::boolean(bool val) {
+    return scalar(ValueType::Boolean, [val] { return nlohmann::json(val); });
+}
+
+bool SchemaValidator::number_integer(number_integer_t val) {
+    return scalar(ValueType::Integer, [val] { return nlohmann::json(val); });
+}
+
+bool SchemaValidator::number_unsigned(number_unsigned_t val) {
+    return scalar(ValueType::Integer, [val] { return nlohmann::json(val); });
+}
+
+bool SchemaValidator::number_float(number_float_t val, const string_t& /*s*/) {
+    // Draft-07 counts numbers without a fractional part as integers
+    ValueType type = std::isfinite(val) && std::floor(val) == val ? ValueType::Integer : ValueType::Number;
+    return scalar(type, [val] { return nlohmann::json(val); });
+}
+
+bool SchemaValidator::string(string_t& val) {
+    return scalar(ValueType::String, [&val] { return nlohmann::json(val); });
+}
+
+bool SchemaValidator::binary(binary_t& val) {
+    return scalar(ValueType::String, [&val] { return nlohmann::json::binary(val); });
+}
+
+bool SchemaValidator::start_object(std::size_t /*elements*/) {
+    return openContainer(ValueType::Object);
+}
+
+bool SchemaValidator::key(string_t& val) {
+    if (inertDepth) return true;
+    Frame& frame = frames.back();
+    frame.key = val;
+    ++frame.count;
+
+    std::vector<std::pair<const SchemaNode*, uint32_t>> names;
+    for (size_t i = frame.firstCheck; i < checks.size(); ++i) {
+        const Check& check = checks[i];
+        const SchemaNode* node = check.node;
+        if (!node->trackedKeys.empty()) {
+            auto tracked = node->trackedKeys.find(val);
+            if (tracked != node->trackedKeys.end()) flags[check.flagBase + tracked->second] = 1;
+        }
+        if (node->propertyNames) names.emplace_back(node->propertyNames, check.sink);
+
+        bool matched = false;
+        auto expect = [this, &check](const SchemaNode* sub) {
+            sub = followRefs(sub);
+            if (sub->constrained) pending.emplace_back(sub, check.sink);
+        };
+        auto property = node->properties.find(val);
+        if (property != node->properties.end()) {
+            expect(property->second);
+            matched = true;
+        }
+        for (const auto& [pattern, sub] : node->patternProperties) {
+            if (std::regex_search(val, pattern.regex)) {
+                expect(sub);
+                matched = true;
+            }
+        }
+        if (!matched && node->additionalProperties) {
+            if (followRefs(node->additionalProperties)->rejectAll) {
+                fail(check.sink, "Property '" + val + "' is not allowed");
+            } else {
+                expect(node->additionalProperties);
+            }
+        }
+    }
+
+    if (!names.empty()) {
+        // Property names are validated as string values of their own
+        std::vector<std::pair<const SchemaNode*, uint32_t>> expected;
+        expected.swap(pending);
+        pending.swap(names);
+        nlohmann::json name(val);
+        bool capture = frame.capture;
+        frame.capture = false;
+        beginValue(ValueType::String);
+        for (size_t i = frames.back().firstCheck; i < checks.size(); ++i) {
+            checkScalar(checks[i], ValueType::String, name);
+        }
+        endValue(nullptr);
+        frames.back().capture = capture;
+        pending.swap(expected);
+    }
+    return keepGoing();
+}
+
+bool SchemaValidator::end_object() {
+    return closeContainer();
+}
+
+bool SchemaValidator::start_array(std::size_t /*elements*/) {
+    return openContainer(ValueType::Array);
+}
+
+bool SchemaValidator::end_array() {
+    return closeContainer();
+}
+
+bool SchemaValidator::parse_error(std::size_t /*position*/, const std::string& /*last_token*/,
+                                  const nlohmann::detail::exception& /*ex*/) {
+    complete = false;
+    return false;
+}
+
+} // namespace mzqc
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+namespace mzqc {
+
+struct SchemaError {
+    std::string path;     // JSON pointer of the offending value
+    std::string message;
+};
+
+struct SchemaNode;
+
+// JSON Schema (draft-07) compiled into a graph of nodes: property tables are
+// hashed, patterns are prebuilt regexes and $refs point straight at their
+// target node, so validating a document never looks at the schema json.
+// Only local "#/..." references are supported.
+class CompiledSchema {
+public:
+    // Throws std::runtime_error if the schema is malformed or uses a remote $ref
+    static std::shared_ptr<const CompiledSchema> compile(const nlohmann::json& schema);
+    static std::shared_ptr<const CompiledSchema> fromFile(const std::string& schemaPath);
+
+    CompiledSchema(const CompiledSchema&) = delete;
+    CompiledSchema& operator=(const CompiledSchema&) = delete;
+    ~CompiledSchema();
+
+    // Validates an existing tree in one pass, stops after maxErrors errors
+    bool validate(const nlohmann::json& j, std::vector<SchemaError>* errors = nullptr, size_t maxErrors = 1) const;
+
+    const std::string& id() const { return schemaId; }
+    const std::string& title() const { return schemaTitle; }
+    // First x.y.z found in the title or $id, empty if there is none
+    const std::string& version() const { return schemaVersion; }
+    // The schema json this was compiled from
+    const nlohmann::json& source() const { return document; }
+
+private:
+    friend class SchemaValidator;
+    friend class SchemaCompiler;
+
+    CompiledSchema();
+
+    // Owned through pointers so nodes never move while the graph is built
+    std::vector<std::unique_ptr<SchemaNode>> nodes;
+    const SchemaNode* root = nullptr;
+    nlohmann::json document;
+    std::string schemaId;
+    std::string schemaTitle;
+    std::string schemaVersion;
+};
+
+// The official mzQC schema nests label, inputFiles and analysisSoftware in a
+// metadata object next to qualityMetrics. MzQCFile reads and writes them next
+// to metrics, sets as label, setRefs and metrics, CVs with an id and units as
+// an accession string. Returns the schema with runQuality, setQuality, unit
+// and controlledVocabulary rewritten to that layout, and every other rule
+// kept; software uri becomes optional since an empty one is not written.
+// Schemas without these definitions are returned unchanged.
+nlohmann::json modelLayout(nlohmann::json schema);
+
+// Process-wide cache of compiled schemas, keyed by file path and by schema
+// version. Files are compiled in their modelLayout(), so loaders and writers
+// validate the layout they use. Lookups take a shared lock and hand out immutable schemas that can
+// be used from any number of threads; compiling a new file happens outside
+// the lock and the first result to be inserted wins.
+class SchemaRegistry {
+public:
+    static SchemaRegistry& global();
+
+    SchemaRegistry() = default;
+    SchemaRegistry(const SchemaRegistry&) = delete;
+    SchemaRegistry& operator=(const SchemaRegistry&) = delete;
+
+    // Loads and compiles the file on first use, throws std::runtime_error on failure
+    std::shared_ptr<const CompiledSchema> get(const std::string& schemaPath);
+    // Schema registered for a version such as "1.0.0", nullptr if unknown
+    std::shared_ptr<const CompiledSchema> find(const std::string& version) const;
+    // Registers a schema under its version(), replacing an earlier one
+    void add(std::shared_ptr<const CompiledSchema> schema);
+    size_t size() const;
+
+private:
+    mutable std::shared_mutex mutex;
+    std::unordered_map<std::string, std::shared_ptr<const CompiledSchema>> byPath;
+    std::unordered_map<std::string, std::shared_ptr<const CompiledSchema>> byVersion;
+};
+
+// Validates a document from SAX events, so it can run alongside a parser
+// instead of walking a finished tree. All applicable subschemas of a value
+// are evaluated side by side; allOf/anyOf/oneOf/not/if branches collect
+// their results separately and are settled when the value ends.
+class SchemaValidator : public nlohmann::json_sax<nlohmann::json> {
+public:
+    // Events return false once maxErrors errors are found, 0 means no limit
+    explicit SchemaValidator(std::shared_ptr<const CompiledSchema> schema, size_t maxErrors = 1);
+    ~SchemaValidator();
+
+    bool valid() const { return errorList.empty() && complete; }
+    const std::vector<SchemaError>& errors() const { return errorList; }
+    // Prepare for another document
+    void reset();
+
+    bool null() override;
+    bool boolean(bool val) override;
+    bool number_integer(number_integer_t val) override;
+    bool number_unsigned(number_unsigned_t val) override;
+    bool number_float(number_float_t val, const string_t& s) override;
+    bool string(string_t& val) override;
+    bool binary(binary_t& val) override;
+    bool start_object(std::size_t elements) override;
+    bool key(string_t& val) override;
+    bool end_object() override;
+    bool start_array(std::size_t elements) override;
+    bool end_array() override;
+    bool parse_error(std::size_t position, const std::string& last_token,
+                     const nlohmann::detail::exception& ex) override;
+
+private:
+    struct Check;
+    struct Sink;
+    struct Resolution;
+    struct Frame;
+    enum class ValueType { Null, Boolean, Integer, Number, String, Object, Array };
+
+    template <typename Make>
+    bool scalar(ValueType type, Make&& make);
+    bool openContainer(ValueType type);
+    bool closeContainer();
+    bool startValue();
+    void prepareItem();
+    void beginValue(ValueType type);
+    void endValue(nlohmann::json* value);
+    void addCheck(const SchemaNode* node, uint32_t sink);
+    void checkScalar(const Check& check, ValueType type, const nlohmann::json& val);
+    void checkContainer(const Check& check, const nlohmann::json* value);
+    void resolve(const Resolution& resolution);
+    uint32_t newSink();
+    void fail(uint32_t sink, std::string message);
+    std::string currentPath() const;
+    bool needsCapture() const;
+    bool keepGoing() const;
+
+    std::shared_ptr<const CompiledSchema> schema;
+    size_t maxErrors;
+    std::vector<SchemaError> errorList;
+    bool complete = false;
+
+    std::vector<Frame> frames;
+    std::vector<Check> checks;
+    std::vector<Sink> sinks;
+    std::vector<Resolution> resolutions;
+    std::vector<uint8_t> flags;
+    // Subschemas that apply to the next value, as (node, sink) pairs
+    std::vector<std::pair<const SchemaNode*, uint32_t>> pending;
+    std::vector<size_t> pendingContains;
+    // Containers below a value no schema applies to are skipped whole
+    size_t inertDepth = 0;
+    // Values built for const/enum/uniqueItems, one per capturing container
+    std::vector<nlohmann::json> captures;
+};
+
+// Passes parse events to a validator and then to another handler, used to
+// validate while the document is being loaded
+class ValidatingSax : public nlohmann::json_sax<nlohmann::json> {
+public:
+    ValidatingSax(SchemaValidator& validator, nlohmann::json_sax<nlohmann::json>& next)
+        : validator(validator), next(next) {}
+
+    bool null() override { return validator.null() && next.null(); }
+    bool boolean(bool val) override { return validator.boolean(val) && next.boolean(val); }
+    bool number_integer(number_integer_t val) override { return validator.number_integer(val) && next.number_integer(val); }
+    bool number_unsigned(number_unsigned_t val) override { return validator.number_unsigned(val) && next.number_unsigned(val); }
+    bool number_float(number_float_t val, const string_t& s) override { return validator.number_float(val, s) && next.number_float(val, s); }
+    bool string(string_t& val) override { return validator.string(val) && next.string(val); }
+    bool binary(binary_t& val) override { return validator.binary(val) && next.binary(val); }
+    bool start_object(std::size_t elements) override { return validator.start_object(elements) && next.start_object(elements); }
+    bool key(string_t& val) override { return validator.key(val) && next.key(val); }
+    bool end_object() override { return validator.end_object() && next.end_object(); }
+    bool start_array(std::size_t elements) override { return validator.start_array(elements) && next.start_array(elements); }
+    bool end_array() override { return validator.end_array() && next.end_array(); }
+    bool parse_error(std::size_t position, const std::string& last_token,
+                     const nlohmann::detail::exception& ex) override {
+        validator.parse_error(position, last_token, ex);
+        return next.parse_error(position, last_token, ex);
+    }
+
+private:
+    SchemaValidator& validator;
+    nlohmann::json_sax<nlohmann::json>& next;
+};
+
+} // namespace mzqc
@@ -0,0 +1,191 @@
+#include "mzqc_sketch.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace mzqc {
+
+static constexpr double pi = 3.14159265358979323846;
+
+// QuantileSketch implementation
+QuantileSketch::QuantileSketch(double compression)
+    : delta(compression),
+      minimum(std::numeric_limits<double>::infinity()),
+      maximum(-std::numeric_limits<double>::infinity()) {
+    if (!(compression >= 10)) {
+        throw std::runtime_error("QuantileSketch compression must be at least 10");
+    }
+    bufferLimit = static_cast<size_t>(compression) * 8;
+    centroids.reserve(static_cast<size_t>(compression) * 2);
+    buffer.reserve(bufferLimit);
+}
+
+void QuantileSketch::add(double value, double weight) {
+    if (std::isnan(value) || !(weight > 0)) return;
+    if (buffer.size() >= bufferLimit) flush();
+    buffer.push_back({value, weight});
+    bufferedWeight += weight;
+    minimum = std::min(minimum, value);
+    maximum = std::max(maximum, value);
+}
+
+void QuantileSketch::add(const double* values, size_t count) {
+    for (size_t i = 0; i < count; ++i) add(values[i]);
+}
+
+void QuantileSketch::merge(const QuantileSketch& other) {
+    other.flush();
+    if (other.centroids.empty()) return;
+    for (const Centroid& c : other.centroids) {
+        if (buffer.size() >= bufferLimit) flush();
+        buffer.push_back(c);
+        bufferedWeight += c.weight;
+    }
+    minimum = std::min(minimum, other.minimum);
+    maximum = std::max(maximum, other.maximum);
+}
+
+// Folds the buffer into the centroids. Neighbours are merged while the
+// centroid spans at most one unit of the k1 scale, k(q) = delta / 2pi * asin(2q - 1),
+// which keeps centroids near q = 0 and q = 1 small. The next limit is clamped
+// to k = delta / 4, the end of the scale: past it the sine turns back and the
+// limit would drop below the weight already merged, leaving every tail value
+// in a centroid of its own.
+void QuantileSketch::flush() const {
+    if (buffer.empty()) return;
+    buffer.insert(buffer.end(), centroids.begin(), centroids.end());
+    std::sort(buffer.begin(), buffer.end(), [](const Centroid& a, const Centroid& b) { return a.mean < b.mean; });
+    const double total = mergedWeight + bufferedWeight;
+    auto scale = [&](double q) { return delta / (2 * pi) * std::asin(2 * q - 1); };
+    auto inverse = [&](double k) { return (std::sin(k * 2 * pi / delta) + 1) / 2; };
+
+    centroids.clear();
+    Centroid current = buffer.front();
+    double before = 0;
+    auto nextLimit = [&](double q) { return total * inverse(std::min(scale(q) + 1, delta / 4)); };
+    double limit = nextLimit(0);
+    for (size_t i = 1; i < buffer.size(); ++i) {
+        const Centroid& next = buffer[i];
+        if (before + current.weight + next.weight <= limit) {
+            double weight = current.weight + next.weight;
+            current.mean += (next.mean - current.mean) * next.weight / weight;
+            current.weight = weight;
+        } else {
+            before += current.weight;
+            centroids.push_back(current);
+            limit = nextLimit(std::min(before / total, 1.0));
+            current = next;
+        }
+    }
+    centroids.push_back(current);
+    buffer.clear();
+    mergedWeight = total;
+    bufferedWeight = 0;
+}
+
+double QuantileSketch::count() const {
+    return mergedWeight + bufferedWeight;
+}
+
+double QuantileSketch::min() const {
+    return empty() ? std::numeric_limits<double>::quiet_NaN() : minimum;
+}
+
+double QuantileSketch::max() const {
+    return empty() ? std::numeric_limits<double>::quiet_NaN() : maximum;
+}
+
+size_t QuantileSketch::centroidCount() const {
+    flush();
+    return centroids.size();
+}
+
+double QuantileSketch::quantile(double q) const {
+    flush();
+    if (centroids.empty()) return std::numeric_limits<double>::quiet_NaN();
+    if (q <= 0 || centroids.size() == 1) return q <= 0 ? minimum : q >= 1 ? maximum : centroids.front().mean;
+    if (q >= 1) return maximum;
+
+    // Each centroid's weight is taken as centred on its mean; the ends
+    // interpolate towards the exact extremes
+    const double index = q * mergedWeight;
+    const Centroid& first = centroids.front();
+    if (index < first.weight / 2) {
+        return minimum + (first.mean - minimum) * index / (first.weight / 2);
+    }
+    double before = first.weight / 2;
+    for (size_t i = 0; i + 1 < centroids.size(); ++i) {
+        double span = (centroids[i].weight + centroids[i + 1].weight) / 2;
+        if (before + span > index) {
+            double z = (index - before) / span;
+            return centroids[i].mean + z * (centroids[i + 1].mean - centroids[i].mean);
+        }
+        before += span;
+    }
+    const Centroid& last = centroids.back();
+    double z = std::min((index - before) / (last.weight / 2), 1.0);
+    return last.mean + z * (maximum - last.mean);
+}
+
+std::vector<double> QuantileSketch::quantiles(const std::vector<double>& levels) const {
+    std::vector<double> out;
+    out.reserve(levels.size());
+    for (double q : levels) out.push_back(quantile(q));
+    return out;
+}
+
+nlohmann::json QuantileSketch::toJson() const {
+    flush();
+    std::vector<double> means;
+    std::vector<double> weights;
+    means.reserve(centroids.size());
+    weights.reserve(centroids.size());
+    for (const Centroid& c : centroids) {
+        means.push_back(c.mean);
+        weights.push_back(c.weight);
+    }
+    nlohmann::json j = {
+        {"compression", delta},
+        {"count", mergedWeight},
+        {"mean", means},
+        {"weight", weights},
+    };
+    // NaN would be written as null
+    if (!centroids.empty()) {
+        j["min"] = minimum;
+        j["max"] = maximum;
+    }
+    return j;
+}
+
+QuantileSketch QuantileSketch::fromJson(const nlohmann::json& j) {
+    if (!j.is_object() || !j.contains("compression") || !j.contains("mean") || !j.contains("weight")) {
+        throw std::runtime_error("Not a quantile sketch");
+    }
+    const auto& means = j.at("mean");
+    const auto& weights = j.at("weight");
+    if (!means.is_array() || !weights.is_array() || means.size() != weights.size()) {
+        throw std::runtime_error("Quantile sketch mean and weight must be arrays of equal length");
+    }
+    QuantileSketch sketch(j.at("compression").get<double>());
+    if (means.empty()) return sketch;
+
+    for (size_t i = 0; i < means.size(); ++i) {
+        double mean = means[i].get<double>();
+        double weight = weights[i].get<double>();
+        if (std::isnan(mean) || !(weight > 0)) {
+            throw std::runtime_error("Invalid quantile sketch centroid");
+        }
+        if (!sketch.centroids.empty() && mean < sketch.centroids.back().mean) {
+            throw std::runtime_error("Quantile sketch centroids are not sorted");
+        }
+        sketch.centroids.push_back({mean, weight});
+        sketch.mergedWeight += weight;
+    }
+    sketch.minimum = j.value("min", sketch.centroids.front().mean);
+    sketch.maximum = j.value("max", sketch.centroids.back().mean);
+    return sketch;
+}
+
+} // namespace mzqc
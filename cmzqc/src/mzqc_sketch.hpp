@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+namespace mzqc {
+
+// Mergeable streaming quantile estimate (merging t-digest). Values are
+// buffered and periodically folded into at most ~compression centroids, so
+// memory stays constant however many values are added; accuracy is best
+// near the tails. Sketches of different runs can be merged without the raw
+// data. Minimum and maximum are exact. Queries fold the buffer in, so a
+// sketch must not be used from several threads at once, even through const.
+class QuantileSketch {
+public:
+    explicit QuantileSketch(double compression = 100);
+
+    // NaN values are ignored
+    void add(double value, double weight = 1);
+    void add(const double* values, size_t count);
+    // The other sketch may use a different compression, the result keeps this one
+    void merge(const QuantileSketch& other);
+
+    double compression() const { return delta; }
+    bool empty() const { return count() == 0; }
+    // Total weight added
+    double count() const;
+    // NaN if empty
+    double min() const;
+    double max() const;
+    // Estimated value at level q in [0, 1], NaN if empty
+    double quantile(double q) const;
+    std::vector<double> quantiles(const std::vector<double>& levels) const;
+    size_t centroidCount() const;
+
+    // {"compression", "count", "min", "max", "mean": [...], "weight": [...]},
+    // suitable as the value of a QualityMetric
+    nlohmann::json toJson() const;
+    // Throws std::runtime_error if the json is not a sketch
+    static QuantileSketch fromJson(const nlohmann::json& j);
+
+private:
+    struct Centroid {
+        double mean;
+        double weight;
+    };
+
+    void flush() const;
+
+    double delta;
+    size_t bufferLimit;
+    double minimum;
+    double maximum;
+    // Sorted by mean after flush()
+    mutable std::vector<Centroid> centroids;
+    mutable std::vector<Centroid> buffer;
+    // Weight in centroids and in the buffer
+    mutable double mergedWeight = 0;
+    mutable double bufferedWeight = 0;
+};
+
+} // namespace mzqc
@@ -0,0 +1,147 @@
+#include "mzqc_stats.hpp"
+#include <utility>
+
+namespace mzqc {
+
+const char* statsPhaseName(StatsPhase phase) {
+    switch (phase) {
+        case StatsPhase::Total:
+            return "total";
+        case StatsPhase::Read:
+            return "read";
+        case StatsPhase::Parse:
+            return "parse";
+        case StatsPhase::Validate:
+            return "validate";
+        case StatsPhase::ToJson:
+            return "toJson";
+        case StatsPhase::Serialize:
+            return "serialize";
+        case StatsPhase::Write:
+            return "write";
+    }
+    return "unknown";
+}
+
+// Stats implementation
+Stats& Stats::global() {
+    static Stats stats;
+    return stats;
+}
+
+void Stats::setSink(Sink newSink) {
+    std::lock_guard<std::mutex> lock(mutex);
+    sink = std::move(newSink);
+}
+
+void Stats::setAllocationCounter(uint64_t (*counter)()) {
+    allocationCounter.store(counter, std::memory_order_relaxed);
+}
+
+uint64_t Stats::allocations() const {
+    auto counter = allocationCounter.load(std::memory_order_relaxed);
+    return counter ? counter() : 0;
+}
+
+void Stats::record(const StatsRecord& record) {
+    std::lock_guard<std::mutex> lock(mutex);
+    StatsTotals& total = sums[std::string(record.operation) + "/" + statsPhaseName(record.phase)];
+    ++total.calls;
+    total.nanoseconds += record.nanoseconds;
+    total.bytes += record.bytes;
+    total.nodes += record.nodes;
+    total.metrics += record.metrics;
+    total.allocations += record.allocations;
+    if (sink) sink(record);
+}
+
+std::map<std::string, StatsTotals> Stats::totals() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return sums;
+}
+
+void Stats::reset() {
+    std::lock_guard<std::mutex> lock(mutex);
+    sums.clear();
+}
+
+#ifdef MZQC_ENABLE_STATS
+
+static thread_local StatsScope* currentScope = nullptr;
+static thread_local bool phaseRunning = false;
+
+static uint64_t elapsed(std::chrono::steady_clock::time_point since) {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - since).count());
+}
+
+// StatsScope implementation
+StatsScope::StatsScope(const char* operation, StatsPhase remainder)
+    : operation(operation),
+      remainder(remainder),
+      start(std::chrono::steady_clock::now()),
+      allocationsAtStart(Stats::global().allocations()),
+      outer(currentScope) {
+    currentScope = this;
+}
+
+StatsScope::~StatsScope() {
+    currentScope = outer;
+    Stats& stats = Stats::global();
+    const uint64_t total = elapsed(start);
+
+    StatsRecord record;
+    record.operation = operation;
+    record.nanoseconds = total;
+    record.nodes = nodes;
+    record.metrics = metrics;
+    record.allocations = stats.allocations() - allocationsAtStart;
+    uint64_t attributed = 0;
+    record.bytes = bytes;
+    for (size_t i = 0; i < statsPhaseCount; ++i) {
+        attributed += phaseTime[i];
+        if (bytes == 0) record.bytes += phaseBytes[i];
+    }
+    stats.record(record);
+
+    phaseTime[static_cast<size_t>(remainder)] += total > attributed ? total - attributed : 0;
+    if (phaseBytes[static_cast<size_t>(remainder)] == 0) phaseBytes[static_cast<size_t>(remainder)] = record.bytes;
+    for (size_t i = 1; i < statsPhaseCount; ++i) {
+        if (phaseTime[i] == 0 && phaseBytes[i] == 0) continue;
+        StatsRecord phase;
+        phase.operation = operation;
+        phase.phase = static_cast<StatsPhase>(i);
+        phase.nanoseconds = phaseTime[i];
+        phase.bytes = phaseBytes[i];
+        stats.record(phase);
+    }
+}
+
+StatsScope* StatsScope::current() {
+    return currentScope;
+}
+
+void StatsScope::addPhase(StatsPhase phase, uint64_t nanoseconds, uint64_t phaseByteCount) {
+    phaseTime[static_cast<size_t>(phase)] += nanoseconds;
+    phaseBytes[static_cast<size_t>(phase)] += phaseByteCount;
+}
+
+// StatsPhaseTimer implementation
+StatsPhaseTimer::StatsPhaseTimer(StatsPhase phase, uint64_t bytes)
+    : bytes(bytes), phase(phase), active(currentScope && !phaseRunning) {
+    if (active) {
+        phaseRunning = true;
+        start = std::chrono::steady_clock::now();
+    }
+}
+
+StatsPhaseTimer::~StatsPhaseTimer() {
+    if (!active) return;
+    phaseRunning = false;
+    // The scope is still open, timers live inside it
+    currentScope->addPhase(phase, elapsed(start), bytes);
+}
+
+#endif
+
+} // namespace mzqc
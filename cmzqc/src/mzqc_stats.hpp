@@ -0,0 +1,143 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace mzqc {
+
+// Parts of a load or store operation. The streaming loaders read, parse,
+// validate and build objects in one pass: their parse phase includes
+// building, and validation when a schema is given; read covers file reads
+// and decompression. validateAgainstSchema reports validation on its own.
+enum class StatsPhase { Total, Read, Parse, Validate, ToJson, Serialize, Write };
+constexpr size_t statsPhaseCount = 7;
+const char* statsPhaseName(StatsPhase phase);
+
+// One finished operation (phase Total) or one of its phases
+struct StatsRecord {
+    // "fromFile", "fromStream", "loadMany", "fromFileParallel", "loadAsync",
+    // "toFile", "saveAsync", "validateAgainstSchema" or "parseOboFile"
+    const char* operation = "";
+    StatsPhase phase = StatsPhase::Total;
+    uint64_t nanoseconds = 0;
+    uint64_t bytes = 0;
+    // JSON values parsed or OBO terms read, Total records only
+    uint64_t nodes = 0;
+    uint64_t metrics = 0;
+    // Total records only, zero without an allocation counter
+    uint64_t allocations = 0;
+};
+
+struct StatsTotals {
+    uint64_t calls = 0;
+    uint64_t nanoseconds = 0;
+    uint64_t bytes = 0;
+    uint64_t nodes = 0;
+    uint64_t metrics = 0;
+    uint64_t allocations = 0;
+};
+
+// Collects the records of instrumented operations. Instrumentation is
+// compiled in only with MZQC_ENABLE_STATS (cmake -DMZQC_ENABLE_STATS=ON);
+// otherwise nothing is ever recorded and the hooks cost nothing.
+class Stats {
+public:
+#ifdef MZQC_ENABLE_STATS
+    static constexpr bool enabled = true;
+#else
+    static constexpr bool enabled = false;
+#endif
+    using Sink = std::function<void(const StatsRecord&)>;
+
+    static Stats& global();
+
+    // Called for every record, on the thread that finished the operation and
+    // under a lock, e.g. to forward to a metrics exporter
+    void setSink(Sink sink);
+    // The library cannot see allocations itself; a program that counts them,
+    // e.g. in a replaced operator new, can supply the running count here
+    void setAllocationCounter(uint64_t (*counter)());
+    uint64_t allocations() const;
+
+    void record(const StatsRecord& record);
+    // Sums keyed by "operation/phase", e.g. "fromFile/read"
+    std::map<std::string, StatsTotals> totals() const;
+    void reset();
+
+private:
+    mutable std::mutex mutex;
+    Sink sink;
+    std::atomic<uint64_t (*)()> allocationCounter{nullptr};
+    std::map<std::string, StatsTotals> sums;
+};
+
+#ifdef MZQC_ENABLE_STATS
+
+// Times one operation on the calling thread. Phase timers and counters
+// started on the same thread while it is open are added to it; the time it
+// does not attribute to a phase goes to its remainder phase. Records are
+// emitted when it closes.
+class StatsScope {
+public:
+    StatsScope(const char* operation, StatsPhase remainder);
+    ~StatsScope();
+    StatsScope(const StatsScope&) = delete;
+    StatsScope& operator=(const StatsScope&) = delete;
+
+    // Innermost open scope of this thread, nullptr if none
+    static StatsScope* current();
+
+    void addPhase(StatsPhase phase, uint64_t nanoseconds, uint64_t bytes);
+
+    // Bytes of the whole operation; if left at zero, the phase bytes are summed
+    uint64_t bytes = 0;
+    uint64_t nodes = 0;
+    uint64_t metrics = 0;
+
+private:
+    const char* operation;
+    StatsPhase remainder;
+    std::chrono::steady_clock::time_point start;
+    uint64_t allocationsAtStart;
+    StatsScope* outer;
+    uint64_t phaseTime[statsPhaseCount] = {};
+    uint64_t phaseBytes[statsPhaseCount] = {};
+};
+
+// Adds its lifetime to a phase of the current scope. A timer started while
+// another one runs on the thread is ignored, so nested I/O is counted once.
+class StatsPhaseTimer {
+public:
+    explicit StatsPhaseTimer(StatsPhase phase, uint64_t bytes = 0);
+    ~StatsPhaseTimer();
+    StatsPhaseTimer(const StatsPhaseTimer&) = delete;
+    StatsPhaseTimer& operator=(const StatsPhaseTimer&) = delete;
+
+    uint64_t bytes;
+
+private:
+    StatsPhase phase;
+    bool active;
+    std::chrono::steady_clock::time_point start;
+};
+
+#define MZQC_STATS_SCOPE(operation, remainder) \
+    ::mzqc::StatsScope mzqcStatsScope(operation, ::mzqc::StatsPhase::remainder)
+#define MZQC_STATS_JOIN2(a, b) a##b
+#define MZQC_STATS_JOIN(a, b) MZQC_STATS_JOIN2(a, b)
+#define MZQC_STATS_PHASE(phase, bytes) \
+    ::mzqc::StatsPhaseTimer MZQC_STATS_JOIN(mzqcStatsPhase, __LINE__)(::mzqc::StatsPhase::phase, bytes)
+
+#else
+
+#define MZQC_STATS_SCOPE(operation, remainder) static_cast<void>(0)
+#define MZQC_STATS_PHASE(phase, bytes) static_cast<void>(0)
+
+#endif
+
+} // namespace mzqc
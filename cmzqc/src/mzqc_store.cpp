@@ -0,0 +1,590 @@
+#include "mzqc_store.hpp"
+#include "mzqc_mmap.hpp"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+
+namespace mzqc {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr char segmentMagic[4] = {'M', 'Z', 'Q', 'S'};
+constexpr uint32_t segmentVersion = 1;
+constexpr int storeFormat = 1;
+constexpr int64_t secondsPerDay = 86400;
+
+// Fixed part of a segment, followed by bodyBytes of data: the smallest and
+// largest label, then the time, value and label offset columns and the
+// label characters, each section padded to 8 bytes
+struct SegmentHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t rows;
+    uint32_t labelBytes;
+    int64_t minTime;
+    int64_t maxTime;
+    double minValue;
+    double maxValue;
+    uint32_t minLabelLength;
+    uint32_t maxLabelLength;
+    uint64_t bodyBytes;
+};
+static_assert(sizeof(SegmentHeader) == 64, "segment header layout");
+
+size_t padded(size_t n) {
+    return (n + 7) & ~size_t(7);
+}
+
+int64_t floorDiv(int64_t a, int64_t b) {
+    int64_t q = a / b;
+    return (a % b != 0 && ((a < 0) != (b < 0))) ? q - 1 : q;
+}
+
+// Days since 1970-01-01 of a proleptic Gregorian date
+int64_t daysFromCivil(int64_t y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    const int64_t era = floorDiv(y, 400);
+    const unsigned yoe = static_cast<unsigned>(y - era * 400);
+    const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+bool digits(const std::string& text, size_t pos, size_t count, int& out) {
+    if (pos + count > text.size()) return false;
+    out = 0;
+    for (size_t i = pos; i < pos + count; ++i) {
+        if (text[i] < '0' || text[i] > '9') return false;
+        out = out * 10 + (text[i] - '0');
+    }
+    return true;
+}
+
+bool startsWith(std::string_view text, std::string_view prefix) {
+    return text.size() >= prefix.size() && text.compare(0, prefix.size(), prefix) == 0;
+}
+
+// Accessions contain ':', which is not portable in file names
+std::string escapeName(const std::string& name) {
+    static const char hex[] = "0123456789ABCDEF";
+    std::string out;
+    for (unsigned char c : name) {
+        if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') ||
+            c == '.' || c == '-' || c == '_') {
+            out += static_cast<char>(c);
+        } else {
+            out += '%';
+            out += hex[c >> 4];
+            out += hex[c & 15];
+        }
+    }
+    return out;
+}
+
+std::string unescapeName(const std::string& name) {
+    std::string out;
+    for (size_t i = 0; i < name.size(); ++i) {
+        if (name[i] == '%' && i + 2 < name.size()) {
+            out += static_cast<char>(std::stoi(name.substr(i + 1, 2), nullptr, 16));
+            i += 2;
+        } else {
+            out += name[i];
+        }
+    }
+    return out;
+}
+
+bool parsePartition(const fs::path& path, int64_t& partition) {
+    if (path.extension() != ".seg") return false;
+    const std::string stem = path.stem().string();
+    if (stem.empty()) return false;
+    size_t used = 0;
+    try {
+        partition = std::stoll(stem, &used);
+    } catch (const std::exception&) {
+        return false;
+    }
+    return used == stem.size();
+}
+
+// Single number of a metric value, false for anything else
+bool scalarValue(const MetricValue& value, double& out) {
+    if (const nlohmann::json* j = value.json()) {
+        if (!j->is_number()) return false;
+        out = j->get<double>();
+        return true;
+    }
+    if (const auto* d = value.doubles()) {
+        if (d->size() != 1) return false;
+        out = d->front();
+        return true;
+    }
+    if (const auto* i = value.integers()) {
+        if (i->size() != 1) return false;
+        out = static_cast<double>(i->front());
+        return true;
+    }
+    return false;
+}
+
+// A complete segment inside a mapped partition file
+struct SegmentView {
+    SegmentHeader header;
+    std::string_view minLabel;
+    std::string_view maxLabel;
+    const char* times;
+    const char* values;
+    const char* offsets;
+    const char* labels;
+
+    int64_t time(size_t i) const {
+        int64_t t;
+        std::memcpy(&t, times + i * sizeof(t), sizeof(t));
+        return t;
+    }
+    double value(size_t i) const {
+        double v;
+        std::memcpy(&v, values + i * sizeof(v), sizeof(v));
+        return v;
+    }
+    std::string_view label(size_t i) const {
+        uint32_t range[2];
+        std::memcpy(range, offsets + i * sizeof(uint32_t), sizeof(range));
+        return std::string_view(labels + range[0], range[1] - range[0]);
+    }
+};
+
+// Calls visit for every complete segment and returns the end of the last
+// one; anything after it is a torn or foreign tail
+template <typename Visit>
+size_t forEachSegment(std::string_view data, Visit&& visit) {
+    size_t pos = 0;
+    while (data.size() - pos >= sizeof(SegmentHeader)) {
+        SegmentView segment;
+        std::memcpy(&segment.header, data.data() + pos, sizeof(SegmentHeader));
+        const SegmentHeader& h = segment.header;
+        if (std::memcmp(h.magic, segmentMagic, sizeof(segmentMagic)) != 0 || h.version != segmentVersion) break;
+        const size_t labelRange = padded(size_t(h.minLabelLength) + h.maxLabelLength);
+        const size_t expected = labelRange + padded(size_t(h.rows) * 8) * 2 +
+                                padded((size_t(h.rows) + 1) * 4 + h.labelBytes);
+        if (h.bodyBytes != expected || h.bodyBytes > data.size() - pos - sizeof(SegmentHeader)) break;
+
+        const char* body = data.data() + pos + sizeof(SegmentHeader);
+        segment.minLabel = std::string_view(body, h.minLabelLength);
+        segment.maxLabel = std::string_view(body + h.minLabelLength, h.maxLabelLength);
+        segment.times = body + labelRange;
+        segment.values = segment.times + padded(size_t(h.rows) * 8);
+        segment.offsets = segment.values + padded(size_t(h.rows) * 8);
+        segment.labels = segment.offsets + (size_t(h.rows) + 1) * 4;
+        visit(segment);
+        pos += sizeof(SegmentHeader) + h.bodyBytes;
+    }
+    return pos;
+}
+
+template <typename T>
+void appendBytes(std::string& out, const T* data, size_t count) {
+    out.append(reinterpret_cast<const char*>(data), count * sizeof(T));
+}
+
+void padTo8(std::string& out) {
+    out.resize(padded(out.size()), '\0');
+}
+
+template <typename Row>
+std::string encodeSegment(const std::vector<Row>& rows) {
+    SegmentHeader h{};
+    std::memcpy(h.magic, segmentMagic, sizeof(segmentMagic));
+    h.version = segmentVersion;
+    h.rows = static_cast<uint32_t>(rows.size());
+
+    std::vector<int64_t> times;
+    std::vector<double> values;
+    std::vector<uint32_t> offsets{0};
+    std::string labels;
+    times.reserve(rows.size());
+    values.reserve(rows.size());
+    offsets.reserve(rows.size() + 1);
+    const std::string* minLabel = &rows.front().label;
+    const std::string* maxLabel = &rows.front().label;
+    h.minTime = h.maxTime = rows.front().time;
+    h.minValue = h.maxValue = rows.front().value;
+    for (const auto& row : rows) {
+        times.push_back(row.time);
+        values.push_back(row.value);
+        labels += row.label;
+        if (labels.size() > UINT32_MAX) throw std::runtime_error("Metric store segment too large");
+        offsets.push_back(static_cast<uint32_t>(labels.size()));
+        h.minTime = std::min(h.minTime, row.time);
+        h.maxTime = std::max(h.maxTime, row.time);
+        // NaN values never leave the zone map range
+        h.minValue = std::min(h.minValue, row.value);
+        h.maxValue = std::max(h.maxValue, row.value);
+        if (row.label < *minLabel) minLabel = &row.label;
+        if (*maxLabel < row.label) maxLabel = &row.label;
+    }
+    h.labelBytes = static_cast<uint32_t>(labels.size());
+    h.minLabelLength = static_cast<uint32_t>(minLabel->size());
+    h.maxLabelLength = static_cast<uint32_t>(maxLabel->size());
+
+    std::string body;
+    body += *minLabel;
+    body += *maxLabel;
+    padTo8(body);
+    appendBytes(body, times.data(), times.size());
+    padTo8(body);
+    appendBytes(body, values.data(), values.size());
+    padTo8(body);
+    appendBytes(body, offsets.data(), offsets.size());
+    body += labels;
+    padTo8(body);
+    h.bodyBytes = body.size();
+
+    std::string out(reinterpret_cast<const char*>(&h), sizeof(h));
+    out += body;
+    return out;
+}
+
+std::vector<std::pair<int64_t, fs::path>> partitionFiles(const fs::path& directory) {
+    std::vector<std::pair<int64_t, fs::path>> files;
+    std::error_code error;
+    for (const auto& entry : fs::directory_iterator(directory, error)) {
+        int64_t partition = 0;
+        if (entry.is_regular_file() && parsePartition(entry.path(), partition)) {
+            files.emplace_back(partition, entry.path());
+        }
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+double median(std::vector<double>& values) {
+    const size_t mid = values.size() / 2;
+    std::nth_element(values.begin(), values.begin() + mid, values.end());
+    double upper = values[mid];
+    if (values.size() % 2 == 1) return upper;
+    double lower = *std::max_element(values.begin(), values.begin() + mid);
+    return (lower + upper) / 2;
+}
+
+} // namespace
+
+bool parseIsoTime(const std::string& text, int64_t& seconds) {
+    int year, month, day, hour, minute, second;
+    if (!digits(text, 0, 4, year) || text.size() < 19 || text[4] != '-' || !digits(text, 5, 2, month) ||
+        text[7] != '-' || !digits(text, 8, 2, day) || (text[10] != 'T' && text[10] != ' ') ||
+        !digits(text, 11, 2, hour) || text[13] != ':' || !digits(text, 14, 2, minute) || text[16] != ':' ||
+        !digits(text, 17, 2, second)) {
+        return false;
+    }
+    if (month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60) return false;
+
+    size_t pos = 19;
+    // Fractions of a second are dropped
+    if (pos < text.size() && text[pos] == '.') {
+        ++pos;
+        const size_t start = pos;
+        while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9') ++pos;
+        if (pos == start) return false;
+    }
+    int64_t offset = 0;
+    if (pos < text.size() && text[pos] == 'Z') {
+        ++pos;
+    } else if (pos < text.size() && (text[pos] == '+' || text[pos] == '-')) {
+        int offsetHour, offsetMinute;
+        if (!digits(text, pos + 1, 2, offsetHour)) return false;
+        size_t minutes = pos + 3 < text.size() && text[pos + 3] == ':' ? pos + 4 : pos + 3;
+        if (!digits(text, minutes, 2, offsetMinute)) return false;
+        offset = (offsetHour * 60 + offsetMinute) * 60;
+        if (text[pos] == '-') offset = -offset;
+        pos = minutes + 2;
+    }
+    // Without a zone designator the time is taken as UTC
+    if (pos != text.size()) return false;
+
+    seconds = daysFromCivil(year, static_cast<unsigned>(month), static_cast<unsigned>(day)) * secondsPerDay +
+              hour * 3600 + minute * 60 + second - offset;
+    return true;
+}
+
+// Rows of one ingest grouped by accession and partition
+struct MetricStore::Batch {
+    std::map<std::pair<std::string, int64_t>, std::vector<Row>> partitions;
+};
+
+// MetricStore implementation
+MetricStore::MetricStore(const std::string& directory, const MetricStoreOptions& options)
+    : root(directory), days(options.partitionDays), threads(options.threads) {
+    std::error_code error;
+    fs::create_directories(root, error);
+    if (error) {
+        throw std::runtime_error("Could not create metric store directory: " + root);
+    }
+
+    const fs::path settings = fs::path(root) / "store.json";
+    std::ifstream in(settings);
+    if (in) {
+        nlohmann::json j;
+        try {
+            in >> j;
+        } catch (const nlohmann::json::exception& e) {
+            throw std::runtime_error("Invalid metric store settings " + settings.string() + ": " + e.what());
+        }
+        if (j.value("format", 0) != storeFormat) {
+            throw std::runtime_error("Unsupported metric store format in " + settings.string());
+        }
+        days = j.value("partitionDays", 0u);
+    } else {
+        std::ofstream out(settings);
+        out << nlohmann::json{{"format", storeFormat}, {"partitionDays", days}}.dump(2) << '\n';
+        if (!out) {
+            throw std::runtime_error("Could not write metric store settings: " + settings.string());
+        }
+    }
+    if (days == 0) {
+        throw std::runtime_error("Metric store partitionDays must be positive");
+    }
+}
+
+std::string MetricStore::partitionPath(const std::string& accession, int64_t partition) const {
+    return (fs::path(root) / escapeName(accession) / (std::to_string(partition) + ".seg")).string();
+}
+
+void MetricStore::collect(const MzQCFile& file, Batch& batch, MetricIngestStats& stats) const {
+    int64_t time = 0;
+    if (!parseIsoTime(file.creationDate, time)) {
+        throw std::runtime_error("Invalid creationDate: " + file.creationDate);
+    }
+    const int64_t partition = floorDiv(time, int64_t(days) * secondsPerDay);
+    ++stats.files;
+    for (const auto& run : file.runQualities) {
+        ++stats.runs;
+        for (const auto& metric : run->metrics) {
+            double value;
+            if (!scalarValue(metric->value, value)) {
+                ++stats.skipped;
+                continue;
+            }
+            batch.partitions[{metric->accession.str(), partition}].push_back({time, value, run->label});
+            ++stats.values;
+        }
+    }
+}
+
+void MetricStore::write(Batch& batch) {
+    for (auto& [key, rows] : batch.partitions) {
+        const fs::path path = partitionPath(key.first, key.second);
+        std::error_code error;
+        fs::create_directories(path.parent_path(), error);
+        if (error) {
+            throw std::runtime_error("Could not create metric store directory: " + path.parent_path().string());
+        }
+
+        // Drop a tail left by an interrupted write so the new segment stays reachable
+        if (fs::exists(path)) {
+            size_t valid;
+            size_t size;
+            {
+                MappedFile mapped(path.string());
+                if (!mapped.isOpen()) throw std::runtime_error("Could not open metric store partition: " + path.string());
+                size = mapped.size();
+                valid = forEachSegment(mapped.view(), [](const SegmentView&) {});
+            }
+            if (valid != size) fs::resize_file(path, valid);
+        }
+
+        std::stable_sort(rows.begin(), rows.end(), [](const Row& a, const Row& b) { return a.time < b.time; });
+        const std::string segment = encodeSegment(rows);
+        std::ofstream out(path, std::ios::binary | std::ios::app);
+        out.write(segment.data(), static_cast<std::streamsize>(segment.size()));
+        out.close();
+        if (!out) {
+            throw std::runtime_error("Could not write metric store partition: " + path.string());
+        }
+    }
+}
+
+MetricIngestStats MetricStore::ingest(const MzQCFile& file) {
+    MetricIngestStats stats;
+    Batch batch;
+    collect(file, batch, stats);
+    write(batch);
+    return stats;
+}
+
+MetricIngestStats MetricStore::ingestFiles(const std::vector<std::string>& paths) {
+    MzQCLoadOptions options;
+    options.threads = threads;
+    MetricIngestStats stats;
+    Batch batch;
+    for (const auto& result : MzQCFile::loadMany(paths, options)) {
+        if (!result.file) {
+            throw std::runtime_error(result.path + ": " + result.error);
+        }
+        try {
+            collect(*result.file, batch, stats);
+        } catch (const std::runtime_error& e) {
+            throw std::runtime_error(result.path + ": " + e.what());
+        }
+    }
+    write(batch);
+    return stats;
+}
+
+MetricRows MetricStore::query(const MetricQuery& query, MetricScanStats* stats) const {
+    MetricScanStats scan;
+    MetricRows rows;
+    const int64_t width = int64_t(days) * secondsPerDay;
+    const std::string_view prefix = query.labelPrefix;
+
+    for (const auto& [partition, path] : partitionFiles(fs::path(root) / escapeName(query.accession))) {
+        ++scan.partitions;
+        // Partition covers [partition * width, (partition + 1) * width)
+        const int64_t first = partition * width;
+        if (query.to <= first || floorDiv(query.from, width) > partition) {
+            ++scan.partitionsPruned;
+            continue;
+        }
+        MappedFile mapped(path.string());
+        if (!mapped.isOpen()) {
+            throw std::runtime_error("Could not open metric store partition: " + path.string());
+        }
+        forEachSegment(mapped.view(), [&](const SegmentView& segment) {
+            ++scan.segments;
+            const SegmentHeader& h = segment.header;
+            // A label outside [minLabel, maxLabel] cannot start with the prefix
+            if (h.maxTime < query.from || h.minTime >= query.to || segment.maxLabel < prefix ||
+                segment.minLabel.substr(0, prefix.size()) > prefix) {
+                ++scan.segmentsPruned;
+                return;
+            }
+            for (size_t i = 0; i < h.rows; ++i) {
+                const int64_t time = segment.time(i);
+                if (time < query.from || time >= query.to) continue;
+                const std::string_view label = segment.label(i);
+                if (!startsWith(label, prefix)) continue;
+                rows.times.push_back(time);
+                rows.labels.emplace_back(label);
+                rows.values.push_back(segment.value(i));
+            }
+            scan.rows += h.rows;
+        });
+    }
+
+    // Segments are each in time order but may overlap one another
+    if (!std::is_sorted(rows.times.begin(), rows.times.end())) {
+        std::vector<size_t> order(rows.times.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(),
+                         [&](size_t a, size_t b) { return rows.times[a] < rows.times[b]; });
+        MetricRows sorted;
+        sorted.times.reserve(order.size());
+        sorted.labels.reserve(order.size());
+        sorted.values.reserve(order.size());
+        for (size_t i : order) {
+            sorted.times.push_back(rows.times[i]);
+            sorted.labels.push_back(std::move(rows.labels[i]));
+            sorted.values.push_back(rows.values[i]);
+        }
+        rows = std::move(sorted);
+    }
+    if (stats) *stats = scan;
+    return rows;
+}
+
+std::vector<MetricTrendPoint> MetricStore::trend(const MetricQuery& query, int64_t bucketSeconds,
+                                                 MetricScanStats* stats) const {
+    if (bucketSeconds <= 0) {
+        throw std::runtime_error("Trend bucket width must be positive");
+    }
+    const MetricRows rows = this->query(query, stats);
+    std::vector<MetricTrendPoint> points;
+    std::vector<double> bucket;
+    // Rows are in time order, so buckets are contiguous
+    for (size_t i = 0; i < rows.times.size();) {
+        const int64_t start = floorDiv(rows.times[i], bucketSeconds) * bucketSeconds;
+        bucket.clear();
+        for (; i < rows.times.size() && floorDiv(rows.times[i], bucketSeconds) * bucketSeconds == start; ++i) {
+            bucket.push_back(rows.values[i]);
+        }
+        MetricTrendPoint point;
+        point.start = start;
+        point.count = bucket.size();
+        point.min = *std::min_element(bucket.begin(), bucket.end());
+        point.max = *std::max_element(bucket.begin(), bucket.end());
+        point.mean = std::accumulate(bucket.begin(), bucket.end(), 0.0) / bucket.size();
+        point.median = median(bucket);
+        points.push_back(point);
+    }
+    return points;
+}
+
+std::vector<std::string> MetricStore::accessions() const {
+    std::vector<std::string> out;
+    std::error_code error;
+    for (const auto& entry : fs::directory_iterator(root, error)) {
+        if (entry.is_directory() && !partitionFiles(entry.path()).empty()) {
+            out.push_back(unescapeName(entry.path().filename().string()));
+        }
+    }
+    if (error) {
+        throw std::runtime_error("Could not read metric store directory: " + root);
+    }
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+void MetricStore::compact() {
+    std::error_code error;
+    for (const auto& entry : fs::directory_iterator(root, error)) {
+        if (!entry.is_directory()) continue;
+        for (const auto& [partition, path] : partitionFiles(entry.path())) {
+            std::vector<Row> rows;
+            size_t segments = 0;
+            size_t valid;
+            size_t size;
+            {
+                MappedFile mapped(path.string());
+                if (!mapped.isOpen()) {
+                    throw std::runtime_error("Could not open metric store partition: " + path.string());
+                }
+                size = mapped.size();
+                valid = forEachSegment(mapped.view(), [&](const SegmentView& segment) {
+                    ++segments;
+                    for (size_t i = 0; i < segment.header.rows; ++i) {
+                        rows.push_back({segment.time(i), segment.value(i), std::string(segment.label(i))});
+                    }
+                });
+            }
+            if (segments == 1 && valid == size) continue;
+            if (rows.empty()) {
+                fs::remove(path);
+                continue;
+            }
+
+            std::stable_sort(rows.begin(), rows.end(), [](const Row& a, const Row& b) { return a.time < b.time; });
+            const std::string segment = encodeSegment(rows);
+            // Replace the partition atomically so a crash leaves either version
+            const fs::path temp = path.string() + ".tmp";
+            std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+            out.write(segment.data(), static_cast<std::streamsize>(segment.size()));
+            out.close();
+            if (!out) {
+                throw std::runtime_error("Could not write metric store partition: " + temp.string());
+            }
+            fs::rename(temp, path);
+        }
+    }
+    if (error) {
+        throw std::runtime_error("Could not read metric store directory: " + root);
+    }
+}
+
+} // namespace mzqc
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "mzqc.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace mzqc {
+
+// Seconds since the epoch of an ISO 8601 date-time such as an mzQC
+// creationDate ("2024-03-04T12:30:00Z", fractions and offsets allowed).
+// Returns false if the text is not one.
+bool parseIsoTime(const std::string& text, int64_t& seconds);
+
+struct MetricStoreOptions {
+    // Width of the time partitions of a new store; an existing store keeps its own
+    unsigned partitionDays = 7;
+    // Worker threads for ingestFiles, 0 uses ThreadPool::shared()
+    unsigned threads = 0;
+};
+
+struct MetricIngestStats {
+    size_t files = 0;
+    size_t runs = 0;
+    // Scalar numeric metrics stored
+    size_t values = 0;
+    // Metrics whose value is not a single number
+    size_t skipped = 0;
+};
+
+// Selects values of one accession. Time bounds are creationDate seconds
+// since the epoch, from inclusive and to exclusive.
+struct MetricQuery {
+    std::string accession;
+    int64_t from = std::numeric_limits<int64_t>::min();
+    int64_t to = std::numeric_limits<int64_t>::max();
+    // Only runs whose label starts with this, e.g. an instrument prefix
+    std::string labelPrefix;
+};
+
+struct MetricRows {
+    std::vector<int64_t> times;
+    std::vector<std::string> labels;
+    std::vector<double> values;
+};
+
+struct MetricScanStats {
+    size_t partitions = 0;
+    size_t partitionsPruned = 0;
+    size_t segments = 0;
+    size_t segmentsPruned = 0;
+    size_t rows = 0;
+};
+
+// Aggregate of the values whose time falls in [start, start + bucketSeconds)
+struct MetricTrendPoint {
+    int64_t start = 0;
+    size_t count = 0;
+    double min = 0;
+    double max = 0;
+    double mean = 0;
+    double median = 0;
+};
+
+// Append-only columnar store of the scalar run metrics of many mzQC files.
+//
+// A directory holds one subdirectory per accession and, inside it, one file
+// per time partition of the file creationDate. Every ingest appends one
+// segment to each partition it touches: a header with the zone map (time,
+// value and label range) followed by the time, value and label columns.
+// Queries open only the partitions of the accession inside the time range,
+// skip segments by their zone map and read just the rows that match. A
+// segment cut short by a crash is ignored. A store has one writer at a time.
+class MetricStore {
+public:
+    // Creates the directory if needed; throws std::runtime_error if it cannot
+    explicit MetricStore(const std::string& directory, const MetricStoreOptions& options = MetricStoreOptions());
+
+    MetricIngestStats ingest(const MzQCFile& file);
+    // Loads the files in parallel and stores them in one batch, so each
+    // partition gets a single segment. Throws on the first file that fails.
+    MetricIngestStats ingestFiles(const std::vector<std::string>& paths);
+
+    MetricRows query(const MetricQuery& query, MetricScanStats* stats = nullptr) const;
+    // Values of the query grouped into buckets of bucketSeconds, in time order
+    std::vector<MetricTrendPoint> trend(const MetricQuery& query, int64_t bucketSeconds,
+                                        MetricScanStats* stats = nullptr) const;
+
+    // Accessions with stored values, sorted
+    std::vector<std::string> accessions() const;
+    // Rewrites every partition as a single time-ordered segment
+    void compact();
+
+    unsigned partitionDays() const { return days; }
+
+private:
+    struct Row {
+        int64_t time;
+        double value;
+        std::string label;
+    };
+    struct Batch;
+
+    void collect(const MzQCFile& file, Batch& batch, MetricIngestStats& stats) const;
+    void write(Batch& batch);
+    std::string partitionPath(const std::string& accession, int64_t partition) const;
+
+    std::string root;
+    unsigned days;
+    unsigned threads;
+};
+
+} // namespace mzqc
@@ -0,0 +1,854 @@
+#include "mzqc_stream.hpp"
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace mzqc {
+
+static std::string takeString(nlohmann::json&& val, const std::string& key) {
+    if (!val.is_string()) {
+        throw std::runtime_error("Expected string value for '" + key + "'");
+    }
+    return std::move(val.get_ref<std::string&>());
+}
+
+// MzQCSaxDispatcher implementation
+MzQCSaxDispatcher::MzQCSaxDispatcher(Context start) {
+    stack.push_back(start);
+}
+
+bool MzQCSaxDispatcher::null() {
+    return scalar(nullptr);
+}
+
+bool MzQCSaxDispatcher::boolean(bool val) {
+    return scalar(val);
+}
+
+bool MzQCSaxDispatcher::number_integer(number_integer_t val) {
+    return scalar(val);
+}
+
+bool MzQCSaxDispatcher::number_unsigned(number_unsigned_t val) {
+    return scalar(val);
+}
+
+bool MzQCSaxDispatcher::number_float(number_float_t val, const string_t& /*s*/) {
+    return scalar(val);
+}
+
+bool MzQCSaxDispatcher::string(string_t& val) {
+    return scalar(std::move(val));
+}
+
+bool MzQCSaxDispatcher::binary(binary_t& val) {
+    // Keeps the subtype, which marks typed arrays in binary encodings
+    return scalar(nlohmann::json(std::move(val)));
+}
+
+bool MzQCSaxDispatcher::start_object(std::size_t /*elements*/) {
+    return open(true);
+}
+
+bool MzQCSaxDispatcher::key(string_t& val) {
+    if (stack.back() == Context::Value) {
+        valueKeys.back() = std::move(val);
+    } else {
+        currentKey = std::move(val);
+    }
+    return true;
+}
+
+bool MzQCSaxDispatcher::end_object() {
+    return close();
+}
+
+bool MzQCSaxDispatcher::start_array(std::size_t /*elements*/) {
+    const bool result = open(false);
+    if (!numbers || stack.back() != Context::Value) return result;
+
+    nlohmann::json rest;
+    if (numericArray == NumericArray::Empty) {
+        numbers->read(doubleValues, integerValues, rest);
+        if (!doubleValues.empty()) {
+            numericArray = NumericArray::Doubles;
+        } else if (!integerValues.empty()) {
+            numericArray = NumericArray::Integers;
+        }
+    } else {
+        // Nested arrays such as table columns stay json, but skip the lexer.
+        // Non-negative integers are unsigned, as the lexer makes them.
+        numbers->read(nestedDoubles, nestedIntegers, rest);
+        auto& elements = valueStack.back()->get_ref<nlohmann::json::array_t&>();
+        elements.reserve(nestedDoubles.size() + nestedIntegers.size() + 1);
+        for (double v : nestedDoubles) elements.emplace_back(v);
+        for (int64_t v : nestedIntegers) {
+            if (v < 0) {
+                elements.emplace_back(v);
+            } else {
+                elements.emplace_back(static_cast<uint64_t>(v));
+            }
+        }
+        nestedDoubles.clear();
+        nestedIntegers.clear();
+    }
+    if (!rest.is_null()) return scalar(std::move(rest)) && result;
+    return result;
+}
+
+bool MzQCSaxDispatcher::end_array() {
+    return close();
+}
+
+bool MzQCSaxDispatcher::parse_error(std::size_t /*position*/, const std::string& /*last_token*/,
+                                    const nlohmann::detail::exception& ex) {
+    throw std::runtime_error("Error parsing JSON from file: " + std::string(ex.what()));
+}
+
+// Keys holding a string in an object of this context
+bool MzQCSaxDispatcher::isStringField(Context context, const std::string& key) {
+    switch (context) {
+        case Context::MzQC:
+            return key == "creationDate" || key == "version" || key == "contactName" ||
+                   key == "contactAddress" || key == "description";
+        case Context::Cv:
+            return key == "id" || key == "name" || key == "uri" || key == "version";
+        case Context::Run:
+        case Context::Set:
+            return key == "label";
+        case Context::InputFile:
+            return key == "location" || key == "name";
+        case Context::FileFormat:
+        case Context::FileProperty:
+            return key == "accession" || key == "name" || key == "value" || key == "cvRef";
+        case Context::Software:
+            return key == "accession" || key == "name" || key == "version" || key == "uri";
+        case Context::Metric:
+            return key == "accession" || key == "name" || key == "description" || key == "unit";
+        default:
+            return false;
+    }
+}
+
+// The list stored under key in an object of this context, Skip if none
+MzQCSaxDispatcher::Context MzQCSaxDispatcher::listContext(Context context, const std::string& key) {
+    switch (context) {
+        case Context::MzQC:
+            if (key == "controlledVocabularies") return Context::CvList;
+            if (key == "runQualities") return Context::RunList;
+            if (key == "setQualities") return Context::SetList;
+            break;
+        case Context::Run:
+            if (key == "inputFiles") return Context::InputFileList;
+            if (key == "analysisSoftware") return Context::SoftwareList;
+            if (key == "metrics") return Context::MetricList;
+            break;
+        case Context::Set:
+            if (key == "setRefs") return Context::SetRefList;
+            if (key == "metrics") return Context::MetricList;
+            break;
+        case Context::InputFile:
+            if (key == "fileProperties") return Context::FilePropertyList;
+            break;
+        default:
+            break;
+    }
+    return Context::Skip;
+}
+
+MzQCSaxDispatcher::Context MzQCSaxDispatcher::elementContext(Context list) {
+    switch (list) {
+        case Context::CvList:
+            return Context::Cv;
+        case Context::RunList:
+            return Context::Run;
+        case Context::SetList:
+            return Context::Set;
+        case Context::InputFileList:
+            return Context::InputFile;
+        case Context::FilePropertyList:
+            return Context::FileProperty;
+        case Context::SoftwareList:
+            return Context::Software;
+        default:
+            return Context::Metric;
+    }
+}
+
+const char* MzQCSaxDispatcher::listName(Context list) {
+    switch (list) {
+        case Context::CvList:
+            return "controlledVocabularies";
+        case Context::RunList:
+            return "runQualities";
+        case Context::SetList:
+            return "setQualities";
+        case Context::InputFileList:
+            return "inputFiles";
+        case Context::FilePropertyList:
+            return "fileProperties";
+        case Context::SoftwareList:
+            return "analysisSoftware";
+        default:
+            return "metrics";
+    }
+}
+
+bool MzQCSaxDispatcher::scalar(nlohmann::json&& val) {
+    Context context = stack.back();
+    const std::string& key = currentKey;
+    switch (context) {
+        case Context::Value: {
+            if (numericArray != NumericArray::Off && appendNumeric(val)) break;
+            nlohmann::json* parent = valueStack.back();
+            if (parent->is_object()) {
+                (*parent)[valueKeys.back()] = std::move(val);
+            } else {
+                parent->push_back(std::move(val));
+            }
+            break;
+        }
+        case Context::Skip:
+            break;
+        case Context::Document:
+            throw std::runtime_error("mzQC document root must be an object");
+        case Context::SetRefList:
+            setRef(takeString(std::move(val), "setRefs"));
+            break;
+        case Context::CvList:
+        case Context::RunList:
+        case Context::SetList:
+        case Context::InputFileList:
+        case Context::FilePropertyList:
+        case Context::SoftwareList:
+        case Context::MetricList:
+            throw std::runtime_error(std::string("Expected object in array '") + listName(context) + "'");
+        case Context::Root:
+            if (key == "mzQC") {
+                throw std::runtime_error("Expected object for 'mzQC'");
+            }
+            // Root-level header fields count until an mzQC object shows up
+            if (sawMzQCKey) break;
+            context = Context::MzQC;
+            [[fallthrough]];
+        default:
+            if (context == Context::Metric && key == "value") {
+                if (!skipValue()) metricValue(std::move(val));
+            } else if (context == Context::InputFile && key == "fileFormat") {
+                throw std::runtime_error("Expected object for 'fileFormat'");
+            } else if (isStringField(context, key)) {
+                field(context, key, takeString(std::move(val), key));
+            }
+            break;
+    }
+    return keepGoing;
+}
+
+bool MzQCSaxDispatcher::open(bool isObject) {
+    Context context = stack.back();
+    Context next = Context::Skip;
+    const std::string& key = currentKey;
+
+    switch (context) {
+        case Context::Value: {
+            if (numericArray != NumericArray::Off) flushNumeric();
+            nlohmann::json* parent = valueStack.back();
+            nlohmann::json child = isObject ? nlohmann::json::object() : nlohmann::json::array();
+            nlohmann::json* inserted;
+            if (parent->is_object()) {
+                inserted = &((*parent)[valueKeys.back()] = std::move(child));
+            } else {
+                parent->push_back(std::move(child));
+                inserted = &parent->back();
+            }
+            valueStack.push_back(inserted);
+            valueKeys.emplace_back();
+            next = Context::Value;
+            break;
+        }
+        case Context::Skip:
+            break;
+        case Context::Document:
+            if (!isObject) {
+                throw std::runtime_error("mzQC document root must be an object");
+            }
+            next = Context::Root;
+            break;
+        case Context::SetRefList:
+            throw std::runtime_error("Expected string value for 'setRefs'");
+        case Context::CvList:
+        case Context::RunList:
+        case Context::SetList:
+        case Context::InputFileList:
+        case Context::FilePropertyList:
+        case Context::SoftwareList:
+        case Context::MetricList:
+            if (!isObject) {
+                throw std::runtime_error(std::string("Expected object in array '") + listName(context) + "'");
+            }
+            next = elementContext(context);
+            beginObject(next);
+            break;
+        case Context::Root:
+            if (key == "mzQC") {
+                if (!isObject) {
+                    throw std::runtime_error("Expected object for 'mzQC'");
+                }
+                // The mzQC object takes precedence over any root-level fields
+                sawMzQCKey = true;
+                beginHeader();
+                next = Context::MzQC;
+                break;
+            }
+            if (sawMzQCKey) break;
+            context = Context::MzQC;
+            [[fallthrough]];
+        default:
+            if (context == Context::Metric && key == "value") {
+                // Skip the payload of filtered-out metrics without building it
+                if (skipValue()) break;
+                valueRoot = isObject ? nlohmann::json::object() : nlohmann::json::array();
+                valueStack.push_back(&valueRoot);
+                valueKeys.emplace_back();
+                numericArray = isObject ? NumericArray::Off : NumericArray::Empty;
+                next = Context::Value;
+            } else if (context == Context::InputFile && key == "fileFormat") {
+                if (!isObject) {
+                    throw std::runtime_error("Expected object for 'fileFormat'");
+                }
+                beginObject(Context::FileFormat);
+                next = Context::FileFormat;
+            } else if (isStringField(context, key)) {
+                throw std::runtime_error("Expected string value for '" + key + "'");
+            } else if (!isObject) {
+                next = listContext(context, key);
+                if (next != Context::Skip) beginList(next, context);
+            }
+            break;
+    }
+
+    stack.push_back(next);
+    return true;
+}
+
+bool MzQCSaxDispatcher::close() {
+    Context context = stack.back();
+    stack.pop_back();
+
+    switch (context) {
+        case Context::Value:
+            valueStack.pop_back();
+            valueKeys.pop_back();
+            if (valueStack.empty()) {
+                if (numericArray == NumericArray::Doubles) {
+                    metricValue(doubleValues);
+                    doubleValues.clear();
+                } else if (numericArray == NumericArray::Integers) {
+                    metricValue(integerValues);
+                    integerValues.clear();
+                } else {
+                    metricValue(std::move(valueRoot));
+                }
+                numericArray = NumericArray::Off;
+                valueRoot = nullptr;
+            }
+            break;
+        case Context::Root:
+            finish();
+            break;
+        case Context::Cv:
+        case Context::Run:
+        case Context::Set:
+        case Context::InputFile:
+        case Context::FileFormat:
+        case Context::FileProperty:
+        case Context::Software:
+        case Context::Metric:
+            if (!endObject(context)) keepGoing = false;
+            break;
+        case Context::CvList:
+        case Context::RunList:
+        case Context::SetList:
+        case Context::InputFileList:
+        case Context::FilePropertyList:
+        case Context::SoftwareList:
+        case Context::MetricList:
+        case Context::SetRefList:
+            endList(context, stack.back());
+            break;
+        default:
+            break;
+    }
+    return keepGoing;
+}
+
+bool MzQCSaxDispatcher::appendNumeric(const nlohmann::json& val) {
+    if (valueStack.size() == 1) {
+        if (val.is_number_float()) {
+            if (numericArray == NumericArray::Empty || numericArray == NumericArray::Doubles) {
+                numericArray = NumericArray::Doubles;
+                doubleValues.push_back(val.get<double>());
+                return true;
+            }
+        } else if (val.is_number_integer() &&
+                   (!val.is_number_unsigned() ||
+                    val.get<uint64_t>() <= static_cast<uint64_t>(std::numeric_limits<int64_t>::max()))) {
+            if (numericArray == NumericArray::Empty || numericArray == NumericArray::Integers) {
+                numericArray = NumericArray::Integers;
+                integerValues.push_back(val.get<int64_t>());
+                return true;
+            }
+        }
+    }
+    flushNumeric();
+    return false;
+}
+
+void MzQCSaxDispatcher::flushNumeric() {
+    for (double v : doubleValues) valueRoot.push_back(v);
+    for (int64_t v : integerValues) valueRoot.push_back(v);
+    doubleValues.clear();
+    integerValues.clear();
+    numericArray = NumericArray::Off;
+}
+
+// MzQCSaxHandler implementation
+MzQCSaxHandler::MzQCSaxHandler(MzQCFile& file) : file(file) {
+    this->file = MzQCFile();
+    this->file.version.clear();
+}
+
+MzQCSaxHandler::MzQCSaxHandler(MzQCFile& file, MzQCVisitor& visitor, const MzQCReaderOptions& options)
+    : MzQCSaxHandler(file) {
+    this->visitor = &visitor;
+    keepMetrics = options.keepMetrics;
+    accessionFilter.insert(options.accessions.begin(), options.accessions.end());
+}
+
+MzQCSaxHandler::MzQCSaxHandler(MzQCFile& file, Fragment fragment)
+    : MzQCSaxDispatcher(fragment == Fragment::Runs ? Context::RunList : Context::SetList), file(file) {
+    this->file = MzQCFile();
+    this->file.version.clear();
+}
+
+bool MzQCSaxHandler::acceptMetric() const {
+    return accessionFilter.empty() || accessionFilter.count(metric->accession) > 0;
+}
+
+void MzQCSaxHandler::beginHeader() {
+    file = MzQCFile();
+    file.version.clear();
+    sawCreationDate = false;
+}
+
+void MzQCSaxHandler::field(Context context, const std::string& key, std::string&& value) {
+    switch (context) {
+        case Context::MzQC:
+            if (key == "creationDate") {
+                file.creationDate = std::move(value);
+                sawCreationDate = true;
+            } else if (key == "version") {
+                file.version = std::move(value);
+            } else if (key == "contactName") {
+                file.contactName = std::move(value);
+            } else if (key == "contactAddress") {
+                file.contactAddress = std::move(value);
+            } else {
+                file.description = std::move(value);
+            }
+            break;
+        case Context::Cv:
+            if (key == "id") {
+                cv->id = std::move(value);
+            } else if (key == "name") {
+                cv->name = std::move(value);
+            } else if (key == "uri") {
+                cv->uri = std::move(value);
+            } else {
+                cv->version = std::move(value);
+            }
+            break;
+        case Context::Run:
+            run->label = std::move(value);
+            break;
+        case Context::Set:
+            set->label = std::move(value);
+            break;
+        case Context::InputFile:
+            if (key == "location") {
+                inputFile->location = std::move(value);
+            } else {
+                inputFile->name = std::move(value);
+            }
+            break;
+        case Context::FileFormat:
+        case Context::FileProperty:
+            if (key == "accession") {
+                cvParameter->accession = std::move(value);
+            } else if (key == "name") {
+                cvParameter->name = std::move(value);
+            } else if (key == "value") {
+                cvParameter->value = std::move(value);
+            } else {
+                cvParameter->cvRef = std::move(value);
+            }
+            break;
+        case Context::Software:
+            if (key == "accession") {
+                software->accession = std::move(value);
+            } else if (key == "name") {
+                software->name = std::move(value);
+            } else if (key == "version") {
+                software->version = std::move(value);
+            } else {
+                software->uri = std::move(value);
+            }
+            break;
+        case Context::Metric:
+            if (key == "accession") {
+                metric->accession = std::move(value);
+                metricAccessionSeen = true;
+            } else if (key == "name") {
+                metric->name = std::move(value);
+            } else if (key == "description") {
+                metric->description = std::move(value);
+            } else {
+                metric->unit = std::move(value);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void MzQCSaxHandler::beginObject(Context context) {
+    switch (context) {
+        case Context::Cv:
+            cv = std::make_shared<ControlledVocabulary>();
+            break;
+        case Context::Run:
+            run = std::make_shared<RunQuality>();
+            break;
+        case Context::Set:
+            set = std::make_shared<SetQuality>();
+            break;
+        case Context::InputFile:
+            inputFile = std::make_shared<InputFile>();
+            break;
+        case Context::FileFormat:
+        case Context::FileProperty:
+            cvParameter = std::make_shared<CvParameter>();
+            break;
+        case Context::Software:
+            software = std::make_shared<AnalysisSoftware>();
+            break;
+        default:
+            metric = std::make_shared<QualityMetric>();
+            metricAccessionSeen = false;
+            break;
+    }
+}
+
+bool MzQCSaxHandler::endObject(Context context) {
+    bool keepGoing = true;
+    switch (context) {
+        case Context::Cv:
+            if (visitor) keepGoing = visitor->visitControlledVocabulary(cv);
+            file.controlledVocabularies.push_back(std::move(cv));
+            break;
+        case Context::Run:
+            if (visitor) {
+                keepGoing = visitor->visitRun(run);
+                run.reset();
+            } else {
+                file.runQualities.push_back(std::move(run));
+            }
+            break;
+        case Context::Set:
+            if (visitor) {
+                keepGoing = visitor->visitSet(set);
+                set.reset();
+            } else {
+                file.setQualities.push_back(std::move(set));
+            }
+            break;
+        case Context::InputFile:
+            run->inputFiles.push_back(std::move(inputFile));
+            break;
+        case Context::FileFormat:
+            inputFile->fileFormat = std::move(cvParameter);
+            break;
+        case Context::FileProperty:
+            inputFile->fileProperties.push_back(std::move(cvParameter));
+            break;
+        case Context::Software:
+            run->analysisSoftware.push_back(std::move(software));
+            break;
+        default:
+            if (!acceptMetric()) {
+                metric.reset();
+                break;
+            }
+            if (visitor) {
+                keepGoing = metricOwner == MetricOwner::Run ? visitor->visitRunMetric(*run, metric)
+                                                            : visitor->visitSetMetric(*set, metric);
+            }
+            if (keepMetrics) {
+                auto& metrics = metricOwner == MetricOwner::Run ? run->metrics : set->metrics;
+                metrics.push_back(std::move(metric));
+            }
+            metric.reset();
+            break;
+    }
+    return keepGoing;
+}
+
+void MzQCSaxHandler::beginList(Context list, Context owner) {
+    switch (list) {
+        case Context::CvList:
+            file.controlledVocabularies.clear();
+            break;
+        case Context::RunList:
+            file.runQualities.clear();
+            break;
+        case Context::SetList:
+            file.setQualities.clear();
+            break;
+        case Context::InputFileList:
+            run->inputFiles.clear();
+            break;
+        case Context::FilePropertyList:
+            inputFile->fileProperties.clear();
+            break;
+        case Context::SoftwareList:
+            run->analysisSoftware.clear();
+            break;
+        case Context::SetRefList:
+            set->setRefs.clear();
+            break;
+        default:
+            if (owner == Context::Run) {
+                run->metrics.clear();
+                metricOwner = MetricOwner::Run;
+            } else {
+                set->metrics.clear();
+                metricOwner = MetricOwner::Set;
+            }
+            break;
+    }
+}
+
+void MzQCSaxHandler::endList(Context list, Context /*owner*/) {
+    if (list == Context::MetricList) metricOwner = MetricOwner::None;
+}
+
+void MzQCSaxHandler::setRef(std::string&& ref) {
+    set->setRefs.push_back(std::move(ref));
+}
+
+bool MzQCSaxHandler::skipValue() const {
+    return metricAccessionSeen && !acceptMetric();
+}
+
+void MzQCSaxHandler::metricValue(nlohmann::json&& value) {
+    metric->value = MetricValue(std::move(value));
+}
+
+void MzQCSaxHandler::metricValue(std::vector<double>& values) {
+    metric->value = MetricValue(std::move(values));
+}
+
+void MzQCSaxHandler::metricValue(std::vector<int64_t>& values) {
+    metric->value = MetricValue(std::move(values));
+}
+
+void MzQCSaxHandler::finish() {
+    if (!sawCreationDate) {
+        file.creationDate = MzQCFile::getCurrentIsoTime();
+    }
+    if (visitor) visitor->visitHeader(file);
+}
+
+// MzQCReader implementation
+MzQCReader::MzQCReader(const MzQCReaderOptions& options) : options(options) {}
+
+bool MzQCReader::read(std::istream& in, MzQCVisitor& visitor) const {
+    MzQCFile header;
+    MzQCSaxHandler handler(header, visitor, options);
+    if (options.schemaPath.empty()) {
+        StreamNumberInput numbers(*in.rdbuf());
+        handler.readNumbersFrom(&numbers);
+        return nlohmann::json::sax_parse(in, &handler);
+    }
+
+    // Validate while reading; objects already visited are not taken back
+    SchemaValidator validator(loadCompiledSchema(options.schemaPath), maxReportedSchemaErrors);
+    ValidatingSax sax(validator, handler);
+    bool completed = nlohmann::json::sax_parse(in, &sax);
+    if (!validator.errors().empty()) {
+        reportSchemaErrors(validator.errors());
+        throw std::runtime_error("File does not conform to mzQC schema");
+    }
+    return completed;
+}
+
+bool MzQCReader::readFile(const std::string& filepath, MzQCVisitor& visitor) const {
+    FileInputStream file(filepath);
+    return read(file, visitor);
+}
+
+void MzQCReader::forEachRunMetric(const std::string& filepath, const std::string& accession,
+                                  const std::function<bool(const RunQuality&, const QualityMetric&)>& callback) {
+    class Visitor : public MzQCVisitor {
+    public:
+        explicit Visitor(const std::function<bool(const RunQuality&, const QualityMetric&)>& callback)
+            : callback(callback) {}
+        bool visitRunMetric(const RunQuality& run, const std::shared_ptr<QualityMetric>& metric) override {
+            return callback(run, *metric);
+        }
+        const std::function<bool(const RunQuality&, const QualityMetric&)>& callback;
+    };
+
+    MzQCReaderOptions options;
+    options.accessions.push_back(accession);
+    Visitor visitor(callback);
+    MzQCReader(options).readFile(filepath, visitor);
+}
+
+// MzQCStreamWriter implementation
+static const char* const elementIndent = "      ";
+
+MzQCStreamWriter::MzQCStreamWriter(const std::string& filepath, const MzQCFile& header,
+                                   const CompressionOptions& compression)
+    : file(std::make_unique<FileOutputStream>(filepath, compression)), out(file.get()) {
+    // A compressed file cannot step back over the trailer
+    keepComplete = file->compression() == Compression::None;
+    writeHeader(header);
+}
+
+MzQCStreamWriter::MzQCStreamWriter(std::ostream& out, const MzQCFile& header)
+    : out(&out), keepComplete(false) {
+    writeHeader(header);
+}
+
+MzQCStreamWriter::~MzQCStreamWriter() {
+    try {
+        close();
+    } catch (...) {
+        // close() explicitly to see write errors
+    }
+}
+
+void MzQCStreamWriter::writeHeader(const MzQCFile& header) {
+    // Same key order as the std::map backed objects produced by toJson
+    version = header.version;
+    std::string text = "{\n  \"mzQC\": {";
+    bool first = true;
+    auto field = [&](const char* key, const std::string& value) {
+        text += first ? "\n    \"" : ",\n    \"";
+        text += key;
+        text += "\": ";
+        text += nlohmann::json(value).dump();
+        first = false;
+    };
+
+    if (!header.contactAddress.empty()) field("contactAddress", header.contactAddress);
+    if (!header.contactName.empty()) field("contactName", header.contactName);
+    if (!header.controlledVocabularies.empty()) {
+        nlohmann::json cvs = nlohmann::json::array();
+        for (const auto& cv : header.controlledVocabularies) {
+            cvs.push_back(cv->toJson());
+        }
+        std::string dumped = cvs.dump(2);
+        text += first ? "\n    \"" : ",\n    \"";
+        text += "controlledVocabularies\": ";
+        for (char c : dumped) {
+            text += c;
+            if (c == '\n') text += "    ";
+        }
+        first = false;
+    }
+    field("creationDate", header.creationDate);
+    if (!header.description.empty()) field("description", header.description);
+
+    out->write(text.data(), text.size());
+    commit();
+}
+
+void MzQCStreamWriter::writeRun(const RunQuality& run) {
+    if (section == Section::Sets || section == Section::Closed) {
+        throw std::runtime_error("runQualities must be written before setQualities");
+    }
+    element.clear();
+    element.write(run);
+    writeElement(Section::Runs);
+    ++runsWritten;
+}
+
+void MzQCStreamWriter::writeSet(const SetQuality& set) {
+    if (section == Section::Closed) {
+        throw std::runtime_error("Cannot write to a closed MzQCStreamWriter");
+    }
+    element.clear();
+    element.write(set);
+    writeElement(Section::Sets);
+    ++setsWritten;
+}
+
+void MzQCStreamWriter::writeElement(Section target) {
+    std::string text;
+    if (section != target) {
+        if (section != Section::Header) text += "\n    ]";
+        text += target == Section::Runs ? ",\n    \"runQualities\": [\n" : ",\n    \"setQualities\": [\n";
+        section = target;
+    } else {
+        text += ",\n";
+    }
+
+    text += elementIndent;
+    out->write(text.data(), text.size());
+    out->write(element.text().data(), static_cast<std::streamsize>(element.text().size()));
+    commit();
+}
+
+std::string MzQCStreamWriter::trailer() const {
+    std::string text;
+    if (section == Section::Runs || section == Section::Sets) text += "\n    ]";
+    text += ",\n    \"version\": " + nlohmann::json(version).dump() + "\n  }\n}";
+    return text;
+}
+
+void MzQCStreamWriter::commit() {
+    if (keepComplete) {
+        // Write the closing part, then step back over it for the next append
+        std::string text = trailer();
+        auto position = out->tellp();
+        out->write(text.data(), text.size());
+        out->flush();
+        out->seekp(position);
+    }
+    if (!*out) {
+        throw std::runtime_error("Error writing mzQC stream");
+    }
+}
+
+void MzQCStreamWriter::close() {
+    if (section == Section::Closed) return;
+    if (keepComplete) {
+        // The trailer is already on disk, just skip past it
+        out->seekp(0, std::ios::end);
+    } else {
+        std::string text = trailer();
+        out->write(text.data(), text.size());
+    }
+    out->flush();
+    section = Section::Closed;
+    if (file) file->close();
+    if (!*out) {
+        throw std::runtime_error("Error writing mzQC stream");
+    }
+}
+
+} // namespace mzqc
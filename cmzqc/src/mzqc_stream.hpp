@@ -0,0 +1,267 @@
+#pragma once
+
+#include "mzqc.hpp"
+#include "mzqc_numbers.hpp"
+#include "mzqc_writer.hpp"
+#include <string>
+#include <vector>
+#include <memory>
+#include <istream>
+#include <ostream>
+#include <fstream>
+#include <functional>
+#include <unordered_set>
+#include <nlohmann/json.hpp>
+
+namespace mzqc {
+
+// Receives objects from MzQCReader as soon as they are complete.
+// Returning false from any visit method stops the read.
+class MzQCVisitor {
+public:
+    virtual ~MzQCVisitor() = default;
+    virtual bool visitControlledVocabulary(const std::shared_ptr<ControlledVocabulary>& /*cv*/) { return true; }
+    // The owning run/set may still be incomplete, e.g. its label can follow its metrics
+    virtual bool visitRunMetric(const RunQuality& /*run*/, const std::shared_ptr<QualityMetric>& /*metric*/) { return true; }
+    virtual bool visitSetMetric(const SetQuality& /*set*/, const std::shared_ptr<QualityMetric>& /*metric*/) { return true; }
+    virtual bool visitRun(const std::shared_ptr<RunQuality>& /*run*/) { return true; }
+    virtual bool visitSet(const std::shared_ptr<SetQuality>& /*set*/) { return true; }
+    // Called at the end of the document with the header fields and controlled vocabularies
+    virtual void visitHeader(const MzQCFile& /*file*/) {}
+};
+
+struct MzQCReaderOptions {
+    // Only metrics with these accessions are decoded and visited, empty means all.
+    // Values of other metrics are skipped without being built when their
+    // accession precedes the value in the document.
+    std::vector<std::string> accessions;
+    // Keep visited metrics attached to the runs/sets passed to visitRun/visitSet
+    bool keepMetrics = false;
+    // Validate against this schema during the read, empty means no validation.
+    // A violation throws std::runtime_error once the read has stopped.
+    std::string schemaPath;
+};
+
+// Follows the mzQC document layout through SAX events: checks the shape of
+// every known field, builds metric values and hands fields and objects to
+// the sink methods of a derived class. MzQCSaxHandler and the MzQCDocument
+// loader share it, so both accept and reject the same documents.
+class MzQCSaxDispatcher : public nlohmann::json_sax<nlohmann::json> {
+public:
+    // Decode the numbers of top-level metric value arrays from the parser's
+    // input instead of taking one event per element. Only for parses whose
+    // events go to this handler alone, a schema validator would miss them.
+    // Has no effect unless numberInputSupported.
+    void readNumbersFrom(NumberInput* input) { numbers = numberInputSupported ? input : nullptr; }
+
+    bool null() override;
+    bool boolean(bool val) override;
+    bool number_integer(number_integer_t val) override;
+    bool number_unsigned(number_unsigned_t val) override;
+    bool number_float(number_float_t val, const string_t& s) override;
+    bool string(string_t& val) override;
+    bool binary(binary_t& val) override;
+    bool start_object(std::size_t elements) override;
+    bool key(string_t& val) override;
+    bool end_object() override;
+    bool start_array(std::size_t elements) override;
+    bool end_array() override;
+    bool parse_error(std::size_t position, const std::string& last_token,
+                     const nlohmann::detail::exception& ex) override;
+
+protected:
+    enum class Context {
+        Document,
+        Root,
+        MzQC,
+        CvList,
+        Cv,
+        RunList,
+        Run,
+        SetList,
+        Set,
+        InputFileList,
+        InputFile,
+        FileFormat,
+        FilePropertyList,
+        FileProperty,
+        SoftwareList,
+        Software,
+        MetricList,
+        Metric,
+        SetRefList,
+        Value,
+        Skip
+    };
+
+    // Starts at the document root, or inside a list to parse its elements
+    explicit MzQCSaxDispatcher(Context start = Context::Document);
+
+    // The mzQC object opened, its fields replace any root-level ones
+    virtual void beginHeader() = 0;
+    // A string field of the open object, MzQC for the header fields
+    virtual void field(Context context, const std::string& key, std::string&& value) = 0;
+    // An element of a list, or a fileFormat, opened and closed. Returning
+    // false from endObject stops the parse.
+    virtual void beginObject(Context context) = 0;
+    virtual bool endObject(Context context) = 0;
+    // A list of the open object of owner opened and closed
+    virtual void beginList(Context list, Context owner) = 0;
+    virtual void endList(Context /*list*/, Context /*owner*/) {}
+    virtual void setRef(std::string&& ref) = 0;
+    // Whether the value of the open metric can be skipped without being built
+    virtual bool skipValue() const { return false; }
+    // The value of the open metric; numeric top-level arrays arrive typed and
+    // their buffers are cleared afterwards
+    virtual void metricValue(nlohmann::json&& value) = 0;
+    virtual void metricValue(std::vector<double>& values) = 0;
+    virtual void metricValue(std::vector<int64_t>& values) = 0;
+    // The root object closed
+    virtual void finish() = 0;
+
+private:
+    static bool isStringField(Context context, const std::string& key);
+    static Context listContext(Context context, const std::string& key);
+    static Context elementContext(Context list);
+    static const char* listName(Context list);
+
+    bool scalar(nlohmann::json&& val);
+    bool open(bool isObject);
+    bool close();
+    bool appendNumeric(const nlohmann::json& val);
+    void flushNumeric();
+
+    bool keepGoing = true;
+    std::vector<Context> stack;
+    std::string currentKey;
+    bool sawMzQCKey = false;
+
+    // Metric value being built, one entry per open container
+    nlohmann::json valueRoot;
+    std::vector<nlohmann::json*> valueStack;
+    std::vector<std::string> valueKeys;
+
+    // Top-level numeric arrays go straight into typed buffers and only fall
+    // back to json when an element of another type shows up
+    enum class NumericArray { Off, Empty, Doubles, Integers };
+    NumericArray numericArray = NumericArray::Off;
+    std::vector<double> doubleValues;
+    std::vector<int64_t> integerValues;
+    NumberInput* numbers = nullptr;
+    std::vector<double> nestedDoubles;
+    std::vector<int64_t> nestedIntegers;
+};
+
+// SAX handler that fills an MzQCFile directly from parse events.
+// Mirrors the field handling of the fromJson methods, but never builds a
+// DOM of the whole document: only metric values are materialized.
+class MzQCSaxHandler : public MzQCSaxDispatcher {
+public:
+    explicit MzQCSaxHandler(MzQCFile& file);
+    // Hand completed objects to the visitor instead of keeping them in the file
+    MzQCSaxHandler(MzQCFile& file, MzQCVisitor& visitor, const MzQCReaderOptions& options);
+
+    // Parses elements of a runQualities or setQualities array, one per
+    // sax_parse call, and appends them to the matching vector of file
+    enum class Fragment { Runs, Sets };
+    MzQCSaxHandler(MzQCFile& file, Fragment fragment);
+
+protected:
+    void beginHeader() override;
+    void field(Context context, const std::string& key, std::string&& value) override;
+    void beginObject(Context context) override;
+    bool endObject(Context context) override;
+    void beginList(Context list, Context owner) override;
+    void endList(Context list, Context owner) override;
+    void setRef(std::string&& ref) override;
+    bool skipValue() const override;
+    void metricValue(nlohmann::json&& value) override;
+    void metricValue(std::vector<double>& values) override;
+    void metricValue(std::vector<int64_t>& values) override;
+    void finish() override;
+
+private:
+    bool acceptMetric() const;
+
+    MzQCFile& file;
+    MzQCVisitor* visitor = nullptr;
+    bool keepMetrics = true;
+    std::unordered_set<InternedString> accessionFilter;
+    bool metricAccessionSeen = false;
+    bool sawCreationDate = false;
+
+    // Objects currently being filled
+    std::shared_ptr<ControlledVocabulary> cv;
+    std::shared_ptr<RunQuality> run;
+    std::shared_ptr<SetQuality> set;
+    std::shared_ptr<InputFile> inputFile;
+    std::shared_ptr<CvParameter> cvParameter;
+    std::shared_ptr<AnalysisSoftware> software;
+    std::shared_ptr<QualityMetric> metric;
+    // Whether the open metrics list belongs to run or to set
+    enum class MetricOwner { None, Run, Set };
+    MetricOwner metricOwner = MetricOwner::None;
+};
+
+// Visitor-based reader for large files: runs and metrics are handed out one
+// at a time and dropped afterwards, so memory is bounded by a single run.
+class MzQCReader {
+public:
+    explicit MzQCReader(const MzQCReaderOptions& options = MzQCReaderOptions());
+
+    // Return false if the visitor stopped the read early
+    bool read(std::istream& in, MzQCVisitor& visitor) const;
+    bool readFile(const std::string& filepath, MzQCVisitor& visitor) const;
+
+    // Call back for every run metric with the given accession
+    static void forEachRunMetric(const std::string& filepath, const std::string& accession,
+                                 const std::function<bool(const RunQuality&, const QualityMetric&)>& callback);
+
+private:
+    MzQCReaderOptions options;
+};
+
+// Incremental writer: the header and controlledVocabularies are written once,
+// then runs and sets are appended as they are finalized. Output is identical
+// to MzQCFile::toFile for the same content. When writing to an uncompressed
+// file the document is kept complete after every append, so readers never see
+// a truncated file; on a stream or a compressed file the closing brackets are
+// written by close().
+class MzQCStreamWriter {
+public:
+    MzQCStreamWriter(const std::string& filepath, const MzQCFile& header,
+                     const CompressionOptions& compression = CompressionOptions());
+    MzQCStreamWriter(std::ostream& out, const MzQCFile& header);
+    ~MzQCStreamWriter();
+
+    MzQCStreamWriter(const MzQCStreamWriter&) = delete;
+    MzQCStreamWriter& operator=(const MzQCStreamWriter&) = delete;
+
+    // All runs must be written before the first set
+    void writeRun(const RunQuality& run);
+    void writeSet(const SetQuality& set);
+    void close();
+
+    size_t runCount() const { return runsWritten; }
+    size_t setCount() const { return setsWritten; }
+
+private:
+    enum class Section { Header, Runs, Sets, Closed };
+
+    void writeHeader(const MzQCFile& header);
+    void writeElement(Section section);
+    std::string trailer() const;
+    void commit();
+
+    // Elements sit three levels deep in the document
+    JsonWriter element{2, 3};
+    std::unique_ptr<FileOutputStream> file;
+    std::ostream* out;
+    bool keepComplete = false;
+    Section section = Section::Header;
+    std::string version;
+    size_t runsWritten = 0;
+    size_t setsWritten = 0;
+};
+
+} // namespace mzqc
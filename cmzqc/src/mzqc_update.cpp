@@ -0,0 +1,267 @@
+#include "mzqc_update.hpp"
+#include "mzqc_compress.hpp"
+#include "mzqc_mmap.hpp"
+#include "mzqc_parallel.hpp"
+#include "mzqc_stream.hpp"
+#include "mzqc_writer.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace mzqc {
+
+static constexpr int indexFormat = 1;
+// Matches the elements written by toFile and MzQCStreamWriter
+static const char* const elementIndent = "      ";
+
+static int64_t modificationTime(const struct stat& info) {
+    return int64_t(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+}
+
+// MzQCUpdater implementation
+MzQCUpdater::MzQCUpdater(const std::string& filepath, const MzQCUpdateOptions& options)
+    : path(filepath), options(options) {
+    fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open mzQC file for update: " + path);
+    }
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Could not read mzQC file: " + path);
+    }
+    fileSize = static_cast<uint64_t>(info.st_size);
+    modified = modificationTime(info);
+
+    try {
+        char magic[4] = {};
+        readAt(0, magic, std::min<uint64_t>(fileSize, sizeof(magic)));
+        if (detectCompression(magic, std::min<uint64_t>(fileSize, sizeof(magic))) != Compression::None) {
+            throw std::runtime_error("Cannot update a compressed mzQC file in place: " + path);
+        }
+        if (!loadIndex()) {
+            buildIndex();
+            saveIndex();
+        }
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+}
+
+MzQCUpdater::~MzQCUpdater() {
+    if (fd >= 0) ::close(fd);
+}
+
+bool MzQCUpdater::loadIndex() {
+    std::ifstream in(indexPath(path));
+    if (!in) return false;
+    nlohmann::json j;
+    try {
+        in >> j;
+        if (j.at("format").get<int>() != indexFormat || j.at("size").get<uint64_t>() != fileSize ||
+            j.at("modified").get<int64_t>() != modified) {
+            return false;
+        }
+        runArray.begin = j.at("runArray").at(0).get<size_t>();
+        runArray.end = j.at("runArray").at(1).get<size_t>();
+        runs.clear();
+        for (const auto& entry : j.at("runs")) {
+            runs.push_back({entry.at(0).get<std::string>(), {entry.at(1).get<size_t>(), entry.at(2).get<size_t>()}});
+        }
+    } catch (const nlohmann::json::exception&) {
+        // A damaged index is rebuilt like a stale one
+        return false;
+    }
+
+    // Cheap check that the ranges still point at the array and its elements
+    if (runArray.begin >= runArray.end || runArray.end > fileSize) return false;
+    char bracket;
+    readAt(runArray.begin, &bracket, 1);
+    if (bracket != '[') return false;
+    readAt(runArray.end - 1, &bracket, 1);
+    if (bracket != ']') return false;
+    for (const auto& entry : runs) {
+        if (entry.span.begin <= runArray.begin || entry.span.end >= runArray.end) return false;
+        readAt(entry.span.begin, &bracket, 1);
+        if (bracket != '{') return false;
+    }
+    reindexLabels();
+    return true;
+}
+
+void MzQCUpdater::buildIndex() {
+    MappedFile mapped(path);
+    if (!mapped.isOpen()) {
+        throw std::runtime_error("Could not map mzQC file: " + path);
+    }
+    MzQCLayout layout;
+    if (!scanLayout(mapped.view(), layout) || layout.runArray.begin == MzQCLayout::npos) {
+        throw std::runtime_error("Cannot update " + path + " in place, no runQualities array was found");
+    }
+
+    // Only the labels are needed, but finding them means parsing the runs
+    std::vector<std::string> labels(layout.runs.size());
+    ThreadPool::shared().parallelFor(layout.runs.size(), [&](size_t i) {
+        MzQCFile part;
+        MzQCSaxHandler handler(part, MzQCSaxHandler::Fragment::Runs);
+        const MzQCLayout::Span& span = layout.runs[i];
+        nlohmann::json::sax_parse(mapped.data() + span.begin, mapped.data() + span.end, &handler);
+        if (!part.runQualities.empty()) labels[i] = part.runQualities.front()->label;
+    });
+
+    runArray = layout.runArray;
+    runs.clear();
+    for (size_t i = 0; i < layout.runs.size(); ++i) {
+        runs.push_back({std::move(labels[i]), layout.runs[i]});
+    }
+    reindexLabels();
+}
+
+void MzQCUpdater::saveIndex() {
+    nlohmann::json entries = nlohmann::json::array();
+    for (const auto& entry : runs) {
+        entries.push_back({entry.label, entry.span.begin, entry.span.end});
+    }
+    const nlohmann::json j = {{"format", indexFormat},
+                              {"size", fileSize},
+                              {"modified", modified},
+                              {"runArray", {runArray.begin, runArray.end}},
+                              {"runs", std::move(entries)}};
+
+    // Written aside and renamed so a reader never sees half an index
+    const std::string target = indexPath(path);
+    const std::string temp = target + ".tmp";
+    std::ofstream out(temp);
+    out << j.dump() << '\n';
+    out.close();
+    if (!out || std::rename(temp.c_str(), target.c_str()) != 0) {
+        throw std::runtime_error("Could not write mzQC index: " + target);
+    }
+}
+
+void MzQCUpdater::reindexLabels() {
+    byLabel.clear();
+    for (size_t i = 0; i < runs.size(); ++i) {
+        byLabel.emplace(runs[i].label, i);
+    }
+}
+
+void MzQCUpdater::readAt(size_t offset, char* data, size_t size) const {
+    while (size > 0) {
+        ssize_t n = ::pread(fd, data, size, static_cast<off_t>(offset));
+        if (n <= 0) {
+            throw std::runtime_error("Could not read mzQC file: " + path);
+        }
+        data += n;
+        offset += static_cast<size_t>(n);
+        size -= static_cast<size_t>(n);
+    }
+}
+
+void MzQCUpdater::writeAt(size_t offset, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = ::pwrite(fd, data, size, static_cast<off_t>(offset));
+        if (n <= 0) {
+            throw std::runtime_error("Could not write mzQC file: " + path);
+        }
+        data += n;
+        offset += static_cast<size_t>(n);
+        size -= static_cast<size_t>(n);
+    }
+}
+
+void MzQCUpdater::blank(size_t begin, size_t end) {
+    const std::string spaces(end - begin, ' ');
+    writeAt(begin, spaces.data(), spaces.size());
+}
+
+size_t MzQCUpdater::splice(size_t begin, size_t end, const std::string& text) {
+    // Only used to grow the file, which cannot shrink without a truncate
+    std::string moved(text);
+    const size_t tail = fileSize - end;
+    moved.resize(text.size() + tail);
+    readAt(end, &moved[text.size()], tail);
+    writeAt(begin, moved.data(), moved.size());
+    const size_t grown = text.size() - (end - begin);
+    fileSize += grown;
+    runArray.end += grown;
+    return moved.size();
+}
+
+std::string MzQCUpdater::slackFor(const std::string& text) const {
+    return std::string(static_cast<size_t>(static_cast<double>(text.size()) * std::max(options.slack, 0.0)), ' ');
+}
+
+MzQCUpdateResult MzQCUpdater::updateRun(const RunQuality& run) {
+    JsonWriter writer(2, 3);
+    writer.write(run);
+    const std::string& text = writer.text();
+
+    MzQCUpdateResult result;
+    auto found = byLabel.find(run.label);
+    if (found != byLabel.end() && text.size() <= runs[found->second].span.size()) {
+        Entry& entry = runs[found->second];
+        std::string padded = text;
+        padded.resize(entry.span.size(), ' ');
+        writeAt(entry.span.begin, padded.data(), padded.size());
+        result.inPlace = true;
+        result.bytesWritten = padded.size();
+    } else if (found != byLabel.end() && found->second + 1 == runs.size()) {
+        // The last run grows into the text after it
+        Entry& entry = runs.back();
+        std::string padded = text + slackFor(text);
+        result.bytesWritten = splice(entry.span.begin, entry.span.end, padded);
+        entry.span.end = entry.span.begin + padded.size();
+        result.appended = true;
+    } else {
+        // The new version goes after the last run first, so a crash before
+        // the old one is blanked loses nothing
+        size_t offset;
+        std::string insert;
+        if (runs.empty()) {
+            offset = runArray.begin + 1;
+            insert = "\n";
+        } else {
+            offset = runs.back().span.end;
+            insert = ",\n";
+        }
+        insert += elementIndent;
+        const size_t begin = offset + insert.size();
+        insert += text;
+        insert += slackFor(text);
+        result.bytesWritten = splice(offset, offset, insert);
+        runs.push_back({run.label, {begin, offset + insert.size()}});
+
+        if (found != byLabel.end()) {
+            // Blank the old run with the comma before it, or after it for the
+            // first run, so the array stays valid
+            const size_t index = found->second;
+            const MzQCLayout::Span old = runs[index].span;
+            if (index > 0) {
+                blank(runs[index - 1].span.end, old.end);
+                result.bytesWritten += old.end - runs[index - 1].span.end;
+            } else {
+                blank(old.begin, runs[index + 1].span.begin);
+                result.bytesWritten += runs[index + 1].span.begin - old.begin;
+            }
+            runs.erase(runs.begin() + static_cast<std::ptrdiff_t>(index));
+        }
+        result.appended = true;
+        reindexLabels();
+    }
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+        throw std::runtime_error("Could not read mzQC file: " + path);
+    }
+    modified = modificationTime(info);
+    saveIndex();
+    return result;
+}
+
+} // namespace mzqc
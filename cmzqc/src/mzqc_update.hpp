@@ -0,0 +1,85 @@
+#pragma once
+
+#include "mzqc.hpp"
+#include "mzqc_layout.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace mzqc {
+
+struct MzQCUpdateOptions {
+    // Free space left after a run that is moved to the end of the array, as a
+    // fraction of its size, so it can grow again without being moved
+    double slack = 0.25;
+};
+
+struct MzQCUpdateResult {
+    // The run was rewritten where it was
+    bool inPlace = false;
+    // The run was added, or moved, to the end of runQualities
+    bool appended = false;
+    // Bytes written to the file, the index not counted
+    size_t bytesWritten = 0;
+};
+
+// Replaces single runs of an uncompressed mzQC text file without rewriting
+// the rest. The byte ranges of the runs are kept in an index file next to it
+// (filepath + ".idx"), built with a full scan when missing or when the file
+// was changed by anything else.
+//
+// A run that fits into its old range, padding included, is written over it
+// and padded with spaces. A larger one is blanked out with the comma that
+// separates it and written again, with slack, at the end of runQualities
+// (the last run simply grows); only the text after that array, setQualities
+// and the closing brackets, is moved. Updates are not atomic: a crash can leave the file with both
+// versions of the run, or, while the tail is moved, truncated.
+class MzQCUpdater {
+public:
+    // Throws std::runtime_error if the file cannot be opened, is compressed or
+    // does not have the usual {"mzQC": {..., "runQualities": [...]}} layout
+    explicit MzQCUpdater(const std::string& filepath, const MzQCUpdateOptions& options = MzQCUpdateOptions());
+    ~MzQCUpdater();
+    MzQCUpdater(const MzQCUpdater&) = delete;
+    MzQCUpdater& operator=(const MzQCUpdater&) = delete;
+
+    static std::string indexPath(const std::string& filepath) { return filepath + ".idx"; }
+
+    size_t runCount() const { return runs.size(); }
+    bool hasRun(std::string_view label) const { return byLabel.count(std::string(label)) != 0; }
+
+    // Replaces the first run with the same label, or adds the run if there is none
+    MzQCUpdateResult updateRun(const RunQuality& run);
+
+private:
+    struct Entry {
+        std::string label;
+        MzQCLayout::Span span;
+    };
+
+    bool loadIndex();
+    void buildIndex();
+    void saveIndex();
+    void readAt(size_t offset, char* data, size_t size) const;
+    void writeAt(size_t offset, const char* data, size_t size);
+    void blank(size_t begin, size_t end);
+    // Replaces [begin, end) with text, moving what follows; returns the bytes written
+    size_t splice(size_t begin, size_t end, const std::string& text);
+    std::string slackFor(const std::string& text) const;
+    void reindexLabels();
+
+    std::string path;
+    MzQCUpdateOptions options;
+    int fd = -1;
+    uint64_t fileSize = 0;
+    int64_t modified = 0;
+    MzQCLayout::Span runArray;
+    // Runs in file order; a moved run goes to the back
+    std::vector<Entry> runs;
+    std::unordered_map<std::string, size_t> byLabel;
+};
+
+} // namespace mzqc
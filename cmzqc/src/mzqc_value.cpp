@@ -0,0 +1,260 @@
+#include "mzqc_value.hpp"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace mzqc {
+
+// Element type shared by every entry of a json array, used to pick a column type
+enum class ArrayType { None, Double, Integer, String, Boolean, Mixed };
+
+static ArrayType elementType(const nlohmann::json& v) {
+    switch (v.type()) {
+        case nlohmann::json::value_t::number_float:
+            return ArrayType::Double;
+        case nlohmann::json::value_t::number_integer:
+            return ArrayType::Integer;
+        case nlohmann::json::value_t::number_unsigned:
+            return v.get<uint64_t>() <= static_cast<uint64_t>(std::numeric_limits<int64_t>::max())
+                       ? ArrayType::Integer : ArrayType::Mixed;
+        case nlohmann::json::value_t::string:
+            return ArrayType::String;
+        case nlohmann::json::value_t::boolean:
+            return ArrayType::Boolean;
+        default:
+            return ArrayType::Mixed;
+    }
+}
+
+// Integers and floats are kept apart so that the json written back is unchanged
+static ArrayType arrayType(const nlohmann::json& array) {
+    ArrayType type = ArrayType::None;
+    for (const auto& v : array) {
+        ArrayType t = elementType(v);
+        if (t == ArrayType::Mixed || (type != ArrayType::None && t != type)) return ArrayType::Mixed;
+        type = t;
+    }
+    return type;
+}
+
+template <typename T>
+static std::vector<T> toVector(const nlohmann::json& array) {
+    std::vector<T> out;
+    out.reserve(array.size());
+    for (const auto& v : array) {
+        out.push_back(v.get<T>());
+    }
+    return out;
+}
+
+// Raw little-endian buffer of a numeric column, tagged with its RFC 8746 type
+template <typename T>
+static nlohmann::json toTypedArray(const std::vector<T>& values, uint8_t tag) {
+    nlohmann::json::binary_t bytes(std::vector<uint8_t>(values.size() * sizeof(T)), tag);
+    if (!values.empty()) std::memcpy(bytes.data(), values.data(), bytes.size());
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    for (size_t i = 0; i < bytes.size(); i += sizeof(T)) {
+        std::reverse(bytes.begin() + i, bytes.begin() + i + sizeof(T));
+    }
+#endif
+    return nlohmann::json(std::move(bytes));
+}
+
+template <typename T>
+static std::vector<T> fromTypedArray(const nlohmann::json::binary_t& bytes) {
+    if (bytes.size() % sizeof(T) != 0) {
+        throw std::runtime_error("Typed array of " + std::to_string(bytes.size()) +
+                                 " bytes is not a multiple of " + std::to_string(sizeof(T)));
+    }
+    std::vector<T> values(bytes.size() / sizeof(T));
+    if (!values.empty()) std::memcpy(values.data(), bytes.data(), bytes.size());
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    auto* raw = reinterpret_cast<uint8_t*>(values.data());
+    for (size_t i = 0; i < bytes.size(); i += sizeof(T)) {
+        std::reverse(raw + i, raw + i + sizeof(T));
+    }
+#endif
+    return values;
+}
+
+// Typed-array tag of a json value, 0 if it is not a typed array
+static uint8_t typedArrayTag(const nlohmann::json& j) {
+    if (!j.is_binary() || !j.get_binary().has_subtype()) return 0;
+    auto subtype = j.get_binary().subtype();
+    return subtype == typedArrayFloat64 || subtype == typedArraySint64 ? static_cast<uint8_t>(subtype) : 0;
+}
+
+// MetricTable implementation
+size_t MetricTable::rowCount() const {
+    if (columns.empty()) return 0;
+    return std::visit([](const auto& col) { return col.size(); }, columns.front());
+}
+
+void MetricTable::addColumn(const std::string& name, TableColumn column) {
+    size_t rows = std::visit([](const auto& col) { return col.size(); }, column);
+    if (!columns.empty() && rows != rowCount()) {
+        throw std::runtime_error("Column '" + name + "' has " + std::to_string(rows) +
+                                 " rows, table has " + std::to_string(rowCount()));
+    }
+    names.push_back(name);
+    columns.push_back(std::move(column));
+}
+
+const TableColumn* MetricTable::column(const std::string& name) const {
+    for (size_t i = 0; i < names.size(); ++i) {
+        if (names[i] == name) return &columns[i];
+    }
+    return nullptr;
+}
+
+nlohmann::json MetricTable::toJson() const {
+    nlohmann::json j = nlohmann::json::object();
+    for (size_t i = 0; i < names.size(); ++i) {
+        j[names[i]] = std::visit([](const auto& col) { return nlohmann::json(col); }, columns[i]);
+    }
+    return j;
+}
+
+nlohmann::json MetricTable::toTypedJson() const {
+    nlohmann::json j = nlohmann::json::object();
+    for (size_t i = 0; i < names.size(); ++i) {
+        if (const auto* doubles = std::get_if<std::vector<double>>(&columns[i])) {
+            j[names[i]] = toTypedArray(*doubles, typedArrayFloat64);
+        } else if (const auto* integers = std::get_if<std::vector<int64_t>>(&columns[i])) {
+            j[names[i]] = toTypedArray(*integers, typedArraySint64);
+        } else {
+            j[names[i]] = std::visit([](const auto& col) { return nlohmann::json(col); }, columns[i]);
+        }
+    }
+    return j;
+}
+
+std::optional<MetricTable> MetricTable::fromJson(const nlohmann::json& j) {
+    if (!j.is_object() || j.empty()) return std::nullopt;
+
+    MetricTable table;
+    size_t rows = 0;
+    for (auto it = j.begin(); it != j.end(); ++it) {
+        const auto& array = it.value();
+        if (uint8_t tag = typedArrayTag(array)) {
+            TableColumn column = tag == typedArrayFloat64
+                                     ? TableColumn(fromTypedArray<double>(array.get_binary()))
+                                     : TableColumn(fromTypedArray<int64_t>(array.get_binary()));
+            size_t size = std::visit([](const auto& col) { return col.size(); }, column);
+            if (it != j.begin() && size != rows) return std::nullopt;
+            rows = size;
+            table.addColumn(it.key(), std::move(column));
+            continue;
+        }
+        if (!array.is_array()) return std::nullopt;
+        if (it == j.begin()) {
+            rows = array.size();
+        } else if (array.size() != rows) {
+            return std::nullopt;
+        }
+
+        switch (arrayType(array)) {
+            case ArrayType::None:
+            case ArrayType::Double:
+                table.addColumn(it.key(), toVector<double>(array));
+                break;
+            case ArrayType::Integer:
+                table.addColumn(it.key(), toVector<int64_t>(array));
+                break;
+            case ArrayType::String:
+                table.addColumn(it.key(), toVector<std::string>(array));
+                break;
+            case ArrayType::Boolean:
+                table.addColumn(it.key(), toVector<bool>(array));
+                break;
+            case ArrayType::Mixed:
+                return std::nullopt;
+        }
+    }
+    return table;
+}
+
+// MetricValue implementation
+MetricValue::MetricValue(const nlohmann::json& j) {
+    // Arrays and tables convert from the tree, only other values are copied
+    if (!convert(j)) data = j;
+}
+
+MetricValue::MetricValue(nlohmann::json&& j) {
+    if (!convert(j)) data = std::move(j);
+}
+
+bool MetricValue::convert(const nlohmann::json& j) {
+    if (uint8_t tag = typedArrayTag(j)) {
+        if (tag == typedArrayFloat64) {
+            data = fromTypedArray<double>(j.get_binary());
+        } else {
+            data = fromTypedArray<int64_t>(j.get_binary());
+        }
+        return true;
+    }
+    if (j.is_array() && !j.empty()) {
+        switch (arrayType(j)) {
+            case ArrayType::Double:
+                data = toVector<double>(j);
+                return true;
+            case ArrayType::Integer:
+                data = toVector<int64_t>(j);
+                return true;
+            default:
+                break;
+        }
+    } else if (j.is_object()) {
+        if (auto table = MetricTable::fromJson(j)) {
+            data = std::move(*table);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool MetricValue::is_null() const {
+    const nlohmann::json* j = json();
+    return j && j->is_null();
+}
+
+nlohmann::json MetricValue::toJson() const {
+    switch (kind()) {
+        case Kind::Doubles:
+            return nlohmann::json(*doubles());
+        case Kind::Integers:
+            return nlohmann::json(*integers());
+        case Kind::Table:
+            return table()->toJson();
+        default:
+            return *json();
+    }
+}
+
+nlohmann::json MetricValue::toTypedJson() const {
+    switch (kind()) {
+        case Kind::Doubles:
+            return toTypedArray(*doubles(), typedArrayFloat64);
+        case Kind::Integers:
+            return toTypedArray(*integers(), typedArraySint64);
+        case Kind::Table:
+            return table()->toTypedJson();
+        default:
+            return *json();
+    }
+}
+
+void to_json(nlohmann::json& j, const MetricValue& value) {
+    j = value.toJson();
+}
+
+void from_json(const nlohmann::json& j, MetricValue& value) {
+    value = MetricValue(j);
+}
+
+std::ostream& operator<<(std::ostream& os, const MetricValue& value) {
+    return os << value.toJson();
+}
+
+} // namespace mzqc
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <variant>
+#include <optional>
+#include <ostream>
+#include <type_traits>
+#include <nlohmann/json.hpp>
+
+namespace mzqc {
+
+// RFC 8746 typed-array tags for little-endian float64 and sint64 arrays. In
+// json trees these are binary values with the tag as subtype, which to_cbor
+// writes as a tagged byte string and to_msgpack as an ext type.
+constexpr uint8_t typedArrayFloat64 = 86;
+constexpr uint8_t typedArraySint64 = 79;
+
+// Column of an mzQC table metric, stored contiguously
+using TableColumn = std::variant<std::vector<double>,
+                                 std::vector<int64_t>,
+                                 std::vector<std::string>,
+                                 std::vector<bool>>;
+
+// Table metric value (an object of equally long arrays) stored as struct-of-arrays
+class MetricTable {
+public:
+    MetricTable() = default;
+
+    // Throws if the column length does not match the existing rows
+    void addColumn(const std::string& name, TableColumn column);
+
+    size_t columnCount() const { return columns.size(); }
+    size_t rowCount() const;
+    const std::string& columnName(size_t index) const { return names[index]; }
+    const TableColumn& column(size_t index) const { return columns[index]; }
+    const TableColumn* column(const std::string& name) const;
+
+    // Returns nullptr if the column is missing or holds another type
+    template <typename T>
+    const std::vector<T>* columnAs(const std::string& name) const {
+        const TableColumn* col = column(name);
+        return col ? std::get_if<std::vector<T>>(col) : nullptr;
+    }
+
+    nlohmann::json toJson() const;
+    // Numeric columns as typed-array binaries, the others as in toJson
+    nlohmann::json toTypedJson() const;
+    // Empty if the json is not an object of equally long homogeneous arrays.
+    // Columns may also be typed-array binaries.
+    static std::optional<MetricTable> fromJson(const nlohmann::json& j);
+
+private:
+    std::vector<std::string> names;
+    std::vector<TableColumn> columns;
+};
+
+// Value of a QualityMetric. Homogeneous numeric arrays and tables are kept in
+// typed contiguous storage; everything else stays a nlohmann::json. Conversion
+// to json only happens at the serialization boundary.
+class MetricValue {
+public:
+    enum class Kind { Json, Doubles, Integers, Table };
+
+    MetricValue() = default;
+    MetricValue(std::vector<double> values) : data(std::move(values)) {}
+    MetricValue(std::vector<int64_t> values) : data(std::move(values)) {}
+    MetricValue(MetricTable table) : data(std::move(table)) {}
+    MetricValue(const nlohmann::json& j);
+    MetricValue(nlohmann::json&& j);
+
+    // Anything a nlohmann::json can be built from, e.g. 60.5 or "text"
+    template <typename T,
+              typename std::enable_if<std::conjunction<
+                  std::negation<std::is_same<typename std::decay<T>::type, MetricValue>>,
+                  std::negation<std::is_same<typename std::decay<T>::type, nlohmann::json>>,
+                  std::negation<std::is_same<typename std::decay<T>::type, std::vector<double>>>,
+                  std::negation<std::is_same<typename std::decay<T>::type, std::vector<int64_t>>>,
+                  std::negation<std::is_same<typename std::decay<T>::type, MetricTable>>,
+                  std::is_constructible<nlohmann::json, T>>::value, int>::type = 0>
+    MetricValue(T&& value) : MetricValue(nlohmann::json(std::forward<T>(value))) {}
+
+    Kind kind() const { return static_cast<Kind>(data.index()); }
+    bool is_null() const;
+
+    // Typed access, nullptr if the value is stored differently
+    const std::vector<double>* doubles() const { return std::get_if<std::vector<double>>(&data); }
+    const std::vector<int64_t>* integers() const { return std::get_if<std::vector<int64_t>>(&data); }
+    const MetricTable* table() const { return std::get_if<MetricTable>(&data); }
+    const nlohmann::json* json() const { return std::get_if<nlohmann::json>(&data); }
+
+    nlohmann::json toJson() const;
+    // Like toJson, but numeric arrays and table columns are typed-array
+    // binaries; constructing from such a tree restores the typed storage
+    nlohmann::json toTypedJson() const;
+
+private:
+    // Stores arrays and tables in typed form, false for any other value
+    bool convert(const nlohmann::json& j);
+
+    std::variant<nlohmann::json, std::vector<double>, std::vector<int64_t>, MetricTable> data;
+};
+
+void to_json(nlohmann::json& j, const MetricValue& value);
+void from_json(const nlohmann::json& j, MetricValue& value);
+std::ostream& operator<<(std::ostream& os, const MetricValue& value);
+
+} // namespace mzqc
@@ -0,0 +1,427 @@
+#include "mzqc_writer.hpp"
+#include "mzqc_stats.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+
+namespace mzqc {
+
+// Text is handed to the sink once this much is buffered
+static constexpr size_t flushThreshold = 1 << 20;
+
+// JsonWriter implementation
+JsonWriter::JsonWriter(int indent, unsigned depth) : indent(indent), depth(depth) {}
+
+JsonWriter::JsonWriter(std::ostream& sink, int indent, unsigned depth)
+    : sink(&sink), indent(indent), depth(depth) {
+    buffer.reserve(flushThreshold + flushThreshold / 4);
+}
+
+void JsonWriter::flush() {
+    if (!sink || buffer.empty()) return;
+    MZQC_STATS_PHASE(Write, buffer.size());
+    sink->write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    buffer.clear();
+    if (!*sink) {
+        throw std::runtime_error("Error writing json output");
+    }
+}
+
+void JsonWriter::maybeFlush() {
+    if (sink && buffer.size() >= flushThreshold) flush();
+}
+
+void JsonWriter::newline() {
+    if (indent < 0) return;
+    buffer += '\n';
+    buffer.append(static_cast<size_t>(indent) * (depth + levels.size()), ' ');
+}
+
+void JsonWriter::beforeValue() {
+    if (levels.empty() || levels.back().object) return;
+    if (!levels.back().empty) buffer += ',';
+    levels.back().empty = false;
+    newline();
+}
+
+void JsonWriter::openObject() {
+    beforeValue();
+    buffer += '{';
+    levels.push_back({true, true});
+}
+
+void JsonWriter::openArray() {
+    beforeValue();
+    buffer += '[';
+    levels.push_back({false, true});
+}
+
+void JsonWriter::close(char bracket) {
+    bool empty = levels.back().empty;
+    levels.pop_back();
+    if (!empty) newline();
+    buffer += bracket;
+    maybeFlush();
+}
+
+void JsonWriter::key(std::string_view name) {
+    if (!levels.back().empty) buffer += ',';
+    levels.back().empty = false;
+    newline();
+    appendQuoted(name);
+    buffer += indent < 0 ? ":" : ": ";
+}
+
+void JsonWriter::field(std::string_view name, std::string_view text) {
+    key(name);
+    writeString(text);
+}
+
+void JsonWriter::writeString(std::string_view text) {
+    beforeValue();
+    appendQuoted(text);
+}
+
+void JsonWriter::appendQuoted(std::string_view text) {
+    // Plain ASCII is copied in runs; anything else is left to nlohmann,
+    // which also rejects invalid UTF-8 the same way dump() does
+    const size_t start = buffer.size();
+    buffer += '"';
+    size_t i = 0;
+    while (i < text.size()) {
+        size_t safe = i;
+        while (safe < text.size()) {
+            unsigned char c = static_cast<unsigned char>(text[safe]);
+            if (c < 0x20 || c >= 0x80 || c == '"' || c == '\\') break;
+            ++safe;
+        }
+        buffer.append(text.data() + i, safe - i);
+        if (safe == text.size()) break;
+
+        unsigned char c = static_cast<unsigned char>(text[safe]);
+        if (c >= 0x80) {
+            buffer.resize(start);
+            buffer += nlohmann::json(std::string(text)).dump();
+            return;
+        }
+        buffer += '\\';
+        switch (c) {
+            case '"': buffer += '"'; break;
+            case '\\': buffer += '\\'; break;
+            case '\b': buffer += 'b'; break;
+            case '\f': buffer += 'f'; break;
+            case '\n': buffer += 'n'; break;
+            case '\r': buffer += 'r'; break;
+            case '\t': buffer += 't'; break;
+            default: {
+                static const char hex[] = "0123456789abcdef";
+                buffer += "u00";
+                buffer += hex[c >> 4];
+                buffer += hex[c & 15];
+                break;
+            }
+        }
+        i = safe + 1;
+    }
+    buffer += '"';
+}
+
+void JsonWriter::writeNumber(double number) {
+    beforeValue();
+    if (!std::isfinite(number)) {
+        buffer += "null";
+        return;
+    }
+    // nlohmann's own Grisu2 formatting, so the digits match dump() exactly
+    char digits[64];
+    char* end = nlohmann::detail::to_chars(digits, digits + sizeof(digits), number);
+    buffer.append(digits, end);
+}
+
+void JsonWriter::writeInteger(int64_t number) {
+    beforeValue();
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), number);
+    buffer.append(digits, result.ptr);
+}
+
+void JsonWriter::writeUnsigned(uint64_t number) {
+    beforeValue();
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), number);
+    buffer.append(digits, result.ptr);
+}
+
+void JsonWriter::writeBoolean(bool flag) {
+    beforeValue();
+    buffer += flag ? "true" : "false";
+}
+
+void JsonWriter::writeNull() {
+    beforeValue();
+    buffer += "null";
+}
+
+void JsonWriter::write(const nlohmann::json& j) {
+    switch (j.type()) {
+        case nlohmann::json::value_t::object:
+            openObject();
+            for (auto it = j.begin(); it != j.end(); ++it) {
+                key(it.key());
+                write(it.value());
+            }
+            close('}');
+            break;
+        case nlohmann::json::value_t::array:
+            openArray();
+            for (const auto& element : j) write(element);
+            close(']');
+            break;
+        case nlohmann::json::value_t::string:
+            writeString(j.get_ref<const std::string&>());
+            break;
+        case nlohmann::json::value_t::boolean:
+            writeBoolean(j.get<bool>());
+            break;
+        case nlohmann::json::value_t::number_integer:
+            writeInteger(j.get<int64_t>());
+            break;
+        case nlohmann::json::value_t::number_unsigned:
+            writeUnsigned(j.get<uint64_t>());
+            break;
+        case nlohmann::json::value_t::number_float:
+            writeNumber(j.get<double>());
+            break;
+        case nlohmann::json::value_t::binary: {
+            // Rare enough to go through dump, re-indented to the current depth
+            beforeValue();
+            std::string dumped = j.dump(indent);
+            std::string pad(indent < 0 ? 0 : static_cast<size_t>(indent) * (depth + levels.size()), ' ');
+            for (char c : dumped) {
+                buffer += c;
+                if (c == '\n') buffer += pad;
+            }
+            break;
+        }
+        default:
+            writeNull();
+            break;
+    }
+}
+
+// Text of one array element, formatted as writeNumber and writeInteger do
+static char* formatNumber(char* out, double number) {
+    if (!std::isfinite(number)) {
+        std::memcpy(out, "null", 4);
+        return out + 4;
+    }
+    return nlohmann::detail::to_chars(out, out + 32, number);
+}
+
+static char* formatNumber(char* out, int64_t number) {
+    return std::to_chars(out, out + 24, number).ptr;
+}
+
+// Long numeric arrays dominate large files. Elements are formatted into a
+// local block behind one precomputed separator instead of going through
+// beforeValue each, and the block is appended to the buffer when full.
+template <typename T>
+void JsonWriter::writeNumbers(const std::vector<T>& values) {
+    openArray();
+    if (values.empty()) {
+        close(']');
+        return;
+    }
+    levels.back().empty = false;
+    separator.assign(1, ',');
+    if (indent >= 0) {
+        separator += '\n';
+        separator.append(static_cast<size_t>(indent) * (depth + levels.size()), ' ');
+    }
+
+    constexpr size_t blockSize = 1 << 14;
+    // Room for a separator and the longest number ("-1.7976931348623157e+308")
+    const size_t reserve = separator.size() + 32;
+    char block[blockSize];
+    char* out = block;
+    // The first element gets the line break without the comma
+    std::memcpy(out, separator.data() + 1, separator.size() - 1);
+    out = formatNumber(out + separator.size() - 1, values[0]);
+    for (size_t i = 1; i < values.size(); ++i) {
+        if (static_cast<size_t>(block + blockSize - out) < reserve) {
+            buffer.append(block, out);
+            maybeFlush();
+            out = block;
+        }
+        std::memcpy(out, separator.data(), separator.size());
+        out = formatNumber(out + separator.size(), values[i]);
+    }
+    buffer.append(block, out);
+    close(']');
+}
+
+template <typename T>
+void JsonWriter::writeColumn(const std::vector<T>& values) {
+    if constexpr (std::is_same<T, double>::value || std::is_same<T, int64_t>::value) {
+        writeNumbers(values);
+    } else {
+        openArray();
+        for (const auto& v : values) {
+            if constexpr (std::is_same<T, bool>::value) {
+                writeBoolean(v);
+            } else {
+                writeString(v);
+            }
+        }
+        close(']');
+    }
+}
+
+template <typename T>
+void JsonWriter::writeArray(const std::vector<std::shared_ptr<T>>& items) {
+    openArray();
+    for (const auto& item : items) write(*item);
+    close(']');
+}
+
+void JsonWriter::write(const MetricValue& value) {
+    switch (value.kind()) {
+        case MetricValue::Kind::Doubles:
+            writeColumn(*value.doubles());
+            break;
+        case MetricValue::Kind::Integers:
+            writeColumn(*value.integers());
+            break;
+        case MetricValue::Kind::Table: {
+            // Columns in key order; with repeated names the last one wins, as in toJson
+            const MetricTable& table = *value.table();
+            std::vector<size_t> order(table.columnCount());
+            std::iota(order.begin(), order.end(), size_t(0));
+            std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+                return table.columnName(a) < table.columnName(b);
+            });
+            openObject();
+            for (size_t i = 0; i < order.size(); ++i) {
+                const std::string& name = table.columnName(order[i]);
+                if (i + 1 < order.size() && table.columnName(order[i + 1]) == name) continue;
+                key(name);
+                std::visit([this](const auto& column) { writeColumn(column); }, table.column(order[i]));
+            }
+            close('}');
+            break;
+        }
+        default:
+            write(*value.json());
+            break;
+    }
+}
+
+// The model writers list their keys in the order of the std::map behind
+// nlohmann::json, with the same optional fields as the toJson methods
+void JsonWriter::write(const ControlledVocabulary& cv) {
+    openObject();
+    field("id", cv.id);
+    field("name", cv.name);
+    field("uri", cv.uri);
+    field("version", cv.version);
+    close('}');
+}
+
+void JsonWriter::write(const CvParameter& parameter) {
+    openObject();
+    field("accession", parameter.accession.str());
+    if (!parameter.cvRef.empty()) field("cvRef", parameter.cvRef.str());
+    field("name", parameter.name.str());
+    if (!parameter.value.empty()) field("value", parameter.value);
+    close('}');
+}
+
+void JsonWriter::write(const AnalysisSoftware& software) {
+    openObject();
+    field("accession", software.accession.str());
+    field("name", software.name.str());
+    if (!software.uri.empty()) field("uri", software.uri);
+    field("version", software.version);
+    close('}');
+}
+
+void JsonWriter::write(const InputFile& file) {
+    openObject();
+    if (file.fileFormat) {
+        key("fileFormat");
+        write(*file.fileFormat);
+    }
+    if (!file.fileProperties.empty()) {
+        key("fileProperties");
+        writeArray(file.fileProperties);
+    }
+    field("location", file.location);
+    field("name", file.name);
+    close('}');
+}
+
+void JsonWriter::write(const QualityMetric& metric) {
+    openObject();
+    field("accession", metric.accession.str());
+    if (!metric.description.empty()) field("description", metric.description);
+    field("name", metric.name.str());
+    if (!metric.unit.empty()) field("unit", metric.unit.str());
+    if (!metric.value.is_null()) {
+        key("value");
+        write(metric.value);
+    }
+    close('}');
+}
+
+void JsonWriter::write(const RunQuality& run) {
+    openObject();
+    key("analysisSoftware");
+    writeArray(run.analysisSoftware);
+    key("inputFiles");
+    writeArray(run.inputFiles);
+    field("label", run.label);
+    key("metrics");
+    writeArray(run.metrics);
+    close('}');
+}
+
+void JsonWriter::write(const SetQuality& set) {
+    openObject();
+    field("label", set.label);
+    key("metrics");
+    writeArray(set.metrics);
+    key("setRefs");
+    writeColumn(set.setRefs);
+    close('}');
+}
+
+void JsonWriter::write(const MzQCFile& file) {
+    openObject();
+    key("mzQC");
+    openObject();
+    if (!file.contactAddress.empty()) field("contactAddress", file.contactAddress);
+    if (!file.contactName.empty()) field("contactName", file.contactName);
+    if (!file.controlledVocabularies.empty()) {
+        key("controlledVocabularies");
+        writeArray(file.controlledVocabularies);
+    }
+    field("creationDate", file.creationDate);
+    if (!file.description.empty()) field("description", file.description);
+    if (!file.runQualities.empty()) {
+        key("runQualities");
+        writeArray(file.runQualities);
+    }
+    if (!file.setQualities.empty()) {
+        key("setQualities");
+        writeArray(file.setQualities);
+    }
+    field("version", file.version);
+    close('}');
+    close('}');
+    flush();
+}
+
+} // namespace mzqc
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "mzqc.hpp"
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mzqc {
+
+// Serializes the model straight into a text buffer without building json
+// trees first. Output is byte-identical to toJson().dump(indent), including
+// key order, number formatting and string escaping; an indent below zero
+// gives compact output. The buffer is kept between calls, and with a sink it
+// is handed over in large blocks instead of growing with the document.
+class JsonWriter {
+public:
+    // depth offsets the indentation, for values nested in surrounding text
+    explicit JsonWriter(int indent = -1, unsigned depth = 0);
+    JsonWriter(std::ostream& sink, int indent = -1, unsigned depth = 0);
+
+    void write(const MzQCFile& file);
+    void write(const RunQuality& run);
+    void write(const SetQuality& set);
+    void write(const QualityMetric& metric);
+    void write(const MetricValue& value);
+    void write(const nlohmann::json& j);
+
+    const std::string& text() const { return buffer; }
+    // Drops the text but keeps the allocation
+    void clear() { buffer.clear(); }
+    // Passes buffered text to the sink; throws std::runtime_error on write errors
+    void flush();
+
+private:
+    void write(const ControlledVocabulary& cv);
+    void write(const CvParameter& parameter);
+    void write(const AnalysisSoftware& software);
+    void write(const InputFile& file);
+    template <typename T>
+    void writeArray(const std::vector<std::shared_ptr<T>>& items);
+    template <typename T>
+    void writeColumn(const std::vector<T>& values);
+    template <typename T>
+    void writeNumbers(const std::vector<T>& values);
+
+    void openObject();
+    void openArray();
+    void close(char bracket);
+    void key(std::string_view name);
+    void beforeValue();
+    void newline();
+
+    void writeString(std::string_view text);
+    void appendQuoted(std::string_view text);
+    void writeNumber(double number);
+    void writeInteger(int64_t number);
+    void writeUnsigned(uint64_t number);
+    void writeBoolean(bool flag);
+    void writeNull();
+    void field(std::string_view name, std::string_view text);
+
+    void maybeFlush();
+
+    struct Level {
+        bool object;
+        bool empty;
+    };
+
+    std::string buffer;
+    std::ostream* sink = nullptr;
+    int indent;
+    unsigned depth;
+    std::vector<Level> levels;
+    // Comma and line break between elements in writeNumbers, kept to reuse
+    // its allocation
+    std::string separator;
+};
+
+} // namespace mzqc
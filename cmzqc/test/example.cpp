@@ -1,50 +1,33 @@
 #include "../src/mzqc.hpp"
+#include "../src/mzqc_csv.hpp"
+#include "../src/mzqc_metrics.hpp"
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <vector>
 #include <memory>
+#include <utility>
 #include <nlohmann/json.hpp>
 
 using namespace mzqc;
 
 int main() {
-    std::ifstream csv_file("../input_files/CPTAC_CompRef_00_iTRAQ_01_2Feb12_Cougar_11-10-09_ids.csv");
-    if (!csv_file.is_open()) {
-        std::cerr << "Failed to open CSV file." << std::endl;
-        return 1;
-    }
-
-    std::string line;
-    std::getline(csv_file, line); // Skip header
-
+    // One table metric with a typed column per CSV column
+    CsvTableOptions csvOptions;
+    csvOptions.columns = identificationColumns();
     std::vector<std::shared_ptr<QualityMetric>> metrics;
-    while (std::getline(csv_file, line)) {
-        std::stringstream ss(line);
-        std::string rt, peptide, target, mz, deltaPPM;
-
-        std::getline(ss, rt, ',');
-        std::getline(ss, peptide, ',');
-        std::getline(ss, target, ',');
-        std::getline(ss, mz, ',');
-        std::getline(ss, deltaPPM, ',');
-
-        nlohmann::json value = {
-            {"RT", rt},
-            {"peptide", peptide},
-            {"MZ", mz},
-            {"deltaPPM", deltaPPM}
-        };
-
-        // this is a example case as a POC for writing mzqc file, 
+    try {
+        // this is a example case as a POC for writing mzqc file,
         //hence many simplifications  are made such as metric terms
-        auto metric = std::make_shared<QualityMetric>(
-            "QC:0000000", "Example Metric", "Example description", value, "unit"
-        );
-        metrics.push_back(metric);
+        metrics.push_back(CsvTableReader(csvOptions).readMetric(
+            "../input_files/CPTAC_CompRef_00_iTRAQ_01_2Feb12_Cougar_11-10-09_ids.csv",
+            "QC:0000000", "Example Metric", "Example description", "unit"
+        ));
+    } catch (const std::exception& e) {
+        std::cerr << "Failed to read CSV file: " << e.what() << std::endl;
+        return 1;
     }
-
-    csv_file.close();
+    std::cout << "Read " << metrics.front()->value.table()->rowCount() << " identifications" << std::endl;
 
     // Create input file
     auto inputFile = std::make_shared<InputFile>(
@@ -82,17 +65,22 @@ int main() {
     std::cout << "Created AnalysisSoftware: " << software->name << std::endl;
     std::cout << "Created CV: " << cv1->name << " and " << cv2->name << std::endl;
 
+    // The vectors are moved in, the table metric is not copied
     auto run_quality = std::make_shared<RunQuality>(
         "Example Run", 
-        inputFiles,  // Use the vector we created
-        software_list,  // Use the vector we created
-        metrics
+        std::move(inputFiles),
+        std::move(software_list),
+        std::move(metrics)
     );
 
+    // PSM count, precursor error and RT statistics computed from the same table
+    IdentificationMetrics().addTo(*run_quality, *run_quality->metrics.front()->value.table());
+
     std::vector<std::shared_ptr<RunQuality>> run_qualities = {run_quality};
     std::vector<std::shared_ptr<SetQuality>> set_qualities;
 
-    MzQCFile mzqc_file("", "1.0.0", "Contact Name", "Contact Address", "Description", run_qualities, set_qualities);
+    MzQCFile mzqc_file("", "1.0.0", "Contact Name", "Contact Address", "Description",
+                       std::move(run_qualities), std::move(set_qualities));
     
     // Add controlled vocabularies to the file
     mzqc_file.controlledVocabularies = {cv1, cv2};
@@ -0,0 +1,470 @@
+#include "../src/mzqc.hpp"
+#include "../src/mzqc_csv.hpp"
+#include "../src/mzqc_cv.hpp"
+#include "../src/mzqc_document.hpp"
+#include "../src/mzqc_mapped.hpp"
+#include "../src/mzqc_schema.hpp"
+#include "../src/mzqc_stats.hpp"
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+// Benchmarks of the load, validate, build and serialize paths on synthetic
+// files, plus OBO loading and CSV ingestion. Every benchmark reports MB/s
+// of its input or output, heap allocations per iteration and, on Linux, how
+// far the resident set size peaked above its size when the benchmark began.
+//
+//   mzqc_bench [--size=RUNSxMETRICSxARRAY]... [--csv=FILE] [--csv_rows=N]
+//              [google benchmark flags, e.g. --benchmark_filter=Parse]
+//
+// Every fourth metric is a scalar, a double array, an integer array or a
+// three-column table, arrays and tables with ARRAY values per column.
+// Built with -DMZQC_ENABLE_STATS=ON it also prints the library's per-phase
+// totals over all runs.
+
+using namespace mzqc;
+
+// Heap allocation counting
+static std::atomic<size_t> allocationCount{0};
+static std::atomic<size_t> allocationBytes{0};
+
+void* operator new(std::size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocationBytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocationBytes.fetch_add(size, std::memory_order_relaxed);
+    return std::malloc(size ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept {
+    return operator new(size, tag);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+struct BenchSize {
+    size_t runs = 100;
+    size_t metrics = 20;
+    size_t arrayLength = 64;
+
+    std::string name() const {
+        return std::to_string(runs) + "x" + std::to_string(metrics) + "x" + std::to_string(arrayLength);
+    }
+};
+
+// Files and trees of one size, built once and shared by its benchmarks
+struct Fixture {
+    BenchSize size;
+    std::string textPath;
+    std::string binaryPath;
+    std::string outputPath;
+    size_t textBytes = 0;
+    size_t binaryBytes = 0;
+    std::shared_ptr<MzQCFile> file;
+    nlohmann::json json;
+};
+
+std::filesystem::path workDirectory() {
+    static const std::filesystem::path dir = [] {
+        auto path = std::filesystem::temp_directory_path() / ("mzqc_bench_" + std::to_string(::getpid()));
+        std::filesystem::create_directories(path);
+        return path;
+    }();
+    return dir;
+}
+
+std::string sourcePath(const std::string& relative) {
+    return std::string(MZQC_SOURCE_DIR) + "/" + relative;
+}
+
+std::string schemaPath() {
+    return sourcePath("schema/mzqc_schema.json");
+}
+
+std::shared_ptr<MzQCFile> generate(const BenchSize& size) {
+    std::mt19937_64 random(42);
+    std::uniform_real_distribution<double> real(0, 1000);
+    std::uniform_int_distribution<int64_t> integer(0, 1000000);
+
+    auto file = std::make_shared<MzQCFile>("2024-01-01T00:00:00Z", "1.0.0", "Bench", "bench@example.org",
+                                           "Synthetic benchmark file");
+    file->controlledVocabularies.push_back(std::make_shared<ControlledVocabulary>(
+        "Proteomics Standards Initiative Mass Spectrometry Ontology",
+        "https://github.com/HUPO-PSI/psi-ms-CV/releases/download/v4.1.155/psi-ms.obo", "4.1.155"));
+    file->controlledVocabularies.back()->id = "MS";
+
+    for (size_t r = 0; r < size.runs; ++r) {
+        const std::string label = "run_" + std::to_string(r);
+        RunQuality& run = file->addRun(
+            label,
+            std::vector<std::shared_ptr<InputFile>>{std::make_shared<InputFile>(
+                "file:///data/" + label + ".mzML", label + ".mzML",
+                std::make_shared<CvParameter>("MS:1000584", "mzML format"))},
+            std::vector<std::shared_ptr<AnalysisSoftware>>{
+                std::make_shared<AnalysisSoftware>("MS:1000799", "custom unreleased software tool", "1.0")});
+        for (size_t m = 0; m < size.metrics; ++m) {
+            const std::string accession = "MS:40000" + std::to_string(10 + m % 90);
+            switch (m % 4) {
+                case 0:
+                    run.addMetric(accession, "scalar metric", "", real(random));
+                    break;
+                case 1: {
+                    std::vector<double> values(size.arrayLength);
+                    for (auto& v : values) v = real(random);
+                    run.addMetric(accession, "double array metric", "", std::move(values));
+                    break;
+                }
+                case 2: {
+                    std::vector<int64_t> values(size.arrayLength);
+                    for (auto& v : values) v = integer(random);
+                    run.addMetric(accession, "integer array metric", "", std::move(values));
+                    break;
+                }
+                default: {
+                    std::vector<double> rt(size.arrayLength);
+                    std::vector<int64_t> charge(size.arrayLength);
+                    std::vector<std::string> peptide(size.arrayLength);
+                    for (size_t i = 0; i < size.arrayLength; ++i) {
+                        rt[i] = real(random);
+                        charge[i] = 1 + integer(random) % 4;
+                        peptide[i] = "PEPTIDE" + std::to_string(integer(random)) + "K";
+                    }
+                    MetricTable table;
+                    table.addColumn("RT", std::move(rt));
+                    table.addColumn("charge", std::move(charge));
+                    table.addColumn("peptide", std::move(peptide));
+                    run.addMetric(accession, "table metric", "", std::move(table));
+                    break;
+                }
+            }
+        }
+    }
+    return file;
+}
+
+std::vector<std::unique_ptr<Fixture>> fixtures;
+
+Fixture& makeFixture(const BenchSize& size) {
+    auto fixture = std::make_unique<Fixture>();
+    fixture->size = size;
+    const auto dir = workDirectory();
+    fixture->textPath = (dir / (size.name() + ".mzqc")).string();
+    fixture->binaryPath = (dir / (size.name() + ".cbor")).string();
+    fixture->outputPath = (dir / (size.name() + ".out.mzqc")).string();
+    fixture->file = generate(size);
+    fixture->file->toFile(fixture->textPath);
+    fixture->file->toBinaryFile(fixture->binaryPath);
+    fixture->textBytes = std::filesystem::file_size(fixture->textPath);
+    fixture->binaryBytes = std::filesystem::file_size(fixture->binaryPath);
+    fixture->json = fixture->file->toJson();
+    if (!validateAgainstSchema(fixture->json, schemaPath())) {
+        throw std::runtime_error("Synthetic file does not conform to the schema");
+    }
+    fixtures.push_back(std::move(fixture));
+    return *fixtures.back();
+}
+
+// Resident set size fields of /proc/self/status in kilobytes, -1 if absent
+long statusKilobytes(const char* field) {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    const size_t length = std::strlen(field);
+    while (std::getline(status, line)) {
+        if (line.compare(0, length, field) == 0 && line.size() > length && line[length] == ':') {
+            return std::strtol(line.c_str() + length + 1, nullptr, 10);
+        }
+    }
+    return -1;
+}
+
+// Resets the peak resident set size of the process to its current size, so
+// VmHWM covers only what follows. Linux 4.0 and later. Memory freed by
+// earlier benchmarks is handed back first, otherwise it stays resident and
+// hides the growth of the next one.
+bool resetPeakRss() {
+#ifdef __GLIBC__
+    ::malloc_trim(0);
+#endif
+    std::ofstream clearRefs("/proc/self/clear_refs");
+    clearRefs << "5";
+    clearRefs.close();
+    return static_cast<bool>(clearRefs);
+}
+
+// Counts the allocations between construction and report(). The peak
+// resident memory above the resident size at construction is this
+// benchmark's own; the counter is left out where the peak cannot be reset.
+class AllocationScope {
+public:
+    AllocationScope()
+        : count(allocationCount.load(std::memory_order_relaxed)),
+          bytes(allocationBytes.load(std::memory_order_relaxed)),
+          startRss(resetPeakRss() ? statusKilobytes("VmRSS") : -1) {}
+
+    void report(benchmark::State& state, size_t bytesProcessed) const {
+        const double iterations = static_cast<double>(std::max<benchmark::IterationCount>(state.iterations(), 1));
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(bytesProcessed));
+        state.counters["allocs"] =
+            static_cast<double>(allocationCount.load(std::memory_order_relaxed) - count) / iterations;
+        state.counters["alloc_MB"] =
+            static_cast<double>(allocationBytes.load(std::memory_order_relaxed) - bytes) / iterations / 1e6;
+        const long peakRss = statusKilobytes("VmHWM");
+        if (startRss >= 0 && peakRss >= 0) {
+            state.counters["peak_rss_growth_MB"] = static_cast<double>(std::max(peakRss - startRss, 0L)) / 1024;
+        }
+    }
+
+private:
+    size_t count;
+    size_t bytes;
+    long startRss;
+};
+
+template <typename Body>
+void measure(benchmark::State& state, size_t bytesProcessed, Body&& body) {
+    AllocationScope scope;
+    for (auto _ : state) {
+        body();
+    }
+    scope.report(state, bytesProcessed);
+}
+
+void registerFileBenchmarks(Fixture& f) {
+    const std::string suffix = "/" + f.size.name();
+
+    // Loading
+    benchmark::RegisterBenchmark(("Parse/Dom" + suffix).c_str(), [&f](benchmark::State& state) {
+        measure(state, f.textBytes, [&] {
+            std::ifstream in(f.textPath);
+            nlohmann::json j = nlohmann::json::parse(in);
+            benchmark::DoNotOptimize(MzQCFile::fromJsonStatic(std::move(j)));
+        });
+    });
+    benchmark::RegisterBenchmark(("Parse/Streaming" + suffix).c_str(), [&f](benchmark::State& state) {
+        measure(state, f.textBytes, [&] { benchmark::DoNotOptimize(MzQCFile::fromFile(f.textPath)); });
+    });
+    benchmark::RegisterBenchmark(("Parse/Parallel" + suffix).c_str(), [&f](benchmark::State& state) {
+        measure(state, f.textBytes, [&] { benchmark::DoNotOptimize(MzQCFile::fromFileParallel(f.textPath)); });
+    })->UseRealTime();
+    benchmark::RegisterBenchmark(("Parse/Arena" + suffix).c_str(), [&f](benchmark::State& state) {
+        measure(state, f.textBytes, [&] { benchmark::DoNotOptimize(MzQCDocument::fromFile(f.textPath)); });
+    });
+    benchmark::RegisterBenchmark(("Parse/Binary" + suffix).c_str(), [&f](benchmark::State& state) {
+        measure(state, f.binaryBytes, [&] { benchmark::DoNotOptimize(MzQCFile::fromBinaryFile(f.binaryPath)); });
+    });
+    benchmark::RegisterBenchmark(("Parse/Mapped" + suffix).c_str(), [&f](benchmark::State& state) {
+        measure(state, f.binaryBytes, [&] {
+            MappedMzQC mapped(f.binaryPath);
+            for (size_t i = 0; i < mapped.runCount(); ++i) {
+                benchmark::DoNotOptimize(mapped.run(i));
+            }
+        });
+    });
+
+    // Validation
+    benchmark::RegisterBenchmark(("Validate/Dom" + suffix).c_str(), [&f](benchmark::State& state) {
+        const std::string schema = schemaPath();
+        measure(state, f.textBytes, [&] { benchmark::DoNotOptimize(validateAgainstSchema(f.json, schema)); });
+    });
+    benchmark::RegisterBenchmark(("Validate/Streaming" + suffix).c_str(), [&f](benchmark::State& state) {
+        auto schema = loadCompiledSchema(schemaPath());
+        measure(state, f.textBytes, [&] {
+            std::ifstream in(f.textPath);
+            SchemaValidator validator(schema);
+            nlohmann::json::sax_parse(in, &validator);
+            if (!validator.valid()) state.SkipWithError("Synthetic file does not validate");
+        });
+    });
+
+    // Building and serializing
+    benchmark::RegisterBenchmark(("Build/Generate" + suffix).c_str(), [&f](benchmark::State& state) {
+        measure(state, f.textBytes, [&] { benchmark::DoNotOptimize(generate(f.size)); });
+    });
+    benchmark::RegisterBenchmark(("Serialize/ToJson" + suffix).c_str(), [&f](benchmark::State& state) {
+        measure(state, f.textBytes, [&] { benchmark::DoNotOptimize(f.file->toJson().dump(2)); });
+    });
+    benchmark::RegisterBenchmark(("Serialize/Dump" + suffix).c_str(), [&f](benchmark::State& state) {
+        measure(state, f.textBytes, [&] { benchmark::DoNotOptimize(f.file->dump(2)); });
+    });
+    benchmark::RegisterBenchmark(("Serialize/ToFile" + suffix).c_str(), [&f](benchmark::State& state) {
+        measure(state, f.textBytes, [&] { f.file->toFile(f.outputPath); });
+    });
+    benchmark::RegisterBenchmark(("Serialize/ToBinary" + suffix).c_str(), [&f](benchmark::State& state) {
+        measure(state, f.binaryBytes, [&] { benchmark::DoNotOptimize(f.file->toBinary()); });
+    });
+}
+
+void registerOboBenchmarks() {
+    const std::string obo = sourcePath("schema/qc-cv.obo");
+    if (!std::filesystem::exists(obo)) return;
+    const size_t bytes = std::filesystem::file_size(obo);
+
+    benchmark::RegisterBenchmark("Obo/Parse", [obo, bytes](benchmark::State& state) {
+        measure(state, bytes, [&] {
+            CvTermCache cache;
+            benchmark::DoNotOptimize(cache.loadFromOboFile(obo));
+        });
+    });
+    benchmark::RegisterBenchmark("Obo/Snapshot", [obo, bytes](benchmark::State& state) {
+        const std::string snapshot = (workDirectory() / "qc-cv.snapshot").string();
+        CvTermCache().loadCached(obo, snapshot);
+        measure(state, bytes, [&] {
+            CvTermCache cache;
+            benchmark::DoNotOptimize(cache.loadCached(obo, snapshot));
+        });
+    });
+}
+
+// One metric per iteration, from strings as read from a file or from the
+// compile-time QC CV registry
+void registerMetricBenchmarks() {
+    benchmark::RegisterBenchmark("Metric/FromStrings", [](benchmark::State& state) {
+        measure(state, 0, [&] {
+            benchmark::DoNotOptimize(
+                QualityMetric("MS:4000059", "Number of MS1 spectra", "", int64_t(5120), "UO:0000189"));
+        });
+    });
+    benchmark::RegisterBenchmark("Metric/FromRegistry", [](benchmark::State& state) {
+        measure(state, 0, [&] { benchmark::DoNotOptimize(make_metric<cv::MS_4000059>(int64_t(5120))); });
+    });
+}
+
+// Identification table shaped like the CSV of test/example.cpp
+std::string writeCsv(size_t rows) {
+    const std::string path = (workDirectory() / ("ids_" + std::to_string(rows) + ".csv")).string();
+    std::mt19937_64 random(7);
+    std::uniform_real_distribution<double> rt(0, 120);
+    std::uniform_real_distribution<double> mz(300, 1500);
+    std::uniform_real_distribution<double> ppm(-10, 10);
+    std::ofstream out(path);
+    out << "RT,peptide,target,MZ,deltaPPM\n";
+    for (size_t i = 0; i < rows; ++i) {
+        out << rt(random) << ",.(iTRAQ4plex)PEPT" << i % 9973 << "IDEK," << (i % 20 ? "TRUE" : "FALSE") << ','
+            << mz(random) << ',' << ppm(random) << '\n';
+    }
+    return path;
+}
+
+void registerCsvBenchmark(const std::string& path) {
+    const size_t bytes = std::filesystem::file_size(path);
+    benchmark::RegisterBenchmark("Csv/Ingest", [path, bytes](benchmark::State& state) {
+        CsvTableOptions options;
+        options.columns = identificationColumns();
+        measure(state, bytes, [&] {
+            benchmark::DoNotOptimize(
+                CsvTableReader(options).readMetric(path, "QC:0000000", "Example Metric", "", ""));
+        });
+    })->UseRealTime();
+}
+
+bool parseSize(const std::string& text, BenchSize& size) {
+    char x1 = 0;
+    char x2 = 0;
+    std::istringstream in(text);
+    in >> size.runs >> x1 >> size.metrics >> x2 >> size.arrayLength;
+    return in && x1 == 'x' && x2 == 'x' && in.peek() == EOF;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    // Our flags are taken out before the benchmark library sees the rest
+    std::vector<BenchSize> sizes;
+    std::string csv;
+    size_t csvRows = 200000;
+    std::vector<char*> rest{argv[0]};
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg.rfind("--size=", 0) == 0) {
+            BenchSize size;
+            if (!parseSize(arg.substr(7), size)) {
+                std::cerr << "Invalid size, expected RUNSxMETRICSxARRAY: " << arg << std::endl;
+                return 1;
+            }
+            sizes.push_back(size);
+        } else if (arg.rfind("--csv=", 0) == 0) {
+            csv = arg.substr(6);
+        } else if (arg.rfind("--csv_rows=", 0) == 0) {
+            csvRows = std::stoul(arg.substr(11));
+        } else {
+            rest.push_back(argv[i]);
+        }
+    }
+    if (sizes.empty()) {
+        sizes = {{100, 20, 64}, {1000, 20, 256}};
+    }
+
+    int restCount = static_cast<int>(rest.size());
+    benchmark::Initialize(&restCount, rest.data());
+    if (benchmark::ReportUnrecognizedArguments(restCount, rest.data())) return 1;
+
+    try {
+        for (const auto& size : sizes) {
+            registerFileBenchmarks(makeFixture(size));
+        }
+        registerOboBenchmarks();
+        registerMetricBenchmarks();
+        registerCsvBenchmark(csv.empty() ? writeCsv(csvRows) : csv);
+    } catch (const std::exception& e) {
+        std::cerr << "Could not prepare benchmark inputs: " << e.what() << std::endl;
+        return 1;
+    }
+
+    Stats::global().setAllocationCounter([] { return uint64_t(allocationCount.load(std::memory_order_relaxed)); });
+    Stats::global().reset();
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+
+    if (Stats::enabled) {
+        std::cout << "\nLibrary stats (operation/phase: calls, ms, MB, allocations)\n";
+        for (const auto& [key, totals] : Stats::global().totals()) {
+            std::cout << "  " << key << ": " << totals.calls << ", " << totals.nanoseconds / 1e6 << ", "
+                      << totals.bytes / 1e6 << ", " << totals.allocations << "\n";
+        }
+    }
+
+    fixtures.clear();
+    std::error_code error;
+    std::filesystem::remove_all(workDirectory(), error);
+    return 0;
+}
@@ -144,7 +144,7 @@ int main(int argc, char* argv[]) {
                         std::cout << " [" << metric->unit << "]";
                     }
                     std::cout << " = ";
-                    displayMetricValue(metric->value);
+                    displayMetricValue(metric->value.toJson());
                     std::cout << std::endl;
                 }
             }
@@ -170,7 +170,7 @@ int main(int argc, char* argv[]) {
                         std::cout << " [" << metric->unit << "]";
                     }
                     std::cout << " = ";
-                    displayMetricValue(metric->value);
+                    displayMetricValue(metric->value.toJson());
                     std::cout << std::endl;
                 }
             }
@@ -0,0 +1,117 @@
+#include "mzqc_aggregate.hpp"
+#include "test_support.hpp"
+#include <gtest/gtest.h>
+#include <cmath>
+
+using namespace mzqc;
+
+namespace {
+
+const std::map<std::string, SetMetricTerm> setTerms = {
+    {"MS:4000053", {"XX:0000001", "chromatography duration summary"}},
+    {"MS:4000065", {"XX:0000002", "precursor error summary"}},
+};
+
+SetAggregate aggregateRuns(size_t first, size_t count) {
+    SetAggregate aggregate;
+    for (size_t i = first; i < first + count; ++i) {
+        aggregate.add(*test::sampleRun("run " + std::to_string(i), i));
+    }
+    return aggregate;
+}
+
+} // namespace
+
+TEST(MetricAggregate, ExactMoments) {
+    MetricAggregate values;
+    const double data[] = {1, 2, 3, 4, NAN, 5};
+    values.add(data, 6);
+    EXPECT_EQ(values.runs(), 1u);
+    EXPECT_EQ(values.count(), 5u);
+    EXPECT_DOUBLE_EQ(values.mean(), 3);
+    EXPECT_DOUBLE_EQ(values.stddev(), std::sqrt(2.5));
+    EXPECT_DOUBLE_EQ(values.sketch().min(), 1);
+    EXPECT_DOUBLE_EQ(values.sketch().max(), 5);
+    EXPECT_TRUE(std::isnan(MetricAggregate().mean()));
+}
+
+TEST(MetricAggregate, MergeMatchesSingleAggregate) {
+    MetricAggregate left;
+    MetricAggregate right;
+    MetricAggregate both;
+    const double a[] = {1.5, 2.5, 10};
+    const double b[] = {-4, 7, 8, 9};
+    left.add(a, 3);
+    right.add(b, 4);
+    both.add(a, 3);
+    both.add(b, 4);
+    left.merge(right);
+    EXPECT_EQ(left.runs(), 2u);
+    EXPECT_EQ(left.count(), 7u);
+    EXPECT_NEAR(left.mean(), both.mean(), 1e-12);
+    EXPECT_NEAR(left.stddev(), both.stddev(), 1e-12);
+    auto copy = MetricAggregate::fromJson(left.toJson());
+    EXPECT_DOUBLE_EQ(copy.mean(), left.mean());
+    EXPECT_EQ(copy.count(), left.count());
+}
+
+TEST(SetAggregate, ShardsMergeToTheSameResult) {
+    auto whole = aggregateRuns(0, 6);
+    auto shard = aggregateRuns(0, 3);
+    shard.merge(SetAggregate::fromBinary(aggregateRuns(3, 3).toBinary()));
+    EXPECT_EQ(shard.runLabels(), whole.runLabels());
+    for (const char* accession : {"MS:4000059", "MS:4000053", "MS:4000065", "MS:4000061"}) {
+        const auto* expected = whole.aggregate(accession);
+        const auto* merged = shard.aggregate(accession);
+        ASSERT_NE(expected, nullptr) << accession;
+        ASSERT_NE(merged, nullptr) << accession;
+        EXPECT_EQ(merged->count(), expected->count());
+        EXPECT_NEAR(merged->mean(), expected->mean(), 1e-9);
+        EXPECT_NEAR(merged->stddev(), expected->stddev(), 1e-9);
+    }
+    // Tables and text are not aggregated
+    EXPECT_EQ(whole.aggregate("MS:4000078"), nullptr);
+    EXPECT_EQ(whole.aggregate("MS:4000000"), nullptr);
+    EXPECT_EQ(whole.aggregate("MS:4000065")->count(), 240u);
+}
+
+TEST(SetAggregate, AccessionFilter) {
+    SetAggregateOptions options;
+    options.accessions = {"MS:4000053"};
+    SetAggregate filtered(options);
+    filtered.add(*test::sampleRun("run", 1));
+    EXPECT_NE(filtered.aggregate("MS:4000053"), nullptr);
+    EXPECT_EQ(filtered.aggregate("MS:4000065"), nullptr);
+    EXPECT_THROW(filtered.merge(SetAggregate()), std::runtime_error);
+}
+
+TEST(SetAggregate, AddFileMatchesAdd) {
+    test::TempDir dir;
+    auto file = test::sampleFile(4);
+    file->toFile(dir.path("runs.mzqc"));
+    SetAggregate streamed;
+    streamed.addFile(dir.path("runs.mzqc"));
+    SetAggregate added;
+    for (const auto& run : file->runQualities) added.add(*run);
+    EXPECT_EQ(streamed.toJson(), added.toJson());
+}
+
+TEST(SetAggregate, SetQualityUsesSetLevelTerms) {
+    auto aggregate = aggregateRuns(0, 4);
+    auto set = aggregate.toSetQuality("summary", setTerms);
+    EXPECT_EQ(set->label, "summary");
+    EXPECT_EQ(set->setRefs, aggregate.runLabels());
+    // Only mapped aggregates are reported, never under the run accession
+    ASSERT_EQ(set->metrics.size(), 2u);
+    const auto& duration = *set->metrics[0];
+    EXPECT_EQ(duration.accession, "XX:0000001");
+    EXPECT_EQ(duration.name, "chromatography duration summary");
+    EXPECT_EQ(duration.unit, "UO:0000010");
+    const auto* table = duration.value.table();
+    ASSERT_NE(table, nullptr);
+    EXPECT_EQ(table->rowCount(), 1u);
+    EXPECT_EQ(*table->columnAs<int64_t>("runs"), std::vector<int64_t>{4});
+    EXPECT_DOUBLE_EQ(table->columnAs<double>("mean")->front(), aggregate.aggregate("MS:4000053")->mean());
+    EXPECT_EQ(set->metrics[1]->accession, "XX:0000002");
+    EXPECT_TRUE(aggregate.toSetQuality("summary", {})->metrics.empty());
+}
@@ -0,0 +1,84 @@
+#include "mzqc_async.hpp"
+#include "test_support.hpp"
+#include <gtest/gtest.h>
+#include <iterator>
+
+using namespace mzqc;
+
+namespace {
+
+// Text spanning many 4 KiB chunks, with a partial last one
+std::string chunkedText() {
+    std::string text;
+    for (int i = 0; text.size() < 10 * 4096 + 123; ++i) text += "line " + std::to_string(i) + "\n";
+    return text;
+}
+
+} // namespace
+
+TEST(AsyncStreams, ReadAheadReadsEveryChunk) {
+    test::TempDir dir;
+    const std::string text = chunkedText();
+    test::writeText(dir.path("in.txt"), text);
+
+    ReadAheadStreamBuf buffer(dir.path("in.txt"), 4096);
+    char start[5] = {};
+    EXPECT_EQ(buffer.peek(start, 5), 5u);
+    EXPECT_EQ(std::string(start, 5), "line ");
+    std::istream in(&buffer);
+    std::string read((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    EXPECT_EQ(read, text);
+
+    EXPECT_THROW(ReadAheadStreamBuf(dir.path("missing.txt")), std::runtime_error);
+}
+
+TEST(AsyncStreams, WriteBehindWritesEveryChunk) {
+    test::TempDir dir;
+    const std::string text = chunkedText();
+    {
+        WriteBehindStreamBuf buffer(dir.path("out.txt"), 4096);
+        std::ostream out(&buffer);
+        // Small and large writes, and a flush in between
+        out << text.substr(0, 100);
+        out.flush();
+        out.write(text.data() + 100, static_cast<std::streamsize>(text.size() - 100));
+        buffer.finish();
+    }
+    EXPECT_EQ(test::readText(dir.path("out.txt")), text);
+
+    EXPECT_THROW(WriteBehindStreamBuf(dir.path("missing/out.txt")), std::runtime_error);
+}
+
+TEST(AsyncLoadSave, MatchesBlockingCalls) {
+    test::TempDir dir;
+    auto file = test::sampleFile(3);
+    file->toFile(dir.path("blocking.mzqc"));
+    MzQCFile::saveAsync(file, dir.path("async.mzqc")).get();
+    EXPECT_EQ(test::readText(dir.path("async.mzqc")), test::readText(dir.path("blocking.mzqc")));
+
+    auto loaded = MzQCFile::loadAsync(dir.path("async.mzqc"), test::schemaPath()).get();
+    ASSERT_NE(loaded, nullptr);
+    EXPECT_EQ(loaded->toJson(), file->toJson());
+}
+
+TEST(AsyncLoadSave, CompressedFiles) {
+    if (!compressionAvailable(Compression::Gzip)) GTEST_SKIP() << "gzip not built in";
+    test::TempDir dir;
+    auto file = test::sampleFile(2);
+    MzQCFile::saveAsync(file, dir.path("file.mzqc.gz")).get();
+    EXPECT_EQ(MzQCFile::fromFile(dir.path("file.mzqc.gz"))->toJson(), file->toJson());
+    EXPECT_EQ(MzQCFile::loadAsync(dir.path("file.mzqc.gz")).get()->toJson(), file->toJson());
+}
+
+TEST(AsyncLoadSave, ErrorsSurfaceThroughTheFuture) {
+    test::TempDir dir;
+    auto missing = MzQCFile::loadAsync(dir.path("missing.mzqc"));
+    EXPECT_THROW(missing.get(), std::runtime_error);
+
+    test::writeText(dir.path("invalid.mzqc"), "{\"mzQC\": {\"version\": 1}}");
+    auto invalid = MzQCFile::loadAsync(dir.path("invalid.mzqc"), test::schemaPath());
+    EXPECT_ANY_THROW(invalid.get());
+
+    auto unwritable = MzQCFile::saveAsync(test::sampleFile(1), dir.path("missing/file.mzqc"));
+    EXPECT_THROW(unwritable.get(), std::runtime_error);
+}
@@ -0,0 +1,61 @@
+#include "mzqc.hpp"
+#include "test_support.hpp"
+#include <gtest/gtest.h>
+#include <cstring>
+
+using namespace mzqc;
+
+TEST(BinaryEncoding, RoundTrip) {
+    auto file = test::sampleFile();
+    for (BinaryFormat format : {BinaryFormat::Cbor, BinaryFormat::MessagePack}) {
+        const std::vector<uint8_t> bytes = file->toBinary(format);
+        auto decoded = MzQCFile::fromBinary(bytes, format);
+        EXPECT_EQ(decoded->dump(2), file->dump(2));
+        // Typed arrays come back as typed storage, not as json
+        const auto& metrics = decoded->runQualities[0]->metrics;
+        ASSERT_NE(metrics[2]->value.doubles(), nullptr);
+        EXPECT_EQ(*metrics[2]->value.doubles(), *file->runQualities[0]->metrics[2]->value.doubles());
+        ASSERT_NE(metrics[3]->value.integers(), nullptr);
+        ASSERT_NE(metrics[4]->value.table(), nullptr);
+    }
+}
+
+TEST(BinaryEncoding, ExactNumbers) {
+    std::vector<double> doubles = {0.1 + 0.2, 1e-300, 4.9e-324, -0.0, 1.7976931348623157e308};
+    std::vector<int64_t> integers = {INT64_MIN, -1, 0, INT64_MAX};
+    auto file = test::sampleFile(1);
+    file->runQualities[0]->addMetric("MS:4000065", "doubles", "", MetricValue(doubles));
+    file->runQualities[0]->addMetric("MS:4000061", "integers", "", MetricValue(integers));
+    auto decoded = MzQCFile::fromBinary(file->toBinary());
+    const auto& metrics = decoded->runQualities[0]->metrics;
+    ASSERT_NE(metrics[metrics.size() - 2]->value.doubles(), nullptr);
+    const auto& decodedDoubles = *metrics[metrics.size() - 2]->value.doubles();
+    for (size_t i = 0; i < doubles.size(); ++i) {
+        EXPECT_EQ(std::memcmp(&decodedDoubles[i], &doubles[i], sizeof(double)), 0) << i;
+    }
+    EXPECT_EQ(*metrics.back()->value.integers(), integers);
+}
+
+TEST(BinaryEncoding, FileRoundTrip) {
+    test::TempDir dir;
+    auto file = test::sampleFile();
+    file->toBinaryFile(dir.path("sample.cbor"));
+    EXPECT_EQ(MzQCFile::fromBinaryFile(dir.path("sample.cbor"))->dump(), file->dump());
+    file->toBinaryFile(dir.path("sample.msgpack"), BinaryFormat::MessagePack);
+    EXPECT_EQ(MzQCFile::fromBinaryFile(dir.path("sample.msgpack"), BinaryFormat::MessagePack)->dump(), file->dump());
+}
+
+TEST(BinaryEncoding, PlainCborIsAccepted) {
+    // CBOR written by other tools has plain arrays instead of typed ones
+    auto file = test::sampleFile();
+    const std::vector<uint8_t> plain = nlohmann::json::to_cbor(file->toJson());
+    EXPECT_EQ(MzQCFile::fromBinary(plain)->dump(), file->dump());
+}
+
+TEST(BinaryEncoding, RejectsMalformedInput) {
+    auto bytes = test::sampleFile()->toBinary();
+    bytes.resize(bytes.size() / 2);
+    EXPECT_ANY_THROW(MzQCFile::fromBinary(bytes));
+    EXPECT_ANY_THROW(MzQCFile::fromBinary(std::vector<uint8_t>{0xff, 0x00}));
+    EXPECT_ANY_THROW(MzQCFile::fromBinaryFile("missing.cbor"));
+}
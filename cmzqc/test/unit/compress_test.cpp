@@ -0,0 +1,98 @@
+#include "mzqc_compress.hpp"
+#include "test_support.hpp"
+#include <gtest/gtest.h>
+#include <sstream>
+
+using namespace mzqc;
+
+namespace {
+
+class CompressionTest : public ::testing::TestWithParam<Compression> {
+protected:
+    void SetUp() override {
+        if (!compressionAvailable(GetParam())) GTEST_SKIP() << "format not built in";
+    }
+
+    std::string extension() const { return GetParam() == Compression::Gzip ? ".gz" : ".zst"; }
+};
+
+std::string compressed(const std::string& text, Compression type, int level = 0) {
+    std::stringbuf sink;
+    {
+        CompressingStreamBuf buffer(sink, type, level);
+        std::ostream out(&buffer);
+        out << text;
+        out.flush();
+        buffer.finish();
+    }
+    return sink.str();
+}
+
+std::string decompressed(const std::string& data, Compression type) {
+    std::stringbuf source(data);
+    DecompressingStreamBuf buffer(source, type);
+    std::istream in(&buffer);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+} // namespace
+
+TEST(Compression, NamesAndMagic) {
+    EXPECT_EQ(compressionForPath("a.mzqc.gz"), Compression::Gzip);
+    EXPECT_EQ(compressionForPath("a.mzqc.zst"), Compression::Zstd);
+    EXPECT_EQ(compressionForPath("a.mzqc"), Compression::None);
+    const unsigned char gzip[] = {0x1f, 0x8b, 0x08};
+    const unsigned char zstd[] = {0x28, 0xb5, 0x2f, 0xfd};
+    EXPECT_EQ(detectCompression(gzip, sizeof(gzip)), Compression::Gzip);
+    EXPECT_EQ(detectCompression(zstd, sizeof(zstd)), Compression::Zstd);
+    EXPECT_EQ(detectCompression("{\"mzQC\"", 7), Compression::None);
+    EXPECT_EQ(detectCompression(gzip, 1), Compression::None);
+}
+
+TEST_P(CompressionTest, StreamRoundTrip) {
+    const std::string text = test::sampleFile(10)->dump(2);
+    for (int level : {0, 1, 9}) {
+        const std::string data = compressed(text, GetParam(), level);
+        EXPECT_LT(data.size(), text.size());
+        EXPECT_EQ(detectCompression(data.data(), data.size()), GetParam());
+        EXPECT_EQ(decompressed(data, GetParam()), text);
+    }
+    EXPECT_EQ(decompressed(compressed("", GetParam()), GetParam()), "");
+}
+
+TEST_P(CompressionTest, ConcatenatedFrames) {
+    const std::string data = compressed("first ", GetParam()) + compressed("second", GetParam());
+    EXPECT_EQ(decompressed(data, GetParam()), "first second");
+}
+
+TEST_P(CompressionTest, FileRoundTrip) {
+    test::TempDir dir;
+    auto file = test::sampleFile();
+    const std::string path = dir.path("sample.mzqc" + extension());
+    file->toFile(path);
+    const std::string raw = test::readText(path);
+    EXPECT_EQ(detectCompression(raw.data(), raw.size()), GetParam());
+    EXPECT_EQ(MzQCFile::fromFile(path)->dump(2), file->dump(2));
+    EXPECT_EQ(MzQCFile::fromFileParallel(path)->dump(2), file->dump(2));
+    EXPECT_EQ(MzQCFile::fromFile(path, test::schemaPath())->dump(), file->dump());
+
+    // The format is detected from the content, not the name
+    CompressionOptions options;
+    options.type = GetParam();
+    file->toFile(dir.path("plain-name.mzqc"), "", options);
+    EXPECT_EQ(MzQCFile::fromFile(dir.path("plain-name.mzqc"))->dump(), file->dump());
+    FileInputStream in(dir.path("plain-name.mzqc"));
+    EXPECT_EQ(in.compression(), GetParam());
+}
+
+TEST_P(CompressionTest, TruncatedInputThrows) {
+    test::TempDir dir;
+    const std::string data = compressed(test::sampleFile()->dump(2), GetParam());
+    test::writeText(dir.path("truncated" + extension()), data.substr(0, data.size() / 2));
+    EXPECT_THROW(MzQCFile::fromFile(dir.path("truncated" + extension())), std::runtime_error);
+}
+
+INSTANTIATE_TEST_SUITE_P(Formats, CompressionTest, ::testing::Values(Compression::Gzip, Compression::Zstd),
+                         [](const ::testing::TestParamInfo<Compression>& info) {
+                             return info.param == Compression::Gzip ? "Gzip" : "Zstd";
+                         });
@@ -0,0 +1,135 @@
+#include "mzqc_csv.hpp"
+#include "test_support.hpp"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <string>
+
+using namespace mzqc;
+
+namespace {
+
+CsvTableReader reader(std::vector<CsvColumn> columns = {}, unsigned threads = 1) {
+    CsvTableOptions options;
+    options.columns = std::move(columns);
+    options.threads = threads;
+    return CsvTableReader(options);
+}
+
+// Message of the runtime_error thrown by parse, empty if it succeeds
+std::string parseError(const CsvTableReader& csv, const std::string& text) {
+    try {
+        csv.parse(text);
+    } catch (const std::runtime_error& e) {
+        return e.what();
+    }
+    return "";
+}
+
+} // namespace
+
+TEST(CsvTableReader, KeepsEveryColumnAsStrings) {
+    MetricTable table = reader().parse("a,b\n1,x\n2,y\n");
+    ASSERT_EQ(table.columnCount(), 2u);
+    EXPECT_EQ(table.rowCount(), 2u);
+    EXPECT_EQ(*table.columnAs<std::string>("a"), (std::vector<std::string>{"1", "2"}));
+    EXPECT_EQ(*table.columnAs<std::string>("b"), (std::vector<std::string>{"x", "y"}));
+}
+
+TEST(CsvTableReader, ConvertsSelectedColumns) {
+    auto csv = reader({{"rt", "RT", CsvColumnType::Double},
+                       {"charge", "", CsvColumnType::Integer},
+                       {"target", "", CsvColumnType::Boolean}});
+    MetricTable table = csv.parse("\xEF\xBB\xBFtarget,skip,charge,rt\r\nTRUE,a,+2, 1.5\r\n0,b,3,\r\n\r\n");
+    ASSERT_EQ(table.columnCount(), 3u);
+    EXPECT_EQ(table.columnName(0), "RT");
+    const auto& rt = *table.columnAs<double>("RT");
+    ASSERT_EQ(rt.size(), 2u);
+    EXPECT_EQ(rt[0], 1.5);
+    EXPECT_TRUE(std::isnan(rt[1]));
+    EXPECT_EQ(*table.columnAs<int64_t>("charge"), (std::vector<int64_t>{2, 3}));
+    EXPECT_EQ(*table.columnAs<bool>("target"), (std::vector<bool>{true, false}));
+}
+
+TEST(CsvTableReader, QuotedFields) {
+    MetricTable table = reader().parse(
+        "name,note\n"
+        "\"a,b\",\"say \"\"hi\"\"\"\n"
+        "\"two\nlines\",plain\"quote\n"
+        "\"\",x\n");
+    EXPECT_EQ(*table.columnAs<std::string>("name"), (std::vector<std::string>{"a,b", "two\nlines", ""}));
+    EXPECT_EQ(*table.columnAs<std::string>("note"), (std::vector<std::string>{"say \"hi\"", "plain\"quote", "x"}));
+}
+
+TEST(CsvTableReader, QuotedHeader) {
+    auto csv = reader({{"m/z, obs", "mz", CsvColumnType::Double}});
+    MetricTable table = csv.parse("id,\"m/z, obs\"\n1,100.5\n");
+    EXPECT_EQ(*table.columnAs<double>("mz"), std::vector<double>{100.5});
+}
+
+TEST(CsvTableReader, OtherDelimiter) {
+    CsvTableOptions options;
+    options.delimiter = '\t';
+    options.threads = 1;
+    MetricTable table = CsvTableReader(options).parse("a\tb\n1,2\t3\n");
+    EXPECT_EQ(*table.columnAs<std::string>("a"), std::vector<std::string>{"1,2"});
+}
+
+TEST(CsvTableReader, ErrorsNameTheLine) {
+    auto csv = reader({{"charge", "", CsvColumnType::Integer}});
+    EXPECT_EQ(parseError(csv, "charge\n1\n2\nthree\n4\n"), "CSV:4: column 'charge': 'three' is not an integer");
+
+    // Lines inside a quoted field count
+    auto strings = reader({{"a", "", CsvColumnType::String}, {"b", "", CsvColumnType::Integer}});
+    EXPECT_EQ(parseError(strings, "a,b\n\"x\ny\",1\n\"z\"w,2\n"), "CSV:4: unexpected character after quoted field");
+    EXPECT_EQ(parseError(strings, "a,b\n1,2\n3\n"), "CSV:3: expected at least 2 fields, found 1");
+    EXPECT_EQ(parseError(strings, "a,b\n\"open,1\n"), "CSV:2: unterminated quoted field");
+}
+
+TEST(CsvTableReader, HeaderErrors) {
+    EXPECT_EQ(parseError(reader(), ""), "CSV: missing CSV header");
+    EXPECT_EQ(parseError(reader({{"missing", "", CsvColumnType::Double}}), "a,b\n1,2\n"),
+              "CSV: CSV column 'missing' not found");
+    EXPECT_EQ(parseError(reader({{"b", "", CsvColumnType::Boolean}}), "a,b\n1,yes\n"),
+              "CSV:2: column 'b': 'yes' is not a boolean");
+}
+
+TEST(CsvTableReader, ChunkedParseMatchesSingleThread) {
+    // Large enough to be split into several chunks
+    std::string text = "index,value\n";
+    const int rows = 300000;
+    for (int i = 0; i < rows; ++i) text += std::to_string(i) + "," + std::to_string(i * 0.25) + "\n";
+    ASSERT_GE(text.size(), 4u << 20);
+
+    std::vector<CsvColumn> columns{{"index", "", CsvColumnType::Integer}, {"value", "", CsvColumnType::Double}};
+    MetricTable serial = reader(columns, 1).parse(text);
+    MetricTable chunked = reader(columns, 4).parse(text);
+    ASSERT_EQ(chunked.rowCount(), size_t(rows));
+    EXPECT_EQ(*chunked.columnAs<int64_t>("index"), *serial.columnAs<int64_t>("index"));
+    EXPECT_EQ(*chunked.columnAs<double>("value"), *serial.columnAs<double>("value"));
+    EXPECT_EQ((*chunked.columnAs<int64_t>("index"))[rows - 1], rows - 1);
+
+    // The line number is counted over the whole text, not within the chunk
+    std::string bad = text + "x,1\n";
+    EXPECT_EQ(parseError(reader(columns, 4), bad),
+              "CSV:" + std::to_string(rows + 2) + ": column 'index': 'x' is not an integer");
+}
+
+TEST(CsvTableReader, ReadMetricFromFile) {
+    test::TempDir dir;
+    std::string path = dir.path("ids.csv");
+    test::writeText(path, "RT,peptide,target,MZ,deltaPPM,extra\n10.5,PEPTIDE,true,500.25,-1.5,z\n");
+    CsvTableOptions options;
+    options.columns = identificationColumns();
+    auto metric = CsvTableReader(options).readMetric(path, "MS:4000078", "table", "", "UO:0000010");
+    ASSERT_NE(metric->value.table(), nullptr);
+    const MetricTable& table = *metric->value.table();
+    EXPECT_EQ(table.columnCount(), 5u);
+    EXPECT_EQ(*table.columnAs<std::string>("peptide"), std::vector<std::string>{"PEPTIDE"});
+
+    try {
+        CsvTableReader(options).read(dir.path("absent.csv"));
+        FAIL() << "expected an exception";
+    } catch (const std::runtime_error& e) {
+        EXPECT_NE(std::string(e.what()).find("Could not open file"), std::string::npos);
+    }
+}
@@ -0,0 +1,64 @@
+#include "mzqc_cv.hpp"
+#include "test_support.hpp"
+#include <gtest/gtest.h>
+
+using namespace mzqc;
+
+// The checks of make_metric run at compile time
+static_assert(cv::termId("MS:4000059") == cv::MS_4000059::id);
+static_assert(cv::termId("MS:9999999") == cv::npos);
+static_assert(cv::isA(cv::MS_4000059::id, cv::termId("MS:4000003")));
+static_assert(!cv::isA(cv::termId("MS:4000003"), cv::MS_4000059::id));
+static_assert(cv::isMetric(cv::MS_4000059::id));
+static_assert(!cv::isMetric(cv::termId("MS:4000003")));
+static_assert(cv::accepts<int64_t>(cv::MS_4000059::id));
+static_assert(cv::accepts<double>(cv::MS_4000059::id));
+static_assert(!cv::accepts<bool>(cv::MS_4000059::id));
+static_assert(!cv::accepts<std::vector<double>>(cv::MS_4000059::id));
+static_assert(cv::accepts<std::vector<double>>(cv::MS_4000078::id));
+static_assert(!cv::accepts<MetricTable>(cv::MS_4000078::id));
+static_assert(cv::accepts<MetricTable>(cv::MS_4000067::id));
+
+TEST(CvRegistry, MatchesOboFile) {
+    CvTermCache cache;
+    ASSERT_GT(cache.loadFromOboFile(test::sourcePath("schema/qc-cv.obo")), 0);
+    for (uint32_t id = 0; id < cv::termCount; ++id) {
+        const CvTermInfo& info = cv::term(id);
+        if (id > 0) {
+            EXPECT_LT(cv::term(id - 1).accession, info.accession);
+        }
+        EXPECT_EQ(cv::termId(info.accession), id);
+
+        const std::string accession(info.accession);
+        const auto* details = cache.lookup(accession);
+        ASSERT_NE(details, nullptr) << accession;
+        EXPECT_EQ(details->name, info.name) << accession;
+        EXPECT_EQ(details->unit.value_or(""), info.unit) << accession;
+        for (uint32_t k = 0; k < info.ancestorCount; ++k) {
+            const std::string ancestor(cv::term(cv::ancestorIds[info.firstAncestor + k]).accession);
+            EXPECT_TRUE(cache.isA(accession, ancestor)) << accession << " " << ancestor;
+        }
+    }
+}
+
+TEST(CvRegistry, MakeMetric) {
+    QualityMetric count = make_metric<cv::MS_4000059>(int64_t(5120), "from the raw file");
+    EXPECT_EQ(count.accession, "MS:4000059");
+    EXPECT_EQ(count.name, "Number of MS1 spectra");
+    EXPECT_EQ(count.unit, "UO:0000189");
+    EXPECT_EQ(count.description, "from the raw file");
+    EXPECT_EQ(count.value.json()->get<int64_t>(), 5120);
+
+    QualityMetric quantiles = make_metric<cv::MS_4000078>(std::vector<double>{0.25, 0.5, 0.75});
+    EXPECT_EQ(quantiles.value.doubles()->size(), 3u);
+    EXPECT_EQ(quantiles.unit, "");
+
+    MetricTable table;
+    table.addColumn("RT", std::vector<double>{1, 2});
+    QualityMetric chromatogram = make_metric<cv::MS_4000067>(std::move(table));
+    ASSERT_NE(chromatogram.value.table(), nullptr);
+    EXPECT_EQ(chromatogram.value.table()->rowCount(), 2u);
+
+    // The same interned strings on every call
+    EXPECT_EQ(make_metric<cv::MS_4000059>(1.5).name.handle(), count.name.handle());
+}
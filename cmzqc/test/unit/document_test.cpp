@@ -0,0 +1,145 @@
+#include "mzqc_document.hpp"
+#include "test_support.hpp"
+#include <gtest/gtest.h>
+#include <sstream>
+
+using namespace mzqc;
+
+namespace {
+
+std::unique_ptr<MzQCDocument> fromText(const std::string& text) {
+    std::istringstream in(text);
+    return MzQCDocument::fromStream(in);
+}
+
+} // namespace
+
+TEST(MzQCDocument, RoundTripsThroughMzQCFile) {
+    auto file = test::sampleFile();
+    auto parsed = fromText(file->dump(2));
+    auto converted = MzQCDocument::fromMzQCFile(*file);
+    EXPECT_EQ(parsed->toMzQCFile()->dump(2), file->dump(2));
+    EXPECT_EQ(converted->toMzQCFile()->dump(2), file->dump(2));
+}
+
+TEST(MzQCDocument, FileRoundTrip) {
+    test::TempDir dir;
+    auto file = test::sampleFile();
+    file->toFile(dir.path("sample.mzqc"));
+    auto doc = MzQCDocument::fromFile(dir.path("sample.mzqc"));
+    EXPECT_EQ(doc->toMzQCFile()->dump(), file->dump());
+}
+
+TEST(MzQCDocument, NodeRanges) {
+    auto file = test::sampleFile();
+    auto doc = fromText(file->dump());
+    ASSERT_EQ(doc->runQualities().size(), 3u);
+    ASSERT_EQ(doc->setQualities().size(), 1u);
+    EXPECT_EQ(doc->version, "1.0.0");
+    EXPECT_EQ(doc->controlledVocabularies().begin()->id, "MS");
+
+    const auto& run = doc->runQualities().begin()[1];
+    EXPECT_EQ(run.label, file->runQualities[1]->label);
+    ASSERT_EQ(doc->metrics(run).size(), file->runQualities[1]->metrics.size());
+    ASSERT_EQ(doc->inputFiles(run).size(), 1u);
+    const auto& input = *doc->inputFiles(run).begin();
+    ASSERT_NE(doc->fileFormat(input), nullptr);
+    EXPECT_EQ(doc->fileFormat(input)->accession, "MS:1000584");
+    EXPECT_EQ(doc->fileProperties(input).size(), 1u);
+    EXPECT_EQ(doc->analysisSoftware(run).begin()->accession, "MS:1000752");
+
+    const auto& expected = file->runQualities[1]->metrics;
+    size_t i = 0;
+    for (const auto& metric : doc->metrics(run)) {
+        EXPECT_EQ(metric.accession, expected[i]->accession.str());
+        if (const auto* doubles = expected[i]->value.doubles()) {
+            EXPECT_EQ(std::vector<double>(metric.doubles().begin(), metric.doubles().end()), *doubles);
+        } else if (expected[i]->accession.str() == "MS:4000078") {
+            EXPECT_EQ(metric.value.kind, DocMetricValue::Kind::Json);
+            EXPECT_EQ(metric.valueJson(), expected[i]->value.toJson());
+        }
+        ++i;
+    }
+
+    const auto& set = *doc->setQualities().begin();
+    EXPECT_EQ(set.label, "all runs");
+    EXPECT_EQ(doc->setRefs(set).size(), 3u);
+    EXPECT_EQ(doc->metrics(set).size(), 1u);
+}
+
+TEST(MzQCDocument, EmptyArrays) {
+    auto file = test::sampleFile(1);
+    file->runQualities[0]->addMetric("MS:4000065", "empty doubles", "", MetricValue(std::vector<double>()));
+    file->runQualities[0]->addMetric("MS:4000061", "empty integers", "", MetricValue(std::vector<int64_t>()));
+    auto converted = MzQCDocument::fromMzQCFile(*file);
+    auto parsed = fromText(file->dump());
+    for (const auto* doc : {converted.get(), parsed.get()}) {
+        const auto& run = *doc->runQualities().begin();
+        const auto& metric = doc->metrics(run).begin()[doc->metrics(run).size() - 1];
+        EXPECT_TRUE(metric.doubles().empty());
+        EXPECT_TRUE(metric.integers().empty());
+        EXPECT_EQ(doc->toMzQCFile()->dump(), file->dump());
+    }
+}
+
+TEST(MzQCDocument, NodeArraysAreSizedOnce) {
+    // Both loaders end with node arrays at their final size, so the arena
+    // holds the same bytes whichever way the document was built
+    auto file = test::sampleFile(20);
+    auto converted = MzQCDocument::fromMzQCFile(*file);
+    auto parsed = fromText(file->dump());
+    EXPECT_EQ(parsed->arenaBytes(), converted->arenaBytes());
+}
+
+TEST(MzQCDocument, RejectsMalformedJson) {
+    EXPECT_THROW(fromText("{\"mzQC\": {\"runQualities\": [}"), std::runtime_error);
+}
+
+TEST(MzQCDocument, RejectsWhatTheStreamLoaderRejects) {
+    const char* inputs[] = {
+        "[]",
+        "1",
+        R"({"mzQC":[]})",
+        R"({"mzQC":"1.0.0"})",
+        R"({"mzQC":{"version":1}})",
+        R"({"mzQC":{"description":{}}})",
+        R"({"mzQC":{"controlledVocabularies":[{"id":null}]}})",
+        R"({"mzQC":{"runQualities":[1]}})",
+        R"({"mzQC":{"runQualities":[{"label":"a"},[]]}})",
+        R"({"mzQC":{"runQualities":[{"label":["a"]}]}})",
+        R"({"mzQC":{"runQualities":[{"inputFiles":[{"fileFormat":"mzML"}]}]}})",
+        R"({"mzQC":{"runQualities":[{"inputFiles":[{"fileFormat":{"accession":1}}]}]}})",
+        R"({"mzQC":{"runQualities":[{"inputFiles":[{"fileProperties":["size"]}]}]}})",
+        R"({"mzQC":{"runQualities":[{"analysisSoftware":[{"uri":2}]}]}})",
+        R"({"mzQC":{"runQualities":[{"metrics":[{"accession":4000059}]}]}})",
+        R"({"mzQC":{"setQualities":[{"setRefs":[1]}]}})",
+        R"({"mzQC":{"setQualities":[{"setRefs":[{}]}]}})",
+        R"({"mzQC":{"setQualities":[{"metrics":[null]}]}})",
+        R"({"mzQC":{"runQualities":[}})",
+    };
+    for (const char* input : inputs) {
+        std::string streamError;
+        std::string documentError;
+        try {
+            std::istringstream in(input);
+            MzQCFile::fromStream(in);
+        } catch (const std::runtime_error& e) {
+            streamError = e.what();
+        }
+        try {
+            fromText(input);
+        } catch (const std::runtime_error& e) {
+            documentError = e.what();
+        }
+        EXPECT_FALSE(streamError.empty()) << input;
+        EXPECT_EQ(documentError, streamError) << input;
+    }
+
+    // The list is named even after keys of its elements were read
+    try {
+        fromText(R"({"mzQC":{"runQualities":[{"label":"a"},[]]}})");
+        FAIL() << "expected an exception";
+    } catch (const std::runtime_error& e) {
+        EXPECT_STREQ(e.what(), "Expected object in array 'runQualities'");
+    }
+}
@@ -0,0 +1,108 @@
+#include "mzqc_index.hpp"
+#include "test_support.hpp"
+#include <gtest/gtest.h>
+#include <cmath>
+
+using namespace mzqc;
+
+namespace {
+
+// Two runs, the second with a repeated scalar metric and no MS:4000053
+std::shared_ptr<MzQCFile> secondFile() {
+    auto file = std::make_shared<MzQCFile>("2020-01-01T00:00:00Z", "1.0.0");
+    file->runQualities.push_back(test::sampleRun("other0", 10));
+    auto run = test::sampleRun("other1", 11);
+    run->metrics.erase(run->metrics.begin() + 1);
+    run->addMetric("MS:4000059", "number of MS1 spectra", "repeat", MetricValue(int64_t(1)));
+    file->runQualities.push_back(run);
+    return file;
+}
+
+} // namespace
+
+TEST(MzQCIndex, NumbersRunsAcrossFiles) {
+    MzQCIndex index(test::sampleFile(3));
+    index.add(secondFile());
+    index.add(nullptr);
+    EXPECT_EQ(index.fileCount(), 2u);
+    ASSERT_EQ(index.runCount(), 5u);
+    EXPECT_EQ(index.run(3).label, "other0");
+    EXPECT_EQ(index.fileOf(2), 0u);
+    EXPECT_EQ(index.fileOf(3), 1u);
+    EXPECT_EQ(index.file(1).runQualities.size(), 2u);
+}
+
+TEST(MzQCIndex, FindsRunsByLabelAndInputFile) {
+    MzQCIndex index(test::sampleFile(3));
+    index.add(secondFile());
+    EXPECT_EQ(index.findRun("run2"), 2u);
+    EXPECT_EQ(index.findRun("other1"), 4u);
+    EXPECT_EQ(index.findRun("missing"), MzQCIndex::npos);
+    EXPECT_EQ(index.findRunByInputFile("other0.mzML"), 3u);
+    EXPECT_EQ(index.findRunByInputFile("run0"), MzQCIndex::npos);
+
+    // A label added again resolves to the first run
+    index.add(test::sampleFile(1));
+    EXPECT_EQ(index.findRun("run0"), 0u);
+}
+
+TEST(MzQCIndex, MetricsByAccession) {
+    MzQCIndex index(test::sampleFile(3));
+    index.add(secondFile());
+
+    const auto& refs = index.metrics("MS:4000059");
+    ASSERT_EQ(refs.size(), 6u);
+    for (size_t i = 1; i < refs.size(); ++i) EXPECT_LE(refs[i - 1].run, refs[i].run);
+    EXPECT_TRUE(index.metrics("MS:9999999-never-interned").empty());
+
+    // The first metric of a run wins
+    const QualityMetric* repeated = index.metric(4, "MS:4000059");
+    ASSERT_NE(repeated, nullptr);
+    EXPECT_EQ(repeated->value.json()->get<int64_t>(), 5131);
+    EXPECT_EQ(index.metric(4, "MS:4000053"), nullptr);
+    EXPECT_EQ(index.metric(1, "MS:4000065"), index.run(1).metrics[2].get());
+}
+
+TEST(MzQCIndex, ColumnAndSeries) {
+    MzQCIndex index(test::sampleFile(3));
+    index.add(secondFile());
+
+    std::vector<double> counts = index.column("MS:4000059");
+    EXPECT_EQ(counts, (std::vector<double>{5120, 5121, 5122, 5130, 5131}));
+
+    std::vector<double> duration = index.column("MS:4000053");
+    ASSERT_EQ(duration.size(), 5u);
+    EXPECT_EQ(duration[3], 3610.5);
+    EXPECT_TRUE(std::isnan(duration[4]));
+
+    // Arrays are not single numbers
+    for (double value : index.column("MS:4000065")) EXPECT_TRUE(std::isnan(value));
+
+    MzQCIndex::Series series = index.series("MS:4000053");
+    EXPECT_EQ(series.runs, (std::vector<uint32_t>{0, 1, 2, 3}));
+    EXPECT_EQ(series.values, (std::vector<double>{3600.5, 3601.5, 3602.5, 3610.5}));
+    EXPECT_EQ(index.series("MS:4000059").runs.size(), 5u);
+    EXPECT_TRUE(index.series("MS:9999999-never-interned").runs.empty());
+}
+
+TEST(MzQCIndex, FromDirectory) {
+    test::TempDir dir;
+    secondFile()->toFile(dir.path("b.mzqc"));
+    test::sampleFile(2)->toFile(dir.path("a.mzqc"));
+    test::writeText(dir.path("notes.txt"), "not a file to index");
+
+    MzQCIndex index = MzQCIndex::fromDirectory(dir.path(""));
+    EXPECT_EQ(index.fileCount(), 2u);
+    ASSERT_EQ(index.runCount(), 4u);
+    EXPECT_EQ(index.run(0).label, "run0");
+    EXPECT_EQ(index.run(2).label, "other0");
+
+    test::writeText(dir.path("c.mzqc"), "{\"mzQC\": ");
+    try {
+        MzQCIndex::fromDirectory(dir.path(""));
+        FAIL() << "expected an exception";
+    } catch (const std::runtime_error& e) {
+        EXPECT_NE(std::string(e.what()).find("c.mzqc"), std::string::npos) << e.what();
+    }
+    EXPECT_THROW(MzQCIndex::fromDirectory(dir.path("missing")), std::runtime_error);
+}
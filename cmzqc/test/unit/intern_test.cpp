@@ -0,0 +1,96 @@
+#include "mzqc_intern.hpp"
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace mzqc;
+
+TEST(StringInternTable, DenseIds) {
+    StringInternTable table;
+    EXPECT_EQ(table.size(), 1u);
+    EXPECT_EQ(table.intern(""), 0u);
+    uint32_t first = table.intern("MS:4000059");
+    uint32_t second = table.intern("MS:4000053");
+    EXPECT_EQ(first, 1u);
+    EXPECT_EQ(second, 2u);
+    EXPECT_EQ(table.intern(std::string("MS:4000059")), first);
+    EXPECT_EQ(table.lookup(second), "MS:4000053");
+    EXPECT_EQ(table.size(), 3u);
+}
+
+TEST(StringInternTable, FindDoesNotAdd) {
+    StringInternTable table;
+    uint32_t id = 99;
+    EXPECT_FALSE(table.find("MS:4000059", id));
+    EXPECT_EQ(table.size(), 1u);
+    uint32_t added = table.intern("MS:4000059");
+    ASSERT_TRUE(table.find("MS:4000059", id));
+    EXPECT_EQ(id, added);
+}
+
+TEST(StringInternTable, TablesDoNotShareCachedIds) {
+    // The per-thread cache must not answer for another table, even one
+    // created at the address of a destroyed table
+    uint32_t id;
+    {
+        StringInternTable table;
+        table.intern("first");
+        table.intern("second");
+    }
+    StringInternTable other;
+    EXPECT_FALSE(other.find("second", id));
+    EXPECT_EQ(other.intern("second"), 1u);
+    StringInternTable third;
+    EXPECT_EQ(third.intern("first"), 1u);
+    EXPECT_EQ(other.lookup(1), "second");
+}
+
+TEST(StringInternTable, ManyStringsAcrossChunks) {
+    StringInternTable table;
+    for (int i = 0; i < 10000; ++i) {
+        EXPECT_EQ(table.intern("term " + std::to_string(i)), uint32_t(i + 1));
+    }
+    for (int i = 0; i < 10000; ++i) {
+        EXPECT_EQ(table.lookup(i + 1), "term " + std::to_string(i));
+    }
+}
+
+TEST(StringInternTable, ConcurrentInterning) {
+    StringInternTable table;
+    const int threads = 8;
+    const int strings = 2000;
+    std::vector<std::vector<uint32_t>> ids(threads, std::vector<uint32_t>(strings));
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            for (int round = 0; round < 3; ++round) {
+                for (int i = 0; i < strings; ++i) {
+                    int n = (i + t * 250) % strings;
+                    uint32_t id = table.intern("accession " + std::to_string(n));
+                    if (round > 0) {
+                        EXPECT_EQ(id, ids[t][n]);
+                    }
+                    ids[t][n] = id;
+                }
+            }
+        });
+    }
+    for (auto& worker : workers) worker.join();
+    EXPECT_EQ(table.size(), size_t(strings) + 1);
+    for (int t = 1; t < threads; ++t) EXPECT_EQ(ids[t], ids[0]);
+    for (int i = 0; i < strings; ++i) EXPECT_EQ(table.lookup(ids[0][i]), "accession " + std::to_string(i));
+}
+
+TEST(InternedString, Handles) {
+    InternedString empty;
+    EXPECT_TRUE(empty.empty());
+    EXPECT_EQ(empty.str(), "");
+    InternedString a("MS:4000059");
+    InternedString b(std::string("MS:4000059"));
+    EXPECT_EQ(a, b);
+    EXPECT_EQ(a.handle(), b.handle());
+    EXPECT_EQ(a, "MS:4000059");
+    EXPECT_NE(a, InternedString("MS:4000053"));
+    EXPECT_TRUE(InternedString("MS:4000053") < a);
+}
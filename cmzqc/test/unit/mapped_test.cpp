@@ -0,0 +1,89 @@
+#include "mzqc_mapped.hpp"
+#include "test_support.hpp"
+#include <gtest/gtest.h>
+#include <limits>
+
+using namespace mzqc;
+
+TEST(MappedMzQC, MatchesLoadedFile) {
+    test::TempDir dir;
+    auto file = test::sampleFile(5);
+    file->toBinaryFile(dir.path("sample.cbor"));
+    MappedMzQC mapped(dir.path("sample.cbor"));
+    ASSERT_EQ(mapped.runCount(), file->runQualities.size());
+    for (size_t r = 0; r < mapped.runCount(); ++r) {
+        const auto& expected = *file->runQualities[r];
+        MappedRun run = mapped.run(r);
+        EXPECT_EQ(run.label(), expected.label);
+        ASSERT_EQ(run.metricCount(), expected.metrics.size());
+        for (size_t m = 0; m < run.metricCount(); ++m) {
+            MappedMetric metric = run.metric(m);
+            EXPECT_EQ(metric.accession(), expected.metrics[m]->accession.str());
+            EXPECT_EQ(metric.name(), expected.metrics[m]->name.str());
+            EXPECT_EQ(metric.unit(), expected.metrics[m]->unit.str());
+            EXPECT_EQ(metric.value().toJson(), expected.metrics[m]->value.toJson());
+        }
+    }
+}
+
+TEST(MappedMzQC, NumericViewReadsLittleEndian) {
+    // 1.0 and -2.0, then 1 and INT64_MIN, as stored in the file
+    const uint8_t doubles[] = {0, 0, 0, 0, 0, 0, 0xF0, 0x3F, 0, 0, 0, 0, 0, 0, 0, 0xC0};
+    const uint8_t integers[] = {1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x80};
+    NumericView<double> d(doubles, 2);
+    EXPECT_EQ(d[0], 1.0);
+    EXPECT_EQ(d.toVector(), (std::vector<double>{1.0, -2.0}));
+    NumericView<int64_t> i(integers, 2);
+    EXPECT_EQ(i[0], 1);
+    EXPECT_EQ(i.toVector(), (std::vector<int64_t>{1, std::numeric_limits<int64_t>::min()}));
+}
+
+TEST(MappedMzQC, TypedArraysAreViews) {
+    test::TempDir dir;
+    auto file = test::sampleFile(2);
+    file->toBinaryFile(dir.path("sample.cbor"));
+    MappedMzQC mapped(dir.path("sample.cbor"));
+    MappedRun run = mapped.run(1);
+    auto doubles = run.find("MS:4000065");
+    ASSERT_TRUE(doubles);
+    const auto& expected = *file->runQualities[1]->metrics[2]->value.doubles();
+    NumericView<double> view = doubles->doubles();
+    ASSERT_EQ(view.size(), expected.size());
+#if !defined(__BYTE_ORDER__) || __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    EXPECT_NE(view.data(), nullptr);
+#endif
+    EXPECT_EQ(view.toVector(), expected);
+    EXPECT_EQ(view[3], expected[3]);
+    EXPECT_TRUE(doubles->integers().empty());
+
+    auto integers = run.find("MS:4000061");
+    ASSERT_TRUE(integers);
+    EXPECT_EQ(integers->integers().toVector(), *file->runQualities[1]->metrics[3]->value.integers());
+    EXPECT_TRUE(run.find("MS:4000078")->doubles().empty());
+    EXPECT_FALSE(run.find("MS:0000000"));
+}
+
+TEST(MappedMzQC, FindRunByLabel) {
+    test::TempDir dir;
+    test::sampleFile(4)->toBinaryFile(dir.path("sample.cbor"));
+    MappedMzQC mapped(dir.path("sample.cbor"));
+    auto run = mapped.findRun("run2");
+    ASSERT_TRUE(run);
+    EXPECT_EQ(run->label(), "run2");
+    EXPECT_FALSE(mapped.findRun("run9"));
+    EXPECT_THROW(mapped.run(4), std::runtime_error);
+}
+
+TEST(MappedMzQC, RejectsOtherFiles) {
+    test::TempDir dir;
+    auto file = test::sampleFile(2);
+    file->toFile(dir.path("sample.mzqc"));
+    EXPECT_THROW(MappedMzQC(dir.path("sample.mzqc")), std::runtime_error);
+    EXPECT_THROW(MappedMzQC(dir.path("missing.cbor")), std::runtime_error);
+
+    auto bytes = file->toBinary();
+    bytes.resize(bytes.size() / 2);
+    test::writeText(dir.path("truncated.cbor"), std::string(bytes.begin(), bytes.end()));
+    MappedMzQC truncated(dir.path("truncated.cbor"));
+    EXPECT_THROW(truncated.run(1), std::runtime_error);
+}
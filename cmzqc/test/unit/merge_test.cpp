@@ -0,0 +1,163 @@
+#include "mzqc_merge.hpp"
+#include "test_support.hpp"
+#include <gtest/gtest.h>
+#include <sstream>
+
+using namespace mzqc;
+
+namespace {
+
+std::vector<std::string> writeInputs(const test::TempDir& dir, size_t count) {
+    std::vector<std::string> paths;
+    for (size_t i = 0; i < count; ++i) {
+        auto file = test::sampleFile(2);
+        for (auto& run : file->runQualities) run->label = "file " + std::to_string(i) + " " + run->label;
+        paths.push_back(dir.path("input" + std::to_string(i) + ".mzqc"));
+        file->toFile(paths.back());
+    }
+    return paths;
+}
+
+} // namespace
+
+TEST(MzQCMerger, ConcatenatesRunsAndSets) {
+    test::TempDir dir;
+    auto inputs = writeInputs(dir, 3);
+    auto stats = MzQCMerger().merge(inputs, dir.path("merged.mzqc"));
+    EXPECT_EQ(stats.files, 3u);
+    EXPECT_EQ(stats.runs, 6u);
+    EXPECT_EQ(stats.sets, 3u);
+    EXPECT_EQ(stats.controlledVocabularies, 1u);
+    EXPECT_EQ(stats.software, 1u);
+
+    auto merged = MzQCFile::fromFile(dir.path("merged.mzqc"), test::schemaPath());
+    ASSERT_EQ(merged->runQualities.size(), 6u);
+    ASSERT_EQ(merged->controlledVocabularies.size(), 1u);
+    std::vector<std::shared_ptr<RunQuality>> expected;
+    for (const auto& path : inputs) {
+        auto input = MzQCFile::fromFile(path);
+        expected.insert(expected.end(), input->runQualities.begin(), input->runQualities.end());
+        EXPECT_EQ(merged->contactName, input->contactName);
+    }
+    for (size_t i = 0; i < expected.size(); ++i) {
+        EXPECT_EQ(merged->runQualities[i]->toJson(), expected[i]->toJson());
+    }
+    EXPECT_EQ(merged->setQualities.size(), 3u);
+}
+
+TEST(MzQCMerger, StreamOutputMatchesFileOutput) {
+    test::TempDir dir;
+    auto inputs = writeInputs(dir, 2);
+    MzQCMerger().merge(inputs, dir.path("merged.mzqc"));
+    std::ostringstream out;
+    MzQCMerger().merge(inputs, out);
+    auto fromStream = nlohmann::json::parse(out.str());
+    auto fromFile = nlohmann::json::parse(test::readText(dir.path("merged.mzqc")));
+    fromStream["mzQC"].erase("creationDate");
+    fromFile["mzQC"].erase("creationDate");
+    EXPECT_EQ(fromStream, fromFile);
+}
+
+TEST(MzQCMerger, DeduplicatesVocabulariesAndSoftware) {
+    test::TempDir dir;
+    auto first = test::sampleFile(1);
+    auto second = test::sampleFile(1);
+    second->controlledVocabularies.push_back(
+        std::make_shared<ControlledVocabulary>("Unit Ontology", "https://example.org/uo.obo", "2020"));
+    auto& run = *second->runQualities[0];
+    run.analysisSoftware.push_back(std::make_shared<AnalysisSoftware>(*run.analysisSoftware[0]));
+    first->toFile(dir.path("first.mzqc"));
+    second->toFile(dir.path("second.mzqc"));
+
+    std::ostringstream out;
+    auto stats = MzQCMerger().merge({dir.path("first.mzqc"), dir.path("second.mzqc")}, out);
+    EXPECT_EQ(stats.controlledVocabularies, 2u);
+    EXPECT_EQ(stats.duplicateSoftware, 1u);
+    std::istringstream in(out.str());
+    auto merged = MzQCFile::fromStream(in);
+    EXPECT_EQ(merged->controlledVocabularies.size(), 2u);
+    EXPECT_EQ(merged->runQualities[1]->analysisSoftware.size(), 1u);
+}
+
+TEST(MzQCMerger, MissingOrInvalidInputThrows) {
+    test::TempDir dir;
+    auto inputs = writeInputs(dir, 1);
+    std::ostringstream out;
+    EXPECT_THROW(MzQCMerger().merge({inputs[0], dir.path("missing.mzqc")}, out), std::runtime_error);
+
+    nlohmann::json broken = nlohmann::json::parse(test::readText(inputs[0]));
+    broken["mzQC"]["runQualities"][0].erase("label");
+    test::writeText(dir.path("broken.mzqc"), broken.dump());
+    MzQCMergeOptions options;
+    options.schemaPath = test::schemaPath();
+    std::ostringstream validated;
+    EXPECT_THROW(MzQCMerger(options).merge({inputs[0], dir.path("broken.mzqc")}, validated), std::runtime_error);
+}
+
+TEST(MzQCMerger, RewritesCvRefOfDifferingIds) {
+    test::TempDir dir;
+    // Same CV as "MS" and as "PSI-MS"; a different CV reusing "MS"
+    std::vector<std::shared_ptr<MzQCFile>> files;
+    for (const char* id : {"MS", "PSI-MS", "MS"}) {
+        auto file = test::sampleFile(1);
+        file->controlledVocabularies[0]->id = id;
+        file->runQualities[0]->label = "run " + std::to_string(files.size());
+        file->runQualities[0]->inputFiles[0]->fileFormat->cvRef = id;
+        file->runQualities[0]->inputFiles[0]->fileProperties[0]->cvRef = id;
+        files.push_back(file);
+    }
+    files[2]->controlledVocabularies[0]->version = "5.0.0";
+    std::vector<std::string> paths;
+    for (size_t i = 0; i < files.size(); ++i) {
+        paths.push_back(dir.path("input" + std::to_string(i) + ".mzqc"));
+        files[i]->toFile(paths.back());
+    }
+
+    std::ostringstream out;
+    auto stats = MzQCMerger().merge(paths, out);
+    EXPECT_EQ(stats.controlledVocabularies, 2u);
+    std::istringstream in(out.str());
+    auto merged = MzQCFile::fromStream(in);
+    ASSERT_EQ(merged->controlledVocabularies.size(), 2u);
+    EXPECT_EQ(merged->controlledVocabularies[0]->id, "MS");
+    EXPECT_EQ(merged->controlledVocabularies[1]->id, "MS_2");
+    EXPECT_EQ(merged->controlledVocabularies[1]->version, "5.0.0");
+    // The inputs still hold their own ids
+    EXPECT_EQ(files[2]->controlledVocabularies[0]->id, "MS");
+
+    ASSERT_EQ(merged->runQualities.size(), 3u);
+    for (size_t i = 0; i < 3; ++i) {
+        const auto& input = *merged->runQualities[i]->inputFiles[0];
+        const char* expected = i == 2 ? "MS_2" : "MS";
+        EXPECT_EQ(input.fileFormat->cvRef, expected) << i;
+        EXPECT_EQ(input.fileProperties[0]->cvRef, expected) << i;
+    }
+    EXPECT_EQ(merged->setQualities.size(), 3u);
+}
+
+TEST(MzQCMerger, SetsKeepTheirMetrics) {
+    test::TempDir dir;
+    auto inputs = writeInputs(dir, 2);
+    // An escaped key defeats the pre-scan, so this input is read again for
+    // its sets instead of parsed by byte range
+    auto unusual = test::sampleFile(1);
+    unusual->setQualities[0]->metrics.push_back(
+        std::make_shared<QualityMetric>("MS:4000065", "errors", "", MetricValue(std::vector<double>{1.5, 2.5})));
+    std::string text = unusual->dump(2);
+    text.replace(text.find("\"setQualities\""), 14, "\"set\\u0051ualities\"");
+    inputs.push_back(dir.path("unusual.mzqc"));
+    test::writeText(inputs.back(), text);
+
+    std::ostringstream out;
+    auto stats = MzQCMerger().merge(inputs, out);
+    EXPECT_EQ(stats.sets, 3u);
+    std::istringstream in(out.str());
+    auto merged = MzQCFile::fromStream(in);
+    ASSERT_EQ(merged->setQualities.size(), 3u);
+    for (size_t i = 0; i < 3; ++i) {
+        auto input = MzQCFile::fromFile(inputs[i]);
+        EXPECT_EQ(merged->setQualities[i]->toJson(), input->setQualities[0]->toJson()) << i;
+    }
+    EXPECT_EQ(merged->setQualities[2]->toJson(), unusual->setQualities[0]->toJson());
+    EXPECT_EQ(merged->runQualities[4]->toJson(), unusual->runQualities[0]->toJson());
+}
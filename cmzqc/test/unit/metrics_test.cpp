@@ -0,0 +1,205 @@
+#include "mzqc_metrics.hpp"
+#include "test_support.hpp"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <limits>
+#include <random>
+
+using namespace mzqc;
+
+namespace {
+
+constexpr double missing = std::numeric_limits<double>::quiet_NaN();
+
+// Five targets, one decoy; the NaN RT and the decoy stay out of the distributions
+MetricTable identificationTable() {
+    MetricTable table;
+    table.addColumn("RT", std::vector<double>{10, 20, 30, 40, missing, 100});
+    table.addColumn("MZ", std::vector<int64_t>{400, 500, 600, 700, 800, 900});
+    table.addColumn("deltaPPM", std::vector<double>{-2, -1, 0, 1, 2, 50});
+    table.addColumn("target", std::vector<bool>{true, true, true, true, true, false});
+    return table;
+}
+
+MetricTable randomTable(size_t rows, unsigned seed) {
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<double> rt(0, 3600);
+    std::normal_distribution<double> ppm(0, 3);
+    std::uniform_real_distribution<double> mz(300, 1500);
+    std::vector<double> rts, ppms, mzs;
+    std::vector<bool> targets;
+    for (size_t i = 0; i < rows; ++i) {
+        rts.push_back(rt(random));
+        ppms.push_back(ppm(random));
+        mzs.push_back(mz(random));
+        targets.push_back(i % 10 != 0);
+    }
+    MetricTable table;
+    table.addColumn("RT", std::move(rts));
+    table.addColumn("MZ", std::move(mzs));
+    table.addColumn("deltaPPM", std::move(ppms));
+    table.addColumn("target", std::move(targets));
+    return table;
+}
+
+IdentificationMetricOptions allMetrics() {
+    IdentificationMetricOptions options;
+    options.accessions.targetDecoyRatio = "XX:0000001";
+    options.accessions.retentionTimeQuantiles = "XX:0000002";
+    options.accessions.mzRange = "XX:0000003";
+    return options;
+}
+
+const QualityMetric* find(const std::vector<std::shared_ptr<QualityMetric>>& metrics, const std::string& accession) {
+    for (const auto& metric : metrics) {
+        if (metric->accession == accession) return metric.get();
+    }
+    return nullptr;
+}
+
+} // namespace
+
+TEST(IdentificationMetrics, ExactSummary) {
+    IdentificationSummary summary = IdentificationMetrics().summarize(identificationTable());
+    EXPECT_TRUE(summary.hasTarget && summary.hasRetentionTime && summary.hasMz && summary.hasDeltaPPM);
+    EXPECT_EQ(summary.psms, 6u);
+    EXPECT_EQ(summary.targets, 5u);
+    EXPECT_EQ(summary.decoys, 1u);
+    EXPECT_EQ(summary.targetDecoyRatio, 5.0);
+
+    // Linear interpolation between order statistics, as numpy.quantile
+    EXPECT_EQ(summary.retentionTimeQuantiles, (std::vector<double>{17.5, 25, 32.5}));
+    EXPECT_EQ(summary.retentionTimeIqr, 15);
+    EXPECT_EQ(summary.deltaPPMQuartiles, (std::vector<double>{-1, 0, 1}));
+    EXPECT_EQ(summary.deltaPPMMedian, 0);
+    EXPECT_EQ(summary.deltaPPMIqr, 2);
+    EXPECT_EQ(summary.mzMin, 400);
+    EXPECT_EQ(summary.mzMax, 800);
+    EXPECT_EQ(summary.mzMedian, 600);
+}
+
+TEST(IdentificationMetrics, TargetLabels) {
+    MetricTable table;
+    table.addColumn("target", std::vector<std::string>{"target", "decoy", "DECOY", "0", "False", "x"});
+    IdentificationSummary summary = IdentificationMetrics().summarize(table);
+    EXPECT_TRUE(summary.hasTarget);
+    EXPECT_EQ(summary.targets, 2u);
+    EXPECT_EQ(summary.decoys, 4u);
+}
+
+TEST(IdentificationMetrics, MissingColumnsDropTheirMetrics) {
+    MetricTable table;
+    table.addColumn("RT", std::vector<double>{1, 2, 3});
+    auto metrics = IdentificationMetrics(allMetrics()).metrics(table);
+    ASSERT_EQ(metrics.size(), 3u);
+    EXPECT_EQ(metrics[0]->accession, "MS:4000186");
+    EXPECT_EQ(metrics[0]->value.json()->get<int64_t>(), 3);
+    EXPECT_EQ(metrics[1]->accession, "MS:4000072");
+    EXPECT_EQ(metrics[2]->accession, "XX:0000002");
+    EXPECT_EQ(*metrics[2]->value.doubles(), (std::vector<double>{1.5, 2, 2.5}));
+
+    // Without decoys every row is a target and the ratio is infinite
+    IdentificationSummary summary = IdentificationMetrics().summarize(table);
+    EXPECT_FALSE(summary.hasTarget);
+    EXPECT_EQ(summary.targets, 3u);
+    EXPECT_TRUE(std::isinf(summary.targetDecoyRatio));
+}
+
+TEST(IdentificationMetrics, EmptyDistributionsAreNaN) {
+    MetricTable table;
+    table.addColumn("MZ", std::vector<double>{missing, missing});
+    IdentificationSummary summary = IdentificationMetrics().summarize(table);
+    EXPECT_TRUE(std::isnan(summary.mzMin));
+    EXPECT_TRUE(std::isnan(summary.mzMax));
+    EXPECT_TRUE(std::isnan(summary.mzMedian));
+}
+
+TEST(IdentificationMetrics, DefaultAndConfiguredAccessions) {
+    auto defaults = IdentificationMetrics().metrics(identificationTable());
+    EXPECT_EQ(defaults.size(), 6u);
+    EXPECT_EQ(find(defaults, "XX:0000001"), nullptr);
+
+    IdentificationMetricOptions options = allMetrics();
+    options.accessions.deltaPPMIqr.clear();
+    auto metrics = IdentificationMetrics(options).metrics(identificationTable());
+    EXPECT_EQ(metrics.size(), 8u);
+    EXPECT_EQ(find(metrics, "MS:4000202"), nullptr);
+    const QualityMetric* range = find(metrics, "XX:0000003");
+    ASSERT_NE(range, nullptr);
+    EXPECT_EQ(*range->value.doubles(), (std::vector<double>{400, 800}));
+    EXPECT_EQ(range->unit, "MS:1000040");
+    EXPECT_EQ(*find(metrics, "MS:4000195")->value.doubles(), (std::vector<double>{-1, 0, 1}));
+}
+
+TEST(IdentificationMetrics, TermsFromCache) {
+    CvTermCache terms;
+    ASSERT_GT(terms.loadFromOboFile(test::sourcePath("schema/qc-cv.obo")), 0);
+    IdentificationMetricOptions options;
+    options.terms = &terms;
+    RunQuality run("run");
+    IdentificationMetrics(options).addTo(run, identificationTable());
+    ASSERT_FALSE(run.metrics.empty());
+    const QualityMetric& count = *run.metrics.front();
+    EXPECT_EQ(count.accession, "MS:4000186");
+    EXPECT_EQ(count.name, "Total number of PSM");
+    EXPECT_EQ(count.description, "Total number of PSM before FDR filtering.");
+    EXPECT_EQ(count.unit, "UO:0000189");
+}
+
+TEST(IdentificationSketch, ApproximatesExactSummary) {
+    MetricTable table = randomTable(20000, 1);
+    IdentificationSummary exact = IdentificationMetrics().summarize(table);
+    IdentificationMetricOptions options;
+    options.approximate = true;
+    IdentificationSummary approximate = IdentificationMetrics(options).summarize(table);
+
+    EXPECT_EQ(approximate.psms, exact.psms);
+    EXPECT_EQ(approximate.targets, exact.targets);
+    EXPECT_EQ(approximate.mzMin, exact.mzMin);
+    EXPECT_EQ(approximate.mzMax, exact.mzMax);
+    EXPECT_NEAR(approximate.mzMedian, exact.mzMedian, 1200 * 0.01);
+    EXPECT_NEAR(approximate.retentionTimeIqr, exact.retentionTimeIqr, 3600 * 0.01);
+    for (size_t k = 0; k < 3; ++k) {
+        EXPECT_NEAR(approximate.deltaPPMQuartiles[k], exact.deltaPPMQuartiles[k], 0.1) << k;
+        EXPECT_NEAR(approximate.retentionTimeQuantiles[k], exact.retentionTimeQuantiles[k], 3600 * 0.01) << k;
+    }
+}
+
+TEST(IdentificationSketch, MergeAndJsonRoundTrip) {
+    MetricTable first = randomTable(5000, 2);
+    MetricTable second = randomTable(3000, 3);
+    IdentificationSketch whole;
+    whole.add(first);
+    whole.add(second);
+    IdentificationSketch left, right;
+    left.add(first);
+    right.add(second);
+    left.merge(right);
+    EXPECT_EQ(left.psms(), 8000u);
+    EXPECT_EQ(left.targets(), whole.targets());
+
+    IdentificationSummary merged = left.summary();
+    IdentificationSummary expected = whole.summary();
+    EXPECT_EQ(merged.mzMin, expected.mzMin);
+    EXPECT_EQ(merged.mzMax, expected.mzMax);
+    EXPECT_NEAR(merged.mzMedian, expected.mzMedian, 1200 * 0.01);
+
+    IdentificationSketch restored = IdentificationSketch::fromJson(left.toJson());
+    IdentificationSummary reread = restored.summary();
+    EXPECT_EQ(reread.psms, merged.psms);
+    EXPECT_EQ(reread.targets, merged.targets);
+    EXPECT_TRUE(reread.hasTarget && reread.hasRetentionTime && reread.hasMz && reread.hasDeltaPPM);
+    EXPECT_EQ(reread.retentionTimeQuantiles, merged.retentionTimeQuantiles);
+    EXPECT_EQ(reread.deltaPPMQuartiles, merged.deltaPPMQuartiles);
+
+    SetQuality set;
+    IdentificationMetrics().addTo(set, restored);
+    ASSERT_FALSE(set.metrics.empty());
+    EXPECT_EQ(set.metrics.front()->value.json()->get<int64_t>(), 8000);
+}
+
+TEST(IdentificationSketch, FromJsonRejectsOtherJson) {
+    EXPECT_THROW(IdentificationSketch::fromJson(nlohmann::json::array()), std::runtime_error);
+    EXPECT_THROW(IdentificationSketch::fromJson({{"psms", 1}}), std::runtime_error);
+    EXPECT_THROW(IdentificationSketch::fromJson({{"psms", 1}, {"targets", 2}}), std::runtime_error);
+}
@@ -0,0 +1,56 @@
+#include "mzqc.hpp"
+#include "test_support.hpp"
+#include <gtest/gtest.h>
+
+using namespace mzqc;
+
+TEST(RunQuality, MovingReadMatchesCopyingRead) {
+    auto run = test::sampleRun("run 1", 1);
+    const nlohmann::json j = run->toJson();
+    RunQuality copied;
+    copied.fromJson(j);
+    nlohmann::json moved = j;
+    RunQuality taken;
+    taken.fromJson(std::move(moved));
+    EXPECT_EQ(copied.toJson(), j);
+    EXPECT_EQ(taken.toJson(), j);
+}
+
+TEST(RunQuality, MovingReadTakesNestedStrings) {
+    const std::string location = "file:///data/" + std::string(64, 'x') + ".raw";
+    const std::string uri = "https://example.org/" + std::string(64, 'y');
+    auto run = test::sampleRun("run 1", 1);
+    run->inputFiles[0]->location = location;
+    run->analysisSoftware[0]->uri = uri;
+    nlohmann::json j = run->toJson();
+
+    RunQuality taken;
+    taken.fromJson(std::move(j));
+    EXPECT_EQ(taken.inputFiles[0]->location, location);
+    EXPECT_EQ(taken.analysisSoftware[0]->uri, uri);
+    ASSERT_TRUE(taken.inputFiles[0]->fileFormat);
+    EXPECT_EQ(taken.inputFiles[0]->fileFormat->accession, "MS:1000584");
+    // The strings were moved out of the tree rather than copied
+    EXPECT_TRUE(j["inputFiles"][0]["location"].get_ref<const std::string&>().empty());
+    EXPECT_TRUE(j["analysisSoftware"][0]["uri"].get_ref<const std::string&>().empty());
+}
+
+TEST(RunQuality, RejectsNonObjectElements) {
+    nlohmann::json j = {{"label", "run"}, {"inputFiles", {5}}};
+    RunQuality fromConst;
+    EXPECT_THROW(fromConst.fromJson(static_cast<const nlohmann::json&>(j)), nlohmann::json::type_error);
+    RunQuality fromMoved;
+    EXPECT_THROW(fromMoved.fromJson(std::move(j)), nlohmann::json::type_error);
+}
+
+TEST(InputFile, MovingReadMatchesCopyingRead) {
+    auto run = test::sampleRun("run 1", 2);
+    const nlohmann::json j = run->inputFiles[0]->toJson();
+    InputFile copied;
+    copied.fromJson(j);
+    InputFile taken;
+    taken.fromJson(nlohmann::json(j));
+    EXPECT_EQ(copied.toJson(), j);
+    EXPECT_EQ(taken.toJson(), j);
+    EXPECT_EQ(taken.fileProperties.size(), 1u);
+}
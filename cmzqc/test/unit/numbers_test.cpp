@@ -0,0 +1,112 @@
+#include "mzqc.hpp"
+#include "mzqc_numbers.hpp"
+#include "test_support.hpp"
+#include <gtest/gtest.h>
+#include <sstream>
+
+using namespace mzqc;
+
+namespace {
+
+std::string documentWithValue(const std::string& value) {
+    return R"({"mzQC": {"version": "1.0.0", "creationDate": "2020-01-01T00:00:00Z", "runQualities": [)"
+           R"({"label": "run", "inputFiles": [], "analysisSoftware": [], "metrics": [)"
+           R"({"accession": "MS:4000065", "name": "values", "value": )" +
+           value + R"(}, {"accession": "MS:4000059", "name": "after", "value": 7}]}]}})";
+}
+
+// The value as decoded by the streaming loaders, which take numeric arrays
+// from the input directly, and by the DOM parser, which never does
+struct Decoded {
+    nlohmann::json stream;
+    nlohmann::json text;
+    nlohmann::json dom;
+};
+
+Decoded decode(const std::string& value) {
+    const std::string document = documentWithValue(value);
+    Decoded decoded;
+    std::istringstream in(document);
+    auto streamed = MzQCFile::fromStream(in);
+    decoded.stream = streamed->runQualities.at(0)->metrics.at(0)->value.toJson();
+    EXPECT_EQ(streamed->runQualities[0]->metrics.at(1)->value.toJson(), 7);
+
+    test::TempDir dir;
+    test::writeText(dir.path("value.mzqc"), document);
+    auto mapped = MzQCFile::fromFileParallel(dir.path("value.mzqc"));
+    decoded.text = mapped->runQualities.at(0)->metrics.at(0)->value.toJson();
+
+    auto dom = MzQCFile::fromJsonStatic(nlohmann::json::parse(document));
+    decoded.dom = dom->runQualities.at(0)->metrics.at(0)->value.toJson();
+    return decoded;
+}
+
+void expectSameAsDom(const std::string& value) {
+    Decoded decoded = decode(value);
+    EXPECT_EQ(decoded.stream, decoded.dom) << value;
+    EXPECT_EQ(decoded.text, decoded.dom) << value;
+    // Equal json can still differ in number types, e.g. 1 and 1.0
+    EXPECT_EQ(decoded.stream.dump(), decoded.dom.dump()) << value;
+    EXPECT_EQ(decoded.text.dump(), decoded.dom.dump()) << value;
+}
+
+void expectRejected(const std::string& value) {
+    const std::string document = documentWithValue(value);
+    EXPECT_ANY_THROW(nlohmann::json::parse(document)) << value;
+    std::istringstream in(document);
+    EXPECT_THROW(MzQCFile::fromStream(in), std::runtime_error) << value;
+    test::TempDir dir;
+    test::writeText(dir.path("value.mzqc"), document);
+    EXPECT_THROW(MzQCFile::fromFileParallel(dir.path("value.mzqc")), std::runtime_error) << value;
+}
+
+} // namespace
+
+TEST(NumberInput, TypedArrays) {
+    expectSameAsDom("[1.5, -2.25, 3e10, 0.0, -0.0, 1E-300, 2.2250738585072014e-308]");
+    expectSameAsDom("[1, -2, 0, 9223372036854775807, -9223372036854775808]");
+    expectSameAsDom("[ 1 ,\n\t2 ,\r\n 3 ]");
+    expectSameAsDom("[]");
+    expectSameAsDom("[ ]");
+    expectSameAsDom("[0.1]");
+}
+
+TEST(NumberInput, MixedAndOutOfRangeElements) {
+    expectSameAsDom("[1, 2.5, 3]");
+    expectSameAsDom("[1.5, 2, 3.5]");
+    expectSameAsDom("[1, 18446744073709551615, 2]");
+    expectSameAsDom("[1, 9223372036854775808]");
+    expectSameAsDom("[1, 100000000000000000000000000, 2]");
+    expectSameAsDom("[-9223372036854775809, 1]");
+    expectSameAsDom("[1, null, 2]");
+    expectSameAsDom("[1, \"two\", 3]");
+    expectSameAsDom("[true, 1, 2]");
+}
+
+TEST(NumberInput, LongNumbers) {
+    const std::string digits(80, '1');
+    expectSameAsDom("[1." + digits + ", 2]");
+    expectSameAsDom("[" + digits + "]");
+    expectSameAsDom("[0." + std::string(70, '0') + "1e70]");
+}
+
+TEST(NumberInput, NestedValues) {
+    expectSameAsDom("[[1, 2], [3.5, 4]]");
+    expectSameAsDom("[1, [2, 3], 4]");
+    expectSameAsDom("{\"RT\": [1.5, 2.5], \"charge\": [1, 2], \"peptide\": [\"A\", \"B\"]}");
+    expectSameAsDom("[{\"a\": 1}, 2]");
+}
+
+TEST(NumberInput, MalformedArrays) {
+    expectRejected("[1,]");
+    expectRejected("[1 2]");
+    expectRejected("[01]");
+    expectRejected("[-]");
+    expectRejected("[1.]");
+    expectRejected("[.5]");
+    expectRejected("[1e]");
+    expectRejected("[+1]");
+    expectRejected("[1, 2");
+    expectRejected("[1, 1e400]");
+    expectRejected("[1.5, 2,, 3]");
+}
@@ -0,0 +1,111 @@
+#include "mzqc.hpp"
+#include "test_support.hpp"
+#include <gtest/gtest.h>
+
+using namespace mzqc;
+
+namespace {
+
+std::string oboPath() {
+    return test::sourcePath("schema/qc-cv.obo");
+}
+
+void expectSameTerms(const CvTermCache& a, const CvTermCache& b) {
+    ASSERT_EQ(a.size(), b.size());
+    for (uint32_t id = 0; id < a.size(); ++id) {
+        const auto& left = a.term(id);
+        const auto& right = b.term(id);
+        EXPECT_EQ(left.accession, right.accession);
+        EXPECT_EQ(left.name, right.name);
+        EXPECT_EQ(left.definition, right.definition);
+        EXPECT_EQ(left.parentTerms, right.parentTerms);
+        EXPECT_EQ(left.relationships, right.relationships);
+        EXPECT_EQ(left.valueType, right.valueType);
+        EXPECT_EQ(left.unit, right.unit);
+        EXPECT_EQ(a.descendants(id), b.descendants(id));
+    }
+}
+
+} // namespace
+
+TEST(CvTermCache, ParsesOboFile) {
+    CvTermCache cache;
+    ASSERT_GT(cache.loadFromOboFile(oboPath()), 0);
+    const auto* term = cache.lookup("MS:4000059");
+    ASSERT_NE(term, nullptr);
+    EXPECT_EQ(term->name, "Number of MS1 spectra");
+    EXPECT_EQ(term->parentTerms, (std::vector<std::string>{"MS:4000003", "MS:4000010", "MS:4000023"}));
+    EXPECT_TRUE(cache.isA("MS:4000059", "MS:4000003"));
+    EXPECT_TRUE(cache.isA("MS:4000059", "MS:4000059"));
+    EXPECT_FALSE(cache.isA("MS:4000003", "MS:4000059"));
+    EXPECT_EQ(cache.lookup("MS:0000000"), nullptr);
+    EXPECT_EQ(cache.termId("MS:0000000"), CvTermCache::npos);
+    EXPECT_EQ(CvTermCache().loadFromOboFile("missing.obo"), -1);
+}
+
+TEST(CvTermCache, SnapshotRoundTrip) {
+    test::TempDir dir;
+    CvTermCache parsed;
+    ASSERT_GT(parsed.loadFromOboFile(oboPath()), 0);
+    ASSERT_TRUE(parsed.saveSnapshot(dir.path("cv.snapshot")));
+    CvTermCache loaded;
+    ASSERT_EQ(loaded.loadSnapshot(dir.path("cv.snapshot")), static_cast<int>(parsed.size()));
+    expectSameTerms(parsed, loaded);
+    EXPECT_TRUE(loaded.isA("MS:4000059", "MS:4000003"));
+}
+
+TEST(CvTermCache, LoadCachedWritesAndReusesSnapshot) {
+    test::TempDir dir;
+    test::writeText(dir.path("cv.obo"), test::readText(oboPath()));
+    CvTermCache first;
+    int count = first.loadCached(dir.path("cv.obo"), dir.path("cv.snapshot"));
+    ASSERT_GT(count, 0);
+    CvTermCache fromSnapshot;
+    ASSERT_EQ(fromSnapshot.loadSnapshot(dir.path("cv.snapshot")), count);
+    CvTermCache second;
+    EXPECT_EQ(second.loadCached(dir.path("cv.obo"), dir.path("cv.snapshot")), count);
+    expectSameTerms(first, second);
+}
+
+TEST(CvTermCache, RejectsBrokenSnapshots) {
+    test::TempDir dir;
+    CvTermCache parsed;
+    ASSERT_GT(parsed.loadFromOboFile(oboPath()), 0);
+    ASSERT_TRUE(parsed.saveSnapshot(dir.path("cv.snapshot")));
+    std::string bytes = test::readText(dir.path("cv.snapshot"));
+
+    CvTermCache cache;
+    EXPECT_EQ(cache.loadSnapshot(dir.path("missing.snapshot")), -1);
+    test::writeText(dir.path("short.snapshot"), bytes.substr(0, bytes.size() - 1));
+    EXPECT_EQ(cache.loadSnapshot(dir.path("short.snapshot")), -1);
+    test::writeText(dir.path("magic.snapshot"), "X" + bytes.substr(1));
+    EXPECT_EQ(cache.loadSnapshot(dir.path("magic.snapshot")), -1);
+    test::writeText(dir.path("cv.obo"), "format-version: 1.2\n");
+    EXPECT_EQ(cache.loadSnapshot(dir.path("cv.obo")), -1);
+}
+
+TEST(CvTermCache, IndexAndAncestry) {
+    CvTermCache cache;
+    ASSERT_GT(cache.loadFromOboFile(oboPath()), 0);
+    for (uint32_t id = 0; id < cache.size(); ++id) {
+        EXPECT_EQ(cache.termId(cache.term(id).accession), id);
+    }
+
+    // Transitive: MS:4000059 is_a MS:4000003 is_a MS:4000002
+    EXPECT_TRUE(cache.isA("MS:4000059", "MS:4000002"));
+    EXPECT_FALSE(cache.isA("MS:4000059", "MS:0000000"));
+    auto singleValues = cache.descendants("MS:4000003");
+    auto found = [&](const char* accession) {
+        for (const auto* term : singleValues) {
+            if (term->accession == accession) return true;
+        }
+        return false;
+    };
+    EXPECT_TRUE(found("MS:4000059"));
+    EXPECT_TRUE(found("MS:4000053"));
+    EXPECT_FALSE(found("MS:4000003"));
+    for (const auto* term : singleValues) {
+        EXPECT_TRUE(cache.isA(term->accession, "MS:4000003")) << term->accession;
+    }
+    EXPECT_TRUE(cache.descendants("MS:0000000").empty());
+}
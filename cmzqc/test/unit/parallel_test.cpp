@@ -0,0 +1,98 @@
+#include "mzqc.hpp"
+#include "mzqc_parallel.hpp"
+#include "test_support.hpp"
+#include <gtest/gtest.h>
+#include <atomic>
+
+using namespace mzqc;
+
+TEST(ThreadPool, ParallelForVisitsEveryIndexOnce) {
+    ThreadPool pool(4);
+    EXPECT_EQ(pool.size(), 4u);
+    std::vector<std::atomic<int>> visits(10000);
+    pool.parallelFor(visits.size(), [&](size_t i) { ++visits[i]; }, 16);
+    for (const auto& count : visits) EXPECT_EQ(count.load(), 1);
+    pool.parallelFor(0, [](size_t) { FAIL(); });
+}
+
+TEST(ThreadPool, ParallelForRethrows) {
+    ThreadPool pool(2);
+    std::atomic<size_t> done{0};
+    EXPECT_THROW(pool.parallelFor(100, [&](size_t i) {
+        ++done;
+        if (i == 50) throw std::runtime_error("item 50");
+    }), std::runtime_error);
+    EXPECT_EQ(done.load(), 100u);
+}
+
+TEST(LoadMany, ResultsInPathOrder) {
+    test::TempDir dir;
+    std::vector<std::string> paths;
+    std::vector<std::string> expected;
+    for (size_t i = 0; i < 6; ++i) {
+        auto file = test::sampleFile(i + 1);
+        paths.push_back(dir.path("file" + std::to_string(i) + ".mzqc"));
+        file->toFile(paths.back());
+        expected.push_back(file->dump());
+    }
+    paths.insert(paths.begin() + 2, dir.path("missing.mzqc"));
+    test::writeText(dir.path("broken.mzqc"), "{\"mzQC\": [");
+    paths.push_back(dir.path("broken.mzqc"));
+
+    MzQCLoadOptions options;
+    options.threads = 3;
+    options.schemaPath = test::schemaPath();
+    auto results = MzQCFile::loadMany(paths, options);
+    ASSERT_EQ(results.size(), paths.size());
+    size_t loaded = 0;
+    for (size_t i = 0; i < results.size(); ++i) {
+        EXPECT_EQ(results[i].path, paths[i]);
+        if (i == 2 || i + 1 == results.size()) {
+            EXPECT_FALSE(results[i].ok());
+            EXPECT_FALSE(results[i].error.empty());
+        } else {
+            ASSERT_TRUE(results[i].ok()) << results[i].error;
+            EXPECT_EQ(results[i].file->dump(), expected[loaded++]);
+        }
+    }
+}
+
+TEST(FromFileParallel, MatchesFromFile) {
+    test::TempDir dir;
+    for (size_t runs : {1u, 2u, 17u, 64u}) {
+        auto file = test::sampleFile(runs);
+        file->toFile(dir.path("runs.mzqc"));
+        auto sequential = MzQCFile::fromFile(dir.path("runs.mzqc"));
+        MzQCLoadOptions options;
+        options.threads = 4;
+        auto parallel = MzQCFile::fromFileParallel(dir.path("runs.mzqc"), options);
+        EXPECT_EQ(parallel->dump(2), sequential->dump(2)) << runs << " runs";
+        EXPECT_EQ(parallel->dump(2), file->dump(2)) << runs << " runs";
+    }
+}
+
+TEST(FromFileParallel, UnusualLayouts) {
+    test::TempDir dir;
+    auto file = test::sampleFile(8);
+    // Compact text, keys in another order and no sets
+    test::writeText(dir.path("compact.mzqc"), file->toJson().dump());
+    EXPECT_EQ(MzQCFile::fromFileParallel(dir.path("compact.mzqc"))->dump(), file->dump());
+
+    nlohmann::json reordered = file->toJson();
+    nlohmann::json sets = reordered["mzQC"]["setQualities"];
+    reordered["mzQC"].erase("setQualities");
+    test::writeText(dir.path("noSets.mzqc"), reordered.dump(1));
+    EXPECT_EQ(MzQCFile::fromFileParallel(dir.path("noSets.mzqc"))->dump(),
+              MzQCFile::fromFile(dir.path("noSets.mzqc"))->dump());
+
+    // The schema is checked and errors surface from the failing run
+    nlohmann::json broken = file->toJson();
+    broken["mzQC"]["runQualities"][5]["metrics"][0]["accession"] = 5;
+    test::writeText(dir.path("broken.mzqc"), broken.dump(2));
+    MzQCLoadOptions options;
+    options.schemaPath = test::schemaPath();
+    EXPECT_THROW(MzQCFile::fromFileParallel(dir.path("broken.mzqc"), options), std::runtime_error);
+    test::writeText(dir.path("truncated.mzqc"), file->dump(2).substr(0, 2000));
+    EXPECT_THROW(MzQCFile::fromFileParallel(dir.path("truncated.mzqc")), std::runtime_error);
+    EXPECT_THROW(MzQCFile::fromFileParallel(dir.path("missing.mzqc")), std::runtime_error);
+}
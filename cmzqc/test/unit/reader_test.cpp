@@ -0,0 +1,104 @@
+#include "mzqc_stream.hpp"
+#include "test_support.hpp"
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace mzqc;
+
+namespace {
+
+class RecordingVisitor : public MzQCVisitor {
+public:
+    bool visitRunMetric(const RunQuality& /*run*/, const std::shared_ptr<QualityMetric>& metric) override {
+        events.push_back("run metric " + metric->accession.str());
+        return ++metrics != stopAfter;
+    }
+    bool visitSetMetric(const SetQuality& set, const std::shared_ptr<QualityMetric>& metric) override {
+        events.push_back("set metric " + metric->accession.str() + " of " + set.label);
+        return ++metrics != stopAfter;
+    }
+    bool visitRun(const std::shared_ptr<RunQuality>& run) override {
+        events.push_back("run " + run->label);
+        runMetricCounts.push_back(run->metrics.size());
+        return true;
+    }
+    bool visitSet(const std::shared_ptr<SetQuality>& set) override {
+        events.push_back("set " + set->label);
+        return true;
+    }
+    void visitHeader(const MzQCFile& file) override { header = file.contactName; }
+
+    std::vector<std::string> events;
+    std::vector<size_t> runMetricCounts;
+    std::string header;
+    size_t metrics = 0;
+    size_t stopAfter = 0;
+};
+
+bool read(const std::string& text, MzQCVisitor& visitor, const MzQCReaderOptions& options = MzQCReaderOptions()) {
+    std::istringstream in(text);
+    return MzQCReader(options).read(in, visitor);
+}
+
+} // namespace
+
+TEST(MzQCReader, VisitsRunsThenSets) {
+    RecordingVisitor visitor;
+    EXPECT_TRUE(read(test::sampleFile(2)->dump(), visitor));
+    ASSERT_EQ(visitor.events.size(), 2 * 7 + 2u);
+    EXPECT_EQ(visitor.events[0], "run metric MS:4000059");
+    EXPECT_EQ(visitor.events[6], "run run0");
+    EXPECT_EQ(visitor.events[14], "set metric MS:4000059 of all runs");
+    EXPECT_EQ(visitor.events[15], "set all runs");
+    EXPECT_EQ(visitor.header, "Jane Doe");
+    // Metrics are dropped once visited unless keepMetrics is set
+    EXPECT_EQ(visitor.runMetricCounts, (std::vector<size_t>{0, 0}));
+}
+
+TEST(MzQCReader, SetMetricsAfterRunsWithKeepMetrics) {
+    RecordingVisitor visitor;
+    MzQCReaderOptions options;
+    options.keepMetrics = true;
+    EXPECT_TRUE(read(test::sampleFile(2)->dump(), visitor, options));
+    EXPECT_EQ(visitor.runMetricCounts, (std::vector<size_t>{6, 6}));
+    EXPECT_EQ(visitor.events.back(), "set all runs");
+}
+
+TEST(MzQCReader, FiltersAccessions) {
+    RecordingVisitor visitor;
+    MzQCReaderOptions options;
+    options.accessions = {"MS:4000065"};
+    EXPECT_TRUE(read(test::sampleFile(3)->dump(), visitor, options));
+    EXPECT_EQ(visitor.metrics, 3u);
+    EXPECT_EQ(visitor.events.front(), "run metric MS:4000065");
+}
+
+TEST(MzQCReader, VisitorStopsTheRead) {
+    RecordingVisitor visitor;
+    visitor.stopAfter = 2;
+    EXPECT_FALSE(read(test::sampleFile(3)->dump(), visitor));
+    EXPECT_EQ(visitor.metrics, 2u);
+}
+
+TEST(MzQCReader, ForEachRunMetric) {
+    test::TempDir dir;
+    test::sampleFile(3)->toFile(dir.path("sample.mzqc"));
+    std::vector<std::string> labels;
+    MzQCReader::forEachRunMetric(dir.path("sample.mzqc"), "MS:4000059",
+                                 [&](const RunQuality& run, const QualityMetric& metric) {
+                                     labels.push_back(run.label);
+                                     EXPECT_EQ(metric.name.str(), "number of MS1 spectra");
+                                     return true;
+                                 });
+    EXPECT_EQ(labels, (std::vector<std::string>{"run0", "run1", "run2"}));
+}
+
+TEST(MzQCReader, ValidatesWithSchema) {
+    RecordingVisitor visitor;
+    MzQCReaderOptions options;
+    options.schemaPath = test::schemaPath();
+    EXPECT_TRUE(read(test::sampleFile(2)->dump(), visitor, options));
+    EXPECT_THROW(read(R"({"mzQC":{"version":"x"}})", visitor, options), std::runtime_error);
+}
@@ -0,0 +1,153 @@
+#include "mzqc.hpp"
+#include "mzqc_schema.hpp"
+#include "test_support.hpp"
+#include <gtest/gtest.h>
+#include <thread>
+
+using namespace mzqc;
+
+namespace {
+
+const nlohmann::json testSchema = nlohmann::json::parse(R"({
+    "$schema": "http://json-schema.org/draft-07/schema#",
+    "title": "test schema 1.2.3",
+    "type": "object",
+    "required": ["name", "items"],
+    "additionalProperties": false,
+    "properties": {
+        "name": {"type": "string", "pattern": "^[A-Z]+:[0-9]+$"},
+        "kind": {"enum": ["run", "set"]},
+        "fixed": {"const": [1, 2]},
+        "items": {"type": "array", "minItems": 1, "uniqueItems": true, "items": {"$ref": "#/definitions/item"}},
+        "choice": {"oneOf": [{"type": "integer"}, {"type": "string", "minLength": 3}]},
+        "any": {"anyOf": [{"type": "null"}, {"type": "number", "minimum": 0}]},
+        "notString": {"not": {"type": "string"}}
+    },
+    "definitions": {
+        "item": {"type": "object", "required": ["id"], "properties": {"id": {"type": "integer", "maximum": 10}}}
+    }
+})");
+
+// Result of the tree validator, checked against the SAX validator
+bool validates(const std::shared_ptr<const CompiledSchema>& schema, const nlohmann::json& j,
+               std::vector<SchemaError>* errors = nullptr) {
+    std::vector<SchemaError> treeErrors;
+    const bool tree = schema->validate(j, &treeErrors, 10);
+    SchemaValidator sax(schema, 10);
+    nlohmann::json::sax_parse(j.dump(), &sax);
+    EXPECT_EQ(sax.valid(), tree) << j.dump();
+    EXPECT_EQ(sax.errors().size(), treeErrors.size()) << j.dump();
+    if (errors) *errors = treeErrors;
+    return tree;
+}
+
+} // namespace
+
+TEST(CompiledSchema, Keywords) {
+    auto schema = CompiledSchema::compile(testSchema);
+    EXPECT_EQ(schema->version(), "1.2.3");
+    auto valid = nlohmann::json::parse(R"({"name": "MS:1", "items": [{"id": 1}, {"id": 2}], "kind": "run",
+        "fixed": [1, 2], "choice": 5, "any": null, "notString": 1})");
+    EXPECT_TRUE(validates(schema, valid));
+
+    auto with = [&](const char* key, nlohmann::json value) {
+        nlohmann::json j = valid;
+        j[key] = std::move(value);
+        return j;
+    };
+    EXPECT_FALSE(validates(schema, with("name", "ms:1")));
+    EXPECT_FALSE(validates(schema, with("name", 1)));
+    EXPECT_FALSE(validates(schema, with("kind", "file")));
+    EXPECT_FALSE(validates(schema, with("fixed", {2, 1})));
+    EXPECT_FALSE(validates(schema, with("items", nlohmann::json::array())));
+    EXPECT_FALSE(validates(schema, with("items", {{{"id", 1}}, {{"id", 1}}})));
+    EXPECT_FALSE(validates(schema, with("items", {{{"id", 11}}})));
+    EXPECT_FALSE(validates(schema, with("items", {{{"name", "x"}}})));
+    EXPECT_FALSE(validates(schema, with("choice", "ab")));
+    EXPECT_TRUE(validates(schema, with("choice", "abc")));
+    EXPECT_FALSE(validates(schema, with("choice", 1.5)));
+    EXPECT_FALSE(validates(schema, with("any", -1)));
+    EXPECT_FALSE(validates(schema, with("notString", "x")));
+    EXPECT_FALSE(validates(schema, with("extra", 1)));
+    nlohmann::json missing = valid;
+    missing.erase("items");
+    EXPECT_FALSE(validates(schema, missing));
+}
+
+TEST(CompiledSchema, ErrorPaths) {
+    auto schema = CompiledSchema::compile(testSchema);
+    std::vector<SchemaError> errors;
+    auto j = nlohmann::json::parse(R"({"name": "MS:1", "items": [{"id": 1}, {"id": "two"}]})");
+    ASSERT_FALSE(validates(schema, j, &errors));
+    ASSERT_EQ(errors.size(), 1u);
+    EXPECT_EQ(errors[0].path, "/items/1/id");
+    EXPECT_FALSE(errors[0].message.empty());
+}
+
+TEST(CompiledSchema, RejectsUnsupportedSchemas) {
+    EXPECT_THROW(CompiledSchema::compile(nlohmann::json::parse(R"({"$ref": "other.json#/a"})")), std::runtime_error);
+    EXPECT_THROW(CompiledSchema::compile(nlohmann::json::parse(R"({"$ref": "#/definitions/missing"})")),
+                 std::runtime_error);
+    EXPECT_THROW(CompiledSchema::fromFile("missing.json"), std::runtime_error);
+}
+
+TEST(CompiledSchema, LibraryOutputValidates) {
+    auto schema = SchemaRegistry::global().get(test::schemaPath());
+    auto file = test::sampleFile();
+    EXPECT_TRUE(validates(schema, file->toJson()));
+    EXPECT_TRUE(validateAgainstSchema(file->toJson(), test::schemaPath()));
+
+    nlohmann::json broken = file->toJson();
+    broken["mzQC"]["runQualities"][0].erase("label");
+    EXPECT_FALSE(validates(schema, broken));
+}
+
+TEST(CompiledSchema, ValidatesWhileLoading) {
+    test::TempDir dir;
+    auto file = test::sampleFile();
+    file->toFile(dir.path("valid.mzqc"));
+    EXPECT_EQ(MzQCFile::fromFile(dir.path("valid.mzqc"), test::schemaPath())->dump(), file->dump());
+
+    nlohmann::json broken = file->toJson();
+    broken["mzQC"]["runQualities"][1]["metrics"][0].erase("accession");
+    test::writeText(dir.path("broken.mzqc"), broken.dump());
+    EXPECT_THROW(MzQCFile::fromFile(dir.path("broken.mzqc"), test::schemaPath()), std::runtime_error);
+    EXPECT_NO_THROW(MzQCFile::fromFile(dir.path("broken.mzqc")));
+}
+
+TEST(ModelLayout, KeepsOtherSchemasUnchanged) {
+    EXPECT_EQ(modelLayout(testSchema), testSchema);
+    auto official = nlohmann::json::parse(test::readText(test::schemaPath()));
+    auto layout = modelLayout(official);
+    EXPECT_NE(layout, official);
+    EXPECT_EQ(layout["definitions"]["runQuality"]["required"],
+              (nlohmann::json{"label", "inputFiles", "analysisSoftware", "metrics"}));
+}
+
+TEST(SchemaRegistry, CachesByPathAndVersion) {
+    SchemaRegistry registry;
+    auto first = registry.get(test::schemaPath());
+    EXPECT_EQ(registry.get(test::schemaPath()), first);
+    EXPECT_EQ(registry.size(), 1u);
+    EXPECT_THROW(registry.get("missing.json"), std::runtime_error);
+
+    EXPECT_EQ(registry.find("1.2.3"), nullptr);
+    auto compiled = CompiledSchema::compile(testSchema);
+    registry.add(compiled);
+    EXPECT_EQ(registry.find("1.2.3"), compiled);
+    auto replacement = CompiledSchema::compile(testSchema);
+    registry.add(replacement);
+    EXPECT_EQ(registry.find("1.2.3"), replacement);
+}
+
+TEST(SchemaRegistry, ConcurrentGetReturnsOneSchema) {
+    SchemaRegistry registry;
+    std::vector<std::shared_ptr<const CompiledSchema>> results(8);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < results.size(); ++i) {
+        threads.emplace_back([&, i] { results[i] = registry.get(test::schemaPath()); });
+    }
+    for (auto& thread : threads) thread.join();
+    for (const auto& result : results) EXPECT_EQ(result, results[0]);
+    EXPECT_TRUE(results[0]->validate(test::sampleFile()->toJson()));
+}
@@ -0,0 +1,81 @@
+#include "mzqc_sketch.hpp"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace mzqc;
+
+namespace {
+
+QuantileSketch uniformSketch(size_t count, double compression = 100) {
+    QuantileSketch sketch(compression);
+    std::mt19937_64 random(7);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    std::vector<double> values(4096);
+    for (size_t added = 0; added < count; added += values.size()) {
+        for (auto& value : values) value = uniform(random);
+        sketch.add(values.data(), std::min(values.size(), count - added));
+    }
+    return sketch;
+}
+
+} // namespace
+
+TEST(QuantileSketch, EmptySketch) {
+    QuantileSketch sketch;
+    EXPECT_TRUE(sketch.empty());
+    EXPECT_TRUE(std::isnan(sketch.quantile(0.5)));
+    EXPECT_TRUE(std::isnan(sketch.min()));
+    EXPECT_EQ(sketch.centroidCount(), 0u);
+}
+
+TEST(QuantileSketch, UniformQuantiles) {
+    auto sketch = uniformSketch(1000000);
+    EXPECT_DOUBLE_EQ(sketch.count(), 1000000);
+    EXPECT_NEAR(sketch.quantile(0.5), 0.5, 0.01);
+    EXPECT_NEAR(sketch.quantile(0.1), 0.1, 0.005);
+    EXPECT_NEAR(sketch.quantile(0.99), 0.99, 0.002);
+    EXPECT_NEAR(sketch.quantile(0.999), 0.999, 0.0005);
+    EXPECT_GE(sketch.quantile(0), sketch.min());
+    EXPECT_LE(sketch.quantile(1), sketch.max());
+}
+
+TEST(QuantileSketch, CentroidCountIsBounded) {
+    // The count must not grow with the number of values, in particular
+    // not through singleton centroids in the tails
+    for (size_t count : {100000u, 1000000u, 4000000u}) {
+        auto sketch = uniformSketch(count);
+        EXPECT_LE(sketch.centroidCount(), 200u) << count << " values";
+    }
+    auto small = uniformSketch(1000000, 20);
+    EXPECT_LE(small.centroidCount(), 40u);
+}
+
+TEST(QuantileSketch, MergeMatchesSingleSketch) {
+    QuantileSketch left;
+    QuantileSketch right;
+    QuantileSketch both;
+    for (int i = 0; i < 100000; ++i) {
+        double value = i / 100000.0;
+        (i % 2 ? left : right).add(value);
+        both.add(value);
+    }
+    left.merge(right);
+    EXPECT_DOUBLE_EQ(left.count(), both.count());
+    EXPECT_DOUBLE_EQ(left.min(), 0);
+    EXPECT_DOUBLE_EQ(left.max(), both.max());
+    for (double q : {0.01, 0.25, 0.5, 0.75, 0.99}) {
+        EXPECT_NEAR(left.quantile(q), both.quantile(q), 0.01) << q;
+    }
+    EXPECT_LE(left.centroidCount(), 200u);
+}
+
+TEST(QuantileSketch, JsonRoundTrip) {
+    auto sketch = uniformSketch(50000);
+    auto copy = QuantileSketch::fromJson(sketch.toJson());
+    EXPECT_EQ(copy.centroidCount(), sketch.centroidCount());
+    EXPECT_DOUBLE_EQ(copy.count(), sketch.count());
+    EXPECT_DOUBLE_EQ(copy.quantile(0.5), sketch.quantile(0.5));
+    EXPECT_THROW(QuantileSketch::fromJson(nlohmann::json::array()), std::runtime_error);
+}
@@ -0,0 +1,125 @@
+#include "mzqc.hpp"
+#include "mzqc_stats.hpp"
+#include "test_support.hpp"
+#include <gtest/gtest.h>
+#include <vector>
+
+using namespace mzqc;
+
+#ifdef MZQC_ENABLE_STATS
+
+namespace {
+
+// Resets the global stats around a test
+class StatsTest : public ::testing::Test {
+protected:
+    void SetUp() override { Stats::global().reset(); }
+    void TearDown() override {
+        Stats::global().setSink(nullptr);
+        Stats::global().reset();
+    }
+};
+
+size_t countMetrics(const MzQCFile& file) {
+    size_t count = 0;
+    for (const auto& run : file.runQualities) count += run->metrics.size();
+    for (const auto& set : file.setQualities) count += set->metrics.size();
+    return count;
+}
+
+} // namespace
+
+TEST_F(StatsTest, LoadAndSaveTotals) {
+    test::TempDir dir;
+    auto file = test::sampleFile(3);
+    const uint64_t metrics = countMetrics(*file);
+    file->toFile(dir.path("sample.mzqc"));
+    const uint64_t size = test::readText(dir.path("sample.mzqc")).size();
+    MzQCFile::fromFile(dir.path("sample.mzqc"));
+
+    auto totals = Stats::global().totals();
+    ASSERT_TRUE(totals.count("fromFile/total"));
+    ASSERT_TRUE(totals.count("fromFile/read"));
+    ASSERT_TRUE(totals.count("toFile/total"));
+    ASSERT_TRUE(totals.count("toFile/write"));
+    EXPECT_EQ(totals["fromFile/total"].calls, 1u);
+    EXPECT_EQ(totals["fromFile/total"].bytes, size);
+    EXPECT_EQ(totals["fromFile/total"].metrics, metrics);
+    EXPECT_GT(totals["fromFile/total"].nodes, 0u);
+    EXPECT_EQ(totals["fromFile/read"].bytes, size);
+    EXPECT_EQ(totals["toFile/total"].bytes, size);
+    EXPECT_EQ(totals["toFile/total"].metrics, metrics);
+    EXPECT_EQ(totals["toFile/write"].bytes, size);
+
+    // The phases split the total, the remainder takes what they leave
+    for (const char* operation : {"fromFile", "toFile"}) {
+        const std::string prefix = std::string(operation) + "/";
+        uint64_t phases = 0;
+        for (const auto& entry : totals) {
+            if (entry.first.compare(0, prefix.size(), prefix) == 0 && entry.first != prefix + "total") {
+                phases += entry.second.nanoseconds;
+            }
+        }
+        EXPECT_EQ(phases, totals[prefix + "total"].nanoseconds) << operation;
+    }
+}
+
+TEST_F(StatsTest, SinkReceivesRecords) {
+    test::TempDir dir;
+    auto file = test::sampleFile(2);
+    file->toFile(dir.path("sample.mzqc"));
+    Stats::global().reset();
+    std::vector<StatsRecord> records;
+    Stats::global().setSink([&records](const StatsRecord& record) { records.push_back(record); });
+    MzQCFile::fromFile(dir.path("sample.mzqc"));
+
+    ASSERT_FALSE(records.empty());
+    // The total comes first, then its phases
+    EXPECT_STREQ(records[0].operation, "fromFile");
+    EXPECT_EQ(records[0].phase, StatsPhase::Total);
+    EXPECT_EQ(records[0].metrics, countMetrics(*file));
+    bool read = false;
+    for (const auto& record : records) {
+        EXPECT_STREQ(record.operation, "fromFile");
+        if (record.phase == StatsPhase::Read) read = true;
+    }
+    EXPECT_TRUE(read);
+    uint64_t calls = 0;
+    for (const auto& entry : Stats::global().totals()) calls += entry.second.calls;
+    EXPECT_EQ(records.size(), calls);
+}
+
+TEST_F(StatsTest, NestedPhasesCountOnce) {
+    {
+        StatsScope scope("nested", StatsPhase::Parse);
+        StatsPhaseTimer read(StatsPhase::Read, 100);
+        {
+            // Ignored, e.g. file reads under decompression
+            StatsPhaseTimer inner(StatsPhase::Read, 40);
+            StatsPhaseTimer write(StatsPhase::Write, 10);
+        }
+    }
+    auto totals = Stats::global().totals();
+    ASSERT_TRUE(totals.count("nested/read"));
+    EXPECT_EQ(totals["nested/read"].calls, 1u);
+    EXPECT_EQ(totals["nested/read"].bytes, 100u);
+    EXPECT_FALSE(totals.count("nested/write"));
+    EXPECT_EQ(totals["nested/total"].bytes, 100u);
+
+    // Without a scope, timers record nothing
+    { StatsPhaseTimer orphan(StatsPhase::Read, 7); }
+    EXPECT_EQ(Stats::global().totals().size(), totals.size());
+}
+
+#else
+
+TEST(Stats, DisabledRecordsNothing) {
+    EXPECT_FALSE(Stats::enabled);
+    Stats::global().reset();
+    test::TempDir dir;
+    test::sampleFile(1)->toFile(dir.path("sample.mzqc"));
+    MzQCFile::fromFile(dir.path("sample.mzqc"));
+    EXPECT_TRUE(Stats::global().totals().empty());
+}
+
+#endif
@@ -0,0 +1,221 @@
+#include "mzqc_store.hpp"
+#include "test_support.hpp"
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+
+using namespace mzqc;
+
+namespace {
+
+constexpr int64_t jan1 = 1704096000;   // 2024-01-01T08:00:00Z
+constexpr int64_t jan2 = 1704182400;   // 2024-01-02T08:00:00Z
+constexpr int64_t jan20 = 1705737600;  // 2024-01-20T08:00:00Z
+constexpr int64_t day = 86400;
+
+// One run per label with two scalar metrics and one array metric
+std::shared_ptr<MzQCFile> fileAt(const std::string& date, const std::vector<std::pair<std::string, int64_t>>& runs) {
+    auto file = std::make_shared<MzQCFile>(date, "1.0.0");
+    for (const auto& [label, value] : runs) {
+        auto run = std::make_shared<RunQuality>(label);
+        run->addMetric("MS:4000059", "number of MS1 spectra", "", MetricValue(value));
+        run->addMetric("MS:4000053", "chromatography duration", "", MetricValue(std::vector<double>{value * 0.5}));
+        run->addMetric("MS:4000065", "precursor errors", "", MetricValue(std::vector<double>{1, 2}));
+        file->runQualities.push_back(run);
+    }
+    return file;
+}
+
+MetricQuery spectra() {
+    MetricQuery query;
+    query.accession = "MS:4000059";
+    return query;
+}
+
+// Store holding 2 runs on each of Jan 1 and Jan 2 (one 7-day partition) and on Jan 20
+void fill(MetricStore& store) {
+    store.ingest(*fileAt("2024-01-02T08:00:00Z", {{"QE_c", 30}, {"TT_d", 40}}));
+    store.ingest(*fileAt("2024-01-01T08:00:00Z", {{"QE_a", 10}, {"TT_b", 20}}));
+    store.ingest(*fileAt("2024-01-20T08:00:00Z", {{"QE_e", 50}, {"TT_f", 60}}));
+}
+
+} // namespace
+
+TEST(MetricStore, ParseIsoTime) {
+    int64_t seconds = 0;
+    ASSERT_TRUE(parseIsoTime("1970-01-02T00:00:00Z", seconds));
+    EXPECT_EQ(seconds, day);
+    ASSERT_TRUE(parseIsoTime("2024-01-01T09:00:00+01:00", seconds));
+    EXPECT_EQ(seconds, jan1);
+    ASSERT_TRUE(parseIsoTime("1970-01-01T00:00:00.999-0130", seconds));
+    EXPECT_EQ(seconds, 5400);
+    ASSERT_TRUE(parseIsoTime("1969-12-31 23:59:59", seconds));
+    EXPECT_EQ(seconds, -1);
+    ASSERT_TRUE(parseIsoTime("2024-02-29T12:00:00Z", seconds));
+    EXPECT_EQ(seconds, 1709208000);
+
+    for (const char* text : {"2024-13-01T00:00:00Z", "2024-01-01", "2024-01-01T00:00:00Zjunk",
+                             "2024-01-01T00:00:00.", "2024-01-01T00:00:00+1"}) {
+        EXPECT_FALSE(parseIsoTime(text, seconds)) << text;
+    }
+}
+
+TEST(MetricStore, IngestAndQuery) {
+    test::TempDir dir;
+    MetricStore store(dir.path("store"));
+    MetricIngestStats stats = store.ingest(*fileAt("2024-01-01T08:00:00Z", {{"QE_a", 10}, {"TT_b", 20}}));
+    EXPECT_EQ(stats.files, 1u);
+    EXPECT_EQ(stats.runs, 2u);
+    EXPECT_EQ(stats.values, 4u);
+    EXPECT_EQ(stats.skipped, 2u);
+    store.ingest(*fileAt("2024-01-20T08:00:00Z", {{"QE_e", 50}, {"TT_f", 60}}));
+    store.ingest(*fileAt("2024-01-02T08:00:00Z", {{"QE_c", 30}, {"TT_d", 40}}));
+
+    // Segments overlap in time but rows come back in time order
+    MetricRows rows = store.query(spectra());
+    EXPECT_EQ(rows.times, (std::vector<int64_t>{jan1, jan1, jan2, jan2, jan20, jan20}));
+    EXPECT_EQ(rows.labels, (std::vector<std::string>{"QE_a", "TT_b", "QE_c", "TT_d", "QE_e", "TT_f"}));
+    EXPECT_EQ(rows.values, (std::vector<double>{10, 20, 30, 40, 50, 60}));
+
+    MetricQuery duration;
+    duration.accession = "MS:4000053";
+    EXPECT_EQ(store.query(duration).values, (std::vector<double>{5, 10, 15, 20, 25, 30}));
+    EXPECT_EQ(store.accessions(), (std::vector<std::string>{"MS:4000053", "MS:4000059"}));
+
+    MetricQuery missing;
+    missing.accession = "MS:4000065";
+    EXPECT_TRUE(store.query(missing).times.empty());
+}
+
+TEST(MetricStore, PrunesPartitionsAndSegments) {
+    test::TempDir dir;
+    MetricStore store(dir.path("store"));
+    fill(store);
+
+    MetricQuery query = spectra();
+    query.from = jan2;
+    query.to = jan2 + day;
+    MetricScanStats stats;
+    MetricRows rows = store.query(query, &stats);
+    EXPECT_EQ(rows.values, (std::vector<double>{30, 40}));
+    EXPECT_EQ(stats.partitions, 2u);
+    EXPECT_EQ(stats.partitionsPruned, 1u);
+    EXPECT_EQ(stats.segments, 2u);
+    // The Jan 1 segment ends before the range
+    EXPECT_EQ(stats.segmentsPruned, 1u);
+
+    query = spectra();
+    query.labelPrefix = "QE";
+    EXPECT_EQ(store.query(query).labels, (std::vector<std::string>{"QE_a", "QE_c", "QE_e"}));
+    query.labelPrefix = "ZZ";
+    EXPECT_TRUE(store.query(query, &stats).times.empty());
+    EXPECT_EQ(stats.segmentsPruned, stats.segments);
+    EXPECT_EQ(stats.rows, 0u);
+}
+
+TEST(MetricStore, Trend) {
+    test::TempDir dir;
+    MetricStore store(dir.path("store"));
+    fill(store);
+    store.ingest(*fileAt("2024-01-02T09:00:00Z", {{"QE_g", 35}}));
+
+    std::vector<MetricTrendPoint> points = store.trend(spectra(), day);
+    ASSERT_EQ(points.size(), 3u);
+    EXPECT_EQ(points[0].start, jan1 - 8 * 3600);
+    EXPECT_EQ(points[0].count, 2u);
+    EXPECT_EQ(points[0].median, 15);
+    EXPECT_EQ(points[1].count, 3u);
+    EXPECT_EQ(points[1].min, 30);
+    EXPECT_EQ(points[1].max, 40);
+    EXPECT_EQ(points[1].mean, 35);
+    EXPECT_EQ(points[1].median, 35);
+    EXPECT_EQ(points[2].start, jan20 - 8 * 3600);
+
+    EXPECT_THROW(store.trend(spectra(), 0), std::runtime_error);
+}
+
+TEST(MetricStore, CompactKeepsRows) {
+    test::TempDir dir;
+    MetricStore store(dir.path("store"));
+    fill(store);
+    MetricRows before = store.query(spectra());
+
+    store.compact();
+    MetricScanStats stats;
+    MetricRows after = store.query(spectra(), &stats);
+    EXPECT_EQ(stats.segments, stats.partitions);
+    EXPECT_EQ(after.times, before.times);
+    EXPECT_EQ(after.labels, before.labels);
+    EXPECT_EQ(after.values, before.values);
+}
+
+TEST(MetricStore, IgnoresTornSegment) {
+    test::TempDir dir;
+    MetricStore store(dir.path("store"));
+    store.ingest(*fileAt("2024-01-01T08:00:00Z", {{"QE_a", 10}}));
+
+    // A write cut short leaves part of a segment behind
+    const int64_t partition = jan1 / (7 * day);
+    const std::string path = dir.path("store/MS%3A4000059/" + std::to_string(partition) + ".seg");
+    const std::string segment = test::readText(path);
+    std::ofstream(path, std::ios::binary | std::ios::app) << segment.substr(0, segment.size() - 8);
+    EXPECT_EQ(store.query(spectra()).values, std::vector<double>{10});
+
+    // The next ingest drops the tail, so its segment is reachable
+    store.ingest(*fileAt("2024-01-02T08:00:00Z", {{"QE_c", 30}}));
+    MetricScanStats stats;
+    EXPECT_EQ(store.query(spectra(), &stats).values, (std::vector<double>{10, 30}));
+    EXPECT_EQ(stats.segments, 2u);
+}
+
+TEST(MetricStore, Settings) {
+    test::TempDir dir;
+    MetricStoreOptions options;
+    options.partitionDays = 1;
+    {
+        MetricStore store(dir.path("store"), options);
+        fill(store);
+    }
+    // An existing store keeps its partition width
+    MetricStore reopened(dir.path("store"));
+    EXPECT_EQ(reopened.partitionDays(), 1u);
+    MetricScanStats stats;
+    reopened.query(spectra(), &stats);
+    EXPECT_EQ(stats.partitions, 3u);
+
+    options.partitionDays = 0;
+    EXPECT_THROW(MetricStore(dir.path("zero"), options), std::runtime_error);
+    std::filesystem::create_directories(dir.path("bad"));
+    std::filesystem::create_directories(dir.path("newer"));
+    test::writeText(dir.path("bad/store.json"), "{");
+    EXPECT_THROW(MetricStore(dir.path("bad")), std::runtime_error);
+    test::writeText(dir.path("newer/store.json"), "{\"format\": 2, \"partitionDays\": 7}");
+    EXPECT_THROW(MetricStore(dir.path("newer")), std::runtime_error);
+}
+
+TEST(MetricStore, IngestFiles) {
+    test::TempDir dir;
+    std::vector<std::string> paths{dir.path("a.mzqc"), dir.path("b.mzqc")};
+    fileAt("2024-01-01T08:00:00Z", {{"QE_a", 10}, {"TT_b", 20}})->toFile(paths[0]);
+    fileAt("2024-01-02T08:00:00Z", {{"QE_c", 30}})->toFile(paths[1]);
+
+    MetricStore store(dir.path("store"));
+    MetricIngestStats stats = store.ingestFiles(paths);
+    EXPECT_EQ(stats.files, 2u);
+    EXPECT_EQ(stats.runs, 3u);
+    EXPECT_EQ(stats.values, 6u);
+    MetricScanStats scan;
+    EXPECT_EQ(store.query(spectra(), &scan).values, (std::vector<double>{10, 20, 30}));
+    // One batch writes a single segment per partition
+    EXPECT_EQ(scan.segments, 1u);
+
+    fileAt("yesterday", {{"QE_x", 1}})->toFile(dir.path("c.mzqc"));
+    try {
+        store.ingestFiles({dir.path("c.mzqc")});
+        FAIL() << "expected an exception";
+    } catch (const std::runtime_error& e) {
+        EXPECT_NE(std::string(e.what()).find("c.mzqc: Invalid creationDate"), std::string::npos) << e.what();
+    }
+    EXPECT_THROW(store.ingestFiles({dir.path("missing.mzqc")}), std::runtime_error);
+    EXPECT_EQ(store.query(spectra()).values.size(), 3u);
+}
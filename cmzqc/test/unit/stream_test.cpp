@@ -0,0 +1,76 @@
+#include "mzqc.hpp"
+#include "test_support.hpp"
+#include <gtest/gtest.h>
+#include <sstream>
+#include <stdexcept>
+
+using namespace mzqc;
+
+namespace {
+
+std::shared_ptr<MzQCFile> fromText(const std::string& text) {
+    std::istringstream in(text);
+    return MzQCFile::fromStream(in);
+}
+
+} // namespace
+
+TEST(StreamLoader, MatchesDomLoader) {
+    auto file = test::sampleFile();
+    const std::string text = file->dump(2);
+    auto streamed = fromText(text);
+    auto dom = MzQCFile::fromJsonStatic(nlohmann::json::parse(text));
+    EXPECT_EQ(streamed->dump(2), dom->dump(2));
+    EXPECT_EQ(streamed->dump(2), text);
+}
+
+TEST(StreamLoader, KeyOrderDoesNotMatter) {
+    // toJson sorts keys, so label follows metrics and inputFiles
+    auto file = test::sampleFile();
+    auto streamed = fromText(file->toJson().dump());
+    EXPECT_EQ(streamed->dump(), file->dump());
+}
+
+TEST(StreamLoader, FileRoundTrip) {
+    test::TempDir dir;
+    auto file = test::sampleFile();
+    file->toFile(dir.path("sample.mzqc"));
+    auto loaded = MzQCFile::fromFile(dir.path("sample.mzqc"));
+    EXPECT_EQ(loaded->dump(), file->dump());
+    ASSERT_EQ(loaded->runQualities.size(), 3u);
+    EXPECT_EQ(loaded->runQualities[1]->label, "run1");
+    EXPECT_EQ(loaded->controlledVocabularies.front()->id, "MS");
+}
+
+TEST(StreamLoader, KeepsTypedValues) {
+    auto loaded = fromText(test::sampleFile()->dump());
+    const auto& metrics = loaded->runQualities[0]->metrics;
+    ASSERT_NE(metrics[2]->value.doubles(), nullptr);
+    EXPECT_EQ(metrics[2]->value.doubles()->size(), 40u);
+    ASSERT_NE(metrics[3]->value.integers(), nullptr);
+    EXPECT_EQ(metrics[3]->value.integers()->front(), -7);
+    ASSERT_NE(metrics[4]->value.table(), nullptr);
+    EXPECT_EQ(metrics[4]->unit.str(), "");
+    EXPECT_EQ(metrics[1]->unit.str(), "UO:0000010");
+}
+
+TEST(StreamLoader, EmptyDocumentParts) {
+    auto loaded = fromText(R"({"mzQC":{"version":"1.0.0","creationDate":"2020-01-01T00:00:00Z"}})");
+    EXPECT_TRUE(loaded->runQualities.empty());
+    EXPECT_TRUE(loaded->setQualities.empty());
+    EXPECT_EQ(loaded->version, "1.0.0");
+}
+
+TEST(StreamLoader, RejectsMalformedJson) {
+    const std::string text = test::sampleFile()->dump();
+    EXPECT_THROW(fromText(text.substr(0, text.size() / 2)), std::runtime_error);
+    EXPECT_THROW(fromText(R"({"mzQC":{"version":"1.0.0",}})"), std::runtime_error);
+    EXPECT_THROW(fromText(""), std::runtime_error);
+}
+
+TEST(StreamLoader, RejectsWrongShapes) {
+    EXPECT_THROW(fromText("[]"), std::runtime_error);
+    EXPECT_THROW(fromText(R"({"mzQC":[]})"), std::runtime_error);
+    EXPECT_THROW(fromText(R"({"mzQC":{"runQualities":[1]}})"), std::runtime_error);
+    EXPECT_THROW(fromText(R"({"mzQC":{"version":1}})"), std::runtime_error);
+}
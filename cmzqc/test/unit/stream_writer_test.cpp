@@ -0,0 +1,67 @@
+#include "mzqc_stream.hpp"
+#include "test_support.hpp"
+#include <gtest/gtest.h>
+#include <sstream>
+
+using namespace mzqc;
+
+namespace {
+
+std::shared_ptr<MzQCFile> headerOf(const MzQCFile& file) {
+    auto header = std::make_shared<MzQCFile>(file.creationDate, file.version, file.contactName,
+                                             file.contactAddress, file.description);
+    header->controlledVocabularies = file.controlledVocabularies;
+    return header;
+}
+
+} // namespace
+
+TEST(MzQCStreamWriter, MatchesToFile) {
+    test::TempDir dir;
+    auto file = test::sampleFile();
+    file->toFile(dir.path("whole.mzqc"));
+    {
+        MzQCStreamWriter writer(dir.path("streamed.mzqc"), *headerOf(*file));
+        for (const auto& run : file->runQualities) writer.writeRun(*run);
+        for (const auto& set : file->setQualities) writer.writeSet(*set);
+        EXPECT_EQ(writer.runCount(), 3u);
+        EXPECT_EQ(writer.setCount(), 1u);
+        writer.close();
+    }
+    EXPECT_EQ(test::readText(dir.path("streamed.mzqc")), test::readText(dir.path("whole.mzqc")));
+}
+
+TEST(MzQCStreamWriter, FileIsCompleteAfterEveryRun) {
+    test::TempDir dir;
+    auto file = test::sampleFile();
+    MzQCStreamWriter writer(dir.path("growing.mzqc"), *headerOf(*file));
+    EXPECT_TRUE(MzQCFile::fromFile(dir.path("growing.mzqc"))->runQualities.empty());
+    for (size_t i = 0; i < file->runQualities.size(); ++i) {
+        writer.writeRun(*file->runQualities[i]);
+        auto loaded = MzQCFile::fromFile(dir.path("growing.mzqc"));
+        ASSERT_EQ(loaded->runQualities.size(), i + 1);
+        EXPECT_EQ(loaded->runQualities[i]->label, file->runQualities[i]->label);
+    }
+    writer.writeSet(*file->setQualities[0]);
+    EXPECT_EQ(MzQCFile::fromFile(dir.path("growing.mzqc"))->dump(), file->dump());
+}
+
+TEST(MzQCStreamWriter, StreamOutputAfterClose) {
+    auto file = test::sampleFile(2);
+    std::ostringstream out;
+    MzQCStreamWriter writer(out, *headerOf(*file));
+    for (const auto& run : file->runQualities) writer.writeRun(*run);
+    writer.writeSet(*file->setQualities[0]);
+    writer.close();
+    EXPECT_EQ(out.str(), file->dump(2));
+}
+
+TEST(MzQCStreamWriter, SectionOrder) {
+    auto file = test::sampleFile(1);
+    std::ostringstream out;
+    MzQCStreamWriter writer(out, *headerOf(*file));
+    writer.writeSet(*file->setQualities[0]);
+    EXPECT_THROW(writer.writeRun(*file->runQualities[0]), std::runtime_error);
+    writer.close();
+    EXPECT_THROW(writer.writeSet(*file->setQualities[0]), std::runtime_error);
+}
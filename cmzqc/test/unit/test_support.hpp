@@ -0,0 +1,108 @@
+#pragma once
+
+#include "mzqc.hpp"
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// Shared fixtures of the unit tests
+namespace mzqc::test {
+
+inline std::string sourcePath(const std::string& relative) {
+    return std::string(MZQC_SOURCE_DIR) + "/" + relative;
+}
+
+inline std::string schemaPath() {
+    return sourcePath("schema/mzqc_schema.json");
+}
+
+// Scratch directory, removed with everything in it
+class TempDir {
+public:
+    TempDir() {
+        static std::atomic<unsigned> counter{0};
+        dir = std::filesystem::temp_directory_path() /
+              ("mzqc_test_" + std::to_string(::getpid()) + "_" + std::to_string(counter++));
+        std::filesystem::create_directories(dir);
+    }
+    ~TempDir() {
+        std::error_code error;
+        std::filesystem::remove_all(dir, error);
+    }
+    TempDir(const TempDir&) = delete;
+    TempDir& operator=(const TempDir&) = delete;
+
+    std::string path(const std::string& name) const { return (dir / name).string(); }
+
+private:
+    std::filesystem::path dir;
+};
+
+inline std::string readText(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+inline void writeText(const std::string& path, const std::string& text) {
+    std::ofstream(path, std::ios::binary) << text;
+}
+
+inline std::shared_ptr<RunQuality> sampleRun(const std::string& label, size_t seed) {
+    auto format = std::make_shared<CvParameter>("MS:1000584", "mzML format");
+    auto input = std::make_shared<InputFile>("file:///data/" + label + ".mzML", label + ".mzML", format);
+    input->fileProperties.push_back(std::make_shared<CvParameter>("MS:1000747", "completion time",
+                                                                  "2020-01-01T00:00:00Z"));
+    auto software = std::make_shared<AnalysisSoftware>("MS:1000752", "TOPP software", "2.4.0",
+                                                       "https://openms.de");
+    auto run = std::make_shared<RunQuality>(label, std::vector<std::shared_ptr<InputFile>>{input},
+                                            std::vector<std::shared_ptr<AnalysisSoftware>>{software});
+
+    const double offset = static_cast<double>(seed);
+    std::vector<double> doubles;
+    std::vector<int64_t> integers;
+    for (size_t i = 0; i < 40; ++i) {
+        doubles.push_back(offset + 0.1 * static_cast<double>(i) - 1.5);
+        integers.push_back(static_cast<int64_t>(i * i) - 7);
+    }
+    MetricTable table;
+    table.addColumn("RT", std::vector<double>{offset + 1.25, 2.5, 1e-7});
+    table.addColumn("charge", std::vector<int64_t>{1, 2, 3});
+    table.addColumn("peptide", std::vector<std::string>{"PEPTIDER", "SAMPLEK", "with \"quote\""});
+
+    run->addMetric("MS:4000059", "number of MS1 spectra", "", MetricValue(int64_t(5120 + seed)));
+    run->addMetric("MS:4000053", "chromatography duration", "RT span", MetricValue(offset + 3600.5), "UO:0000010");
+    run->addMetric("MS:4000065", "precursor errors", "", MetricValue(std::move(doubles)), "UO:0000169");
+    run->addMetric("MS:4000061", "charge counts", "", MetricValue(std::move(integers)));
+    run->addMetric("MS:4000078", "identifications", "", MetricValue(std::move(table)));
+    run->addMetric("MS:4000000", "free text", "", MetricValue(nlohmann::json("ünïcode \\ \n text")));
+    return run;
+}
+
+// A file touching every part of the model: header fields, CVs, runs with
+// inputs, software and scalar, array, table and json metrics, and a set
+inline std::shared_ptr<MzQCFile> sampleFile(size_t runs = 3) {
+    auto file = std::make_shared<MzQCFile>("2020-01-01T00:00:00Z", "1.0.0", "Jane Doe", "jane@example.org",
+                                           "Sample file");
+    auto cv = std::make_shared<ControlledVocabulary>("Proteomics Standards Initiative Quality Control Ontology",
+                                                     "https://github.com/HUPO-PSI/psi-ms-CV/blob/master/psi-ms.obo",
+                                                     "4.1.7");
+    cv->id = "MS";
+    file->controlledVocabularies.push_back(cv);
+    std::vector<std::string> labels;
+    for (size_t i = 0; i < runs; ++i) {
+        labels.push_back("run" + std::to_string(i));
+        file->runQualities.push_back(sampleRun(labels.back(), i));
+    }
+    auto& set = file->addSet("all runs", labels);
+    set.addMetric("MS:4000059", "number of MS1 spectra", "mean", MetricValue(5121.0));
+    return file;
+}
+
+} // namespace mzqc::test
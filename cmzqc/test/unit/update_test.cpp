@@ -0,0 +1,152 @@
+#include "mzqc_compress.hpp"
+#include "mzqc_update.hpp"
+#include "test_support.hpp"
+#include <gtest/gtest.h>
+#include <filesystem>
+
+using namespace mzqc;
+
+namespace {
+
+class MzQCUpdaterTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        original = test::sampleFile(3);
+        path = dir.path("file.mzqc");
+        original->toFile(path);
+    }
+
+    // Run i of the sample file with more metrics, so it no longer fits
+    std::shared_ptr<RunQuality> grown(size_t i) const {
+        auto run = test::sampleRun("run" + std::to_string(i), i);
+        for (int k = 0; k < 20; ++k) {
+            run->addMetric("MS:4000070", "extra", "added by the update", MetricValue(std::vector<double>(10, k)));
+        }
+        return run;
+    }
+
+    // The file must still load and hold these runs, in this order, and the set
+    void expectRuns(const std::vector<std::shared_ptr<RunQuality>>& runs) const {
+        auto file = MzQCFile::fromFile(path);
+        ASSERT_EQ(file->runQualities.size(), runs.size());
+        for (size_t i = 0; i < runs.size(); ++i) {
+            EXPECT_EQ(file->runQualities[i]->toJson(), runs[i]->toJson()) << i;
+        }
+        ASSERT_EQ(file->setQualities.size(), 1u);
+        EXPECT_EQ(file->setQualities[0]->toJson(), original->setQualities[0]->toJson());
+    }
+
+    test::TempDir dir;
+    std::shared_ptr<MzQCFile> original;
+    std::string path;
+};
+
+} // namespace
+
+TEST_F(MzQCUpdaterTest, ShrinkInPlace) {
+    const auto size = std::filesystem::file_size(path);
+    MzQCUpdater updater(path);
+    EXPECT_EQ(updater.runCount(), 3u);
+    EXPECT_TRUE(updater.hasRun("run1"));
+
+    auto smaller = test::sampleRun("run1", 1);
+    smaller->metrics.resize(2);
+    MzQCUpdateResult result = updater.updateRun(*smaller);
+    EXPECT_TRUE(result.inPlace);
+    EXPECT_FALSE(result.appended);
+    EXPECT_EQ(std::filesystem::file_size(path), size);
+    expectRuns({original->runQualities[0], smaller, original->runQualities[2]});
+}
+
+TEST_F(MzQCUpdaterTest, GrowingRunMovesToTheEnd) {
+    MzQCUpdater updater(path);
+    auto middle = grown(1);
+    MzQCUpdateResult result = updater.updateRun(*middle);
+    EXPECT_FALSE(result.inPlace);
+    EXPECT_TRUE(result.appended);
+    EXPECT_EQ(updater.runCount(), 3u);
+    expectRuns({original->runQualities[0], original->runQualities[2], middle});
+
+    // The slack left after it takes a small change in place
+    middle->metrics.front()->value = MetricValue(int64_t(123456789));
+    EXPECT_TRUE(updater.updateRun(*middle).inPlace);
+    expectRuns({original->runQualities[0], original->runQualities[2], middle});
+}
+
+TEST_F(MzQCUpdaterTest, GrowingFirstAndLastRuns) {
+    MzQCUpdater updater(path);
+    auto last = grown(2);
+    MzQCUpdateResult result = updater.updateRun(*last);
+    EXPECT_TRUE(result.appended);
+    expectRuns({original->runQualities[0], original->runQualities[1], last});
+
+    // The first run is blanked together with the comma after it
+    auto first = grown(0);
+    EXPECT_TRUE(updater.updateRun(*first).appended);
+    expectRuns({original->runQualities[1], last, first});
+}
+
+TEST_F(MzQCUpdaterTest, AppendsNewRuns) {
+    MzQCUpdater updater(path);
+    auto added = test::sampleRun("run3", 3);
+    MzQCUpdateResult result = updater.updateRun(*added);
+    EXPECT_TRUE(result.appended);
+    EXPECT_EQ(updater.runCount(), 4u);
+    EXPECT_TRUE(updater.hasRun("run3"));
+    expectRuns({original->runQualities[0], original->runQualities[1], original->runQualities[2], added});
+}
+
+TEST_F(MzQCUpdaterTest, AppendsToEmptyRunArray) {
+    // toFile leaves out an empty array, other writers may not
+    test::writeText(path, "{\"mzQC\": {\"version\": \"1.0.0\", \"creationDate\": \"2020-01-01T00:00:00Z\",\n"
+                          "  \"runQualities\": []}}\n");
+    MzQCUpdater updater(path);
+    EXPECT_EQ(updater.runCount(), 0u);
+    auto run = test::sampleRun("run0", 0);
+    EXPECT_TRUE(updater.updateRun(*run).appended);
+    auto file = MzQCFile::fromFile(path);
+    ASSERT_EQ(file->runQualities.size(), 1u);
+    EXPECT_EQ(file->runQualities[0]->toJson(), run->toJson());
+}
+
+TEST_F(MzQCUpdaterTest, IndexFollowsTheFile) {
+    {
+        MzQCUpdater updater(path);
+        updater.updateRun(*grown(0));
+    }
+    ASSERT_TRUE(std::filesystem::exists(MzQCUpdater::indexPath(path)));
+    {
+        // The saved index matches the updated file
+        MzQCUpdater updater(path);
+        EXPECT_EQ(updater.runCount(), 3u);
+        EXPECT_TRUE(updater.updateRun(*grown(0)).inPlace);
+    }
+
+    // Changed by something else: the index is stale and rebuilt
+    test::sampleFile(2)->toFile(path);
+    EXPECT_EQ(MzQCUpdater(path).runCount(), 2u);
+
+    // A damaged index is rebuilt too
+    test::writeText(MzQCUpdater::indexPath(path), "{\"format\": ");
+    MzQCUpdater rebuilt(path);
+    EXPECT_EQ(rebuilt.runCount(), 2u);
+    EXPECT_TRUE(rebuilt.hasRun("run1"));
+}
+
+TEST_F(MzQCUpdaterTest, RejectsUnsupportedFiles) {
+    EXPECT_THROW(MzQCUpdater(dir.path("missing.mzqc")), std::runtime_error);
+
+    test::writeText(path, "{\"mzQC\": {\"version\": \"1.0.0\"}}");
+    EXPECT_THROW(MzQCUpdater{path}, std::runtime_error);
+
+    if (compressionAvailable(Compression::Gzip)) {
+        std::string compressed = dir.path("file.mzqc.gz");
+        original->toFile(compressed);
+        try {
+            MzQCUpdater updater(compressed);
+            FAIL() << "expected an exception";
+        } catch (const std::runtime_error& e) {
+            EXPECT_NE(std::string(e.what()).find("compressed"), std::string::npos) << e.what();
+        }
+    }
+}
@@ -0,0 +1,80 @@
+#include "mzqc_value.hpp"
+#include <gtest/gtest.h>
+#include <sstream>
+
+using namespace mzqc;
+
+TEST(MetricValue, NumericArraysAreTyped) {
+    MetricValue doubles(nlohmann::json::parse("[1.5, 2.5, 3.0]"));
+    ASSERT_NE(doubles.doubles(), nullptr);
+    EXPECT_EQ(doubles.kind(), MetricValue::Kind::Doubles);
+    EXPECT_EQ(*doubles.doubles(), (std::vector<double>{1.5, 2.5, 3.0}));
+
+    MetricValue integers(nlohmann::json::parse("[1, -2, 3]"));
+    ASSERT_NE(integers.integers(), nullptr);
+    EXPECT_EQ(*integers.integers(), (std::vector<int64_t>{1, -2, 3}));
+}
+
+TEST(MetricValue, OtherValuesStayJson) {
+    for (const char* text : {"5", "2.5", "\"text\"", "null", "[1, 2.5]", "[1, \"a\"]", "[[1, 2]]", "[]",
+                             "{\"a\": 1}", "[18446744073709551615]"}) {
+        MetricValue value(nlohmann::json::parse(text));
+        EXPECT_EQ(value.kind(), MetricValue::Kind::Json) << text;
+        EXPECT_EQ(value.toJson(), nlohmann::json::parse(text)) << text;
+        EXPECT_EQ(value.toJson().dump(), nlohmann::json::parse(text).dump()) << text;
+    }
+    EXPECT_TRUE(MetricValue().is_null());
+    EXPECT_FALSE(MetricValue(0).is_null());
+}
+
+TEST(MetricValue, TablesAreColumnar) {
+    const auto j = nlohmann::json::parse(
+        R"({"RT": [1.5, 2.5], "charge": [1, 2], "peptide": ["A", "B"], "decoy": [true, false]})");
+    MetricValue value(j);
+    ASSERT_NE(value.table(), nullptr);
+    const MetricTable& table = *value.table();
+    EXPECT_EQ(table.columnCount(), 4u);
+    EXPECT_EQ(table.rowCount(), 2u);
+    EXPECT_EQ(*table.columnAs<double>("RT"), (std::vector<double>{1.5, 2.5}));
+    EXPECT_EQ(*table.columnAs<int64_t>("charge"), (std::vector<int64_t>{1, 2}));
+    EXPECT_EQ(*table.columnAs<std::string>("peptide"), (std::vector<std::string>{"A", "B"}));
+    EXPECT_EQ(*table.columnAs<bool>("decoy"), (std::vector<bool>{true, false}));
+    EXPECT_EQ(table.columnAs<double>("charge"), nullptr);
+    EXPECT_EQ(table.column("missing"), nullptr);
+    EXPECT_EQ(value.toJson().dump(), j.dump());
+
+    // Ragged or nested objects are not tables
+    EXPECT_EQ(MetricValue(nlohmann::json::parse(R"({"a": [1, 2], "b": [1]})")).table(), nullptr);
+    EXPECT_EQ(MetricValue(nlohmann::json::parse(R"({"a": {"b": [1]}})")).table(), nullptr);
+}
+
+TEST(MetricTable, RejectsColumnsOfAnotherLength) {
+    MetricTable table;
+    table.addColumn("a", std::vector<double>{1, 2});
+    EXPECT_THROW(table.addColumn("b", std::vector<int64_t>{1}), std::exception);
+    EXPECT_EQ(table.columnCount(), 1u);
+}
+
+TEST(MetricValue, TypedJsonRoundTrip) {
+    MetricTable table;
+    table.addColumn("RT", std::vector<double>{1.5, 2.5});
+    table.addColumn("charge", std::vector<int64_t>{1, 2});
+    table.addColumn("peptide", std::vector<std::string>{"A", "B"});
+    for (const MetricValue& value : {MetricValue(std::vector<double>{1.5, -2.5}),
+                                     MetricValue(std::vector<int64_t>{1, -2, 3}), MetricValue(table),
+                                     MetricValue("text")}) {
+        const nlohmann::json typed = value.toTypedJson();
+        MetricValue restored(typed);
+        EXPECT_EQ(restored.kind(), value.kind());
+        EXPECT_EQ(restored.toJson(), value.toJson());
+    }
+    EXPECT_TRUE(MetricValue(std::vector<double>{1}).toTypedJson().is_binary());
+    EXPECT_EQ(MetricValue(std::vector<double>{1}).toTypedJson().get_binary().subtype(), typedArrayFloat64);
+    EXPECT_EQ(MetricValue(std::vector<int64_t>{1}).toTypedJson().get_binary().subtype(), typedArraySint64);
+}
+
+TEST(MetricValue, StreamsAsJson) {
+    std::ostringstream out;
+    out << MetricValue(std::vector<int64_t>{1, 2});
+    EXPECT_EQ(out.str(), "[1,2]");
+}
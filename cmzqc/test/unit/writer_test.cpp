@@ -0,0 +1,95 @@
+#include "mzqc_writer.hpp"
+#include "test_support.hpp"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <limits>
+#include <sstream>
+
+using namespace mzqc;
+
+namespace {
+
+std::string written(const MzQCFile& file, int indent) {
+    JsonWriter writer(indent);
+    writer.write(file);
+    return writer.text();
+}
+
+std::string written(const nlohmann::json& j, int indent) {
+    JsonWriter writer(indent);
+    writer.write(j);
+    return writer.text();
+}
+
+} // namespace
+
+TEST(JsonWriter, MatchesDumpOfToJson) {
+    auto file = test::sampleFile();
+    file->setQualities[0]->metrics[0]->unit = "UO:0000189";
+    for (int indent : {-1, 0, 1, 2, 4}) {
+        EXPECT_EQ(written(*file, indent), file->toJson().dump(indent)) << "indent " << indent;
+        EXPECT_EQ(file->dump(indent), file->toJson().dump(indent)) << "indent " << indent;
+    }
+    auto empty = test::sampleFile(0);
+    EXPECT_EQ(written(*empty, 2), empty->toJson().dump(2));
+}
+
+TEST(JsonWriter, PartsMatchDumpOfToJson) {
+    auto file = test::sampleFile(1);
+    const auto& run = *file->runQualities[0];
+    for (int indent : {-1, 2}) {
+        JsonWriter writer(indent);
+        writer.write(run);
+        EXPECT_EQ(writer.text(), run.toJson().dump(indent));
+        for (const auto& metric : run.metrics) {
+            writer.clear();
+            writer.write(*metric);
+            EXPECT_EQ(writer.text(), metric->toJson().dump(indent));
+        }
+        writer.clear();
+        writer.write(*file->setQualities[0]);
+        EXPECT_EQ(writer.text(), file->setQualities[0]->toJson().dump(indent));
+    }
+}
+
+TEST(JsonWriter, NumbersAndStrings) {
+    const nlohmann::json values = {0.1, 1e-7, 1e21, 123456789.125, -0.0, 5e-324, 1.7976931348623157e308,
+                                   std::numeric_limits<double>::quiet_NaN(), INFINITY,
+                                   std::numeric_limits<int64_t>::min(), std::numeric_limits<uint64_t>::max(),
+                                   "quote \" backslash \\ tab \t newline \n bell \x07 ünï", "", nullptr,
+                                   true, nlohmann::json::object(), nlohmann::json::array()};
+    for (int indent : {-1, 2}) {
+        EXPECT_EQ(written(values, indent), values.dump(indent));
+        for (const auto& value : values) {
+            EXPECT_EQ(written(value, indent), value.dump(indent)) << value.dump();
+        }
+    }
+
+    // Typed storage goes through the same number formatting
+    std::vector<double> doubles = {0.1, 1e-7, 1e21, -0.0, 2.5};
+    MetricValue value(doubles);
+    JsonWriter writer(2);
+    writer.write(value);
+    EXPECT_EQ(writer.text(), value.toJson().dump(2));
+}
+
+TEST(JsonWriter, SinkReceivesTheSameText) {
+    auto file = test::sampleFile(20);
+    std::ostringstream out;
+    {
+        JsonWriter writer(out, 2);
+        writer.write(*file);
+        writer.flush();
+    }
+    EXPECT_EQ(out.str(), file->toJson().dump(2));
+}
+
+TEST(JsonWriter, DepthOffsetsIndentation) {
+    auto file = test::sampleFile(1);
+    const auto& metric = *file->runQualities[0]->metrics[0];
+    JsonWriter writer(2, 3);
+    writer.write(metric);
+    nlohmann::json wrapped = {{"a", {{"b", {{"c", metric.toJson()}}}}}};
+    const std::string whole = wrapped.dump(2);
+    EXPECT_NE(whole.find(writer.text()), std::string::npos);
+}
@@ -0,0 +1,203 @@
+// Build-time generator of the constexpr term table included by mzqc_cv.hpp.
+//
+//   mzqc_cvgen <qc-cv.obo> <mzqc_cv_terms.inc>
+//
+// Kept free of the library so the library can include its output.
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Term {
+    std::string accession;
+    std::string name;
+    std::string unit;
+    std::string valueType;
+    std::vector<std::string> parents;
+};
+
+std::string trim(const std::string& text) {
+    size_t first = text.find_first_not_of(" \t");
+    if (first == std::string::npos) return std::string();
+    size_t last = text.find_last_not_of(" \t\r");
+    return text.substr(first, last - first + 1);
+}
+
+// Drop a trailing "! comment" from a tag value
+std::string stripComment(const std::string& value) {
+    size_t bang = value.find(" !");
+    return trim(bang == std::string::npos ? value : value.substr(0, bang));
+}
+
+bool tag(const std::string& line, const char* name, std::string& value) {
+    const size_t size = std::char_traits<char>::length(name);
+    if (line.compare(0, size, name) != 0) return false;
+    value = line.substr(size);
+    return true;
+}
+
+bool readObo(const std::string& path, std::vector<Term>& terms) {
+    std::ifstream in(path);
+    if (!in) return false;
+    Term current;
+    bool inTerm = false;
+    auto finish = [&]() {
+        if (inTerm && !current.accession.empty()) terms.push_back(std::move(current));
+        current = Term();
+    };
+
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty() || line[0] == '!') continue;
+        if (line[0] == '[') {
+            finish();
+            inTerm = line == "[Term]";
+            continue;
+        }
+        if (!inTerm) continue;
+
+        std::string value;
+        if (tag(line, "id:", value)) {
+            current.accession = trim(value);
+        } else if (tag(line, "name:", value)) {
+            current.name = trim(value);
+        } else if (tag(line, "is_a:", value)) {
+            current.parents.push_back(stripComment(value));
+        } else if (tag(line, "relationship: has_units ", value)) {
+            if (current.unit.empty()) current.unit = stripComment(value);
+        } else if (tag(line, "xref: value-type:", value)) {
+            // e.g. xref: value-type:xsd\:double "The allowed value-type for this CV term."
+            std::string type = value.substr(0, value.find(' '));
+            size_t escape = type.find("\\:");
+            if (escape != std::string::npos) type.erase(escape, 1);
+            current.valueType = type;
+        }
+    }
+    finish();
+    return true;
+}
+
+std::string quote(const std::string& text) {
+    std::string out = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out + '"';
+}
+
+// Accessions become type names, MS:4000053 -> MS_4000053
+bool identifier(const std::string& accession, std::string& name) {
+    name = accession;
+    std::replace(name.begin(), name.end(), ':', '_');
+    if (name.empty() || !(std::isalpha(static_cast<unsigned char>(name[0])) || name[0] == '_')) return false;
+    return std::all_of(name.begin(), name.end(),
+                       [](char c) { return std::isalnum(static_cast<unsigned char>(c)) || c == '_'; });
+}
+
+// Value shape terms of the QC CV, see CvValueShape
+const std::pair<const char*, const char*> shapeTerms[] = {
+    {"MS:4000003", "SingleValue"},
+    {"MS:4000004", "Tuple"},
+    {"MS:4000006", "Table"},
+    {"MS:4000007", "Matrix"},
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " <obo file> <output file>" << std::endl;
+        return 2;
+    }
+    std::vector<Term> terms;
+    if (!readObo(argv[1], terms)) {
+        std::cerr << "Could not open file: " << argv[1] << std::endl;
+        return 1;
+    }
+    std::sort(terms.begin(), terms.end(),
+              [](const Term& a, const Term& b) { return a.accession < b.accession; });
+    terms.erase(std::unique(terms.begin(), terms.end(),
+                            [](const Term& a, const Term& b) { return a.accession == b.accession; }),
+                terms.end());
+
+    std::map<std::string, uint32_t> ids;
+    for (uint32_t id = 0; id < terms.size(); ++id) ids[terms[id].accession] = id;
+
+    // Transitive is_a closure including the term itself; parents outside
+    // this file (PSI-MS, UO, STATO) are dropped
+    std::vector<std::set<uint32_t>> ancestors(terms.size());
+    std::vector<int> state(terms.size(), 0);
+    auto close = [&](auto& self, uint32_t id) -> void {
+        if (state[id] != 0) return;
+        state[id] = 1;
+        ancestors[id].insert(id);
+        for (const auto& parent : terms[id].parents) {
+            auto it = ids.find(parent);
+            if (it == ids.end() || state[it->second] == 1) continue;
+            self(self, it->second);
+            ancestors[id].insert(ancestors[it->second].begin(), ancestors[it->second].end());
+        }
+        state[id] = 2;
+    };
+    for (uint32_t id = 0; id < terms.size(); ++id) close(close, id);
+
+    std::ostringstream out;
+    out << "// Generated by mzqc_cvgen from " << argv[1] << ", do not edit\n"
+        << "// Included by mzqc_cv.hpp\n\n"
+        << "namespace mzqc {\nnamespace cv {\n\n"
+        << "inline constexpr uint32_t termCount = " << terms.size() << ";\n\n";
+
+    std::vector<uint32_t> ancestorIds;
+    out << "inline constexpr CvTermInfo terms[] = {\n";
+    for (uint32_t id = 0; id < terms.size(); ++id) {
+        const Term& term = terms[id];
+        const char* shape = "None";
+        // Only metrics have a shape, not the shape terms themselves
+        for (const auto& [accession, name] : shapeTerms) {
+            auto it = ids.find(accession);
+            if (it != ids.end() && it->second != id && ancestors[id].count(it->second)) shape = name;
+        }
+        const char* valueType = term.valueType == "xsd:int"      ? "Integer"
+                                : term.valueType == "xsd:double" ? "Double"
+                                                                 : "Any";
+        out << "    {" << quote(term.accession) << ", " << quote(term.name) << ", " << quote(term.unit)
+            << ", CvValueShape::" << shape << ", CvValueType::" << valueType << ", " << ancestorIds.size() << ", "
+            << ancestors[id].size() << "},\n";
+        ancestorIds.insert(ancestorIds.end(), ancestors[id].begin(), ancestors[id].end());
+    }
+    out << "};\n\n";
+
+    out << "// Sorted ancestors of each term, see CvTermInfo::firstAncestor\n"
+        << "inline constexpr uint32_t ancestorIds[] = {";
+    for (size_t i = 0; i < ancestorIds.size(); ++i) {
+        out << (i % 16 == 0 ? "\n    " : " ") << ancestorIds[i] << ',';
+    }
+    out << "\n};\n\n";
+
+    for (uint32_t id = 0; id < terms.size(); ++id) {
+        std::string name;
+        if (identifier(terms[id].accession, name)) {
+            out << "using " << name << " = CvTerm<" << id << ">; // " << terms[id].name << '\n';
+        }
+    }
+    out << "\n} // namespace cv\n} // namespace mzqc\n";
+
+    std::ofstream file(argv[2], std::ios::binary);
+    file << out.str();
+    if (!file) {
+        std::cerr << "Could not write file: " << argv[2] << std::endl;
+        return 1;
+    }
+    return 0;
+}